@@ -4,17 +4,15 @@
 #include <vector>
 #include <unordered_map>
 #include <cstring>
+#include <cstdlib>
 #include <limits>
-
-struct Vertex {
-    float px, py, pz;
-    float nx, ny, nz;
-    float tx, ty;
-
-    bool operator==(const Vertex& other) const {
-        return memcmp(this, &other, sizeof(Vertex)) == 0;
-    }
-};
+#include <algorithm>
+#include <cmath>
+#include "mesh_types.h"
+#include "mesh_simplify.h"
+#include "mesh_optimize.h"
+#include "mesh_meshlets.h"
+#include "mesh_format.h"
 
 struct VertexHash {
     size_t operator()(const Vertex& v) const {
@@ -27,23 +25,60 @@ struct VertexHash {
     }
 };
 
-struct AABB {
-    float minX, minY, minZ;
-    float maxX, maxY, maxZ;
-};
-
-struct MeshFileHeader {
-    uint32_t vertexCount;
-    uint32_t indexCount;
-    AABB localAABB;
-};
+static uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    // UVs don't need denormals, flush them to zero.
+    if (exponent <= 0) return sign;
+    if (exponent >= 31) return sign | 0x7C00;
+    uint16_t half = (uint16_t)(sign | (exponent << 10) | (mantissa >> 13));
+    // Round to nearest, a carry out of the mantissa correctly bumps the exponent.
+    if (mantissa & 0x1000) ++half;
+    return half;
+}
+
+static uint32_t packSnorm10(float value) {
+    int32_t quantized = (int32_t)std::round(std::clamp(value, -1.0f, 1.0f) * 511.0f);
+    return (uint32_t)quantized & 0x3FF;
+}
+
+static uint16_t quantizeUnorm16(float value, float min, float max) {
+    float range = max - min;
+    if (range <= 0.0f) return 0;
+    return (uint16_t)std::round(std::clamp((value - min) / range, 0.0f, 1.0f) * 65535.0f);
+}
+
+static CompactVertex compactVertex(const Vertex& v, const AABB& aabb) {
+    CompactVertex compact = {};
+    compact.position[0] = quantizeUnorm16(v.px, aabb.minX, aabb.maxX);
+    compact.position[1] = quantizeUnorm16(v.py, aabb.minY, aabb.maxY);
+    compact.position[2] = quantizeUnorm16(v.pz, aabb.minZ, aabb.maxZ);
+    compact.normal = packSnorm10(v.nx) | (packSnorm10(v.ny) << 10) | (packSnorm10(v.nz) << 20);
+    compact.uv[0] = floatToHalf(v.tx);
+    compact.uv[1] = floatToHalf(v.ty);
+    return compact;
+}
 
 int main(int argc, char** argv) {
     if (argc < 3) {
-        printf("Usage: mesh_converter input.obj output.mesh\n");
+        printf("Usage: mesh_converter input.obj output.mesh [--lods N] [--compact]\n");
         return 1;
     }
 
+    uint32_t maxLods = MAX_MESH_LODS;
+    bool compact = false;
+    for (int i = 3; i < argc; ++i) {
+        if (strcmp(argv[i], "--lods") == 0 && i + 1 < argc) {
+            maxLods = std::clamp((uint32_t)atoi(argv[++i]), 1u, MAX_MESH_LODS);
+        } else if (strcmp(argv[i], "--compact") == 0) {
+            // Not for the skybox, its shader uses the positions without a model matrix.
+            compact = true;
+        }
+    }
+
     tinyobj::ObjReader reader;
     if (!reader.ParseFromFile(argv[1])) {
         printf("Failed to parse %s: %s\n", argv[1], reader.Error().c_str());
@@ -112,19 +147,83 @@ int main(int argc, char** argv) {
         }
     }
 
-    MeshFileHeader header;
+    // Every LOD is simplified from LOD0 rather than the previous level so errors don't compound.
+    // Generation stops early once a level no longer removes a meaningful amount of triangles.
+    std::vector<std::vector<uint32_t>> lodIndices = {indices};
+    std::vector<float> lodErrors = {0.0f};
+    for (uint32_t lod = 1; lod < maxLods; ++lod) {
+        size_t target = (indices.size() >> lod) / 3 * 3;
+        float error = 0.0f;
+        std::vector<uint32_t> simplified = simplifyMesh(vertices, indices, target, error);
+        if (simplified.empty() || simplified.size() > lodIndices.back().size() * 9 / 10) break;
+        lodIndices.push_back(std::move(simplified));
+        lodErrors.push_back(std::max(error, lodErrors.back()));
+    }
+
+    // Each LOD gets its own cache and overdraw order, the shared vertex buffer then follows LOD0's first use.
+    std::vector<VertexCacheStats> statsBefore;
+    std::vector<std::vector<uint32_t>*> indexRanges;
+    for (std::vector<uint32_t>& lod : lodIndices) {
+        statsBefore.push_back(analyzeVertexCache(lod.data(), lod.size(), vertices.size()));
+        optimizeVertexCache(lod.data(), lod.size(), vertices.size());
+        optimizeOverdraw(lod.data(), lod.size(), vertices);
+        indexRanges.push_back(&lod);
+    }
+    optimizeVertexFetch(vertices, indexRanges);
+    // LOD0 is at offset 0, so meshlet offsets double as offsets into the file's index data.
+    std::vector<Meshlet> meshlets = buildMeshlets(vertices, lodIndices[0]);
+
+    MeshFileHeader header = {};
+    header.magic = MESH_FILE_MAGIC;
+    header.version = MESH_FILE_VERSION;
     header.vertexCount = (uint32_t)vertices.size();
-    header.indexCount = (uint32_t)indices.size();
     header.localAABB = aabb;
+    header.lodCount = (uint32_t)lodIndices.size();
+    header.vertexFormat = compact ? MeshVertexFormat::Compact : MeshVertexFormat::Float;
+    header.indexSize = vertices.size() <= 65536 ? sizeof(uint16_t) : sizeof(uint32_t);
+    header.meshletCount = (uint32_t)meshlets.size();
+    uint32_t indexOffset = 0;
+    for (uint32_t lod = 0; lod < header.lodCount; ++lod) {
+        header.lods[lod].indexOffset = indexOffset;
+        header.lods[lod].indexCount = (uint32_t)lodIndices[lod].size();
+        header.lods[lod].error = lodErrors[lod];
+        indexOffset += header.lods[lod].indexCount;
+    }
+    header.indexCount = indexOffset;
 
     FILE* out = fopen(argv[2], "wb");
+    if (!out) {
+        printf("Failed to open %s for writing\n", argv[2]);
+        return 1;
+    }
     fwrite(&header, sizeof(MeshFileHeader), 1, out);
-    fwrite(vertices.data(), sizeof(Vertex), vertices.size(), out);
-    fwrite(indices.data(), sizeof(uint32_t), indices.size(), out);
+    if (compact) {
+        std::vector<CompactVertex> compactVertices(vertices.size());
+        for (size_t v = 0; v < vertices.size(); ++v) compactVertices[v] = compactVertex(vertices[v], aabb);
+        fwrite(compactVertices.data(), sizeof(CompactVertex), compactVertices.size(), out);
+    } else {
+        fwrite(vertices.data(), sizeof(Vertex), vertices.size(), out);
+    }
+    for (const std::vector<uint32_t>& lod : lodIndices) {
+        if (header.indexSize == sizeof(uint16_t)) {
+            std::vector<uint16_t> narrow(lod.begin(), lod.end());
+            fwrite(narrow.data(), sizeof(uint16_t), narrow.size(), out);
+        } else {
+            fwrite(lod.data(), sizeof(uint32_t), lod.size(), out);
+        }
+    }
+    fwrite(meshlets.data(), sizeof(Meshlet), meshlets.size(), out);
     fclose(out);
 
-    printf("Converted: %u unique verts, %u indices\n",
-           header.vertexCount, header.indexCount);
+    printf("Converted: %u unique verts (%zu bytes each), %u indices (%u bytes each)\n",
+           header.vertexCount, compact ? sizeof(CompactVertex) : sizeof(Vertex), header.indexCount, header.indexSize);
+    printf("  %u meshlets\n", header.meshletCount);
+    for (uint32_t lod = 0; lod < header.lodCount; ++lod) {
+        VertexCacheStats after = analyzeVertexCache(lodIndices[lod].data(), lodIndices[lod].size(), vertices.size());
+        printf("  LOD%u: %u triangles, error %f, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", lod,
+               header.lods[lod].indexCount / 3, header.lods[lod].error,
+               statsBefore[lod].acmr, after.acmr, statsBefore[lod].atvr, after.atvr);
+    }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,97 @@
+#include "mesh_meshlets.h"
+#include <algorithm>
+#include <cmath>
+
+static void computeMeshletBounds(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, Meshlet& meshlet) {
+    float minP[3] = {INFINITY, INFINITY, INFINITY};
+    float maxP[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (uint32_t i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; ++i) {
+        const Vertex& v = vertices[indices[i]];
+        const float p[3] = {v.px, v.py, v.pz};
+        for (int k = 0; k < 3; ++k) {
+            minP[k] = std::min(minP[k], p[k]);
+            maxP[k] = std::max(maxP[k], p[k]);
+        }
+    }
+
+    float radiusSq = 0.0f;
+    for (int k = 0; k < 3; ++k) meshlet.center[k] = (minP[k] + maxP[k]) * 0.5f;
+    for (uint32_t i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; ++i) {
+        const Vertex& v = vertices[indices[i]];
+        float dx = v.px - meshlet.center[0];
+        float dy = v.py - meshlet.center[1];
+        float dz = v.pz - meshlet.center[2];
+        radiusSq = std::max(radiusSq, dx * dx + dy * dy + dz * dz);
+    }
+    meshlet.radius = std::sqrt(radiusSq);
+
+    // Cone from the face normals as wound, which is what back face culling uses, not the vertex normals.
+    std::vector<float> normals;
+    normals.reserve(meshlet.indexCount);
+    float axis[3] = {0.0f, 0.0f, 0.0f};
+    for (uint32_t i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; i += 3) {
+        const Vertex& a = vertices[indices[i]];
+        const Vertex& b = vertices[indices[i + 1]];
+        const Vertex& c = vertices[indices[i + 2]];
+        float e1[3] = {b.px - a.px, b.py - a.py, b.pz - a.pz};
+        float e2[3] = {c.px - a.px, c.py - a.py, c.pz - a.pz};
+        float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length <= 0.0f) continue;
+        for (int k = 0; k < 3; ++k) {
+            n[k] /= length;
+            axis[k] += n[k];
+            normals.push_back(n[k]);
+        }
+    }
+
+    float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    meshlet.coneAxis[0] = 0.0f;
+    meshlet.coneAxis[1] = 0.0f;
+    meshlet.coneAxis[2] = 1.0f;
+    meshlet.coneCutoff = 1.0f;
+    if (axisLength <= 0.0f) return;
+    for (int k = 0; k < 3; ++k) meshlet.coneAxis[k] = axis[k] / axisLength;
+
+    float minDot = 1.0f;
+    for (size_t i = 0; i < normals.size(); i += 3) {
+        float d = normals[i] * meshlet.coneAxis[0] + normals[i + 1] * meshlet.coneAxis[1] + normals[i + 2] * meshlet.coneAxis[2];
+        minDot = std::min(minDot, d);
+    }
+    // Past 90 degrees there's no direction from which every triangle is back facing.
+    if (minDot <= 0.0f) return;
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+std::vector<Meshlet> buildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> usedBy(vertices.size(), UINT32_MAX);
+    uint32_t vertexCount = 0;
+
+    for (uint32_t i = 0; i + 2 < indices.size(); i += 3) {
+        uint32_t newVertices = 0;
+        if (!meshlets.empty()) {
+            uint32_t current = (uint32_t)meshlets.size() - 1;
+            for (int k = 0; k < 3; ++k) newVertices += usedBy[indices[i + k]] != current ? 1 : 0;
+        }
+
+        if (meshlets.empty() || vertexCount + newVertices > MAX_MESHLET_VERTICES ||
+            meshlets.back().indexCount / 3 >= MAX_MESHLET_TRIANGLES) {
+            meshlets.push_back(Meshlet{});
+            meshlets.back().indexOffset = i;
+            vertexCount = 0;
+        }
+
+        uint32_t current = (uint32_t)meshlets.size() - 1;
+        for (int k = 0; k < 3; ++k) {
+            if (usedBy[indices[i + k]] != current) {
+                usedBy[indices[i + k]] = current;
+                ++vertexCount;
+            }
+        }
+        meshlets.back().indexCount += 3;
+    }
+
+    for (Meshlet& meshlet : meshlets) computeMeshletBounds(vertices, indices, meshlet);
+    return meshlets;
+}
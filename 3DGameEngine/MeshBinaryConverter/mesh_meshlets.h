@@ -0,0 +1,9 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "mesh_types.h"
+#include "mesh_format.h"
+
+// Greedily cuts the index list into meshlets of at most MAX_MESHLET_VERTICES / MAX_MESHLET_TRIANGLES in its current order,
+// so it should run after the cache optimisation which already keeps neighbouring triangles together.
+std::vector<Meshlet> buildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
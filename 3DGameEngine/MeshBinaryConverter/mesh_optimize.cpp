@@ -0,0 +1,240 @@
+#include "mesh_optimize.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static constexpr int FORSYTH_CACHE_SIZE = 32;
+// Clusters shorter than this are merged into the next one, tiny clusters cost more cache misses than they save overdraw.
+static constexpr size_t MIN_CLUSTER_TRIANGLES = 16;
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+    VertexCacheStats stats = {0.0f, 0.0f};
+    if (indexCount == 0) return stats;
+
+    // A vertex is in the FIFO if fewer than cacheSize misses happened since it was last loaded.
+    std::vector<uint32_t> loadedAt(vertexCount, 0);
+    std::vector<uint8_t> used(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    uint32_t misses = 0;
+    uint32_t uniqueVertices = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        uint32_t v = indices[i];
+        if (time - loadedAt[v] > cacheSize) {
+            loadedAt[v] = time++;
+            ++misses;
+        }
+        if (!used[v]) {
+            used[v] = 1;
+            ++uniqueVertices;
+        }
+    }
+
+    stats.acmr = (float)misses / (float)(indexCount / 3);
+    stats.atvr = (float)misses / (float)uniqueVertices;
+    return stats;
+}
+
+static float forsythVertexScore(int cachePosition, uint32_t remainingTriangles) {
+    if (remainingTriangles == 0) return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        // The last triangle's vertices get a fixed score so the next triangle doesn't just reuse the same edge.
+        if (cachePosition < 3) {
+            score = 0.75f;
+        } else {
+            float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = std::pow(1.0f - (float)(cachePosition - 3) * scale, 1.5f);
+        }
+    }
+    // Favour vertices with few triangles left so they get finished off instead of lingering.
+    score += 2.0f * std::pow((float)remainingTriangles, -0.5f);
+    return score;
+}
+
+void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount) {
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) return;
+
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; ++i) ++remaining[indices[i]];
+
+    std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+    std::vector<uint32_t> adjacency(indexCount);
+    std::vector<uint32_t> cursor(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for (size_t i = 0; i < indexCount; ++i) adjacency[cursor[indices[i]]++] = (uint32_t)(i / 3);
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    int64_t bestTriangle = 0;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        if (triangleScore[t] > triangleScore[bestTriangle]) bestTriangle = (int64_t)t;
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(indexCount);
+    uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+    uint32_t cacheCount = 0;
+    size_t scanCursor = 0;
+
+    while (output.size() < indexCount) {
+        // Nothing in the cache has triangles left, restart from the next untouched triangle.
+        if (bestTriangle < 0) {
+            while (emitted[scanCursor]) ++scanCursor;
+            bestTriangle = (int64_t)scanCursor;
+        }
+
+        const uint32_t* triangle = &indices[bestTriangle * 3];
+        emitted[bestTriangle] = 1;
+        output.insert(output.end(), triangle, triangle + 3);
+
+        for (int i = 0; i < 3; ++i) {
+            uint32_t v = triangle[i];
+            uint32_t* list = &adjacency[adjacencyOffset[v]];
+            for (uint32_t j = 0; j < remaining[v]; ++j) {
+                if (list[j] == (uint32_t)bestTriangle) {
+                    list[j] = list[remaining[v] - 1];
+                    break;
+                }
+            }
+            --remaining[v];
+        }
+
+        // LRU: the triangle's vertices move to the front, everything else shifts back and the tail falls out.
+        uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+        uint32_t newCount = 0;
+        for (int i = 0; i < 3; ++i) newCache[newCount++] = triangle[i];
+        for (uint32_t i = 0; i < cacheCount; ++i) {
+            uint32_t v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) newCache[newCount++] = v;
+        }
+        for (uint32_t i = 0; i < newCount; ++i) cachePosition[newCache[i]] = i < (uint32_t)FORSYTH_CACHE_SIZE ? (int)i : -1;
+        cacheCount = std::min(newCount, (uint32_t)FORSYTH_CACHE_SIZE);
+        memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+
+        for (uint32_t i = 0; i < newCount; ++i) {
+            uint32_t v = newCache[i];
+            float score = forsythVertexScore(cachePosition[v], remaining[v]);
+            float delta = score - vertexScore[v];
+            vertexScore[v] = score;
+            for (uint32_t j = 0; j < remaining[v]; ++j) triangleScore[adjacency[adjacencyOffset[v] + j]] += delta;
+        }
+
+        // Only triangles touching the cache changed score, so the next pick comes from those.
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (uint32_t i = 0; i < cacheCount; ++i) {
+            uint32_t v = cache[i];
+            for (uint32_t j = 0; j < remaining[v]; ++j) {
+                uint32_t t = adjacency[adjacencyOffset[v] + j];
+                if (triangleScore[t] > bestScore) {
+                    bestScore = triangleScore[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+    }
+
+    std::copy(output.begin(), output.end(), indices);
+}
+
+struct TriangleCluster {
+    size_t firstTriangle;
+    size_t triangleCount;
+    float sortKey;
+};
+
+void optimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices) {
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) return;
+
+    // Split wherever all three vertices miss the cache, reordering at those points costs nothing extra.
+    const uint32_t cacheSize = 16;
+    std::vector<uint32_t> loadedAt(vertices.size(), 0);
+    uint32_t time = cacheSize + 1;
+    std::vector<TriangleCluster> clusters;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        int misses = 0;
+        for (int i = 0; i < 3; ++i) {
+            uint32_t v = indices[t * 3 + i];
+            if (time - loadedAt[v] > cacheSize) {
+                loadedAt[v] = time++;
+                ++misses;
+            }
+        }
+        if (clusters.empty() || (misses == 3 && clusters.back().triangleCount >= MIN_CLUSTER_TRIANGLES)) {
+            clusters.push_back(TriangleCluster{t, 0, 0.0f});
+        }
+        ++clusters.back().triangleCount;
+    }
+    if (clusters.size() < 2) return;
+
+    float meshCenter[3] = {0.0f, 0.0f, 0.0f};
+    float meshArea = 0.0f;
+    std::vector<float> clusterData(clusters.size() * 7, 0.0f); // Area weighted centroid, summed area normal, area.
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        float* data = &clusterData[c * 7];
+        for (size_t t = clusters[c].firstTriangle; t < clusters[c].firstTriangle + clusters[c].triangleCount; ++t) {
+            const Vertex& a = vertices[indices[t * 3 + 0]];
+            const Vertex& b = vertices[indices[t * 3 + 1]];
+            const Vertex& d = vertices[indices[t * 3 + 2]];
+            float e1[3] = {b.px - a.px, b.py - a.py, b.pz - a.pz};
+            float e2[3] = {d.px - a.px, d.py - a.py, d.pz - a.pz};
+            float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            float centroid[3] = {(a.px + b.px + d.px) / 3.0f, (a.py + b.py + d.py) / 3.0f, (a.pz + b.pz + d.pz) / 3.0f};
+            for (int i = 0; i < 3; ++i) {
+                data[i] += centroid[i] * area;
+                data[3 + i] += n[i];
+                meshCenter[i] += centroid[i] * area;
+            }
+            data[6] += area;
+            meshArea += area;
+        }
+    }
+    if (meshArea <= 0.0f) return;
+    for (int i = 0; i < 3; ++i) meshCenter[i] /= meshArea;
+
+    // Clusters facing away from the mesh center are on the outside and occlude the rest, draw them first.
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        const float* data = &clusterData[c * 7];
+        float normalLength = std::sqrt(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+        if (data[6] <= 0.0f || normalLength <= 0.0f) continue;
+        float key = 0.0f;
+        for (int i = 0; i < 3; ++i) key += (data[i] / data[6] - meshCenter[i]) * (data[3 + i] / normalLength);
+        clusters[c].sortKey = key;
+    }
+    std::stable_sort(clusters.begin(), clusters.end(),
+                     [](const TriangleCluster& a, const TriangleCluster& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<uint32_t> output;
+    output.reserve(indexCount);
+    for (const TriangleCluster& cluster : clusters) {
+        output.insert(output.end(), indices + cluster.firstTriangle * 3,
+                      indices + (cluster.firstTriangle + cluster.triangleCount) * 3);
+    }
+    std::copy(output.begin(), output.end(), indices);
+}
+
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<std::vector<uint32_t>*>& indexRanges) {
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (std::vector<uint32_t>* range : indexRanges) {
+        for (uint32_t& index : *range) {
+            if (remap[index] == UINT32_MAX) {
+                remap[index] = (uint32_t)reordered.size();
+                reordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+    }
+    vertices.swap(reordered);
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "mesh_types.h"
+
+// Post-transform cache statistics for a FIFO cache of cacheSize entries.
+// ACMR = transformed vertices per triangle, ATVR = transformed vertices per unique vertex (1.0 is ideal).
+struct VertexCacheStats {
+    float acmr;
+    float atvr;
+};
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+
+// Reorders triangles for the post-transform cache (Forsyth's linear speed algorithm).
+void optimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+// Splits the cache-optimised order into clusters at cache restarts and sorts them front to back from the outside in,
+// so from most directions nearer surfaces go first. Keeps triangle order inside each cluster.
+void optimizeOverdraw(uint32_t* indices, size_t indexCount, const std::vector<Vertex>& vertices);
+// Rewrites the vertex buffer in first-use order of the index ranges and remaps the indices. Unused vertices are dropped.
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<std::vector<uint32_t>*>& indexRanges);
@@ -0,0 +1,239 @@
+#include "mesh_simplify.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+// Symmetric 4x4 matrix stored as its upper triangle: a00 a01 a02 a03 a11 a12 a13 a22 a23 a33.
+struct Quadric {
+    double m[10] = {};
+
+    void addPlane(double a, double b, double c, double d) {
+        m[0] += a * a; m[1] += a * b; m[2] += a * c; m[3] += a * d;
+        m[4] += b * b; m[5] += b * c; m[6] += b * d;
+        m[7] += c * c; m[8] += c * d;
+        m[9] += d * d;
+    }
+
+    void add(const Quadric& other) {
+        for (int i = 0; i < 10; ++i) m[i] += other.m[i];
+    }
+
+    double evaluate(double x, double y, double z) const {
+        return m[0] * x * x + 2.0 * m[1] * x * y + 2.0 * m[2] * x * z + 2.0 * m[3] * x +
+               m[4] * y * y + 2.0 * m[5] * y * z + 2.0 * m[6] * y +
+               m[7] * z * z + 2.0 * m[8] * z +
+               m[9];
+    }
+};
+
+struct CollapseCandidate {
+    double cost;
+    uint32_t from;
+    uint32_t to;
+    uint32_t fromVersion;
+    uint32_t toVersion;
+
+    bool operator>(const CollapseCandidate& other) const {
+        return cost > other.cost;
+    }
+};
+
+struct PositionHash {
+    size_t operator()(const uint64_t& key) const {
+        return (size_t)(key ^ (key >> 29) ^ (key >> 41));
+    }
+};
+
+static uint64_t positionKey(const Vertex& v) {
+    uint32_t bits[3];
+    memcpy(bits, &v.px, sizeof(bits));
+    return ((uint64_t)bits[0] * 73856093ull) ^ ((uint64_t)bits[1] * 19349663ull << 16) ^ ((uint64_t)bits[2] * 83492791ull << 32);
+}
+
+static void triangleNormal(const Vertex& a, const Vertex& b, const Vertex& c, double n[3]) {
+    double e1[3] = {b.px - a.px, b.py - a.py, b.pz - a.pz};
+    double e2[3] = {c.px - a.px, c.py - a.py, c.pz - a.pz};
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                   size_t targetIndexCount, float& error) {
+    const uint32_t vertexCount = (uint32_t)vertices.size();
+    const uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+
+    // Weld by position. Several vertices at one position means an attribute seam, those are locked.
+    std::vector<uint32_t> positionId(vertexCount);
+    std::vector<uint32_t> positionUses;
+    std::unordered_map<uint64_t, std::vector<uint32_t>, PositionHash> positionBuckets;
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        std::vector<uint32_t>& bucket = positionBuckets[positionKey(vertices[v])];
+        uint32_t id = UINT32_MAX;
+        for (uint32_t other : bucket) {
+            const Vertex& o = vertices[other];
+            if (o.px == vertices[v].px && o.py == vertices[v].py && o.pz == vertices[v].pz) {
+                id = positionId[other];
+                break;
+            }
+        }
+        if (id == UINT32_MAX) {
+            id = (uint32_t)positionUses.size();
+            positionUses.push_back(0);
+        }
+        bucket.push_back(v);
+        positionId[v] = id;
+        ++positionUses[id];
+    }
+
+    std::vector<uint8_t> positionLocked(positionUses.size(), 0);
+    for (size_t p = 0; p < positionUses.size(); ++p) {
+        if (positionUses[p] > 1) positionLocked[p] = 1;
+    }
+
+    // Edges used by a single triangle are open borders, collapsing them would eat into the silhouette.
+    std::unordered_map<uint64_t, uint32_t> edgeUses;
+    for (uint32_t t = 0; t < triangleCount; ++t) {
+        for (int e = 0; e < 3; ++e) {
+            uint32_t a = positionId[indices[t * 3 + e]];
+            uint32_t b = positionId[indices[t * 3 + (e + 1) % 3]];
+            uint64_t key = a < b ? ((uint64_t)a << 32 | b) : ((uint64_t)b << 32 | a);
+            ++edgeUses[key];
+        }
+    }
+    for (const auto& [key, uses] : edgeUses) {
+        if (uses == 1) {
+            positionLocked[key >> 32] = 1;
+            positionLocked[key & 0xFFFFFFFF] = 1;
+        }
+    }
+
+    std::vector<uint32_t> triangles(indices.begin(), indices.begin() + triangleCount * 3);
+    std::vector<uint8_t> triangleAlive(triangleCount, 1);
+    std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+    std::vector<Quadric> quadrics(vertexCount);
+
+    for (uint32_t t = 0; t < triangleCount; ++t) {
+        const Vertex& a = vertices[triangles[t * 3 + 0]];
+        const Vertex& b = vertices[triangles[t * 3 + 1]];
+        const Vertex& c = vertices[triangles[t * 3 + 2]];
+        double n[3];
+        triangleNormal(a, b, c, n);
+        double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        for (int i = 0; i < 3; ++i) vertexTriangles[triangles[t * 3 + i]].push_back(t);
+        if (length <= 0.0) continue;
+        n[0] /= length;
+        n[1] /= length;
+        n[2] /= length;
+        double d = -(n[0] * a.px + n[1] * a.py + n[2] * a.pz);
+        // Unweighted planes keep the cost in squared distance units, so sqrt(cost) is a usable error bound.
+        for (int i = 0; i < 3; ++i) quadrics[triangles[t * 3 + i]].addPlane(n[0], n[1], n[2], d);
+    }
+
+    std::vector<uint32_t> version(vertexCount, 0);
+    std::vector<uint8_t> removed(vertexCount, 0);
+    std::priority_queue<CollapseCandidate, std::vector<CollapseCandidate>, std::greater<CollapseCandidate>> queue;
+
+    auto pushCandidate = [&](uint32_t from, uint32_t to) {
+        if (positionLocked[positionId[from]]) return;
+        Quadric q = quadrics[from];
+        q.add(quadrics[to]);
+        const Vertex& target = vertices[to];
+        double cost = std::max(q.evaluate(target.px, target.py, target.pz), 0.0);
+        queue.push(CollapseCandidate{cost, from, to, version[from], version[to]});
+    };
+
+    for (uint32_t t = 0; t < triangleCount; ++t) {
+        for (int e = 0; e < 3; ++e) {
+            pushCandidate(triangles[t * 3 + e], triangles[t * 3 + (e + 1) % 3]);
+            pushCandidate(triangles[t * 3 + (e + 1) % 3], triangles[t * 3 + e]);
+        }
+    }
+
+    auto triangleHas = [&](uint32_t t, uint32_t v) {
+        return triangles[t * 3] == v || triangles[t * 3 + 1] == v || triangles[t * 3 + 2] == v;
+    };
+
+    size_t liveIndexCount = (size_t)triangleCount * 3;
+    double maxCost = 0.0;
+
+    while (liveIndexCount > targetIndexCount && !queue.empty()) {
+        CollapseCandidate candidate = queue.top();
+        queue.pop();
+        uint32_t u = candidate.from;
+        uint32_t v = candidate.to;
+        if (removed[u] || removed[v] || version[u] != candidate.fromVersion || version[v] != candidate.toVersion) continue;
+
+        // Reject collapses that would flip a remaining triangle of u, or tilt it by more than 60 degrees. A smaller tilt
+        // than a flip can still fold the surface over itself.
+        bool adjacent = false;
+        bool flips = false;
+        for (uint32_t t : vertexTriangles[u]) {
+            if (!triangleAlive[t]) continue;
+            if (triangleHas(t, v)) {
+                adjacent = true;
+                continue;
+            }
+            const Vertex* corners[3];
+            const Vertex* moved[3];
+            for (int i = 0; i < 3; ++i) {
+                corners[i] = &vertices[triangles[t * 3 + i]];
+                moved[i] = triangles[t * 3 + i] == u ? &vertices[v] : corners[i];
+            }
+            double before[3], after[3];
+            triangleNormal(*corners[0], *corners[1], *corners[2], before);
+            triangleNormal(*moved[0], *moved[1], *moved[2], after);
+            double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+            double lengths = std::sqrt((before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) *
+                                       (after[0] * after[0] + after[1] * after[1] + after[2] * after[2]));
+            if (dot <= 0.5 * lengths) {
+                flips = true;
+                break;
+            }
+        }
+        if (!adjacent || flips) continue;
+
+        for (uint32_t t : vertexTriangles[u]) {
+            if (!triangleAlive[t]) continue;
+            if (triangleHas(t, v)) {
+                triangleAlive[t] = 0;
+                liveIndexCount -= 3;
+                continue;
+            }
+            for (int i = 0; i < 3; ++i) {
+                if (triangles[t * 3 + i] == u) triangles[t * 3 + i] = v;
+            }
+            vertexTriangles[v].push_back(t);
+        }
+        vertexTriangles[u].clear();
+        removed[u] = 1;
+        quadrics[v].add(quadrics[u]);
+        maxCost = std::max(maxCost, candidate.cost);
+
+        // Every candidate touching v is stale now, the version bump drops them and they get pushed again.
+        ++version[v];
+        std::vector<uint32_t>& around = vertexTriangles[v];
+        around.erase(std::remove_if(around.begin(), around.end(), [&](uint32_t t) { return !triangleAlive[t]; }), around.end());
+        for (uint32_t t : around) {
+            for (int i = 0; i < 3; ++i) {
+                uint32_t w = triangles[t * 3 + i];
+                if (w == v) continue;
+                pushCandidate(v, w);
+                pushCandidate(w, v);
+            }
+        }
+    }
+
+    std::vector<uint32_t> result;
+    result.reserve(liveIndexCount);
+    for (uint32_t t = 0; t < triangleCount; ++t) {
+        if (!triangleAlive[t]) continue;
+        result.push_back(triangles[t * 3 + 0]);
+        result.push_back(triangles[t * 3 + 1]);
+        result.push_back(triangles[t * 3 + 2]);
+    }
+
+    error = (float)std::sqrt(maxCost);
+    return result;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "mesh_types.h"
+
+// Quadric error metric edge collapse. Vertices are never moved or created, an index list for the simplified mesh is
+// returned that still points into the original vertex array. Attribute seams and open borders are locked.
+// error receives the object space error of the worst collapse.
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                   size_t targetIndexCount, float& error);
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+struct Vertex {
+    float px, py, pz;
+    float nx, ny, nz;
+    float tx, ty;
+
+    bool operator==(const Vertex& other) const {
+        return memcmp(this, &other, sizeof(Vertex)) == 0;
+    }
+};
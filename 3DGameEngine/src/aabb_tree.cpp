@@ -0,0 +1,410 @@
+#include "aabb_tree.h"
+#include "render_system.h"
+#include <algorithm>
+
+static inline bool isLeaf(const AABBTreeNode& node) {
+    return node.left == INVALID_INDEX;
+}
+
+static inline AABB combine(const AABB& a, const AABB& b) {
+    return AABB{std::min(a.minX, b.minX), std::min(a.minY, b.minY), std::min(a.minZ, b.minZ),
+                std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY), std::max(a.maxZ, b.maxZ)};
+}
+
+static inline float surfaceArea(const AABB& box) {
+    float dx = box.maxX - box.minX;
+    float dy = box.maxY - box.minY;
+    float dz = box.maxZ - box.minZ;
+    return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+static inline bool contains(const AABB& outer, const AABB& inner) {
+    return outer.minX <= inner.minX && outer.minY <= inner.minY && outer.minZ <= inner.minZ &&
+           outer.maxX >= inner.maxX && outer.maxY >= inner.maxY && outer.maxZ >= inner.maxZ;
+}
+
+static uint32_t allocateNode(AABBTree& tree) {
+    uint32_t index = tree.freeList;
+    AABBTreeNode& node = tree.nodes[index];
+    tree.freeList = node.parent;
+    node.parent = INVALID_INDEX;
+    node.left = INVALID_INDEX;
+    node.right = INVALID_INDEX;
+    node.entity = INVALID_INDEX;
+    node.height = 0;
+    return index;
+}
+
+static void freeNode(AABBTree& tree, uint32_t index) {
+    tree.nodes[index].parent = tree.freeList;
+    tree.nodes[index].height = -1;
+    tree.freeList = index;
+}
+
+static void refit(AABBTree& tree, uint32_t index) {
+    AABBTreeNode& node = tree.nodes[index];
+    const AABBTreeNode& left = tree.nodes[node.left];
+    const AABBTreeNode& right = tree.nodes[node.right];
+    node.bounds = combine(left.bounds, right.bounds);
+    node.height = 1 + std::max(left.height, right.height);
+}
+
+// Performs a left or right rotation if node A is imbalanced, returns the new root of the subtree.
+static uint32_t balance(AABBTree& tree, uint32_t iA) {
+    AABBTreeNode* nodes = tree.nodes;
+    AABBTreeNode& A = nodes[iA];
+    if (isLeaf(A) || A.height < 2) return iA;
+
+    uint32_t iB = A.left;
+    uint32_t iC = A.right;
+    AABBTreeNode& B = nodes[iB];
+    AABBTreeNode& C = nodes[iC];
+    int32_t heightDifference = C.height - B.height;
+
+    // Rotate C up
+    if (heightDifference > 1) {
+        uint32_t iF = C.left;
+        uint32_t iG = C.right;
+        AABBTreeNode& F = nodes[iF];
+        AABBTreeNode& G = nodes[iG];
+
+        C.left = iA;
+        C.parent = A.parent;
+        A.parent = iC;
+
+        if (C.parent != INVALID_INDEX) {
+            if (nodes[C.parent].left == iA) nodes[C.parent].left = iC;
+            else nodes[C.parent].right = iC;
+        } else {
+            tree.root = iC;
+        }
+
+        if (F.height > G.height) {
+            C.right = iF;
+            A.right = iG;
+            G.parent = iA;
+        } else {
+            C.right = iG;
+            A.right = iF;
+            F.parent = iA;
+        }
+        refit(tree, iA);
+        refit(tree, iC);
+        return iC;
+    }
+
+    // Rotate B up
+    if (heightDifference < -1) {
+        uint32_t iD = B.left;
+        uint32_t iE = B.right;
+        AABBTreeNode& D = nodes[iD];
+        AABBTreeNode& E = nodes[iE];
+
+        B.left = iA;
+        B.parent = A.parent;
+        A.parent = iB;
+
+        if (B.parent != INVALID_INDEX) {
+            if (nodes[B.parent].left == iA) nodes[B.parent].left = iB;
+            else nodes[B.parent].right = iB;
+        } else {
+            tree.root = iB;
+        }
+
+        if (D.height > E.height) {
+            B.right = iD;
+            A.left = iE;
+            E.parent = iA;
+        } else {
+            B.right = iE;
+            A.left = iD;
+            D.parent = iA;
+        }
+        refit(tree, iA);
+        refit(tree, iB);
+        return iB;
+    }
+
+    return iA;
+}
+
+// A rotation only moves a subtree one level, so the node it pushed down is balanced again until nothing rotates.
+static uint32_t rebalance(AABBTree& tree, uint32_t index) {
+    uint32_t top = balance(tree, index);
+    if (top != index) {
+        rebalance(tree, index);
+        refit(tree, top);
+    }
+    return top;
+}
+
+static void refitAncestors(AABBTree& tree, uint32_t index) {
+    while (index != INVALID_INDEX) {
+        index = rebalance(tree, index);
+        refit(tree, index);
+        index = tree.nodes[index].parent;
+    }
+}
+
+static void insertLeaf(AABBTree& tree, uint32_t leaf) {
+    AABBTreeNode* nodes = tree.nodes;
+    if (tree.root == INVALID_INDEX) {
+        tree.root = leaf;
+        nodes[leaf].parent = INVALID_INDEX;
+        return;
+    }
+
+    // Walk down picking the child with the cheapest surface area increase.
+    const AABB leafBounds = nodes[leaf].bounds;
+    uint32_t index = tree.root;
+    while (!isLeaf(nodes[index])) {
+        const AABBTreeNode& node = nodes[index];
+        float area = surfaceArea(node.bounds);
+        float combinedArea = surfaceArea(combine(node.bounds, leafBounds));
+
+        float cost = 2.0f * combinedArea;
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        const AABBTreeNode& left = nodes[node.left];
+        float costLeft = surfaceArea(combine(leafBounds, left.bounds)) + inheritanceCost;
+        if (!isLeaf(left)) costLeft -= surfaceArea(left.bounds);
+
+        const AABBTreeNode& right = nodes[node.right];
+        float costRight = surfaceArea(combine(leafBounds, right.bounds)) + inheritanceCost;
+        if (!isLeaf(right)) costRight -= surfaceArea(right.bounds);
+
+        if (cost < costLeft && cost < costRight) break;
+        index = costLeft < costRight ? node.left : node.right;
+    }
+
+    uint32_t sibling = index;
+    uint32_t oldParent = nodes[sibling].parent;
+    uint32_t newParent = allocateNode(tree);
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].bounds = combine(leafBounds, nodes[sibling].bounds);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].left = sibling;
+    nodes[newParent].right = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent != INVALID_INDEX) {
+        if (nodes[oldParent].left == sibling) nodes[oldParent].left = newParent;
+        else nodes[oldParent].right = newParent;
+    } else {
+        tree.root = newParent;
+    }
+
+    // From the new parent itself, the descent can stop above a tall subtree and leave it unbalanced.
+    refitAncestors(tree, newParent);
+}
+
+static void removeLeaf(AABBTree& tree, uint32_t leaf) {
+    AABBTreeNode* nodes = tree.nodes;
+    if (leaf == tree.root) {
+        tree.root = INVALID_INDEX;
+        return;
+    }
+
+    uint32_t parent = nodes[leaf].parent;
+    uint32_t grandParent = nodes[parent].parent;
+    uint32_t sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+    if (grandParent != INVALID_INDEX) {
+        if (nodes[grandParent].left == parent) nodes[grandParent].left = sibling;
+        else nodes[grandParent].right = sibling;
+        nodes[sibling].parent = grandParent;
+        freeNode(tree, parent);
+        refitAncestors(tree, grandParent);
+    } else {
+        tree.root = sibling;
+        nodes[sibling].parent = INVALID_INDEX;
+        freeNode(tree, parent);
+    }
+}
+
+void initAABBTree(AABBTree& tree, uint32_t entityCapacity) {
+    tree.capacity = 2 * entityCapacity;
+    tree.entityCapacity = entityCapacity;
+    tree.arena.init(tree.capacity * sizeof(AABBTreeNode) + entityCapacity * (sizeof(uint32_t) + 2 * sizeof(glm::vec3)) + 64);
+    tree.nodes = (AABBTreeNode*)tree.arena.alloc(tree.capacity * sizeof(AABBTreeNode), alignof(AABBTreeNode));
+    tree.leafOf = (uint32_t*)tree.arena.alloc(entityCapacity * sizeof(uint32_t), alignof(uint32_t));
+    tree.centers = (glm::vec3*)tree.arena.alloc(entityCapacity * sizeof(glm::vec3), alignof(glm::vec3));
+    tree.extents = (glm::vec3*)tree.arena.alloc(entityCapacity * sizeof(glm::vec3), alignof(glm::vec3));
+    for (uint32_t i = 0; i < tree.capacity; ++i) {
+        tree.nodes[i].parent = i + 1 < tree.capacity ? i + 1 : INVALID_INDEX;
+        tree.nodes[i].height = -1;
+    }
+    tree.freeList = 0;
+    tree.root = INVALID_INDEX;
+    tree.proxyCount = 0;
+    std::fill(tree.leafOf, tree.leafOf + entityCapacity, INVALID_INDEX);
+}
+
+void freeAABBTree(AABBTree& tree) {
+    free(tree.arena.base);
+    tree = AABBTree{};
+}
+
+static inline AABB fatBounds(const glm::vec3& center, const glm::vec3& extent) {
+    const float m = AABBTree::margin;
+    return AABB{center.x - extent.x - m, center.y - extent.y - m, center.z - extent.z - m,
+                center.x + extent.x + m, center.y + extent.y + m, center.z + extent.z + m};
+}
+
+uint32_t insertProxy(AABBTree& tree, uint32_t entity, const glm::vec3& center, const glm::vec3& extent) {
+    uint32_t leaf = allocateNode(tree);
+    tree.nodes[leaf].bounds = fatBounds(center, extent);
+    tree.nodes[leaf].entity = entity;
+    insertLeaf(tree, leaf);
+    tree.leafOf[entity] = leaf;
+    tree.centers[entity] = center;
+    tree.extents[entity] = extent;
+    ++tree.proxyCount;
+    return leaf;
+}
+
+void removeProxy(AABBTree& tree, uint32_t entity) {
+    uint32_t leaf = tree.leafOf[entity];
+    if (leaf == INVALID_INDEX) return;
+    removeLeaf(tree, leaf);
+    freeNode(tree, leaf);
+    tree.leafOf[entity] = INVALID_INDEX;
+    --tree.proxyCount;
+}
+
+bool moveProxy(AABBTree& tree, uint32_t entity, const glm::vec3& center, const glm::vec3& extent) {
+    uint32_t leaf = tree.leafOf[entity];
+    tree.centers[entity] = center;
+    tree.extents[entity] = extent;
+    AABB bounds{center.x - extent.x, center.y - extent.y, center.z - extent.z,
+                center.x + extent.x, center.y + extent.y, center.z + extent.z};
+    if (contains(tree.nodes[leaf].bounds, bounds)) return false;
+    removeLeaf(tree, leaf);
+    tree.nodes[leaf].bounds = fatBounds(center, extent);
+    insertLeaf(tree, leaf);
+    return true;
+}
+
+void updateRenderTree(AABBTree& tree, SparseSet<RenderableTag>& renderableSet, SparseSet<TransformComponent>& transformSet,
+                      SparseSet<MeshData>& meshSet, WorldBoundsBuffer& worldBounds) {
+    const SparseSet<RenderableTag>& renderables = renderableSet;
+    const SparseSet<TransformComponent>& transforms = transformSet;
+    const SparseSet<MeshData>& meshes = meshSet;
+    worldBounds.size = renderables.entityCount;
+
+    auto refresh = [&](uint32_t entity) {
+        if (!renderables.hasComponent(entity)) return;
+        glm::vec3 center, extent;
+        computeWorldBounds(transforms.getComponent(entity), meshes.getComponent(entity), center, extent);
+        uint32_t i = renderables.sparse[entity];
+        worldBounds.centerX[i] = center.x;
+        worldBounds.centerY[i] = center.y;
+        worldBounds.centerZ[i] = center.z;
+        worldBounds.extentX[i] = extent.x;
+        worldBounds.extentY[i] = extent.y;
+        worldBounds.extentZ[i] = extent.z;
+        worldBounds.entities[i] = entity;
+        if (tree.leafOf[entity] == INVALID_INDEX) insertProxy(tree, entity, center, extent);
+        else moveProxy(tree, entity, center, extent);
+    };
+    // Removing a renderable marks the sparse block of its ID, which is the only place a removed entity still shows up.
+    for (uint32_t block = 0; block * DIRTY_BLOCK_SIZE < MAX_ENTITIES; ++block) {
+        if (!renderables.isSparseBlockDirty(DIRTY_RENDER_TREE, block)) continue;
+        uint32_t last = std::min((block + 1) * DIRTY_BLOCK_SIZE, (uint32_t)MAX_ENTITIES);
+        for (uint32_t entity = block * DIRTY_BLOCK_SIZE; entity < last; ++entity) {
+            if (tree.leafOf[entity] != INVALID_INDEX && !renderables.hasComponent(entity)) removeProxy(tree, entity);
+        }
+    }
+    // Dense slots that moved need their world bounds rewritten even if the entity itself didn't change.
+    auto refreshDirtyBlocks = [&](const auto& set) {
+        for (uint32_t block = 0; block * DIRTY_BLOCK_SIZE < set.entityCount; ++block) {
+            if (!set.isDenseBlockDirty(DIRTY_RENDER_TREE, block)) continue;
+            uint32_t last = std::min((block + 1) * DIRTY_BLOCK_SIZE, set.entityCount);
+            for (uint32_t i = block * DIRTY_BLOCK_SIZE; i < last; ++i) refresh(set.entities[i]);
+        }
+    };
+    refreshDirtyBlocks(renderables);
+    refreshDirtyBlocks(transforms);
+    refreshDirtyBlocks(meshes);
+
+    renderableSet.clearDirty(DIRTY_RENDER_TREE);
+    transformSet.clearDirty(DIRTY_RENDER_TREE);
+    meshSet.clearDirty(DIRTY_RENDER_TREE);
+}
+
+enum class FrustumTest {
+    Outside,
+    Intersecting,
+    Inside
+};
+
+// Planes the parent was already fully inside of are dropped from the mask, so deeper nodes test fewer planes.
+static FrustumTest classifyBounds(const glm::vec3& center, const glm::vec3& extent, const glm::vec4* frustumPlanes,
+                                  uint8_t& planeMask) {
+    for (int i = 0; i < 6; ++i) {
+        if (!(planeMask & (1u << i))) continue;
+        const glm::vec4& plane = frustumPlanes[i];
+        float r = extent.x * glm::abs(plane.x) + extent.y * glm::abs(plane.y) + extent.z * glm::abs(plane.z);
+        float s = glm::dot(glm::vec3(plane), center) + plane.w;
+        if (s < -r) return FrustumTest::Outside;
+        if (s >= r) planeMask &= ~(1u << i);
+    }
+    return planeMask == 0 ? FrustumTest::Inside : FrustumTest::Intersecting;
+}
+
+static FrustumTest classifyBounds(const AABB& box, const glm::vec4* frustumPlanes, uint8_t& planeMask) {
+    glm::vec3 center((box.minX + box.maxX) * 0.5f, (box.minY + box.maxY) * 0.5f, (box.minZ + box.maxZ) * 0.5f);
+    glm::vec3 extent((box.maxX - box.minX) * 0.5f, (box.maxY - box.minY) * 0.5f, (box.maxZ - box.minZ) * 0.5f);
+    return classifyBounds(center, extent, frustumPlanes, planeMask);
+}
+
+static void appendSubtree(const AABBTree& tree, uint32_t index, VisibleEntityBuffer& visibleEntityBuffer) {
+    uint32_t stack[64];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = index;
+    while (stackSize > 0) {
+        const AABBTreeNode& node = tree.nodes[stack[--stackSize]];
+        if (isLeaf(node)) {
+            visibleEntityBuffer.buffer[visibleEntityBuffer.size++] = node.entity;
+        } else {
+            stack[stackSize++] = node.left;
+            stack[stackSize++] = node.right;
+        }
+    }
+}
+
+void performFrustumCullingTree(const AABBTree& tree, VisibleEntityBuffer& visibleEntityBuffer, const glm::vec4* frustumPlanes) {
+    visibleEntityBuffer.size = 0;
+    if (tree.root == INVALID_INDEX) return;
+
+    // The tree is height balanced, so 64 levels is far more than any leaf count that fits in memory.
+    struct StackEntry {
+        uint32_t node;
+        uint8_t planeMask;
+    };
+    StackEntry stack[64];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = StackEntry{tree.root, 0x3F};
+
+    while (stackSize > 0) {
+        StackEntry entry = stack[--stackSize];
+        const AABBTreeNode& node = tree.nodes[entry.node];
+        FrustumTest result = classifyBounds(node.bounds, frustumPlanes, entry.planeMask);
+        if (result == FrustumTest::Outside) continue;
+        if (result == FrustumTest::Inside) {
+            appendSubtree(tree, entry.node, visibleEntityBuffer);
+            continue;
+        }
+        if (isLeaf(node)) {
+            // The fat bounds straddle a plane, the tight ones decide, same as the linear path would.
+            if (classifyBounds(tree.centers[node.entity], tree.extents[node.entity], frustumPlanes, entry.planeMask) !=
+                FrustumTest::Outside) {
+                visibleEntityBuffer.buffer[visibleEntityBuffer.size++] = node.entity;
+            }
+        } else {
+            stack[stackSize++] = StackEntry{node.left, entry.planeMask};
+            stack[stackSize++] = StackEntry{node.right, entry.planeMask};
+        }
+    }
+}
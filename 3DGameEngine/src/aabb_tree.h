@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "sparse_set.h"
+#include "asset_manager.h"
+
+struct WorldBoundsBuffer;
+struct TransformComponent;
+struct VisibleEntityBuffer;
+
+// Dynamic AABB tree (Box2D style) over the world bounds of renderables.
+// Leaves store a fattened AABB so small movements don't touch the tree.
+struct AABBTreeNode {
+    AABB bounds;
+    uint32_t parent; // Doubles as the next pointer while the node is on the free list.
+    uint32_t left;
+    uint32_t right;
+    uint32_t entity;
+    int32_t height; // -1 when free, 0 for leaves.
+};
+
+struct AABBTree {
+    static constexpr float margin = 0.25f;
+    Arena arena;
+    AABBTreeNode* nodes;
+    uint32_t capacity = 0;
+    uint32_t entityCapacity = 0; // Entity IDs below this can own a leaf.
+    uint32_t root = INVALID_INDEX;
+    uint32_t freeList = INVALID_INDEX;
+    uint32_t* leafOf;
+    // Tight world bounds per entity. Leaves are culled with these, the fat node bounds only prune the walk.
+    glm::vec3* centers;
+    glm::vec3* extents;
+    uint32_t proxyCount = 0;
+};
+
+void initAABBTree(AABBTree& tree, uint32_t entityCapacity);
+void freeAABBTree(AABBTree& tree);
+uint32_t insertProxy(AABBTree& tree, uint32_t entity, const glm::vec3& center, const glm::vec3& extent);
+void removeProxy(AABBTree& tree, uint32_t entity);
+bool moveProxy(AABBTree& tree, uint32_t entity, const glm::vec3& center, const glm::vec3& extent);
+
+// Refreshes the world bounds and leaves of renderables in blocks written since the last call and drops removed ones,
+// so cost follows what changed rather than scene size. Clears the sets' DIRTY_RENDER_TREE bits.
+void updateRenderTree(AABBTree& tree, SparseSet<RenderableTag>& renderableSet, SparseSet<TransformComponent>& transformSet,
+                      SparseSet<MeshData>& meshSet, WorldBoundsBuffer& worldBounds);
+
+// Accepts or rejects whole subtrees against the frustum, so cost follows the visible count rather than scene size.
+void performFrustumCullingTree(const AABBTree& tree, VisibleEntityBuffer& visibleEntities, const glm::vec4* frustumPlanes);
@@ -11,9 +11,27 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include "hot_reload.h"
+#include <chrono>
 
 static constexpr bool LOAD_SCENE_FROM_FILE = false;
 static constexpr const char* SCENE_PATH = "scene.bin";
+// Frames after a reload the new game code is watched for before its rollback point is dropped.
+static constexpr uint32_t RELOAD_GUARD_FRAMES = 120;
+
+static bool isFinite(const glm::vec3& v) {
+    return !glm::any(glm::isnan(v)) && !glm::any(glm::isinf(v));
+}
+
+static bool simulationIsFinite(const ECS& scene) {
+    for (uint32_t i = 0; i < scene.transformSet.entityCount; ++i) {
+        const TransformComponent& transform = scene.transformSet.dense[i];
+        if (!isFinite(transform.position) || !isFinite(transform.scale)) return false;
+    }
+    for (uint32_t i = 0; i < scene.velocitySet.entityCount; ++i) {
+        if (!isFinite(scene.velocitySet.dense[i].velocity)) return false;
+    }
+    return true;
+}
 
 int run(ECS& scene) {
     GLFWwindow* windowPtr = scene.window.windowPtr;
@@ -44,19 +62,33 @@ int run(ECS& scene) {
     glfwSetKeyCallback(windowPtr, keyCallback);
 
     GameDLL gameDLL = {};
+    WorldSnapshot reloadSnapshot;
+    uint32_t reloadGuardFrames = 0;
     loadGameDLL(gameDLL, "game.dll", "game_temp.dll");
     if (LOAD_SCENE_FROM_FILE)
         loadScene(scene, SCENE_PATH);
     else
         initScene(scene);
 
+    InputReplay& replay = scene.inputReplay;
+    if (replay.mode == InputReplayMode::Record) startInputRecording(replay, hashSimulationState(scene));
+    if (replay.mode == InputReplayMode::Replay) startInputReplay(replay, hashSimulationState(scene));
+    if (replay.headless) {
+        scene.debugMode = false;
+        scene.useSoftwareOcclusion = false;
+    }
+
     while (!glfwWindowShouldClose(windowPtr)) {
+        auto frameStart = std::chrono::steady_clock::now();
 
         static bool reloadPressed = false;
         if (glfwGetKey(windowPtr, GLFW_KEY_B) == GLFW_PRESS && !reloadPressed) {
             reloadPressed = true;
             system("cmake --build .. --target game");
-            loadGameDLL(gameDLL, "game.dll", "game_temp.dll");
+            // The state from before the new code ran is what a misbehaving reload rolls back to.
+            if (loadGameDLL(gameDLL, "game.dll", "game_temp.dll") && takeSnapshot(scene, reloadSnapshot)) {
+                reloadGuardFrames = RELOAD_GUARD_FRAMES;
+            }
         }
         if (glfwGetKey(windowPtr, GLFW_KEY_B) == GLFW_RELEASE) {
             reloadPressed = false;
@@ -68,17 +100,26 @@ int run(ECS& scene) {
         uint32_t camEntity = scene.currentCamera;
         CameraComponent& camera = scene.cameraSet.getComponent(camEntity);
 
-        scene.physicsManifold.size = 0;
         scene.deleteBuffer.size = 0;
 
         updateTiming(scene);
+        if (replay.mode != InputReplayMode::Off) scene.deltaTime = replay.tickSeconds;
 
         glfwPollEvents();
 
+        // A replay's input replaces the live input, only the window itself still reacts.
+        bool replaying = replay.mode == InputReplayMode::Replay;
+        if (replaying && !replayInputTick(replay, scene.keyStateBuffer)) break;
         Event event;
         while (pollEvent(scene.eventQueue, event)) {
+            if (replaying && event.type != EventType::WindowResize) continue;
             handleWindowEvent(event, scene.window, scene.framebuffer, camera, scene.mouseData);
+            recordInputEvent(replay, event);
         }
+        for (uint32_t i = 0; replaying && i < replay.eventCount; ++i) {
+            handleWindowEvent(replay.events[i], scene.window, scene.framebuffer, camera, scene.mouseData);
+        }
+        recordInputTick(replay, scene.keyStateBuffer);
 
         processMouseMovement(camera, scene.mouseData.frameOffsetX, scene.mouseData.frameOffsetY, true);
         scene.mouseData.frameOffsetX = 0.0f;
@@ -90,20 +131,81 @@ int run(ECS& scene) {
         }
         updateCameraPosition(scene.transformSet, scene.cameraSet);
         updateViewMatrix(camera);
+        updateWorldStreaming(scene.worldStreamer, scene, camera.position);
+
+        // Update systems, paused while the editor shows an older snapshot.
+        if (gameDLL.update && scene.snapshotRing.scrubFrame < 0) {
+            bool healthy = callGameUpdate(gameDLL, scene, camera);
+            if (reloadGuardFrames > 0) {
+                --reloadGuardFrames;
+                healthy = healthy && simulationIsFinite(scene);
+            }
+            if (!healthy) {
+                gameDLL.update = nullptr;
+                reloadGuardFrames = 0;
+                if (restoreSnapshot(scene, reloadSnapshot)) std::cout << "Game update misbehaved, rolled back to before the reload" << std::endl;
+                else std::cout << "Game update faulted, stopped calling it" << std::endl;
+                std::cout << "Fix it and press B to rebuild" << std::endl;
+            }
+        }
+        recordSnapshot(scene.snapshotRing, scene);
 
-        // Update systems
-        if (gameDLL.update) {
-            gameDLL.update(scene, camera);
+        auto simulationEnd = std::chrono::steady_clock::now();
+        double simulationMilliseconds = std::chrono::duration<double, std::milli>(simulationEnd - frameStart).count();
+        if (replay.headless) {
+            writeFrameTiming(replay, simulationMilliseconds, 0.0, simulationMilliseconds);
+            std::memcpy(scene.lastKeyStateBuffer, scene.keyStateBuffer, sizeof(scene.keyStateBuffer));
+            continue;
         }
 
         // Render
-        performLightCulling(scene.pointLightSet, scene.transformSet, scene.visiblePointLightBuffer, camera.frustumPlanes);
+        // Occluders are rasterized on the worker while the lights and bounds below are prepared.
+        if (scene.useSoftwareOcclusion) {
+            kickOccluderRasterization(scene.occluderRasterizer, scene.occluderSet, scene.transformSet, scene.meshSet,
+                                      scene.meshBuffer, camera.viewProjectionMatrix);
+        }
+        processAssetUploads(scene.assetLoader, scene.textureStreamer, scene.materialSSBO);
+        performLightCulling(scene.pointLightSet, scene.transformSet, scene.pointLightBoundsBuffer,
+                            scene.visiblePointLightBuffer, camera.frustumPlanes);
         uploadLightSSBO(scene.lightSSBO, scene.visiblePointLightBuffer);
         updateSceneData(scene.sceneData, camera, scene.visiblePointLightBuffer, scene.skyboxData);
         uploadSceneUBO(scene.sceneUBO, scene.sceneData);
-        performFrustumCulling(scene.renderableSet, scene.transformSet, scene.meshSet,
-                              scene.visibleEntityBuffer, camera.frustumPlanes);
-        renderSystem(scene.visibleEntityBuffer, scene.materialSet, scene.meshSet, scene.transformSet, scene.framebuffer);
+        if (scene.useCullingTree) {
+            updateRenderTree(scene.renderTree, scene.renderableSet, scene.transformSet, scene.meshSet, scene.worldBoundsBuffer);
+            performFrustumCullingTree(scene.renderTree, scene.visibleEntityBuffer, camera.frustumPlanes);
+        } else {
+            updateWorldBounds(scene.renderableSet, scene.transformSet, scene.meshSet, scene.worldBoundsBuffer);
+            performFrustumCulling(scene.worldBoundsBuffer, scene.visibleEntityBuffer, camera.frustumPlanes);
+        }
+        if (scene.useSoftwareOcclusion) {
+            const SoftwareDepthBuffer& occluderDepth = waitOccluderRasterization(scene.occluderRasterizer);
+            performSoftwareOcclusionCulling(occluderDepth, scene.worldBoundsBuffer, scene.renderableSet, scene.occluderSet,
+                                            camera.viewProjectionMatrix, scene.visibleEntityBuffer, scene.softwareOccludedCount);
+        }
+        selectMeshLODs(scene.visibleEntityBuffer, scene.meshSet, scene.transformSet, scene.meshBuffer, camera,
+                       scene.window.height, scene.lodSelection);
+        updateTextureStreaming(scene.textureStreamer, scene.visibleEntityBuffer, scene.materialSet, scene.meshSet, scene.transformSet,
+                               camera, scene.window.height, scene.materialSSBO);
+        performClusterCulling(scene.visibleEntityBuffer, scene.meshSet, scene.transformSet, scene.meshBuffer, scene.lodSelection,
+                              camera, scene.clusterDrawList);
+        clearFramebuffer(scene.framebuffer);
+        if (scene.useOcclusionCulling && collectOcclusionResults(scene.hiZBuffer, scene.occlusionData)) {
+            // Draw everything not known to be occluded and build the Hi-Z from that depth. The test against it decides
+            // which of the rest get drawn now, through indirect commands it writes, and what is drawn first next frames.
+            OcclusionCullingData& occlusion = scene.occlusionData;
+            partitionOcclusionCandidates(scene.visibleEntityBuffer, scene.worldBoundsBuffer, scene.renderableSet, occlusion);
+            renderSystem(occlusion.drawnFirst, scene.materialSet, scene.meshSet, scene.transformSet, scene.meshBuffer,
+                         scene.lodSelection, scene.clusterDrawList, scene.framebuffer);
+            buildHiZ(scene.hiZBuffer, scene.framebuffer);
+            writeDrawCommands(occlusion.retested, scene.meshSet, scene.meshBuffer, scene.lodSelection, occlusion.retestCommands);
+            uint32_t slot = submitOcclusionTest(scene.hiZBuffer, occlusion, camera.viewProjectionMatrix);
+            renderIndirect(occlusion.retested, scene.hiZBuffer, slot, scene.materialSet, scene.meshSet, scene.transformSet,
+                           scene.meshBuffer, scene.framebuffer);
+        } else {
+            // Also taken when the GPU is still on the slot this frame's test would go into, then everything is drawn.
+            renderSystem(scene.visibleEntityBuffer, scene.materialSet, scene.meshSet, scene.transformSet, scene.meshBuffer,
+                         scene.lodSelection, scene.clusterDrawList, scene.framebuffer);
+        }
         renderSkybox(scene.skyboxData);
         drawToFramebuffer(scene.framebuffer, scene.quadVAO);
         renderTextSystem(scene.textBuffer, scene.textRenderData, scene.window.width, scene.window.height);
@@ -112,8 +214,21 @@ int run(ECS& scene) {
 
         glfwSwapBuffers(windowPtr);
         std::memcpy(scene.lastKeyStateBuffer, scene.keyStateBuffer, sizeof(scene.keyStateBuffer));
+
+        auto frameEnd = std::chrono::steady_clock::now();
+        writeFrameTiming(replay, simulationMilliseconds, std::chrono::duration<double, std::milli>(frameEnd - simulationEnd).count(),
+                         std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
     }
-    return 0;
+    bool replayMatched = replay.mode == InputReplayMode::Off || finishInputReplay(replay, hashSimulationState(scene));
+    closeWorld(scene.worldStreamer, scene);
+    freeSnapshotRing(scene.snapshotRing);
+    freeSnapshot(reloadSnapshot);
+    freeContactStream(scene.contacts);
+    freeAABBTree(scene.renderTree);
+    stopAssetLoader(scene.assetLoader);
+    stopTextureStreamer(scene.textureStreamer);
+    stopOccluderRasterizer(scene.occluderRasterizer);
+    return replayMatched ? 0 : 1;
 }
 
 void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
@@ -190,9 +305,10 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
     }
 }
 
-int main() {
+int main(int argc, char** argv) {
     try {
         ECS* scene = new ECS();
+        if (!parseInputReplayArgs(scene->inputReplay, argc, argv)) return 1;
         initState(*scene);
         return run(*scene);
     } catch (const std::runtime_error& e) {
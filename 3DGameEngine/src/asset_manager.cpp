@@ -4,20 +4,75 @@
 #include "stb_image.h"
 #include <iostream>
 #include <bit>
+#include <algorithm>
 #include "shader_s.h"
 #include <string>
+#include <cstddef>
+#include <cstring>
+#include "asset_pack.h"
+#include "async_loader.h"
+#include "mesh_file.h"
+#include "software_occlusion.h"
+
+// glad was generated without EXT_texture_compression_s3tc, the formats are core in every GL 4.6 driver anyway.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
 
 void loadBinaryMesh(const std::string& path, MeshBuffer& meshBuffer) {
-    FILE* f = fopen(path.c_str(), "rb");
-    MeshFileHeader header;
-    fread(&header, sizeof(MeshFileHeader), 1, f);
+    AssetView file;
+    if (!openAsset(path.c_str(), file)) {
+        std::cout << "Failed to open mesh: " << path << std::endl;
+        return;
+    }
 
-    std::vector<float> vertices(header.vertexCount * 8);
-    fread(vertices.data(), sizeof(float) * 8, header.vertexCount, f);
+    MeshFileHeader header;
+    size_t vertexOffset = 0;
+    if (!readMeshFileHeader(file, header, vertexOffset) ||
+        meshBuffer.meshletSize + header.meshletCount > MeshBuffer::meshletCapacity) {
+        std::cout << "Invalid header in mesh: " << path << std::endl;
+        closeAsset(file);
+        return;
+    }
 
-    std::vector<uint32_t> indices(header.indexCount);
-    fread(indices.data(), sizeof(uint32_t), header.indexCount, f);
-    fclose(f);
+    const bool compact = header.vertexFormat == MeshVertexFormat::Compact;
+    const size_t vertexSize = compact ? sizeof(CompactVertex) : sizeof(float) * 8;
+    const uint8_t* vertices = file.data + vertexOffset;
+    const size_t vertexBytes = header.vertexCount * vertexSize;
+    const uint8_t* indices = vertices + vertexBytes;
+    size_t indexBytes = header.indexCount * header.indexSize;
+    const uint8_t* meshletData = indices + indexBytes;
+
+    // Only worth culling per meshlet when there's more than one. The mapping has no alignment guarantee, so copy.
+    uint32_t meshletOffset = meshBuffer.meshletSize;
+    uint32_t meshletCount = header.meshletCount > 1 ? header.meshletCount : 0;
+    memcpy(&meshBuffer.meshlets[meshletOffset], meshletData, meshletCount * sizeof(Meshlet));
+    for (uint32_t m = 0; m < meshletCount; ++m) {
+        const Meshlet& meshlet = meshBuffer.meshlets[meshletOffset + m];
+        if ((uint64_t)meshlet.indexOffset + meshlet.indexCount > header.lods[0].indexOffset + header.lods[0].indexCount) {
+            meshletCount = 0;
+            break;
+        }
+    }
+    meshBuffer.meshletSize += meshletCount;
+
+    // Older files always store 32 bit indices, narrow them here when the vertex count allows.
+    // That's the only copy left, the rest is uploaded straight out of the mapping.
+    std::vector<uint16_t> narrowIndices;
+    if (header.indexSize == sizeof(uint32_t) && header.vertexCount <= 65536) {
+        narrowIndices.resize(header.indexCount);
+        for (uint32_t i = 0; i < header.indexCount; ++i) {
+            uint32_t index;
+            memcpy(&index, indices + i * sizeof(uint32_t), sizeof(uint32_t));
+            narrowIndices[i] = (uint16_t)index;
+        }
+        indices = reinterpret_cast<const uint8_t*>(narrowIndices.data());
+        indexBytes = narrowIndices.size() * sizeof(uint16_t);
+        header.indexSize = sizeof(uint16_t);
+    }
 
     uint32_t VAO, VBO, EBO;
     glGenVertexArrays(1, &VAO);
@@ -27,25 +82,62 @@ void loadBinaryMesh(const std::string& path, MeshBuffer& meshBuffer) {
     glBindVertexArray(VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertices, GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
-
-    GLsizei stride = 8 * sizeof(float);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indices, GL_STATIC_DRAW);
+
+    // Positions for the software occluder rasterizer, only decoded for meshes small enough to be kept.
+    const MeshLOD& fullDetail = header.lods[0];
+    std::vector<glm::vec3> positions;
+    if (fullDetail.indexCount / 3 <= MAX_OCCLUDER_TRIANGLES) {
+        const AABB& bounds = header.localAABB;
+        const glm::vec3 boundsMin(bounds.minX, bounds.minY, bounds.minZ);
+        const glm::vec3 boundsSize(bounds.maxX - bounds.minX, bounds.maxY - bounds.minY, bounds.maxZ - bounds.minZ);
+        positions.resize(header.vertexCount);
+        for (uint32_t v = 0; v < header.vertexCount; ++v) {
+            if (compact) {
+                uint16_t quantized[3];
+                memcpy(quantized, vertices + v * vertexSize + offsetof(CompactVertex, position), sizeof(quantized));
+                positions[v] = boundsMin + glm::vec3(quantized[0], quantized[1], quantized[2]) / 65535.0f * boundsSize;
+            } else {
+                memcpy(&positions[v], vertices + v * vertexSize, sizeof(glm::vec3));
+            }
+        }
+    }
+    addOccluderMesh(meshBuffer, meshBuffer.size, positions.data(), indices + fullDetail.indexOffset * header.indexSize,
+                    header.indexSize, fullDetail.indexCount);
+    closeAsset(file);
+
+    GLsizei stride = (GLsizei)vertexSize;
+    if (compact) {
+        // Positions come out in [0, 1] across the AABB, renderSystem scales them back with the model matrix.
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(CompactVertex, position));
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(CompactVertex, normal));
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(CompactVertex, uv));
+    } else {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
+    }
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
     glEnableVertexAttribArray(2);
 
     MeshData mesh;
     mesh.handle = meshBuffer.size;
     mesh.vao = VAO;
     mesh.vertexCount = header.vertexCount;
-    mesh.indexCount = header.indexCount;
+    mesh.indexCount = header.lods[0].indexCount;
     mesh.localAABB = header.localAABB;
+    meshBuffer.vertexFormats[meshBuffer.size] = header.vertexFormat;
+    meshBuffer.indexTypes[meshBuffer.size] = header.indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    meshBuffer.meshletOffsets[meshBuffer.size] = meshletOffset;
+    meshBuffer.meshletCounts[meshBuffer.size] = meshletCount;
+    meshBuffer.lodCounts[meshBuffer.size] = (uint8_t)header.lodCount;
+    for (uint32_t lod = 0; lod < header.lodCount; ++lod) {
+        meshBuffer.lods[meshBuffer.size][lod] = header.lods[lod];
+    }
     meshBuffer.buffer[meshBuffer.size++] = mesh;
 }
 
@@ -60,21 +152,37 @@ void updateMaterialColour(MaterialData& materialData, MaterialSSBOData& material
     materialSSBOData.colourAndShine.z = newColor.z;
 }
 
-uint64_t loadSkyboxCubemap() {
-    std::string paths[6] = {
-        {"right.jpg"},
-        {"left.jpg"},
-        {"top.jpg"},
-        {"bottom.jpg"},
-        {"front.jpg"},
-        {"back.jpg"}};
-    const char* cubemapTexturePaths[6] = {
-        paths[0].c_str(), paths[1].c_str(), paths[2].c_str(),
-        paths[3].c_str(), paths[4].c_str(), paths[5].c_str()};
+static const char* const skyboxFaces[6] = {"right.jpg", "left.jpg", "top.jpg", "bottom.jpg", "front.jpg", "back.jpg"};
 
+uint64_t loadSkyboxCubemap() {
+    const char* cubemapTexturePaths[6] = {skyboxFaces[0], skyboxFaces[1], skyboxFaces[2],
+                                          skyboxFaces[3], skyboxFaces[4], skyboxFaces[5]};
     return loadCubemap(cubemapTexturePaths);
 }
 
+void requestSkyboxCubemap(AsyncAssetLoader& loader, uint64_t* cubemapHandle) {
+    requestCubemap(loader, skyboxFaces, cubemapHandle);
+}
+
+// 1x1 white cubemap the skybox samples until the real faces are uploaded.
+uint64_t createDefaultCubemap() {
+    uint32_t textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    glTexStorage2D(GL_TEXTURE_CUBE_MAP, 1, GL_RGBA8, 1, 1);
+
+    uint8_t whitePixel[] = {255, 255, 255, 255};
+    for (int i = 0; i < 6; ++i) {
+        glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, whitePixel);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    uint64_t textureHandle = glGetTextureHandleARB(textureID);
+    glMakeTextureHandleResidentARB(textureHandle);
+    return textureHandle;
+}
+
 uint64_t createDefaultTexture() {
     uint32_t whiteTextureID;
     glGenTextures(1, &whiteTextureID);
@@ -93,42 +201,113 @@ uint64_t createDefaultTexture() {
     return whiteTextureHandle;
 }
 
-uint64_t loadTexture(const char* path) {
+unsigned char* loadImage(const char* name, int& width, int& height, int& componentCount, int desiredComponents) {
+    AssetView file;
+    if (!openAsset(name, file)) return nullptr;
+    unsigned char* data = stbi_load_from_memory(file.data, (int)file.size, &width, &height, &componentCount, desiredComponents);
+    closeAsset(file);
+    return data;
+}
+
+uint64_t createTextureFromPixels(const unsigned char* pixels, int width, int height) {
     uint32_t textureID;
     glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    int mipMapLevel = std::bit_width((uint32_t)std::max(width, height));
+    glTexStorage2D(GL_TEXTURE_2D, mipMapLevel, GL_RGBA8, width, height);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
 
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 4);
-    if (data) {
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        int mipMapLevel = std::bit_width((uint32_t)std::max(width, height));
-        glTexStorage2D(GL_TEXTURE_2D, mipMapLevel, GL_RGBA8, width, height);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    } else {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    uint64_t textureHandle = glGetTextureHandleARB(textureID);
+    glMakeTextureHandleResidentARB(textureHandle);
+    return textureHandle;
+}
+
+bool readTextureFileHeader(const AssetView& file, TextureFileHeader& header) {
+    if (file.size < sizeof(TextureFileHeader)) return false;
+    memcpy(&header, file.data, sizeof(TextureFileHeader));
+    if (header.magic != TEXTURE_FILE_MAGIC || header.version != TEXTURE_FILE_VERSION) return false;
+    if (header.format > TextureFileFormat::BC7 || header.width == 0 || header.height == 0) return false;
+    if (header.mipCount == 0 || header.mipCount > MAX_TEXTURE_MIPS) return false;
+    for (uint32_t level = 0; level < header.mipCount; ++level) {
+        uint32_t mipWidth = std::max(header.width >> level, 1u);
+        uint32_t mipHeight = std::max(header.height >> level, 1u);
+        if (header.mipSizes[level] != textureMipSize(header.format, mipWidth, mipHeight)) return false;
+        if ((uint64_t)header.mipOffsets[level] + header.mipSizes[level] > file.size) return false;
     }
+    return true;
+}
+
+static GLenum textureInternalFormat(TextureFileFormat format) {
+    switch (format) {
+    case TextureFileFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TextureFileFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case TextureFileFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+    case TextureFileFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    default: return GL_RGBA8;
+    }
+}
+
+void allocateCookedTexture(GLenum target, const TextureFileHeader& header, uint32_t firstMip) {
+    glTexStorage2D(target, header.mipCount - firstMip, textureInternalFormat(header.format),
+                   std::max(header.width >> firstMip, 1u), std::max(header.height >> firstMip, 1u));
+}
+
+void uploadCookedMips(GLenum target, const TextureFileHeader& header, const uint8_t* file, uint32_t firstMip, uint32_t endMip) {
+    for (uint32_t level = firstMip; level < std::min(header.mipCount, endMip); ++level) {
+        GLsizei mipWidth = (GLsizei)std::max(header.width >> level, 1u);
+        GLsizei mipHeight = (GLsizei)std::max(header.height >> level, 1u);
+        const uint8_t* mip = file + header.mipOffsets[level];
+        if (header.format == TextureFileFormat::RGBA8) {
+            glTexSubImage2D(target, level - firstMip, 0, 0, mipWidth, mipHeight, GL_RGBA, GL_UNSIGNED_BYTE, mip);
+        } else {
+            glCompressedTexSubImage2D(target, level - firstMip, 0, 0, mipWidth, mipHeight, textureInternalFormat(header.format),
+                                      header.mipSizes[level], mip);
+        }
+    }
+}
+
+uint64_t createTextureFromCooked(const TextureFileHeader& header, const uint8_t* file) {
+    uint32_t textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    allocateCookedTexture(GL_TEXTURE_2D, header);
+    uploadCookedMips(GL_TEXTURE_2D, header, file);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
     uint64_t textureHandle = glGetTextureHandleARB(textureID);
     glMakeTextureHandleResidentARB(textureHandle);
     return textureHandle;
 }
 
+uint64_t loadTexture(const char* path) {
+    int width, height, nrComponents;
+    unsigned char* data = loadImage(path, width, height, nrComponents, 4);
+    if (!data) {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+        return createDefaultTexture();
+    }
+    uint64_t textureHandle = createTextureFromPixels(data, width, height);
+    stbi_image_free(data);
+    return textureHandle;
+}
+
 uint64_t loadCubemap(const char* (&faces)[6]) {
     uint32_t textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
     int width, height, nrComponents;
     for (int i = 0; i < 6; ++i) {
-        unsigned char* data = stbi_load(faces[i], &width, &height, &nrComponents, 4);
+        unsigned char* data = loadImage(faces[i], width, height, nrComponents, 4);
         if (data) {
             if (i == 0) {
                 int mipMapLevel = std::bit_width((uint32_t)std::max(width, height));
@@ -154,10 +333,11 @@ uint64_t loadCubemap(const char* (&faces)[6]) {
     return textureHandle;
 }
 
-void initDefaultMaterials(MaterialBuffer& materialBuffer, MaterialSSBODataBuffer& materialSSBODataBuffer) {
+void initDefaultMaterials(MaterialBuffer& materialBuffer, MaterialSSBODataBuffer& materialSSBODataBuffer, AsyncAssetLoader& loader) {
     uint64_t defualtTexture = createDefaultTexture();
-    uint64_t cubeDiffuse = loadTexture("container2.png");
-    uint64_t cubeSpecular = loadTexture("container2_specular.png");
+    // The cube starts out white and picks up its textures once the loader has them.
+    uint64_t cubeDiffuse = defualtTexture;
+    uint64_t cubeSpecular = defualtTexture;
 
     uint32_t defualtShaderID = createShaderProgram("default_vertex.vs", "default_fragment.fs");
 
@@ -165,6 +345,10 @@ void initDefaultMaterials(MaterialBuffer& materialBuffer, MaterialSSBODataBuffer
     MaterialSSBOData noMaterial = {glm::vec4(0.2f, 0.2f, 0.2f, 0.0f), defualtTexture, defualtTexture};
     materialSSBODataBuffer.buffer[materialSSBODataBuffer.size++] = cubeMaterial; // Index 0
     materialSSBODataBuffer.buffer[materialSSBODataBuffer.size++] = noMaterial;   // Index 1 - need to find a better way to do this.
+    requestTexture(loader, "container2.png", &materialSSBODataBuffer.buffer[0].diffuseTextureHandle,
+                   offsetof(MaterialSSBOData, diffuseTextureHandle));
+    requestTexture(loader, "container2_specular.png", &materialSSBODataBuffer.buffer[0].specularTextureHandle,
+                   offsetof(MaterialSSBOData, specularTextureHandle));
     materialBuffer.buffer[materialBuffer.size++] = MaterialData{defualtShaderID, 0};
     materialBuffer.buffer[materialBuffer.size++] = MaterialData{defualtShaderID, 1};
 }
@@ -223,7 +407,7 @@ uint32_t createUnitCubePrimitive(MeshBuffer& meshBuffer) {
         h, -h, h, 0.0f, -1.0f, 0.0f, 1.0f, 1.0f,
         -h, -h, h, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f};
 
-    uint32_t indices[] = {
+    uint16_t indices[] = {
         0, 1, 2, 2, 3, 0,
         4, 5, 6, 6, 7, 4,
         8, 9, 10, 10, 11, 8,
@@ -262,6 +446,15 @@ uint32_t createUnitCubePrimitive(MeshBuffer& meshBuffer) {
     mesh.vertexCount = 24;
     mesh.indexCount = 36;
     mesh.localAABB = AABB{-h, -h, -h, h, h, h};
+    meshBuffer.vertexFormats[meshBuffer.size] = MeshVertexFormat::Float;
+    meshBuffer.indexTypes[meshBuffer.size] = GL_UNSIGNED_SHORT;
+    meshBuffer.meshletOffsets[meshBuffer.size] = 0;
+    meshBuffer.meshletCounts[meshBuffer.size] = 0;
+    meshBuffer.lodCounts[meshBuffer.size] = 1;
+    meshBuffer.lods[meshBuffer.size][0] = MeshLOD{0, 36, 0.0f};
+    glm::vec3 positions[24];
+    for (uint32_t v = 0; v < 24; ++v) positions[v] = glm::vec3(vertices[v * 8], vertices[v * 8 + 1], vertices[v * 8 + 2]);
+    addOccluderMesh(meshBuffer, handle, positions, (const uint8_t*)indices, sizeof(uint16_t), 36);
     meshBuffer.buffer[meshBuffer.size++] = mesh;
 
     return handle;
@@ -3,11 +3,11 @@
 #include <cstdint>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include "mesh_format.h"
+#include "texture_format.h"
 
-struct AABB {
-    float minX, minY, minZ;
-    float maxX, maxY, maxZ;
-};
+struct AsyncAssetLoader;
+struct AssetView;
 
 struct MeshData {
     uint32_t handle;
@@ -17,12 +17,6 @@ struct MeshData {
     AABB localAABB;
 };
 
-struct MeshFileHeader {
-    uint32_t vertexCount;
-    uint32_t indexCount;
-    AABB localAABB;
-};
-
 struct MaterialSSBOData {
     glm::vec4 colourAndShine;
     uint64_t diffuseTextureHandle;
@@ -38,6 +32,23 @@ struct MeshBuffer {
     static constexpr uint8_t capacity = 255;
     uint8_t size = 0;
     MeshData buffer[capacity];
+    // Indexed by MeshData::handle. Kept out of MeshData since that gets copied into every entity and the scene files.
+    MeshVertexFormat vertexFormats[capacity];
+    GLenum indexTypes[capacity]; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, LOD offsets are in indices of this type.
+    uint8_t lodCounts[capacity];
+    MeshLOD lods[capacity][MAX_MESH_LODS];
+    // Meshlets of every mesh share one pool, each mesh owns a contiguous range of it.
+    static constexpr uint32_t meshletCapacity = 16384;
+    uint32_t meshletSize = 0;
+    uint32_t meshletOffsets[capacity];
+    uint32_t meshletCounts[capacity];
+    Meshlet meshlets[meshletCapacity];
+    // LOD0 triangles of the meshes the software rasterizer can draw as occluders, three positions each, see addOccluderMesh.
+    static constexpr uint32_t occluderVertexCapacity = 65536;
+    uint32_t occluderVertexSize = 0;
+    uint32_t occluderOffsets[capacity];
+    uint32_t occluderVertexCounts[capacity]; // 0 for meshes too large to rasterize, those never occlude anything.
+    glm::vec3 occluderVertices[occluderVertexCapacity];
 };
 
 struct MaterialBuffer {
@@ -52,12 +63,24 @@ struct MaterialSSBODataBuffer {
     MaterialSSBOData buffer[capacity];
 };
 
+// stbi_load through the asset pack, free the result with stbi_image_free.
+unsigned char* loadImage(const char* name, int& width, int& height, int& componentCount, int desiredComponents);
+uint64_t createTextureFromPixels(const unsigned char* pixels, int width, int height);
+// Cooked .ptex textures: every mip comes from the file, nothing is generated on the GPU.
+bool readTextureFileHeader(const AssetView& file, TextureFileHeader& header);
+// firstMip drops the finest levels, the texture's level 0 is then the file's firstMip. Uploads stop before endMip.
+void allocateCookedTexture(GLenum target, const TextureFileHeader& header, uint32_t firstMip = 0);
+void uploadCookedMips(GLenum target, const TextureFileHeader& header, const uint8_t* file, uint32_t firstMip = 0,
+                      uint32_t endMip = MAX_TEXTURE_MIPS);
+uint64_t createTextureFromCooked(const TextureFileHeader& header, const uint8_t* file);
 uint64_t loadTexture(const char* path);
 uint64_t loadCubemap(const char* (&faces)[6]);
 uint64_t loadSkyboxCubemap();
+void requestSkyboxCubemap(AsyncAssetLoader& loader, uint64_t* cubemapHandle);
+uint64_t createDefaultCubemap();
 void updateMaterialColour(MaterialData& materialData, MaterialSSBOData& materialSSBOData, glm::vec3 newColor, uint32_t ssbo);
 uint64_t createDefaultTexture();
 uint32_t initMaterialSSBO(MaterialSSBODataBuffer& materialSSBODataBuffer);
-void initDefaultMaterials(MaterialBuffer& materialBuffer, MaterialSSBODataBuffer& materialSSBODataBuffer);
+void initDefaultMaterials(MaterialBuffer& materialBuffer, MaterialSSBODataBuffer& materialSSBODataBuffer, AsyncAssetLoader& loader);
 void initMeshes(MeshBuffer& meshBuffer);
 uint32_t createUnitCubePrimitive(MeshBuffer& meshBuffer);
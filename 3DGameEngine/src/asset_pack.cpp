@@ -0,0 +1,75 @@
+#include "asset_pack.h"
+#include "asset_pack_format.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+struct AssetPack {
+    MappedFile file;
+    const AssetPackEntry* entries = nullptr;
+    uint32_t entryCount = 0;
+};
+
+static AssetPack mountedPack;
+
+bool mountAssetPack(const char* path) {
+    unmountAssetPack();
+
+    MappedFile file;
+    if (!openMappedFile(path, file)) return false;
+
+    AssetPackHeader header;
+    bool valid = file.size >= sizeof(AssetPackHeader);
+    if (valid) {
+        memcpy(&header, file.data, sizeof(AssetPackHeader));
+        valid = header.magic == ASSET_PACK_MAGIC && header.version == ASSET_PACK_VERSION &&
+                header.tocOffset % alignof(AssetPackEntry) == 0 &&
+                header.tocOffset + (uint64_t)header.entryCount * sizeof(AssetPackEntry) <= file.size;
+    }
+    // The mapping is page aligned so the TOC can be used in place.
+    const AssetPackEntry* entries = valid ? reinterpret_cast<const AssetPackEntry*>(file.data + header.tocOffset) : nullptr;
+    for (uint32_t i = 0; valid && i < header.entryCount; ++i) {
+        valid = entries[i].offset + entries[i].size <= file.size && (i == 0 || entries[i - 1].nameHash < entries[i].nameHash);
+    }
+    if (!valid) {
+        std::cout << "Invalid asset pack: " << path << std::endl;
+        closeMappedFile(file);
+        return false;
+    }
+
+    mountedPack.file = file;
+    mountedPack.entries = entries;
+    mountedPack.entryCount = header.entryCount;
+    return true;
+}
+
+void unmountAssetPack() {
+    closeMappedFile(mountedPack.file);
+    mountedPack = AssetPack{};
+}
+
+bool openAsset(const char* name, AssetView& view) {
+    view = AssetView{};
+    if (mountedPack.entryCount > 0) {
+        uint64_t hash = hashAssetName(name);
+        const AssetPackEntry* end = mountedPack.entries + mountedPack.entryCount;
+        const AssetPackEntry* entry = std::lower_bound(mountedPack.entries, end, hash,
+                                                       [](const AssetPackEntry& e, uint64_t h) { return e.nameHash < h; });
+        if (entry != end && entry->nameHash == hash) {
+            view.data = mountedPack.file.data + entry->offset;
+            view.size = (size_t)entry->size;
+            return true;
+        }
+    }
+
+    // Loose files still work, for assets added since the pack was built.
+    if (!openMappedFile(name, view.looseFile)) return false;
+    view.data = view.looseFile.data;
+    view.size = view.looseFile.size;
+    return true;
+}
+
+void closeAsset(AssetView& view) {
+    closeMappedFile(view.looseFile);
+    view = AssetView{};
+}
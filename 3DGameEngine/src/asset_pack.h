@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "mapped_file.h"
+
+// Bytes of one asset. Points into the mounted pack, or into a mapping of the loose file when it isn't packed.
+struct AssetView {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    MappedFile looseFile;
+};
+
+// Maps the pack once, every openAsset after that is a binary search over the TOC instead of a file open.
+bool mountAssetPack(const char* path);
+void unmountAssetPack();
+bool openAsset(const char* name, AssetView& view);
+void closeAsset(AssetView& view);
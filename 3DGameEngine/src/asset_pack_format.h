@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+
+// Layout of .pack files, shared between the engine and asset_packer.
+// File = AssetPackHeader, entryCount AssetPackEntries sorted by nameHash, then the data of every entry at an aligned offset.
+
+#define ASSET_PACK_MAGIC 0x4B434150 // "PACK"
+#define ASSET_PACK_VERSION 1
+
+static constexpr uint32_t ASSET_PACK_ALIGNMENT = 64;
+
+struct AssetPackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t alignment;
+    uint64_t tocOffset;
+};
+
+struct AssetPackEntry {
+    uint64_t nameHash;
+    uint64_t offset; // From the start of the file.
+    uint64_t size;
+};
+
+// FNV-1a over the name as written in code, e.g. "cube.mesh". Subdirectories use '/'.
+inline uint64_t hashAssetName(const char* name) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const char* c = name; *c; ++c) {
+        hash ^= (uint8_t)*c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
@@ -0,0 +1,201 @@
+#include "async_loader.h"
+#include "asset_manager.h"
+#include "texture_streamer.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iostream>
+
+// Every image of every request fits in flight at once, so neither side ever spins on a full queue waiting for the other.
+static_assert(MAX_TEXTURE_REQUESTS * 6 <= decltype(AsyncAssetLoader::jobs)::capacity);
+static_assert(MAX_TEXTURE_REQUESTS * 6 <= decltype(AsyncAssetLoader::completed)::capacity);
+
+// container2.png -> container2.ptex
+static bool openCookedTexture(const char* name, AssetView& view) {
+    char cookedName[sizeof(AssetLoadJob::name) + 8];
+    strncpy(cookedName, name, sizeof(cookedName) - 1);
+    cookedName[sizeof(cookedName) - 1] = '\0';
+    char* extension = strrchr(cookedName, '.');
+    if (!extension) extension = cookedName + strlen(cookedName);
+    strcpy(extension, ".ptex");
+
+    TextureFileHeader header;
+    if (!openAsset(cookedName, view)) return false;
+    if (readTextureFileHeader(view, header)) return true;
+    std::cout << "Invalid cooked texture, decoding the source image instead: " << cookedName << std::endl;
+    closeAsset(view);
+    view = AssetView{};
+    return false;
+}
+
+static void assetWorker(AsyncAssetLoader* loader) {
+    for (;;) {
+        loader->jobSignal.acquire();
+        if (!loader->running.load(std::memory_order_acquire)) return;
+
+        AssetLoadJob job;
+        if (!loader->jobs.pop(job)) continue;
+
+        AssetLoadResult result = {};
+        result.request = job.request;
+        result.face = job.face;
+        if (openCookedTexture(job.name, result.cooked)) {
+            TextureFileHeader header;
+            memcpy(&header, result.cooked.data, sizeof(TextureFileHeader));
+            result.width = (int)header.width;
+            result.height = (int)header.height;
+        } else {
+            int componentCount;
+            result.pixels = loadImage(job.name, result.width, result.height, componentCount, 4);
+        }
+        loader->completed.push(result);
+    }
+}
+
+void startAssetLoader(AsyncAssetLoader& loader) {
+    loader.startTime = std::chrono::steady_clock::now();
+    loader.running.store(true, std::memory_order_release);
+    uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 2u);
+    loader.workerCount = std::min(hardwareThreads - 1, MAX_ASSET_WORKERS);
+    for (uint32_t i = 0; i < loader.workerCount; ++i) {
+        loader.workers[i] = std::thread(assetWorker, &loader);
+    }
+}
+
+void stopAssetLoader(AsyncAssetLoader& loader) {
+    loader.running.store(false, std::memory_order_release);
+    loader.jobSignal.release(loader.workerCount);
+    for (uint32_t i = 0; i < loader.workerCount; ++i) {
+        loader.workers[i].join();
+    }
+    loader.workerCount = 0;
+
+    AssetLoadResult result;
+    while (loader.completed.pop(result)) {
+        stbi_image_free(result.pixels);
+        if (result.cooked.data) closeAsset(result.cooked);
+    }
+}
+
+static void submitJob(AsyncAssetLoader& loader, const char* name, uint16_t request, uint8_t face) {
+    AssetLoadJob job = {};
+    strncpy(job.name, name, sizeof(job.name) - 1);
+    job.request = request;
+    job.face = face;
+    loader.jobs.push(job);
+    loader.jobSignal.release();
+    ++loader.pendingImages;
+}
+
+void requestTexture(AsyncAssetLoader& loader, const char* name, uint64_t* handleTarget, GLintptr ssboOffset) {
+    if (loader.requestCount >= MAX_TEXTURE_REQUESTS) {
+        std::cout << "Too many texture requests, keeping the placeholder for: " << name << std::endl;
+        return;
+    }
+    uint16_t request = loader.requestCount++;
+    loader.requests[request] = TextureRequest{TextureRequestKind::Texture2D, 1, false, 0, handleTarget, ssboOffset};
+    submitJob(loader, name, request, 0);
+}
+
+void requestCubemap(AsyncAssetLoader& loader, const char* const (&faces)[6], uint64_t* handleTarget) {
+    if (loader.requestCount >= MAX_TEXTURE_REQUESTS) {
+        std::cout << "Too many texture requests, keeping the placeholder for: " << faces[0] << std::endl;
+        return;
+    }
+    uint16_t request = loader.requestCount++;
+    loader.requests[request] = TextureRequest{TextureRequestKind::Cubemap, 6, false, 0, handleTarget, -1};
+    // Faces decode on separate workers, the cubemap only gets a handle once all six are uploaded.
+    for (uint8_t face = 0; face < 6; ++face) {
+        submitJob(loader, faces[face], request, face);
+    }
+}
+
+static void uploadCubemapFace(TextureRequest& request, const AssetLoadResult& result) {
+    // All six faces are expected to come the same way, a cubemap mixing cooked and decoded faces keeps whichever storage came first.
+    if (result.cooked.data) {
+        TextureFileHeader header;
+        memcpy(&header, result.cooked.data, sizeof(TextureFileHeader));
+        if (request.textureID == 0) {
+            glGenTextures(1, &request.textureID);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, request.textureID);
+            allocateCookedTexture(GL_TEXTURE_CUBE_MAP, header);
+            request.cookedMips = true;
+        }
+        glBindTexture(GL_TEXTURE_CUBE_MAP, request.textureID);
+        uploadCookedMips(GL_TEXTURE_CUBE_MAP_POSITIVE_X + result.face, header, result.cooked.data);
+    } else if (result.pixels) {
+        if (request.textureID == 0) {
+            glGenTextures(1, &request.textureID);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, request.textureID);
+            int mipMapLevel = std::bit_width((uint32_t)std::max(result.width, result.height));
+            glTexStorage2D(GL_TEXTURE_CUBE_MAP, mipMapLevel, GL_RGBA8, result.width, result.height);
+        }
+        glBindTexture(GL_TEXTURE_CUBE_MAP, request.textureID);
+        glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + result.face, 0, 0, 0, result.width, result.height,
+                        GL_RGBA, GL_UNSIGNED_BYTE, result.pixels);
+    }
+
+    if (--request.facesRemaining > 0 || request.textureID == 0) return;
+
+    glBindTexture(GL_TEXTURE_CUBE_MAP, request.textureID);
+    if (!request.cookedMips) glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    uint64_t textureHandle = glGetTextureHandleARB(request.textureID);
+    glMakeTextureHandleResidentARB(textureHandle);
+    *request.handleTarget = textureHandle;
+}
+
+static void setTextureHandle(const TextureRequest& request, uint64_t textureHandle, uint32_t materialSSBO) {
+    *request.handleTarget = textureHandle;
+    if (request.ssboOffset >= 0) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, materialSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, request.ssboOffset, sizeof(uint64_t), &textureHandle);
+    }
+}
+
+void processAssetUploads(AsyncAssetLoader& loader, TextureStreamer& streamer, uint32_t materialSSBO) {
+    size_t uploadedBytes = 0;
+    AssetLoadResult result;
+    // At least one image goes up per frame however big it is, so nothing can stall behind the budget.
+    while (uploadedBytes < loader.uploadBudgetBytes && loader.completed.pop(result)) {
+        TextureRequest& request = loader.requests[result.request];
+        --loader.pendingImages;
+        ++loader.uploadedImages;
+
+        if (request.kind == TextureRequestKind::Cubemap) {
+            uploadCubemapFace(request, result);
+        } else if (result.cooked.data) {
+            TextureFileHeader header;
+            memcpy(&header, result.cooked.data, sizeof(TextureFileHeader));
+            // Streamed textures only upload their small mips now and keep the file open for the rest.
+            if (registerStreamedTexture(streamer, result.cooked, header, request.handleTarget, request.ssboOffset, materialSSBO)) {
+                uploadedBytes += streamer.textures[streamer.textureCount - 1].residentBytes;
+                continue;
+            }
+            setTextureHandle(request, createTextureFromCooked(header, result.cooked.data), materialSSBO);
+        } else if (result.pixels) {
+            setTextureHandle(request, createTextureFromPixels(result.pixels, result.width, result.height), materialSSBO);
+        }
+
+        if (result.cooked.data) {
+            uploadedBytes += result.cooked.size - sizeof(TextureFileHeader);
+            closeAsset(result.cooked);
+        } else {
+            uploadedBytes += (size_t)result.width * (size_t)result.height * 4;
+            stbi_image_free(result.pixels);
+        }
+    }
+
+    if (!loader.startupReported && loader.pendingImages == 0 && loader.uploadedImages > 0) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - loader.startTime);
+        std::cout << "All " << loader.uploadedImages << " images decoded on " << loader.workerCount << " workers and uploaded "
+                  << elapsed.count() << " ms after startup" << std::endl;
+        loader.startupReported = true;
+    }
+}
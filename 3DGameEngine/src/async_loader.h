@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <semaphore>
+#include <thread>
+#include <glad/glad.h>
+#include "lock_free_queue.h"
+#include "asset_pack.h"
+
+struct TextureStreamer;
+
+// Texture decode runs on worker threads, the GL thread uploads finished images under a per frame byte budget.
+// Until then whatever handle the target already holds (the white placeholders) stays in use.
+
+static constexpr uint32_t MAX_ASSET_WORKERS = 8;
+static constexpr uint32_t MAX_TEXTURE_REQUESTS = 64;
+
+enum class TextureRequestKind : uint8_t {
+    Texture2D,
+    Cubemap,
+};
+
+struct AssetLoadJob {
+    char name[64];
+    uint16_t request;
+    uint8_t face;
+};
+
+// Either a cooked .ptex found next to the requested image, or the image decoded by stbi.
+struct AssetLoadResult {
+    AssetView cooked;      // Validated, data is null when there was no cooked file.
+    unsigned char* pixels; // stbi allocated, null if decoding failed.
+    int width;
+    int height;
+    uint16_t request;
+    uint8_t face;
+};
+
+// Where a finished texture's bindless handle goes. ssboOffset is -1 when only the CPU copy needs patching.
+struct TextureRequest {
+    TextureRequestKind kind;
+    uint8_t facesRemaining;
+    bool cookedMips; // Cubemaps only generate mips when the faces weren't cooked.
+    uint32_t textureID;
+    uint64_t* handleTarget;
+    GLintptr ssboOffset;
+};
+
+struct AsyncAssetLoader {
+    LockFreeQueue<AssetLoadJob, 512> jobs;
+    LockFreeQueue<AssetLoadResult, 512> completed;
+    std::counting_semaphore<> jobSignal{0};
+    std::atomic<bool> running{false};
+    std::thread workers[MAX_ASSET_WORKERS];
+    uint32_t workerCount = 0;
+
+    TextureRequest requests[MAX_TEXTURE_REQUESTS];
+    uint16_t requestCount = 0;
+    uint32_t pendingImages = 0;
+    size_t uploadBudgetBytes = 8 * 1024 * 1024;
+    uint32_t uploadedImages = 0;
+    std::chrono::steady_clock::time_point startTime;
+    bool startupReported = false;
+};
+
+void startAssetLoader(AsyncAssetLoader& loader);
+void stopAssetLoader(AsyncAssetLoader& loader);
+void requestTexture(AsyncAssetLoader& loader, const char* name, uint64_t* handleTarget, GLintptr ssboOffset);
+void requestCubemap(AsyncAssetLoader& loader, const char* const (&faces)[6], uint64_t* handleTarget);
+// Drains the completion queue on the GL thread until the frame's upload budget is spent. Cooked material textures
+// are handed to the streamer instead of being uploaded whole.
+void processAssetUploads(AsyncAssetLoader& loader, TextureStreamer& streamer, uint32_t materialSSBO);
@@ -0,0 +1,122 @@
+#include "block_compression.h"
+#include <cstring>
+
+static constexpr uint32_t MIN_MATCH = 4;
+static constexpr uint32_t MAX_OFFSET = 65535;
+static constexpr uint32_t HASH_BITS = 13;
+static constexpr uint32_t NO_POSITION = UINT32_MAX;
+
+static uint32_t read32(const uint8_t* data) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(uint32_t));
+    return value;
+}
+
+static uint32_t hashSequence(uint32_t value) {
+    return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Lengths past 15 continue in bytes of 255 and a final remainder.
+static bool writeLength(uint8_t*& out, const uint8_t* end, size_t length) {
+    for (; length >= 255; length -= 255) {
+        if (out == end) return false;
+        *out++ = 255;
+    }
+    if (out == end) return false;
+    *out++ = (uint8_t)length;
+    return true;
+}
+
+static bool writeSequence(uint8_t*& out, const uint8_t* end, const uint8_t* literals, size_t literalCount,
+                          uint32_t offset, size_t matchLength) {
+    if (out == end) return false;
+    uint8_t& token = *out++;
+    token = (uint8_t)((literalCount < 15 ? literalCount : 15) << 4);
+    if (literalCount >= 15 && !writeLength(out, end, literalCount - 15)) return false;
+    if ((size_t)(end - out) < literalCount) return false;
+    // An empty block may come with a null source.
+    if (literalCount > 0) memcpy(out, literals, literalCount);
+    out += literalCount;
+    if (matchLength == 0) return true;
+
+    if (end - out < 2) return false;
+    *out++ = (uint8_t)offset;
+    *out++ = (uint8_t)(offset >> 8);
+    size_t length = matchLength - MIN_MATCH;
+    token |= (uint8_t)(length < 15 ? length : 15);
+    return length < 15 || writeLength(out, end, length - 15);
+}
+
+size_t compressBlock(const uint8_t* source, size_t size, uint8_t* destination, size_t capacity) {
+    uint32_t table[1u << HASH_BITS];
+    for (uint32_t& position : table) position = NO_POSITION;
+
+    uint8_t* out = destination;
+    const uint8_t* end = destination + capacity;
+    size_t anchor = 0;
+    size_t i = 0;
+    while (i + MIN_MATCH <= size) {
+        uint32_t value = read32(source + i);
+        uint32_t& slot = table[hashSequence(value)];
+        uint32_t candidate = slot;
+        slot = (uint32_t)i;
+        if (candidate == NO_POSITION || i - candidate > MAX_OFFSET || read32(source + candidate) != value) {
+            ++i;
+            continue;
+        }
+
+        size_t length = MIN_MATCH;
+        while (i + length < size && source[candidate + length] == source[i + length]) ++length;
+        if (!writeSequence(out, end, source + anchor, i - anchor, (uint32_t)(i - candidate), length)) return 0;
+        // One more entry near the end of the match keeps long runs of repeats finding each other.
+        if (i + length + 2 <= size) table[hashSequence(read32(source + i + length - 2))] = (uint32_t)(i + length - 2);
+        i += length;
+        anchor = i;
+    }
+    if (!writeSequence(out, end, source + anchor, size - anchor, 0, 0)) return 0;
+    return (size_t)(out - destination);
+}
+
+static bool readLength(const uint8_t*& in, const uint8_t* end, size_t& length) {
+    uint8_t byte;
+    do {
+        if (in == end) return false;
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool decompressBlock(const uint8_t* source, size_t size, uint8_t* destination, size_t rawSize) {
+    const uint8_t* in = source;
+    const uint8_t* inEnd = source + size;
+    uint8_t* out = destination;
+    uint8_t* outEnd = destination + rawSize;
+    while (in < inEnd) {
+        uint8_t token = *in++;
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !readLength(in, inEnd, literalCount)) return false;
+        if ((size_t)(inEnd - in) < literalCount || (size_t)(outEnd - out) < literalCount) return false;
+        if (literalCount > 0) memcpy(out, in, literalCount);
+        in += literalCount;
+        out += literalCount;
+        if (in == inEnd) break;
+
+        if (inEnd - in < 2) return false;
+        size_t offset = in[0] | (size_t)in[1] << 8;
+        in += 2;
+        size_t length = token & 15;
+        if (length == 15 && !readLength(in, inEnd, length)) return false;
+        length += MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(out - destination) || (size_t)(outEnd - out) < length) return false;
+        // Matches may overlap what they write, a run of one byte has offset 1.
+        const uint8_t* match = out - offset;
+        if (offset >= length) {
+            memcpy(out, match, length);
+            out += length;
+        } else {
+            for (size_t b = 0; b < length; ++b) *out++ = match[b];
+        }
+    }
+    return out == outEnd;
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Byte oriented LZ77 in the style of LZ4: every sequence is a token (literal length in the high nibble, match length - 4
+// in the low one, 15 meaning more length bytes follow), the literals, then a 16 bit match offset. The block ends after
+// the literals of its last sequence. Every block stands alone so blocks can be decoded on different threads.
+
+inline size_t compressBlockBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+// Returns the compressed size, or 0 when it wouldn't fit in capacity.
+size_t compressBlock(const uint8_t* source, size_t size, uint8_t* destination, size_t capacity);
+// Fails on anything that doesn't decode to exactly rawSize bytes.
+bool decompressBlock(const uint8_t* source, size_t size, uint8_t* destination, size_t rawSize);
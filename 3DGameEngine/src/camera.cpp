@@ -86,10 +86,11 @@ void updateFrustumPlanes(CameraComponent& camera) {
 }
 
 void updateCameraPosition(SparseSet<TransformComponent>& transformSet, SparseSet<CameraComponent>& cameraSet) {
+    const SparseSet<TransformComponent>& transforms = transformSet;
     for (int i = 0; i < cameraSet.entityCount; ++i) {
         uint32_t entity = cameraSet.entities[i];
         CameraComponent& camera = cameraSet.getComponent(entity);
-        TransformComponent& transform = transformSet.getComponent(entity);
+        const TransformComponent& transform = transforms.getComponent(entity);
         camera.position = transform.position + camera.positionOffset;
     }
 }
\ No newline at end of file
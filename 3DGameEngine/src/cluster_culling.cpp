@@ -0,0 +1,70 @@
+#include "cluster_culling.h"
+#include "entity.h"
+
+void performClusterCulling(const VisibleEntityBuffer& visibleEntities, const SparseSet<MeshData>& meshSet,
+                           const SparseSet<TransformComponent>& transformSet, const MeshBuffer& meshBuffer,
+                           const MeshLODSelection& lodSelection, const CameraComponent& camera, ClusterDrawList& drawList) {
+    drawList.size = 0;
+    drawList.testedMeshlets = 0;
+    drawList.culledMeshlets = 0;
+
+    for (uint32_t i = 0; i < visibleEntities.size; ++i) {
+        uint32_t entity = visibleEntities.buffer[i];
+        drawList.first[entity] = NOT_CLUSTERED;
+
+        const MeshData& mesh = meshSet.getComponent(entity);
+        uint32_t meshletCount = meshBuffer.meshletCounts[mesh.handle];
+        if (meshletCount == 0 || lodSelection.lod[entity] != 0) continue;
+        if (drawList.size + meshletCount > ClusterDrawList::capacity) continue;
+
+        const TransformComponent& transform = transformSet.getComponent(entity);
+        glm::mat4 model = buildTransformMatrix(transform.position, transform.scale, transform.rotation);
+        glm::vec3 localCamera = glm::vec3(glm::inverse(model) * glm::vec4(camera.position, 1.0f));
+        // A mirrored transform flips the winding, the cone test would cull the front faces.
+        bool testCones = glm::determinant(glm::mat3(model)) > 0.0f;
+
+        glm::vec4 localPlanes[6];
+        float planeScale[6];
+        glm::mat4 modelTranspose = glm::transpose(model);
+        for (int p = 0; p < 6; ++p) {
+            localPlanes[p] = modelTranspose * camera.frustumPlanes[p];
+            planeScale[p] = glm::length(glm::vec3(localPlanes[p]));
+        }
+
+        size_t indexSize = meshBuffer.indexTypes[mesh.handle] == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        uint32_t nextIndex = UINT32_MAX;
+        drawList.first[entity] = drawList.size;
+
+        const Meshlet* meshlets = &meshBuffer.meshlets[meshBuffer.meshletOffsets[mesh.handle]];
+        for (uint32_t m = 0; m < meshletCount; ++m) {
+            const Meshlet& meshlet = meshlets[m];
+            glm::vec3 center = glm::vec3(meshlet.center[0], meshlet.center[1], meshlet.center[2]);
+            ++drawList.testedMeshlets;
+
+            bool visible = true;
+            for (int p = 0; p < 6 && visible; ++p) {
+                visible = glm::dot(glm::vec3(localPlanes[p]), center) + localPlanes[p].w >= -meshlet.radius * planeScale[p];
+            }
+            if (visible && testCones && meshlet.coneCutoff < 1.0f) {
+                glm::vec3 toCenter = center - localCamera;
+                glm::vec3 axis = glm::vec3(meshlet.coneAxis[0], meshlet.coneAxis[1], meshlet.coneAxis[2]);
+                visible = glm::dot(toCenter, axis) < meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+            }
+            if (!visible) {
+                ++drawList.culledMeshlets;
+                continue;
+            }
+
+            // Neighbouring surviving meshlets are contiguous in the index buffer, merge them into one draw.
+            if (meshlet.indexOffset == nextIndex) {
+                drawList.counts[drawList.size - 1] += (GLsizei)meshlet.indexCount;
+            } else {
+                drawList.counts[drawList.size] = (GLsizei)meshlet.indexCount;
+                drawList.offsets[drawList.size] = (const void*)(uintptr_t)(meshlet.indexOffset * indexSize);
+                ++drawList.size;
+            }
+            nextIndex = meshlet.indexOffset + meshlet.indexCount;
+        }
+        drawList.count[entity] = drawList.size - drawList.first[entity];
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <glad/glad.h>
+#include "render_system.h"
+#include "asset_manager.h"
+
+// Per entity meshlet draw ranges for glMultiDrawElements, built on the CPU after LOD selection.
+// Only entities drawn at LOD0 with a meshlet table go through here, everything else draws its whole LOD.
+static constexpr uint32_t NOT_CLUSTERED = UINT32_MAX;
+
+struct ClusterDrawList {
+    static constexpr uint32_t capacity = 65536;
+    uint32_t size = 0;
+    GLsizei counts[capacity];
+    const void* offsets[capacity];
+    uint32_t first[MAX_ENTITIES]; // NOT_CLUSTERED when the entity isn't drawn per meshlet.
+    uint32_t count[MAX_ENTITIES];
+    uint32_t testedMeshlets = 0;
+    uint32_t culledMeshlets = 0;
+};
+
+// Rejects meshlets outside the frustum or facing entirely away from the camera. Tests run in object space,
+// the camera and planes get the inverse transform, so non-uniform scale stays conservative.
+void performClusterCulling(const VisibleEntityBuffer& visibleEntities, const SparseSet<MeshData>& meshSet,
+                           const SparseSet<TransformComponent>& transformSet, const MeshBuffer& meshBuffer,
+                           const MeshLODSelection& lodSelection, const CameraComponent& camera, ClusterDrawList& drawList);
@@ -2,113 +2,220 @@
 #include "ecs.h"
 #include "entity.h"
 #include <algorithm>
+#include <cfloat>
+
+// An entity moving further than this fraction of its smallest box side in one tick is swept instead of tested where it
+// ended up, anything faster could pass through a box as thin as itself.
+static constexpr float SWEEP_THRESHOLD = 0.5f;
+// Obstacles hit this close after the first one are hit at the same time, like the two boxes either side of a seam.
+static constexpr float SWEEP_TIME_EPSILON = 1e-4f;
+static constexpr uint32_t MAX_SWEPT_HITS = 4;
+
+// Using the Minimum Translation Vector (MTV) approach, 
+// the idea is the shortest overlap would be the direction in which we collided (not always true but it works in practice),
+// therefore we resolve in this direction (we translate our entity by the depth of the overlap).
+static void minimumTranslation(const glm::vec3& overlap, const glm::vec3& position, const glm::vec3& obstaclePos,
+                               glm::vec3& normal, float& depth) {
+    bool alongX = overlap.x < overlap.y && overlap.x < overlap.z;
+    bool alongY = !alongX && overlap.y < overlap.z;
+    bool alongZ = !alongX && !alongY;
+    depth = alongX ? overlap.x : (alongY ? overlap.y : overlap.z);
+    normal = glm::vec3(alongX ? (position.x < obstaclePos.x ? -1.0f : 1.0f) : 0.0f,
+                       alongY ? (position.y < obstaclePos.y ? -1.0f : 1.0f) : 0.0f,
+                       alongZ ? (position.z < obstaclePos.z ? -1.0f : 1.0f) : 0.0f);
+}
+
+// Time of impact of the entity's box moving from start to start + displacement against an obstacle box, as a ray
+// against the obstacle grown by the entity's half size. Only the first obstacles hit along the way are kept, the entity
+// never gets past them. Obstacles it was already inside at the start are tested where it ended up, like the discrete
+// path does.
+static void sweptContacts(uint32_t entity, const glm::vec3& position, const glm::vec3& displacement, const CollisionComponent& box,
+                          const SparseSet<TransformComponent>& transforms, const SparseSet<CollisionComponent>& boxes,
+                          const uint32_t* collisionEntities, uint32_t collisionSetSize, ContactStream& contacts) {
+    glm::vec3 boxMin(box.minX, box.minY, box.minZ);
+    glm::vec3 boxMax(box.maxX, box.maxY, box.maxZ);
+    glm::vec3 halfSize = (boxMax - boxMin) * 0.5f;
+    glm::vec3 end = position + (boxMin + boxMax) * 0.5f;
+    glm::vec3 start = end - displacement;
+    // The broadphase test, against the box covering the whole move.
+    glm::vec3 sweptMin = glm::min(start, end) - halfSize;
+    glm::vec3 sweptMax = glm::max(start, end) + halfSize;
+
+    Contact hits[MAX_SWEPT_HITS];
+    uint32_t hitCount = 0;
+    float firstHit = FLT_MAX;
+
+    reserveContacts(contacts, collisionSetSize + MAX_SWEPT_HITS);
+    for (uint32_t j = 0; j < collisionSetSize; ++j) {
+        uint32_t obstacleEntity = collisionEntities[j];
+        if (obstacleEntity == entity) continue;
+        glm::vec3 obstaclePos = transforms.getComponent(obstacleEntity).position;
+        const CollisionComponent& obstacleBox = boxes.getComponent(obstacleEntity);
+        glm::vec3 obstacleMin = obstaclePos + glm::vec3(obstacleBox.minX, obstacleBox.minY, obstacleBox.minZ);
+        glm::vec3 obstacleMax = obstaclePos + glm::vec3(obstacleBox.maxX, obstacleBox.maxY, obstacleBox.maxZ);
+        if (glm::any(glm::greaterThan(sweptMin, obstacleMax)) || glm::any(glm::lessThan(sweptMax, obstacleMin))) continue;
+
+        glm::vec3 low = obstacleMin - halfSize;
+        glm::vec3 high = obstacleMax + halfSize;
+        float enter = -FLT_MAX;
+        float exit = FLT_MAX;
+        int enterAxis = 0;
+        bool missed = false;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (std::abs(displacement[axis]) < 1e-8f) {
+                missed |= start[axis] < low[axis] || start[axis] > high[axis];
+                continue;
+            }
+            float t0 = (low[axis] - start[axis]) / displacement[axis];
+            float t1 = (high[axis] - start[axis]) / displacement[axis];
+            if (t0 > t1) std::swap(t0, t1);
+            if (t0 > enter) {
+                enter = t0;
+                enterAxis = axis;
+            }
+            exit = std::min(exit, t1);
+        }
+        if (missed || enter > exit || exit < 0.0f || enter > 1.0f) continue;
+
+        if (enter < 0.0f) {
+            if (exit < 1.0f) continue; // Leaving it.
+            glm::vec3 overlap = glm::min(end + halfSize, obstacleMax) - glm::max(end - halfSize, obstacleMin);
+            Contact& contact = contacts.contacts[contacts.count++];
+            contact = Contact{entity, obstacleEntity, glm::vec3(0.0f), 0.0f, ContactState::Enter, 0.0f, UINT32_MAX};
+            minimumTranslation(overlap, position, obstaclePos, contact.normal, contact.depth);
+            continue;
+        }
+
+        if (enter > firstHit + SWEEP_TIME_EPSILON) continue;
+        if (enter < firstHit - SWEEP_TIME_EPSILON) hitCount = 0;
+        firstHit = std::min(firstHit, enter);
+        if (hitCount == MAX_SWEPT_HITS) continue;
+        // Pushes the entity back along the axis it came in on, to where it touched the obstacle.
+        glm::vec3 normal(0.0f);
+        normal[enterAxis] = displacement[enterAxis] > 0.0f ? -1.0f : 1.0f;
+        float depth = (1.0f - enter) * std::abs(displacement[enterAxis]);
+        hits[hitCount++] = Contact{entity, obstacleEntity, normal, depth, ContactState::Enter, 0.0f, UINT32_MAX};
+    }
+    for (uint32_t i = 0; i < hitCount; ++i) contacts.contacts[contacts.count++] = hits[i];
+}
 
 void collisionSystem(SparseSet<CollisionComponent>& collisionSet, SparseSet<TransformComponent>& transformSet,
-                     SparseSet<DynamicTag>& dynamicSet, SparseSet<BulletTag>& bulletSet, SparseSet<HealthComponent>& healthSet,
-                     CollisionPhysicsManifold& physicsManifold, DeleteBuffer& deleteBuffer) {
+                     SparseSet<DynamicTag>& dynamicSet, const SparseSet<VelocityComponent>& velocitySet, float deltaTime,
+                     const BodySleepState& sleep, ContactStream& contacts) {
     
     const uint32_t* collisionEntities = collisionSet.entities;
     uint32_t collisionSetSize = collisionSet.entityCount;
     const uint32_t* dynamicEntities = dynamicSet.entities;
     uint32_t dynamicSetSize = dynamicSet.entityCount;
+    // Only read here, going through const sets keeps them out of the snapshot dirty blocks.
+    const SparseSet<TransformComponent>& transforms = transformSet;
+    const SparseSet<CollisionComponent>& boxes = collisionSet;
 
+    beginContacts(contacts);
     for (uint32_t i = 0; i < dynamicSetSize; ++i) {
         uint32_t entity = dynamicEntities[i];
+        if (sleep.asleep[entity]) continue;
         
-        TransformComponent& transform = transformSet.getComponent(entity);
-        CollisionComponent& boundingBox = collisionSet.getComponent(entity);
+        glm::vec3 position = transforms.getComponent(entity).position;
+        const CollisionComponent& boundingBox = boxes.getComponent(entity);
+
+        float minX1 = position.x + boundingBox.minX;
+        float maxX1 = position.x + boundingBox.maxX;
+        float minY1 = position.y + boundingBox.minY;
+        float maxY1 = position.y + boundingBox.maxY;
+        float minZ1 = position.z + boundingBox.minZ;
+        float maxZ1 = position.z + boundingBox.maxZ;
+
+        // Movement already happened this tick, so the move being swept is the one that led here.
+        glm::vec3 displacement = velocitySet.hasComponent(entity) ? velocitySet.getComponent(entity).velocity * deltaTime : glm::vec3(0.0f);
+        float smallestSide = std::min({maxX1 - minX1, maxY1 - minY1, maxZ1 - minZ1});
+        if (glm::dot(displacement, displacement) > smallestSide * smallestSide * SWEEP_THRESHOLD * SWEEP_THRESHOLD) {
+            sweptContacts(entity, position, displacement, boundingBox, transforms, boxes, collisionEntities, collisionSetSize, contacts);
+            continue;
+        }
 
-        glm::vec3 position = transform.position;
+        // Room for every obstacle up front, the contact is always written and only kept when the boxes overlap.
+        reserveContacts(contacts, collisionSetSize);
+        Contact* out = contacts.contacts;
+        uint32_t count = contacts.count;
 
         for (uint32_t j = 0; j < collisionSetSize; ++j) {
             uint32_t obstacleEntity = collisionEntities[j];
-            if (entity != obstacleEntity) {
-                glm::vec3 obstaclePos = glm::vec3(transformSet.getComponent(obstacleEntity).position);
-                CollisionComponent& obstacleBox = collisionSet.getComponent(obstacleEntity);
-
-                float minX1 = position.x + boundingBox.minX;
-                float maxX1 = position.x + boundingBox.maxX;
-                float minY1 = position.y + boundingBox.minY;
-                float maxY1 = position.y + boundingBox.maxY;
-                float minZ1 = position.z + boundingBox.minZ;
-                float maxZ1 = position.z + boundingBox.maxZ;
-
-                float minX2 = obstaclePos.x + obstacleBox.minX;
-                float maxX2 = obstaclePos.x + obstacleBox.maxX;
-                float minY2 = obstaclePos.y + obstacleBox.minY;
-                float maxY2 = obstaclePos.y + obstacleBox.maxY;
-                float minZ2 = obstaclePos.z + obstacleBox.minZ;
-                float maxZ2 = obstaclePos.z + obstacleBox.maxZ;
-
-                if (minX1 <= maxX2 && maxX1 >= minX2 &&
-                    minY1 <= maxY2 && maxY1 >= minY2 &&
-                    minZ1 <= maxZ2 && maxZ1 >= minZ2) {
-
-                    // Using the Minimum Translation Vector (MTV) approach, 
-                    // the idea is the shortest overlap would be the direction in which we collided (not always true but it works in practice),
-                    // therefore we resolve in this direction (we translate our entity by the depth of the overlap).
-
-                    float overlapX = std::min(maxX1, maxX2) - std::max(minX1, minX2);
-                    float overlapY = std::min(maxY1, maxY2) - std::max(minY1, minY2);
-                    float overlapZ = std::min(maxZ1, maxZ2) - std::max(minZ1, minZ2);
-
-                    glm::vec3 normal(0.0f);
-                    float depth = 0.0f;
-
-                    if (overlapX < overlapY && overlapX < overlapZ) {
-                        depth = overlapX;
-                        if (position.x < obstaclePos.x) normal = glm::vec3(-1, 0, 0);
-                        else normal = glm::vec3(1, 0, 0);
-                    } else if (overlapY < overlapZ) {
-                        depth = overlapY;
-                        if (position.y < obstaclePos.y) normal = glm::vec3(0, -1, 0);
-                        else normal = glm::vec3(0, 1, 0);
-                    } else {
-                        depth = overlapZ;
-                        if (position.z < obstaclePos.z) normal = glm::vec3(0, 0, -1);
-                        else normal = glm::vec3(0, 0, 1);
-                    }
-
-                    // TODO: THIS IS A BAD HACK AND NEEDS TO BE CHANGED, SEPERATE THEM INTO SYSTEMS OR SOMETHING IDK - WE SHOULD KEEP THE MANIFOLD
-                    if (bulletSet.hasComponent(entity)) {
-                        if (deleteBuffer.size < deleteBuffer.capacity) deleteBuffer.buffer[deleteBuffer.size++] = entity;
-                        if (healthSet.hasComponent(obstacleEntity)) {
-                            --healthSet.getComponent(obstacleEntity).health;
-                        }
-                    } else if (physicsManifold.size < physicsManifold.capacity && !bulletSet.hasComponent(obstacleEntity)) {
-                        physicsManifold.buffer[physicsManifold.size++] =
-                            PhysicsManifoldEntry{.entityID = entity, .depth = depth, .collisionNormal = normal};
-                    }
-
-                }
-            }
+            glm::vec3 obstaclePos = glm::vec3(transforms.getComponent(obstacleEntity).position);
+            const CollisionComponent& obstacleBox = boxes.getComponent(obstacleEntity);
+
+            float minX2 = obstaclePos.x + obstacleBox.minX;
+            float maxX2 = obstaclePos.x + obstacleBox.maxX;
+            float minY2 = obstaclePos.y + obstacleBox.minY;
+            float maxY2 = obstaclePos.y + obstacleBox.maxY;
+            float minZ2 = obstaclePos.z + obstacleBox.minZ;
+            float maxZ2 = obstaclePos.z + obstacleBox.maxZ;
+
+            bool overlapping = minX1 <= maxX2 && maxX1 >= minX2 &&
+                               minY1 <= maxY2 && maxY1 >= minY2 &&
+                               minZ1 <= maxZ2 && maxZ1 >= minZ2 && entity != obstacleEntity;
+
+            glm::vec3 overlap(std::min(maxX1, maxX2) - std::max(minX1, minX2),
+                              std::min(maxY1, maxY2) - std::max(minY1, minY2),
+                              std::min(maxZ1, maxZ2) - std::max(minZ1, minZ2));
+            glm::vec3 normal;
+            float depth;
+            minimumTranslation(overlap, position, obstaclePos, normal, depth);
+
+            out[count] = Contact{entity, obstacleEntity, normal, depth, ContactState::Enter, 0.0f, UINT32_MAX};
+            count += overlapping;
         }
+        contacts.count = count;
     }
+    endContacts(contacts, sleep.asleep);
 }
 
-void resolveCollisions(CollisionPhysicsManifold& physicsManifold, SparseSet<TransformComponent>& transformSet, 
-                       SparseSet<VelocityComponent>& velocitySet) {
-    for (int i = 0; i < physicsManifold.size; ++i) {
-        uint32_t entity = physicsManifold.buffer[i].entityID;
-        float depth = physicsManifold.buffer[i].depth;
-        const glm::vec3& normal = physicsManifold.buffer[i].collisionNormal; 
-        glm::vec3& velocity = velocitySet.getComponent(entity).velocity;
-        glm::vec3& position = transformSet.getComponent(entity).position;
-
-        velocity = velocity - (glm::dot(velocity, normal) * normal);
-        position = position + (normal * depth);
+void bulletHitSystem(const ContactStream& contacts, SparseSet<BulletTag>& bulletSet, SparseSet<HealthComponent>& healthSet,
+                     DeleteBuffer& deleteBuffer, EventQueue& gameEvents) {
+    for (uint32_t i = 0; i < contacts.count; ++i) {
+        const Contact& contact = contacts.contacts[i];
+        if (contact.state != ContactState::Enter || !bulletSet.hasComponent(contact.entity)) continue;
+        if (deleteBuffer.size < deleteBuffer.capacity) deleteBuffer.buffer[deleteBuffer.size++] = contact.entity;
+        if (healthSet.hasComponent(contact.other)) {
+            pushEvent(gameEvents, Event{.type = EventType::Damage, .damage = {contact.other, contact.entity, 1}});
+        }
     }
 }
 
-
-void healthSystem(SparseSet<HealthComponent>& healthSet, DeleteBuffer& deleteBuffer) {
+// Catches health set to nothing outside of damage, from the editor or a loaded scene.
+void healthSystem(SparseSet<HealthComponent>& healthSet, EventQueue& gameEvents) {
     for (int i = 0; i < healthSet.entityCount; ++i) {
-        if (healthSet.dense[i].health <= 0 && deleteBuffer.size < deleteBuffer.capacity) {
-            deleteBuffer.buffer[deleteBuffer.size++] = healthSet.entities[i];
+        if (healthSet.dense[i].health <= 0) {
+            pushEvent(gameEvents, Event{.type = EventType::Death, .death = {healthSet.entities[i]}});
         }
     }
 }
 
+static void onDamage(const Event* events, uint32_t count, void* context) {
+    ECS& scene = *static_cast<ECS*>(context);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t target = events[i].damage.target;
+        if (!scene.healthSet.hasComponent(target)) continue;
+        int32_t& health = scene.healthSet.getComponent(target).health;
+        bool wasAlive = health > 0;
+        health -= events[i].damage.amount;
+        if (wasAlive && health <= 0) pushEvent(scene.gameEvents, Event{.type = EventType::Death, .death = {target}});
+    }
+}
+
+static void onDeath(const Event* events, uint32_t count, void* context) {
+    DeleteBuffer& deleteBuffer = static_cast<ECS*>(context)->deleteBuffer;
+    for (uint32_t i = 0; i < count && deleteBuffer.size < deleteBuffer.capacity; ++i) {
+        deleteBuffer.buffer[deleteBuffer.size++] = events[i].death.entity;
+    }
+}
+
+void subscribeGameplayEvents(EventQueue& gameEvents) {
+    clearEventHandlers(gameEvents);
+    subscribeEvents(gameEvents, EventType::Damage, onDamage);
+    subscribeEvents(gameEvents, EventType::Death, onDeath);
+}
+
 // TODO: FIGURE OUT A SMART WAY TO DO THIS - PROBABLY COMES AFTER THE ARENA SET UP - AND ALSO MAKE 0 INVALID
 void deleteSystem(ECS& scene) {
     uint32_t* deleteBuffer = scene.deleteBuffer.buffer;
@@ -124,6 +231,7 @@ void deleteSystem(ECS& scene) {
     for (uint32_t i = 0; i < size; ++i) {
         if (deleteBuffer[i] == last) continue;
         scene.transformSet.remove(deleteBuffer[i]);
+        resetBody(scene.bodySleep, deleteBuffer[i]);
         scene.freeStack[scene.freeStackSize++] = deleteBuffer[i]; // This is fine but only because everything has a transform, the delete system will be reworked.
         last = deleteBuffer[i];
     }
@@ -253,4 +361,11 @@ void deleteSystem(ECS& scene) {
         scene.nameSet.remove(deleteBuffer[i]);
         last = deleteBuffer[i];
     }
+
+    last = UINT32_MAX;
+    for (uint32_t i = 0; i < size; ++i) {
+        if (deleteBuffer[i] == last) continue;
+        scene.occluderSet.remove(deleteBuffer[i]);
+        last = deleteBuffer[i];
+    }
 }
\ No newline at end of file
@@ -2,6 +2,9 @@
 #include <cstdint>
 #include <glm/glm.hpp>
 #include "sparse_set.h"
+#include "events.h"
+#include "contact_stream.h"
+#include "contact_solver.h"
 
 struct ECS;
 struct CollisionComponent;
@@ -11,32 +14,25 @@ struct BulletTag;
 struct HealthComponent;
 struct VelocityComponent;
 
-struct PhysicsManifoldEntry {
-    uint32_t entityID;
-    float depth;
-    glm::vec3 collisionNormal;
-};
-
-// TODO: The capacity and size of these can probably be 16 bit - but we can leave it for now - MAKE THESE ONE BUFFER STRUCT?
-struct CollisionPhysicsManifold {
-    static constexpr uint32_t capacity = 64;
-    uint32_t size = 0;
-    PhysicsManifoldEntry buffer[capacity];
-};
-
 struct DeleteBuffer {
     static constexpr uint32_t capacity = 64;
     uint32_t size = 0;
     uint32_t buffer[capacity];
 };
 
+// The narrowphase, writes every overlap of a dynamic entity into the contact stream and nothing else. Runs after
+// movement, entities that moved far for their size this tick are swept along that move instead. Sleeping ones are skipped.
 void collisionSystem(SparseSet<CollisionComponent>& collisionSet, SparseSet<TransformComponent>& transformSet,
-                     SparseSet<DynamicTag>& dynamicSet, SparseSet<BulletTag>& bulletSet, SparseSet<HealthComponent>& healthSet,
-                     CollisionPhysicsManifold& physicsManifold, DeleteBuffer& deleteBuffer);
+                     SparseSet<DynamicTag>& dynamicSet, const SparseSet<VelocityComponent>& velocitySet, float deltaTime,
+                     const BodySleepState& sleep, ContactStream& contacts);
+
+// A bullet is deleted when it starts touching something and damages it if it has health.
+void bulletHitSystem(const ContactStream& contacts, SparseSet<BulletTag>& bulletSet, SparseSet<HealthComponent>& healthSet,
+                     DeleteBuffer& deleteBuffer, EventQueue& gameEvents);
 
-void resolveCollisions(CollisionPhysicsManifold& physicsManifold, SparseSet<TransformComponent>& transformSet,
-                       SparseSet<VelocityComponent>& velocitySet);
+void healthSystem(SparseSet<HealthComponent>& healthSet, EventQueue& gameEvents);
 
-void healthSystem(SparseSet<HealthComponent>& healthSet, DeleteBuffer& deleteBuffer);
+// Damage kills, the dead go to the delete buffer. The handlers expect the ECS as context.
+void subscribeGameplayEvents(EventQueue& gameEvents);
 
 void deleteSystem(ECS& scene);
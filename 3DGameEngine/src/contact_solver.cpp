@@ -0,0 +1,169 @@
+#include "contact_solver.h"
+#include "entity.h"
+
+static void wakeIsland(BodySleepState& sleep, const SparseSet<DynamicTag>& dynamicSet, uint32_t island) {
+    for (uint32_t i = 0; i < dynamicSet.entityCount; ++i) {
+        uint32_t entity = dynamicSet.entities[i];
+        if (sleep.asleep[entity] && sleep.island[entity] == island) resetBody(sleep, entity);
+    }
+}
+
+void wakeMovedBodies(BodySleepState& sleep, const SparseSet<DynamicTag>& dynamicSet, const SparseSet<VelocityComponent>& velocitySet) {
+    if (sleep.sleepingCount == 0) return;
+    for (uint32_t i = 0; i < dynamicSet.entityCount; ++i) {
+        uint32_t entity = dynamicSet.entities[i];
+        if (!sleep.asleep[entity] || !velocitySet.hasComponent(entity)) continue;
+        const glm::vec3& velocity = velocitySet.getComponent(entity).velocity;
+        if (glm::dot(velocity, velocity) > 0.0f) wakeIsland(sleep, dynamicSet, sleep.island[entity]);
+    }
+}
+
+void wakeTouchedBodies(BodySleepState& sleep, const SparseSet<DynamicTag>& dynamicSet, const SparseSet<VelocityComponent>& velocitySet,
+                       const SparseSet<CollisionComponent>& collisionSet, const SparseSet<TransformComponent>& transformSet,
+                       float deltaTime) {
+    if (sleep.sleepingCount == 0) return;
+    for (uint32_t i = 0; i < velocitySet.entityCount; ++i) {
+        uint32_t mover = velocitySet.entities[i];
+        const glm::vec3& velocity = velocitySet.dense[i].velocity;
+        if (dynamicSet.hasComponent(mover) || !collisionSet.hasComponent(mover) || glm::dot(velocity, velocity) == 0.0f) continue;
+        // Covers the whole move, a fast one could otherwise pass a sleeper within one tick.
+        const CollisionComponent& box = collisionSet.getComponent(mover);
+        glm::vec3 end = transformSet.getComponent(mover).position;
+        glm::vec3 start = end - velocity * deltaTime;
+        glm::vec3 moverMin = glm::min(start, end) + glm::vec3(box.minX, box.minY, box.minZ);
+        glm::vec3 moverMax = glm::max(start, end) + glm::vec3(box.maxX, box.maxY, box.maxZ);
+        for (uint32_t j = 0; j < dynamicSet.entityCount; ++j) {
+            uint32_t entity = dynamicSet.entities[j];
+            if (!sleep.asleep[entity] || !collisionSet.hasComponent(entity)) continue;
+            const CollisionComponent& sleeper = collisionSet.getComponent(entity);
+            glm::vec3 position = transformSet.getComponent(entity).position;
+            glm::vec3 sleeperMin = position + glm::vec3(sleeper.minX, sleeper.minY, sleeper.minZ);
+            glm::vec3 sleeperMax = position + glm::vec3(sleeper.maxX, sleeper.maxY, sleeper.maxZ);
+            if (glm::all(glm::lessThanEqual(moverMin, sleeperMax)) && glm::all(glm::greaterThanEqual(moverMax, sleeperMin))) {
+                wakeIsland(sleep, dynamicSet, sleep.island[entity]);
+            }
+        }
+        if (sleep.sleepingCount == 0) return;
+    }
+}
+
+static uint32_t findIsland(BodySleepState& sleep, uint32_t entity) {
+    while (sleep.island[entity] != entity) {
+        sleep.island[entity] = sleep.island[sleep.island[entity]];
+        entity = sleep.island[entity];
+    }
+    return entity;
+}
+
+// A contact the solver works on. Only a pair's two bodies and their inverse masses are needed, without rotation the
+// effective mass along the normal is just their sum.
+struct SolverContact {
+    Contact* contact;
+    glm::vec3* velocityA;
+    glm::vec3* velocityB; // Null against something that doesn't move.
+    float inverseMassB;
+    float normalMass;
+};
+
+void solveContacts(ContactStream& contacts, const SparseSet<DynamicTag>& dynamicSet, const SparseSet<BulletTag>& bulletSet,
+                   SparseSet<TransformComponent>& transformSet, SparseSet<VelocityComponent>& velocitySet, BodySleepState& sleep) {
+    auto isBody = [&](uint32_t entity) { return dynamicSet.hasComponent(entity) && velocitySet.hasComponent(entity); };
+
+    // Touching a sleeping body wakes its island, it is solved from this frame on.
+    for (uint32_t i = 0; i < contacts.count; ++i) {
+        const Contact& contact = contacts.contacts[i];
+        if (contact.state != ContactState::Exit && sleep.asleep[contact.other] && dynamicSet.hasComponent(contact.other)) {
+            wakeIsland(sleep, dynamicSet, sleep.island[contact.other]);
+        }
+    }
+    for (uint32_t i = 0; i < dynamicSet.entityCount; ++i) {
+        uint32_t entity = dynamicSet.entities[i];
+        if (!sleep.asleep[entity]) sleep.island[entity] = entity;
+    }
+
+    // The solver works in the contact arena, right after the contacts.
+    size_t solverBytes = contacts.count * sizeof(SolverContact) + alignof(SolverContact);
+    reserveContacts(contacts, (uint32_t)((solverBytes + sizeof(Contact) - 1) / sizeof(Contact)));
+    uintptr_t solverStart = (uintptr_t)(contacts.contacts + contacts.count);
+    solverStart = (solverStart + alignof(SolverContact) - 1) & ~(uintptr_t)(alignof(SolverContact) - 1);
+    SolverContact* solverContacts = (SolverContact*)solverStart;
+    uint32_t solverCount = 0;
+    for (uint32_t i = 0; i < contacts.count; ++i) {
+        Contact& contact = contacts.contacts[i];
+        if (contact.state == ContactState::Exit || sleep.asleep[contact.entity] || !isBody(contact.entity)) continue;
+        if (bulletSet.hasComponent(contact.entity) || bulletSet.hasComponent(contact.other)) continue;
+        bool otherIsBody = isBody(contact.other);
+        // Two bodies find each other from both sides, one of the two contacts is enough. A body that was asleep in the
+        // narrowphase, or that a sweep hit without touching it where it ended up, leaves this one the only one.
+        if (otherIsBody && contact.other < contact.entity && findContact(contacts, contact.other, contact.entity)) continue;
+        if (otherIsBody) {
+            uint32_t a = findIsland(sleep, contact.entity);
+            uint32_t b = findIsland(sleep, contact.other);
+            if (a != b) sleep.island[a] = b;
+        }
+        float inverseMassB = otherIsBody ? 1.0f : 0.0f;
+        solverContacts[solverCount++] = SolverContact{&contact, &velocitySet.getComponent(contact.entity).velocity,
+                                                      otherIsBody ? &velocitySet.getComponent(contact.other).velocity : nullptr,
+                                                      inverseMassB, 1.0f / (1.0f + inverseMassB)};
+    }
+
+    auto applyImpulse = [](SolverContact& solver, float impulse) {
+        glm::vec3 push = solver.contact->normal * impulse;
+        *solver.velocityA += push;
+        if (solver.velocityB) *solver.velocityB -= push * solver.inverseMassB;
+    };
+    for (uint32_t i = 0; i < solverCount; ++i) applyImpulse(solverContacts[i], solverContacts[i].contact->impulse);
+    for (uint32_t iteration = 0; iteration < SOLVER_ITERATIONS; ++iteration) {
+        for (uint32_t i = 0; i < solverCount; ++i) {
+            SolverContact& solver = solverContacts[i];
+            glm::vec3 relative = *solver.velocityA - (solver.velocityB ? *solver.velocityB : glm::vec3(0.0f));
+            float normalSpeed = glm::dot(relative, solver.contact->normal);
+            float previous = solver.contact->impulse;
+            solver.contact->impulse = std::max(previous - normalSpeed * solver.normalMass, 0.0f);
+            applyImpulse(solver, solver.contact->impulse - previous);
+        }
+    }
+    for (uint32_t i = 0; i < solverCount; ++i) {
+        const SolverContact& solver = solverContacts[i];
+        const Contact& contact = *solver.contact;
+        float correction = std::max(contact.depth - CONTACT_SLOP, 0.0f) * solver.normalMass;
+        transformSet.getComponent(contact.entity).position += contact.normal * correction;
+        if (solver.velocityB) transformSet.getComponent(contact.other).position -= contact.normal * correction * solver.inverseMassB;
+    }
+    cacheContactImpulses(contacts);
+
+    // An island sleeps once its most recently moving body has been resting for long enough.
+    for (uint32_t i = 0; i < dynamicSet.entityCount; ++i) {
+        uint32_t entity = dynamicSet.entities[i];
+        if (sleep.asleep[entity] || !velocitySet.hasComponent(entity)) continue;
+        const glm::vec3& velocity = velocitySet.getComponent(entity).velocity;
+        bool resting = glm::dot(velocity, velocity) < SLEEP_SPEED * SLEEP_SPEED;
+        sleep.restingFrames[entity] = resting ? std::min<uint16_t>(sleep.restingFrames[entity] + 1, SLEEP_FRAMES) : 0;
+    }
+    // Roots start out ready and are held back by any member that isn't.
+    bool* islandReady = sleep.islandReady;
+    sleep.islandCount = 0;
+    for (uint32_t i = 0; i < dynamicSet.entityCount; ++i) {
+        uint32_t entity = dynamicSet.entities[i];
+        if (sleep.asleep[entity]) continue;
+        uint32_t root = findIsland(sleep, entity);
+        if (root == entity) {
+            islandReady[root] = true;
+            ++sleep.islandCount;
+        }
+    }
+    for (uint32_t i = 0; i < dynamicSet.entityCount; ++i) {
+        uint32_t entity = dynamicSet.entities[i];
+        if (sleep.asleep[entity]) continue;
+        bool ready = velocitySet.hasComponent(entity) && sleep.restingFrames[entity] >= SLEEP_FRAMES;
+        islandReady[findIsland(sleep, entity)] &= ready;
+    }
+    for (uint32_t i = 0; i < dynamicSet.entityCount; ++i) {
+        uint32_t entity = dynamicSet.entities[i];
+        if (sleep.asleep[entity] || !islandReady[findIsland(sleep, entity)]) continue;
+        sleep.asleep[entity] = true;
+        sleep.island[entity] = findIsland(sleep, entity);
+        velocitySet.getComponent(entity).velocity = glm::vec3(0.0f);
+        ++sleep.sleepingCount;
+    }
+}
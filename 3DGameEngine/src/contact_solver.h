@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include "sparse_set.h"
+#include "contact_stream.h"
+
+struct TransformComponent;
+struct VelocityComponent;
+struct CollisionComponent;
+struct DynamicTag;
+struct BulletTag;
+
+// Sequential impulses on the contact stream. Dynamic bodies with a velocity have unit mass, everything else doesn't move.
+// Every contact starts from the impulse its pair ended on last frame, then a few passes over all contacts each correct
+// the relative normal velocity of one pair while keeping its total impulse pushing, never pulling. Penetration past
+// the slop is pushed out directly afterwards.
+// Dynamic bodies touching each other form islands. An island whose bodies all stayed slow for long enough sleeps as a
+// whole: its bodies keep their last contacts and skip movement, the narrowphase and the solver until something touches
+// them or gives one of them a velocity.
+static constexpr uint32_t SOLVER_ITERATIONS = 8;
+static constexpr float CONTACT_SLOP = 0.005f;
+static constexpr float SLEEP_SPEED = 0.05f;
+static constexpr uint16_t SLEEP_FRAMES = 30;
+
+// Indexed by entity, kept outside the ECS arena since none of it is saved or snapshotted.
+struct BodySleepState {
+    bool asleep[MAX_ENTITIES];
+    uint16_t restingFrames[MAX_ENTITIES];
+    uint32_t island[MAX_ENTITIES]; // The island's root while solving, the island it fell asleep in after.
+    bool islandReady[MAX_ENTITIES];
+    uint32_t sleepingCount = 0;
+    uint32_t islandCount = 0;
+};
+
+inline void wakeAllBodies(BodySleepState& sleep) {
+    memset(sleep.asleep, 0, sizeof(sleep.asleep));
+    memset(sleep.restingFrames, 0, sizeof(sleep.restingFrames));
+    sleep.sleepingCount = 0;
+}
+
+inline void resetBody(BodySleepState& sleep, uint32_t entity) {
+    sleep.sleepingCount -= sleep.asleep[entity];
+    sleep.asleep[entity] = false;
+    sleep.restingFrames[entity] = 0;
+}
+
+// Wakes the islands of sleeping bodies that were given a velocity since they fell asleep. Runs before movement.
+void wakeMovedBodies(BodySleepState& sleep, const SparseSet<DynamicTag>& dynamicSet, const SparseSet<VelocityComponent>& velocitySet);
+// Wakes the islands of sleeping bodies overlapped by a moving collider that isn't a body, like a patrolling platform.
+// Those never run the narrowphase themselves, so nothing else would notice. Runs after movement, before the narrowphase.
+void wakeTouchedBodies(BodySleepState& sleep, const SparseSet<DynamicTag>& dynamicSet, const SparseSet<VelocityComponent>& velocitySet,
+                       const SparseSet<CollisionComponent>& collisionSet, const SparseSet<TransformComponent>& transformSet,
+                       float deltaTime);
+
+void solveContacts(ContactStream& contacts, const SparseSet<DynamicTag>& dynamicSet, const SparseSet<BulletTag>& bulletSet,
+                   SparseSet<TransformComponent>& transformSet, SparseSet<VelocityComponent>& velocitySet, BodySleepState& sleep);
@@ -0,0 +1,138 @@
+#include "contact_stream.h"
+#include <cstdlib>
+#include <cstring>
+
+static constexpr uint64_t EMPTY_PAIR = UINT64_MAX;
+static constexpr uint32_t MIN_CONTACT_CAPACITY = 1024;
+
+static uint64_t pairKey(uint32_t entity, uint32_t other) {
+    return ((uint64_t)entity << 32) | other;
+}
+
+static uint32_t pairSlot(uint64_t key, uint32_t capacity) {
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (capacity - 1);
+}
+
+// Returns the pair's slot, or UINT32_MAX when it isn't there.
+static uint32_t findPair(const ContactPairSet& set, uint64_t key) {
+    if (set.capacity == 0) return UINT32_MAX;
+    for (uint32_t slot = pairSlot(key, set.capacity);; slot = (slot + 1) & (set.capacity - 1)) {
+        if (set.keys[slot] == key) return slot;
+        if (set.keys[slot] == EMPTY_PAIR) return UINT32_MAX;
+    }
+}
+
+static uint32_t insertPair(ContactPairSet& set, uint64_t key, float impulse, uint32_t contact) {
+    uint32_t slot = pairSlot(key, set.capacity);
+    while (set.keys[slot] != EMPTY_PAIR && set.keys[slot] != key) slot = (slot + 1) & (set.capacity - 1);
+    set.count += set.keys[slot] == EMPTY_PAIR;
+    set.keys[slot] = key;
+    set.impulses[slot] = impulse;
+    set.contacts[slot] = contact;
+    return slot;
+}
+
+// Keeps the load under a half.
+static void resetPairSet(ContactPairSet& set, uint32_t pairCount) {
+    uint32_t capacity = set.capacity ? set.capacity : 64;
+    while (capacity < pairCount * 2) capacity *= 2;
+    if (capacity != set.capacity) {
+        free(set.keys);
+        free(set.impulses);
+        free(set.contacts);
+        set.keys = (uint64_t*)malloc(capacity * sizeof(uint64_t));
+        set.impulses = (float*)malloc(capacity * sizeof(float));
+        set.contacts = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+        set.capacity = capacity;
+    }
+    memset(set.keys, 0xFF, capacity * sizeof(uint64_t));
+    set.count = 0;
+}
+
+void beginContacts(ContactStream& stream) {
+    stream.currentPairs ^= 1;
+    stream.count = 0;
+    stream.enterCount = 0;
+    stream.exitCount = 0;
+}
+
+void reserveContacts(ContactStream& stream, uint32_t additional) {
+    if (stream.count + additional <= stream.capacity) return;
+    uint32_t capacity = stream.capacity ? stream.capacity : MIN_CONTACT_CAPACITY;
+    while (capacity < stream.count + additional) capacity *= 2;
+
+    Arena arena;
+    arena.init(capacity * sizeof(Contact) + alignof(Contact));
+    Contact* contacts = (Contact*)arena.alloc(capacity * sizeof(Contact), alignof(Contact));
+    if (stream.count > 0) memcpy(contacts, stream.contacts, stream.count * sizeof(Contact));
+    free(stream.arena.base);
+    stream.arena = arena;
+    stream.contacts = contacts;
+    stream.capacity = capacity;
+}
+
+void endContacts(ContactStream& stream, const bool* asleep) {
+    ContactPairSet& current = stream.pairs[stream.currentPairs];
+    const ContactPairSet& previous = stream.pairs[stream.currentPairs ^ 1];
+    resetPairSet(current, stream.count + previous.count);
+
+    for (uint32_t i = 0; i < stream.count; ++i) {
+        Contact& contact = stream.contacts[i];
+        uint64_t key = pairKey(contact.entity, contact.other);
+        uint32_t previousSlot = findPair(previous, key);
+        bool touching = previousSlot != UINT32_MAX;
+        contact.state = touching ? ContactState::Stay : ContactState::Enter;
+        contact.impulse = touching ? previous.impulses[previousSlot] : 0.0f;
+        contact.pair = insertPair(current, key, contact.impulse, i);
+        stream.enterCount += !touching;
+    }
+
+    for (uint32_t slot = 0; slot < previous.capacity; ++slot) {
+        uint64_t key = previous.keys[slot];
+        if (key == EMPTY_PAIR || findPair(current, key) != UINT32_MAX) continue;
+        uint32_t entity = (uint32_t)(key >> 32);
+        if (asleep && asleep[entity]) {
+            insertPair(current, key, previous.impulses[slot], UINT32_MAX);
+            continue;
+        }
+        reserveContacts(stream, 1);
+        stream.contacts[stream.count++] =
+            Contact{entity, (uint32_t)key, glm::vec3(0.0f), 0.0f, ContactState::Exit, 0.0f, UINT32_MAX};
+        ++stream.exitCount;
+    }
+}
+
+void cacheContactImpulses(ContactStream& stream) {
+    ContactPairSet& current = stream.pairs[stream.currentPairs];
+    for (uint32_t i = 0; i < stream.count; ++i) {
+        const Contact& contact = stream.contacts[i];
+        if (contact.state != ContactState::Exit) current.impulses[contact.pair] = contact.impulse;
+    }
+}
+
+Contact* findContact(ContactStream& stream, uint32_t entity, uint32_t other) {
+    const ContactPairSet& current = stream.pairs[stream.currentPairs];
+    uint32_t slot = findPair(current, pairKey(entity, other));
+    if (slot == UINT32_MAX || current.contacts[slot] == UINT32_MAX) return nullptr;
+    return &stream.contacts[current.contacts[slot]];
+}
+
+void resetContactPairs(ContactStream& stream) {
+    for (ContactPairSet& set : stream.pairs) {
+        if (set.capacity > 0) memset(set.keys, 0xFF, set.capacity * sizeof(uint64_t));
+        set.count = 0;
+    }
+    stream.count = 0;
+    stream.enterCount = 0;
+    stream.exitCount = 0;
+}
+
+void freeContactStream(ContactStream& stream) {
+    free(stream.arena.base);
+    for (ContactPairSet& set : stream.pairs) {
+        free(set.keys);
+        free(set.impulses);
+        free(set.contacts);
+    }
+    stream = ContactStream{};
+}
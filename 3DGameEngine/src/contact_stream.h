@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "sparse_set.h"
+
+// Every overlap the narrowphase finds in a frame, in one array in its own arena that grows before the narrowphase could
+// run out of room, so no contact is ever dropped. Pairs are remembered from one frame to the next to tell a contact
+// that just started from one that carries on, and the pairs that stopped touching are appended as Exit contacts.
+// Each pair also keeps the impulse the solver ended on, the next frame's solve starts from it.
+
+enum class ContactState : uint8_t {
+    Enter,
+    Stay,
+    Exit
+};
+
+struct Contact {
+    uint32_t entity; // The dynamic one.
+    uint32_t other;
+    glm::vec3 normal; // Pushes entity out of other, zero for Exit.
+    float depth;
+    ContactState state;
+    float impulse; // Accumulated along the normal, carried over from last frame for Stay.
+    uint32_t pair; // Slot in this frame's pair set.
+};
+
+// Open addressing on (entity << 32 | other), an empty slot holds UINT64_MAX.
+struct ContactPairSet {
+    uint64_t* keys = nullptr;
+    float* impulses = nullptr;
+    uint32_t* contacts = nullptr; // The pair's contact in the stream, UINT32_MAX for a sleeping body's pair kept without one.
+    uint32_t capacity = 0;
+    uint32_t count = 0;
+};
+
+struct ContactStream {
+    Arena arena = {};
+    Contact* contacts = nullptr;
+    uint32_t count = 0;
+    uint32_t capacity = 0;
+
+    ContactPairSet pairs[2]; // This frame's and last frame's, swapped every frame.
+    uint32_t currentPairs = 0;
+    uint32_t enterCount = 0;
+    uint32_t exitCount = 0;
+};
+
+void beginContacts(ContactStream& stream);
+// Makes room for this many more contacts past count, moving the ones already written if the arena has to grow.
+void reserveContacts(ContactStream& stream, uint32_t additional);
+// Sets every contact's state against last frame's pairs and appends the exits. The pairs of entities flagged in
+// asleep (indexed by entity, can be null) weren't tested this frame and are kept as they were instead.
+void endContacts(ContactStream& stream, const bool* asleep = nullptr);
+// Stores every contact's impulse with its pair for the next frame.
+void cacheContactImpulses(ContactStream& stream);
+// This frame's Enter or Stay contact for the pair, null when the narrowphase didn't write one.
+Contact* findContact(ContactStream& stream, uint32_t entity, uint32_t other);
+// Forgets every contact and pair, for when the sets were replaced and last frame's contacts no longer apply.
+void resetContactPairs(ContactStream& stream);
+void freeContactStream(ContactStream& stream);
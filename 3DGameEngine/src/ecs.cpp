@@ -12,10 +12,14 @@
 #include <GLFW/glfw3.h>
 #include <cstdio>
 #include "asset_manager.h"
+#include "asset_pack.h"
 #include <chrono>
 #include <iostream>
 
 void initState(ECS& scene) {
+    startAssetLoader(scene.assetLoader);
+    startTextureStreamer(scene.textureStreamer);
+    startOccluderRasterizer(scene.occluderRasterizer);
     scene.arena.init(ARENA_SIZE);
     scene.transformSet.init(scene.arena, CAPACITY_TRANSFORM);
     scene.meshSet.init(scene.arena, CAPACITY_MESH);
@@ -36,22 +40,31 @@ void initState(ECS& scene) {
     scene.healthSet.init(scene.arena, CAPACITY_HEALTH);
     scene.inputMapSet.init(scene.arena, CAPACITY_INPUT_MAP);
     scene.nameSet.init(scene.arena, CAPACITY_NAME);
+    scene.occluderSet.init(scene.arena, CAPACITY_OCCLUDER);
+    initAABBTree(scene.renderTree, MAX_ENTITIES);
 
     scene.window.width = 1600;
     scene.window.height = 1200;
     scene.window.title = "PROTOPLAY";
-    scene.window.windowPtr = createWindow(scene.window.width, scene.window.height, scene.window.title);
+    scene.window.windowPtr = createWindow(scene.window.width, scene.window.height, scene.window.title, !scene.inputReplay.headless);
     initOpenglRenderState();
-    initDefaultMaterials(scene.materialBuffer, scene.materialSSBODataBuffer);
+    initShaderCache("shader_cache");
+    if (!mountAssetPack("assets.pack")) {
+        std::cout << "No assets.pack, loading loose files" << std::endl;
+    }
+    initDefaultMaterials(scene.materialBuffer, scene.materialSSBODataBuffer, scene.assetLoader);
     scene.materialSSBO = initMaterialSSBO(scene.materialSSBODataBuffer);
     scene.cubePrimitiveIndex = createUnitCubePrimitive(scene.meshBuffer);
     initMeshes(scene.meshBuffer);
     scene.framebuffer = createFrameBuffer(createShaderProgram("fb_vertex_shader.vs", "fb_fragment_shader.fs"), scene.window.width, scene.window.height);
+    scene.hiZBuffer = createHiZBuffer(createComputeProgram("hiz_downsample.comp"), createComputeProgram("occlusion_cull.comp"));
     scene.quadVAO = createQuad();
     scene.lightSSBO = createLightSSBO(scene.visiblePointLightBuffer.capacity);
-    scene.skyboxData.cubemapHandle = loadSkyboxCubemap();
+    scene.skyboxData.cubemapHandle = createDefaultCubemap();
+    requestSkyboxCubemap(scene.assetLoader, &scene.skyboxData.cubemapHandle);
     scene.skyboxData.shaderID = createShaderProgram("skybox.vs", "skybox.fs");
     scene.skyboxData.meshVAO = scene.meshBuffer.buffer[3].vao; // TODO: CHANGE
+    scene.skyboxData.indexType = scene.meshBuffer.indexTypes[3];
     scene.sceneUBO = createSceneUBO();
     std::memset(scene.keyStateBuffer, 0, sizeof(scene.keyStateBuffer));
     std::memset(scene.lastKeyStateBuffer, 0, sizeof(scene.lastKeyStateBuffer));
@@ -60,6 +73,7 @@ void initState(ECS& scene) {
     textRenderData.textShaderID = createShaderProgram("text_vertex_shader.vs", "text_fragment_shader.fs");
     parseFont("ariallatin.fnt", textRenderData.glyphs, textRenderData.glyphCount);
     textRenderData.bitmapFontTextureID = loadBitmapFont("ariallatin_0.png", textRenderData.glyphs, textRenderData.glyphCount);
+    finishShaderPrograms();
 
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -72,6 +86,10 @@ void initState(ECS& scene) {
 
     ImGui_ImplGlfw_InitForOpenGL(scene.window.windowPtr, false);
     ImGui_ImplOpenGL3_Init("#version 430");
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - scene.assetLoader.startTime);
+    std::cout << "initState finished in " << elapsed.count() << " ms, " << scene.assetLoader.pendingImages
+              << " images still loading" << std::endl;
 }
 
 void initScene(ECS& scene) {
@@ -96,6 +114,7 @@ void initScene(ECS& scene) {
     scene.renderableSet.add(baseplate, RenderableTag{});
     scene.transformSet.add(baseplate, TransformComponent{.position = glm::vec3(-50, 0, 50)});
     scene.nameSet.add(baseplate, NameComponent{"Baseplate"});
+    scene.occluderSet.add(baseplate, OccluderTag{});
 
     const uint32_t MAT = 0;
 
@@ -125,10 +144,10 @@ void initScene(ECS& scene) {
     scene.pointLightSet.add(l2, {.colour = {1.0f, 1.0f, 1.0f}, .intensity = 1.0f, .radius = 10.0f});
     scene.nameSet.add(l2, NameComponent{"Light 2"});
 
-    createCube(scene, {0.0f, 0.5f, -10.0f}, {20.0f, 1.0f, 1.0f}, MAT);
-    createCube(scene, {0.0f, 0.5f, 2.0f}, {20.0f, 1.0f, 1.0f}, MAT);
-    createCube(scene, {-10.0f, 0.5f, -4.0f}, {1.0f, 1.0f, 12.0f}, MAT);
-    createCube(scene, {10.0f, 0.5f, -4.0f}, {1.0f, 1.0f, 12.0f}, MAT);
+    scene.occluderSet.add(createCube(scene, {0.0f, 0.5f, -10.0f}, {20.0f, 1.0f, 1.0f}, MAT), OccluderTag{});
+    scene.occluderSet.add(createCube(scene, {0.0f, 0.5f, 2.0f}, {20.0f, 1.0f, 1.0f}, MAT), OccluderTag{});
+    scene.occluderSet.add(createCube(scene, {-10.0f, 0.5f, -4.0f}, {1.0f, 1.0f, 12.0f}, MAT), OccluderTag{});
+    scene.occluderSet.add(createCube(scene, {10.0f, 0.5f, -4.0f}, {1.0f, 1.0f, 12.0f}, MAT), OccluderTag{});
 }
 
 void addTextFloat(ECS& scene, const char* text, float value, uint8_t textLength, float xPos, float yPos, float size) {
@@ -10,6 +10,15 @@
 #include "events.h"
 #include "text.h"
 #include "render_system.h"
+#include "aabb_tree.h"
+#include "occlusion_culling.h"
+#include "software_occlusion.h"
+#include "cluster_culling.h"
+#include "async_loader.h"
+#include "texture_streamer.h"
+#include "world_streaming.h"
+#include "snapshot.h"
+#include "input_replay.h"
 
 struct ECS {
     float deltaTime, lastFrame;
@@ -34,6 +43,7 @@ struct ECS {
     SparseSet<HealthComponent> healthSet;
     SparseSet<InputMapComponent> inputMapSet;
     SparseSet<NameComponent> nameSet;
+    SparseSet<OccluderTag> occluderSet;
 
     WindowData window;
     
@@ -42,6 +52,10 @@ struct ECS {
     MaterialBuffer materialBuffer;
     MaterialSSBODataBuffer materialSSBODataBuffer;
     uint32_t materialSSBO;
+    AsyncAssetLoader assetLoader;
+    TextureStreamer textureStreamer;
+    WorldStreamer worldStreamer;
+    SnapshotRing snapshotRing;
 
     uint32_t entityCount = 0;
     uint32_t freeStack[64]; // Right now this is the same capacity as the delete buffer which makes sense,
@@ -49,21 +63,33 @@ struct ECS {
     uint8_t freeStackSize = 0;
 
     Framebuffer framebuffer;
+    HiZBuffer hiZBuffer;
+    OcclusionCullingData occlusionData;
+    OccluderRasterizer occluderRasterizer;
+    uint32_t softwareOccludedCount = 0;
     uint32_t quadVAO;
     
+    WorldBoundsBuffer worldBoundsBuffer;
+    AABBTree renderTree;
     VisibleEntityBuffer visibleEntityBuffer;
+    MeshLODSelection lodSelection;
+    ClusterDrawList clusterDrawList;
+    PointLightBoundsBuffer pointLightBoundsBuffer;
     VisiblePointLightBuffer visiblePointLightBuffer;
     uint32_t lightSSBO;
     SkyboxData skyboxData;
     uint32_t sceneUBO;
     SceneUBOData sceneData;
 
-    CollisionPhysicsManifold physicsManifold;
+    ContactStream contacts;
+    BodySleepState bodySleep;
     DeleteBuffer deleteBuffer;
     // TODO: so the idea is that allowing 0 as null will make it easier to have a null mapping, but I need to check performance compared to tags.
     float keyStateBuffer[318];
     float lastKeyStateBuffer[318];
     EventQueue eventQueue;
+    EventQueue gameEvents;
+    InputReplay inputReplay;
     MouseData mouseData;
 
     TextBuffer textBuffer;
@@ -72,12 +98,18 @@ struct ECS {
     uint32_t currentCamera;
 
     bool debugMode = true;
+    bool useCullingTree = true;
+    bool useOcclusionCulling = false;
+    bool useSoftwareOcclusion = true;
     int lastPressedGLFWKey = -1;
     int awaitingBind = -1;
     int selectedEntity = -1;
     glm::vec3 pendingDirection = glm::vec3(0.0f, 0.0f, 1.0f);
     float pendingMagnitude = 5.0f;
     char fileNameBuffer[64] = "scene.bin";
+    bool compressScenes = false;
+    char worldFileNameBuffer[64] = "world.bin";
+    float worldCellSize = 32.0f;
 };
 
 void initState(ECS& scene);
@@ -64,6 +64,46 @@ void setGui(ECS& scene) {
     ImGui::Text("Entities: %d", (int)scene.transformSet.entityCount);
     ImGui::Text("Visible Entities: %d", (int)scene.visibleEntityBuffer.size);
     ImGui::Text("Visible Lights: %d", (int)scene.visiblePointLightBuffer.size);
+    ImGui::Checkbox("Hierarchical Culling", &scene.useCullingTree);
+    ImGui::Checkbox("Software Occlusion", &scene.useSoftwareOcclusion);
+    if (scene.useSoftwareOcclusion) ImGui::Text("Software Occluded: %d", (int)scene.softwareOccludedCount);
+    ImGui::Checkbox("Occlusion Culling", &scene.useOcclusionCulling);
+    if (scene.useOcclusionCulling) ImGui::Text("Occluded Entities: %d", (int)scene.occlusionData.occludedCount);
+    ImGui::SliderFloat("LOD Error (px)", &scene.lodSelection.pixelThreshold, 0.0f, 8.0f);
+    ImGui::Text("LODs: %d / %d / %d / %d", (int)scene.lodSelection.lodHistogram[0], (int)scene.lodSelection.lodHistogram[1],
+                (int)scene.lodSelection.lodHistogram[2], (int)scene.lodSelection.lodHistogram[3]);
+    if (scene.assetLoader.pendingImages > 0) ImGui::Text("Images Loading: %d", (int)scene.assetLoader.pendingImages);
+    TextureStreamer& streamer = scene.textureStreamer;
+    ImGui::Text("Texture Memory: %.1f / %.1f MB", streamer.residentBytes / (1024.0f * 1024.0f),
+                streamer.memoryBudgetBytes / (1024.0f * 1024.0f));
+    ImGui::Text("Mips Streamed In: %d, Evicted: %d, Over Budget Frames: %d", (int)streamer.promotions, (int)streamer.evictions,
+                (int)streamer.overBudgetFrames);
+    ImGui::SliderFloat("Texture Mip Bias", &streamer.mipBias, -2.0f, 4.0f);
+    if (ImGui::CollapsingHeader("Streamed Textures")) {
+        for (uint16_t i = 0; i < streamer.textureCount; ++i) {
+            const StreamedTexture& texture = streamer.textures[i];
+            ImGui::Text("Material %d: %ux%u, mip %d resident, %d wanted, %.0f KB", (int)texture.material,
+                        std::max(texture.header.width >> texture.residentMip, 1u),
+                        std::max(texture.header.height >> texture.residentMip, 1u), (int)texture.residentMip,
+                        (int)texture.requestedMip, texture.residentBytes / 1024.0f);
+        }
+    }
+    ImGui::Text("Meshlets Culled: %d / %d", (int)scene.clusterDrawList.culledMeshlets, (int)scene.clusterDrawList.testedMeshlets);
+    ImGui::Text("Contacts: %d, %d started, %d ended", (int)scene.contacts.count, (int)scene.contacts.enterCount,
+                (int)scene.contacts.exitCount);
+    ImGui::Text("Islands: %d awake, %d bodies asleep", (int)scene.bodySleep.islandCount, (int)scene.bodySleep.sleepingCount);
+    if (ImGui::CollapsingHeader("Events")) {
+        static const char* eventNames[EVENT_TYPE_COUNT] = {"Window Resize", "Mouse Move", "Scroll", "Damage", "Death"};
+        for (const EventQueue* queue : {&scene.eventQueue, &scene.gameEvents}) {
+            for (uint32_t type = 0; type < EVENT_TYPE_COUNT; ++type) {
+                const EventChannel& channel = queue->channels[type];
+                uint32_t dropped = channel.dropped.load(std::memory_order_relaxed);
+                if (channel.dispatched == 0 && dropped == 0) continue;
+                ImGui::Text("%s: %d dispatched, largest batch %d, %d dropped", eventNames[type], (int)channel.dispatched,
+                            (int)channel.largestBatch, (int)dropped);
+            }
+        }
+    }
     ImGui::Separator();
 
     int& selectedEntity = scene.selectedEntity;
@@ -104,12 +144,53 @@ void setGui(ECS& scene) {
 
     ImGui::InputText("File Name", scene.fileNameBuffer, sizeof(scene.fileNameBuffer));
     if (ImGui::Button("Save Scene")) {
-        saveScene(scene, scene.fileNameBuffer);
+        saveScene(scene, scene.fileNameBuffer, scene.compressScenes);
     }
+    ImGui::SameLine();
+    ImGui::Checkbox("Compress", &scene.compressScenes);
     if (ImGui::Button("Load Scene")) {
+        // Loading replaces every set, the streamer's entities would be gone from under it.
+        closeWorld(scene.worldStreamer, scene);
         loadScene(scene, scene.fileNameBuffer);
     }
 
+    SnapshotRing& ring = scene.snapshotRing;
+    if (ImGui::Checkbox("Record Snapshots", &ring.recording) && !ring.recording) freeSnapshotRing(ring);
+    if (ring.count > 0) {
+        int framesBack = ring.scrubFrame < 0 ? 0 : ring.scrubFrame;
+        if (ImGui::SliderInt("Rewind Frames", &framesBack, 0, (int)ring.count - 1)) restoreRingSnapshot(ring, scene, (uint32_t)framesBack);
+        if (ring.scrubFrame >= 0) {
+            ImGui::SameLine();
+            if (ImGui::Button("Resume")) resumeFromScrub(ring);
+        }
+        ImGui::Text("History: %d frames, %.1f / %.0f MB", (int)ring.count, snapshotRingBytes(ring) / (1024.0f * 1024.0f),
+                    SNAPSHOT_HISTORY_BYTES / (1024.0f * 1024.0f));
+        ImGui::Text("Recorded: %.1f KB last frame, %.1f KB per frame", ring.lastRecordBytes / 1024.0f, ring.averageRecordBytes / 1024.0f);
+        ImGui::Text("Record %.0f us, restore %.0f us", ring.snapshotMicroseconds, ring.restoreMicroseconds);
+    }
+
+    WorldStreamer& worldStreamer = scene.worldStreamer;
+    ImGui::InputText("World File", scene.worldFileNameBuffer, sizeof(scene.worldFileNameBuffer));
+    ImGui::InputFloat("Cell Size", &scene.worldCellSize);
+    if (ImGui::Button("Save World")) {
+        saveWorld(scene, scene.worldFileNameBuffer, scene.worldCellSize);
+    }
+    if (ImGui::Button("Stream World")) {
+        // Takes the static entities out of the scene first, they'd be doubled if the world was saved from it.
+        closeWorld(worldStreamer, scene);
+        clearWorldEntities(scene);
+        openWorld(worldStreamer, scene, scene.worldFileNameBuffer, 4096);
+    }
+    if (worldStreamer.open) {
+        ImGui::SameLine();
+        if (ImGui::Button("Close World")) closeWorld(worldStreamer, scene);
+        ImGui::SliderInt("Load Radius", &worldStreamer.loadRadius, 0, 8);
+        worldStreamer.unloadRadius = worldStreamer.loadRadius + 1;
+        ImGui::Text("World Cells: %d / %d, Entities: %d / %d", (int)worldStreamer.residentCells, (int)worldStreamer.header.cellCount,
+                    (int)(worldStreamer.entityCapacity - worldStreamer.freeEntities.size()), (int)worldStreamer.entityCapacity);
+        ImGui::Text("Streamed In: %d, Out: %d this frame", (int)worldStreamer.committedThisFrame, (int)worldStreamer.removedThisFrame);
+    }
+
     if (selectedEntity >= 0) {
         uint32_t e = (uint32_t)selectedEntity;
         ImGui::Separator();
@@ -421,6 +502,19 @@ void setGui(ECS& scene) {
         ImGui::EndDisabled();
         if (!renderableReqs) ImGui::TextDisabled("Renderable requires Mesh + Material");
 
+        // Occluder Tag
+        bool occluderReqs = scene.meshSet.hasComponent(e) && scene.transformSet.hasComponent(e);
+        ImGui::BeginDisabled(!occluderReqs);
+        if (scene.occluderSet.hasComponent(e)) {
+            ImGui::Text("[ Occluder ]");
+            ImGui::SameLine();
+            if (ImGui::Button("Remove##Occluder")) scene.occluderSet.remove(e);
+        } else {
+            if (ImGui::Button("Add Occluder")) scene.occluderSet.add(e, OccluderTag{});
+        }
+        ImGui::EndDisabled();
+        if (!occluderReqs) ImGui::TextDisabled("Occluder requires Mesh + Transform");
+
         // Tank Input Tag
         bool tankReqs = scene.velocitySet.hasComponent(e) &&
                         scene.speedSet.hasComponent(e) &&
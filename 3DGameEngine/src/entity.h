@@ -108,3 +108,5 @@ struct PlayerInputNoClipTag {};
 struct BulletTag {};
 
 struct DynamicTag {};
+
+struct OccluderTag {};
@@ -0,0 +1,50 @@
+#include "events.h"
+#include <algorithm>
+
+bool pushEvent(EventQueue& queue, const Event& event) {
+    if (queue.queue.push(event)) return true;
+    queue.channels[(uint32_t)event.type].dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool pollEvent(EventQueue& eventQueue, Event& event) {
+    return eventQueue.queue.pop(event);
+}
+
+bool subscribeEvents(EventQueue& queue, EventType type, EventHandler handler) {
+    EventChannel& channel = queue.channels[(uint32_t)type];
+    if (channel.handlerCount == MAX_EVENT_HANDLERS) return false;
+    channel.handlers[channel.handlerCount++] = handler;
+    return true;
+}
+
+void clearEventHandlers(EventQueue& queue) {
+    for (EventChannel& channel : queue.channels) channel.handlerCount = 0;
+}
+
+static void flushChannel(EventChannel& channel, void* context) {
+    if (channel.size == 0) return;
+    for (uint32_t i = 0; i < channel.handlerCount; ++i) channel.handlers[i](channel.batch, channel.size, context);
+    channel.dispatched += channel.size;
+    channel.largestBatch = std::max(channel.largestBatch, channel.size);
+    channel.size = 0;
+}
+
+uint32_t dispatchEvents(EventQueue& queue, void* context) {
+    uint32_t total = 0;
+    for (uint32_t pass = 0; pass < MAX_DISPATCH_PASSES; ++pass) {
+        uint32_t drained = 0;
+        Event event;
+        while (queue.queue.pop(event)) {
+            EventChannel& channel = queue.channels[(uint32_t)event.type];
+            // A full batch goes out early, the type order only holds within what fits in one.
+            if (channel.size == EVENT_BATCH_CAPACITY) flushChannel(channel, context);
+            channel.batch[channel.size++] = event;
+            ++drained;
+        }
+        if (drained == 0) break;
+        for (EventChannel& channel : queue.channels) flushChannel(channel, context);
+        total += drained;
+    }
+    return total;
+}
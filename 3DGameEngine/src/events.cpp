@@ -5,33 +5,6 @@
 #include "imgui.h"
 #include <glad/glad.h>
 
-bool eventQueueEmpty(EventQueue& queue) {
-    return queue.front == queue.back;
-}
-
-// There is one index always left empty between the back and the front to distinguish between an empty queue and a full queue.
-void pushEvent(EventQueue& queue, const Event& event) {
-    uint8_t next = (queue.back + 1) & 127;
-    if (next != queue.front) {
-        queue.ringBuffer[queue.back] = event;
-        queue.back = next;
-    }
-}
-
-Event popEvent(EventQueue& queue) {
-    uint8_t front = queue.front;
-    queue.front = (queue.front + 1) & 127;
-    return queue.ringBuffer[front];
-}
-
-bool pollEvent(EventQueue& eventQueue, Event& event) {
-    if (!eventQueueEmpty(eventQueue)) {
-        event = popEvent(eventQueue);
-        return true;
-    }
-    return false;
-}
-
 void handleWindowEvent(const Event& event, WindowData& window, Framebuffer& framebuffer, CameraComponent& camera,
                        MouseData& mouseData) {
 
@@ -42,9 +15,7 @@ void handleWindowEvent(const Event& event, WindowData& window, Framebuffer& fram
         glViewport(0, 0, event.resize.width, event.resize.height);
         window.width = event.resize.width;
         window.height = event.resize.height;
-        glDeleteFramebuffers(1, &framebuffer.buffer);
-        glDeleteTextures(1, &framebuffer.textureAttachment);
-        glDeleteRenderbuffers(1, &framebuffer.renderBufferObject);
+        destroyFrameBuffer(framebuffer);
         framebuffer = createFrameBuffer(framebuffer.shaderID, window.width, window.height);
         updateProjectionMatrix(camera, window.width, window.height);
         break;
@@ -68,5 +39,7 @@ void handleWindowEvent(const Event& event, WindowData& window, Framebuffer& fram
         processMouseScroll(camera, event.scroll.yOffset);
         break;
     }
+    default:
+        break;
     }
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
+#include <atomic>
 #include <cstdint>
+#include "lock_free_queue.h"
 
 struct WindowData;
 struct Framebuffer;
@@ -8,9 +10,14 @@ struct CameraComponent;
 enum class EventType {
     WindowResize,
     MouseMove,
-    Scroll
+    Scroll,
+    Damage,
+    Death,
+    Count
 };
 
+static constexpr uint32_t EVENT_TYPE_COUNT = (uint32_t)EventType::Count;
+
 struct Event {
     EventType type;
     union {
@@ -23,15 +30,41 @@ struct Event {
         struct {
             float yOffset;
         } scroll;
+        struct {
+            uint32_t target, source;
+            int32_t amount;
+        } damage;
+        struct {
+            uint32_t entity;
+        } death;
     };
 };
 
-// TODO: NEED TO FIND HOW MUCH SPACE I ACTUALLY NEED FOR THIS.
+// Any thread can post (GLFW callbacks, loader and job workers), one thread drains. Either events are taken one by one
+// with pollEvent, or dispatchEvents sorts them into one channel per type and hands each channel's handlers whole
+// batches, one type after the other in EventType order.
+static constexpr uint32_t EVENT_QUEUE_CAPACITY = 1024;
+static constexpr uint32_t EVENT_BATCH_CAPACITY = 256;
+static constexpr uint32_t MAX_EVENT_HANDLERS = 4;
+// Handlers can post further events, which are dispatched in another pass, up to this many.
+static constexpr uint32_t MAX_DISPATCH_PASSES = 8;
+
+typedef void (*EventHandler)(const Event* events, uint32_t count, void* context);
+
+struct EventChannel {
+    EventHandler handlers[MAX_EVENT_HANDLERS];
+    uint32_t handlerCount = 0;
+    Event batch[EVENT_BATCH_CAPACITY];
+    uint32_t size = 0;
+
+    std::atomic<uint32_t> dropped{0}; // Posted while the queue was full.
+    uint32_t dispatched = 0;
+    uint32_t largestBatch = 0;
+};
 
 struct EventQueue {
-    Event ringBuffer[128];
-    uint8_t front = 0;
-    uint8_t back = 0;
+    LockFreeQueue<Event, EVENT_QUEUE_CAPACITY> queue;
+    EventChannel channels[EVENT_TYPE_COUNT];
 };
 
 struct MouseData {
@@ -42,14 +75,15 @@ struct MouseData {
     bool hasBeenRecorded = false;
 };
 
-bool eventQueueEmpty(EventQueue& queue);
-
-// There is one index always left empty between the back and the front to distinguish between an empty queue and a full queue.
-void pushEvent(EventQueue& queue, const Event& event);
-
-Event popEvent(EventQueue& queue);
+// Returns false and counts the event as dropped when the queue is full.
+bool pushEvent(EventQueue& queue, const Event& event);
 
 bool pollEvent(EventQueue& eventQueue, Event& event);
 
+bool subscribeEvents(EventQueue& queue, EventType type, EventHandler handler);
+void clearEventHandlers(EventQueue& queue);
+// Returns how many events were dispatched. Events without a handler are dropped silently.
+uint32_t dispatchEvents(EventQueue& queue, void* context);
+
 void handleWindowEvent(const Event& event, WindowData& window, Framebuffer& framebuffer, CameraComponent& camera,
                        MouseData& mouseData);
\ No newline at end of file
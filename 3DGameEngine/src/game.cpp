@@ -2,6 +2,9 @@
 #include "movement_system.h"
 #include "collision_system.h"
 
+// Several times the bullet's size per tick, the collision sweep keeps it from passing through walls.
+static constexpr float BULLET_SPEED = 60.0f;
+
 void createBullet(ECS& scene, glm::vec3 position, glm::quat rotation) {
     uint32_t id = createEntity(scene);
     scene.meshSet.add(id, scene.meshBuffer.buffer[scene.cubePrimitiveIndex]);
@@ -12,7 +15,7 @@ void createBullet(ECS& scene, glm::vec3 position, glm::quat rotation) {
     position += bulletOffset * front;
     scene.transformSet.add(id, TransformComponent{.position = position, .scale = glm::vec3(0.2f)});
     scene.collisionSet.add(id, CollisionComponent{.minX = -0.1f, .maxX = 0.1f, .minY = -0.1f, .maxY = 0.1f, .minZ = -0.1f, .maxZ = 0.1f});
-    scene.velocitySet.add(id, VelocityComponent{glm::vec3(10.0f * front)});
+    scene.velocitySet.add(id, VelocityComponent{glm::vec3(BULLET_SPEED * front)});
     scene.bulletSet.add(id, BulletTag{});
     scene.dynamicSet.add(id, DynamicTag{});
 }
@@ -32,17 +35,29 @@ void bulletSystem(ECS& scene) {
     }
 }
 
+// Every reload starts with this false again, so the handlers never point into an unloaded DLL.
+static bool gameplayEventsSubscribed = false;
+
 extern "C" __declspec(dllexport) void game_update(ECS& scene, CameraComponent& camera) {
+    if (!gameplayEventsSubscribed) {
+        subscribeGameplayEvents(scene.gameEvents);
+        gameplayEventsSubscribed = true;
+    }
     worldSpaceInputSystem(scene.inputWorldSet, scene.velocitySet, scene.speedSet, scene.inputMapSet, scene.keyStateBuffer);
     tankInputSystem(scene.rotationSpeedSet, scene.speedSet, scene.inputTankSet,
                     scene.velocitySet, scene.transformSet, scene.deltaTime, scene.keyStateBuffer, scene.inputMapSet);
     noClipInputSystem(scene.inputNoClipSet, scene.speedSet, scene.velocitySet, scene.inputMapSet, scene.keyStateBuffer, camera.front, camera.right);
     patrolSystem(scene.patrolSet, scene.speedSet, scene.velocitySet, scene.deltaTime);
-    movementSystem(scene.velocitySet, scene.transformSet, scene.deltaTime);
+    // Before movement, so a new bullet has made the move the collision sweep assumes it made.
     bulletSystem(scene);
-    collisionSystem(scene.collisionSet, scene.transformSet, scene.dynamicSet, scene.bulletSet, scene.healthSet,
-                    scene.physicsManifold, scene.deleteBuffer);
-    resolveCollisions(scene.physicsManifold, scene.transformSet, scene.velocitySet);
-    healthSystem(scene.healthSet, scene.deleteBuffer);
+    wakeMovedBodies(scene.bodySleep, scene.dynamicSet, scene.velocitySet);
+    movementSystem(scene.velocitySet, scene.transformSet, scene.deltaTime, scene.bodySleep);
+    wakeTouchedBodies(scene.bodySleep, scene.dynamicSet, scene.velocitySet, scene.collisionSet, scene.transformSet, scene.deltaTime);
+    collisionSystem(scene.collisionSet, scene.transformSet, scene.dynamicSet, scene.velocitySet, scene.deltaTime, scene.bodySleep,
+                    scene.contacts);
+    solveContacts(scene.contacts, scene.dynamicSet, scene.bulletSet, scene.transformSet, scene.velocitySet, scene.bodySleep);
+    bulletHitSystem(scene.contacts, scene.bulletSet, scene.healthSet, scene.deleteBuffer, scene.gameEvents);
+    healthSystem(scene.healthSet, scene.gameEvents);
+    dispatchEvents(scene.gameEvents, &scene);
     deleteSystem(scene);
 }
\ No newline at end of file
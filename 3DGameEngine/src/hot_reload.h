@@ -45,6 +45,20 @@ inline bool loadGameDLL(GameDLL& dll, const char* sourcePath, const char* tempPa
     return dll.update != nullptr;
 }
 
+// Structured exceptions only exist on MSVC, elsewhere a fault in the game still takes the engine down.
+inline bool callGameUpdate(GameDLL& dll, ECS& scene, CameraComponent& camera) {
+#ifdef _MSC_VER
+    __try {
+        dll.update(scene, camera);
+    } __except (EXCEPTION_EXECUTE_HANDLER) {
+        return false;
+    }
+#else
+    dll.update(scene, camera);
+#endif
+    return true;
+}
+
 inline bool checkForReload(GameDLL& dll, const char* sourcePath, const char* tempPath) {
     FILETIME current = getFileWriteTime(sourcePath);
     if (current.dwLowDateTime == 0 && current.dwHighDateTime == 0)
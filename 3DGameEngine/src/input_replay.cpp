@@ -0,0 +1,191 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "input_replay.h"
+#include "scene_sets.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+
+bool parseInputReplayArgs(InputReplay& replay, int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--record") == 0 && hasValue) {
+            replay.mode = InputReplayMode::Record;
+            replay.path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && hasValue) {
+            replay.mode = InputReplayMode::Replay;
+            replay.path = argv[++i];
+        } else if (strcmp(argv[i], "--csv") == 0 && hasValue) {
+            replay.csvPath = argv[++i];
+        } else if (strcmp(argv[i], "--tick") == 0 && hasValue) {
+            replay.tickSeconds = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            replay.headless = true;
+        } else {
+            std::cout << "Unknown argument: " << argv[i] << std::endl;
+            std::cout << "Usage: engine [--record file | --replay file [--headless]] [--csv file] [--tick seconds]" << std::endl;
+            return false;
+        }
+    }
+    if (replay.tickSeconds <= 0.0f) replay.tickSeconds = 1.0f / 60.0f;
+    // Without a recording there's nothing to drive a headless run.
+    if (replay.mode != InputReplayMode::Replay) replay.headless = false;
+    return true;
+}
+
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Only the live part of every set, dense order included since systems iterate in it.
+uint64_t hashSimulationState(ECS& scene) {
+    uint64_t hash = 14695981039346656037ull;
+    forEachSceneSet(scene, [&](SceneChunkID, uint32_t, SceneMigrateFn, auto& set) {
+        using Component = std::remove_reference_t<decltype(set.dense[0])>;
+        hash = hashBytes(hash, &set.entityCount, sizeof(uint32_t));
+        hash = hashBytes(hash, set.entities, set.entityCount * sizeof(uint32_t));
+        hash = hashBytes(hash, set.dense, set.entityCount * sizeof(Component));
+    });
+    return hashBytes(hash, &scene.entityCount, sizeof(uint32_t));
+}
+
+static bool openCsv(InputReplay& replay) {
+    if (!replay.csvPath) return true;
+    replay.csv = fopen(replay.csvPath, "w");
+    if (!replay.csv) {
+        std::cout << "Failed to open " << replay.csvPath << std::endl;
+        return false;
+    }
+    fprintf(replay.csv, "frame,simulation_ms,render_ms,frame_ms\n");
+    return true;
+}
+
+bool startInputRecording(InputReplay& replay, uint64_t initialHash) {
+    replay.file = fopen(replay.path, "wb");
+    if (!replay.file) {
+        std::cout << "Failed to open " << replay.path << " for recording" << std::endl;
+        replay.mode = InputReplayMode::Off;
+        return false;
+    }
+    replay.header = {INPUT_STREAM_MAGIC, INPUT_STREAM_VERSION, replay.tickSeconds, 0, initialHash, 0};
+    // Written again with the tick count and final hash once the recording ends.
+    fwrite(&replay.header, sizeof(InputStreamHeader), 1, replay.file);
+    memset(replay.keyState, 0, sizeof(replay.keyState));
+    replay.eventCount = 0;
+    replay.tick = 0;
+    std::cout << "Recording input to " << replay.path << std::endl;
+    return openCsv(replay);
+}
+
+void recordInputEvent(InputReplay& replay, const Event& event) {
+    // Resizes follow the window the replay runs in, not the recorded one.
+    if (replay.mode != InputReplayMode::Record || event.type == EventType::WindowResize) return;
+    if (replay.eventCount < MAX_TICK_EVENTS) replay.events[replay.eventCount++] = event;
+}
+
+void recordInputTick(InputReplay& replay, const float* keyStateBuffer) {
+    if (replay.mode != InputReplayMode::Record) return;
+    InputKeyChange changes[INPUT_KEY_COUNT];
+    uint16_t changeCount = 0;
+    for (uint32_t key = 0; key < INPUT_KEY_COUNT; ++key) {
+        if (keyStateBuffer[key] == replay.keyState[key]) continue;
+        changes[changeCount++] = {key, keyStateBuffer[key]};
+        replay.keyState[key] = keyStateBuffer[key];
+    }
+    uint16_t eventCount = (uint16_t)replay.eventCount;
+    fwrite(&changeCount, sizeof(uint16_t), 1, replay.file);
+    fwrite(&eventCount, sizeof(uint16_t), 1, replay.file);
+    fwrite(changes, sizeof(InputKeyChange), changeCount, replay.file);
+    fwrite(replay.events, sizeof(Event), eventCount, replay.file);
+    replay.eventCount = 0;
+    ++replay.tick;
+}
+
+bool startInputReplay(InputReplay& replay, uint64_t initialHash) {
+    FILE* f = fopen(replay.path, "rb");
+    bool valid = f != nullptr;
+    if (valid) {
+        fseek(f, 0, SEEK_END);
+        replay.stream.resize((size_t)ftell(f));
+        fseek(f, 0, SEEK_SET);
+        valid = fread(replay.stream.data(), 1, replay.stream.size(), f) == replay.stream.size();
+        fclose(f);
+    }
+    valid = valid && replay.stream.size() >= sizeof(InputStreamHeader);
+    if (valid) memcpy(&replay.header, replay.stream.data(), sizeof(InputStreamHeader));
+    valid = valid && replay.header.magic == INPUT_STREAM_MAGIC && replay.header.version == INPUT_STREAM_VERSION;
+    if (!valid) {
+        std::cout << "Not an input recording: " << replay.path << std::endl;
+        replay.mode = InputReplayMode::Off;
+        return false;
+    }
+
+    if (replay.header.initialHash != initialHash) {
+        std::cout << "Replay starts from a different scene than it was recorded in, expect it to diverge" << std::endl;
+    }
+    replay.tickSeconds = replay.header.tickSeconds;
+    replay.readOffset = sizeof(InputStreamHeader);
+    memset(replay.keyState, 0, sizeof(replay.keyState));
+    replay.tick = 0;
+    std::cout << "Replaying " << replay.header.tickCount << " ticks from " << replay.path << std::endl;
+    return openCsv(replay);
+}
+
+bool replayInputTick(InputReplay& replay, float* keyStateBuffer) {
+    replay.eventCount = 0;
+    if (replay.tick >= replay.header.tickCount) return false;
+
+    uint16_t counts[2];
+    const uint8_t* stream = replay.stream.data();
+    size_t size = replay.stream.size();
+    if (replay.readOffset + sizeof(counts) > size) return false;
+    memcpy(counts, stream + replay.readOffset, sizeof(counts));
+    size_t tickSize = sizeof(counts) + counts[0] * sizeof(InputKeyChange) + counts[1] * sizeof(Event);
+    if (replay.readOffset + tickSize > size || counts[1] > MAX_TICK_EVENTS) return false;
+
+    const uint8_t* in = stream + replay.readOffset + sizeof(counts);
+    for (uint16_t i = 0; i < counts[0]; ++i) {
+        InputKeyChange change;
+        memcpy(&change, in + i * sizeof(InputKeyChange), sizeof(InputKeyChange));
+        if (change.key < INPUT_KEY_COUNT) replay.keyState[change.key] = change.value;
+    }
+    memcpy(replay.events, in + counts[0] * sizeof(InputKeyChange), counts[1] * sizeof(Event));
+    replay.eventCount = counts[1];
+    memcpy(keyStateBuffer, replay.keyState, sizeof(replay.keyState));
+    replay.readOffset += tickSize;
+    ++replay.tick;
+    return true;
+}
+
+void writeFrameTiming(InputReplay& replay, double simulationMilliseconds, double renderMilliseconds, double frameMilliseconds) {
+    if (!replay.csv) return;
+    fprintf(replay.csv, "%u,%.4f,%.4f,%.4f\n", replay.tick, simulationMilliseconds, renderMilliseconds, frameMilliseconds);
+}
+
+bool finishInputReplay(InputReplay& replay, uint64_t finalHash) {
+    bool matched = true;
+    if (replay.mode == InputReplayMode::Record && replay.file) {
+        replay.header.tickCount = replay.tick;
+        replay.header.finalHash = finalHash;
+        fseek(replay.file, 0, SEEK_SET);
+        fwrite(&replay.header, sizeof(InputStreamHeader), 1, replay.file);
+        fclose(replay.file);
+        replay.file = nullptr;
+        printf("Recorded %u ticks, final state %016llx\n", replay.tick, (unsigned long long)finalHash);
+    } else if (replay.mode == InputReplayMode::Replay) {
+        matched = replay.tick == replay.header.tickCount && finalHash == replay.header.finalHash;
+        printf("Replayed %u / %u ticks, final state %016llx, recorded %016llx: %s\n", replay.tick, replay.header.tickCount,
+               (unsigned long long)finalHash, (unsigned long long)replay.header.finalHash, matched ? "match" : "MISMATCH");
+    }
+    if (replay.csv) {
+        fclose(replay.csv);
+        replay.csv = nullptr;
+    }
+    replay.mode = InputReplayMode::Off;
+    return matched;
+}
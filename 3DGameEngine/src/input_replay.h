@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "events.h"
+
+struct ECS;
+
+// Key state and input events are everything the simulation reads from outside. A recording stores them once per tick,
+// a replay feeds them back instead of the live input, and both step the simulation by the same fixed tick so a
+// recording plays out identically on every build. Replays compare the final state hash with the recorded one and can
+// write per frame timings to a CSV.
+// Recording starts and replays start from the scene the engine starts with, the initial hash catches a mismatch.
+
+#define INPUT_STREAM_MAGIC 0x504E4950 // "PINP"
+#define INPUT_STREAM_VERSION 2 // Events are stored as raw Event structs, a change to Event needs a new version.
+
+static constexpr uint32_t INPUT_KEY_COUNT = 318;
+static constexpr uint32_t MAX_TICK_EVENTS = 64;
+
+// File = InputStreamHeader, then per tick: uint16 changed keys, uint16 events, the changed keys as InputKeyChange
+// (against the tick before), then the events.
+struct InputStreamHeader {
+    uint32_t magic;
+    uint32_t version;
+    float tickSeconds;
+    uint32_t tickCount;
+    uint64_t initialHash;
+    uint64_t finalHash;
+};
+
+struct InputKeyChange {
+    uint32_t key;
+    float value;
+};
+
+enum class InputReplayMode {
+    Off,
+    Record,
+    Replay,
+};
+
+struct InputReplay {
+    InputReplayMode mode = InputReplayMode::Off;
+    bool headless = false; // Hidden window, no rendering or editor, runs as fast as the simulation goes.
+    float tickSeconds = 1.0f / 60.0f;
+    const char* path = nullptr;
+    const char* csvPath = nullptr;
+
+    FILE* file = nullptr;
+    FILE* csv = nullptr;
+    InputStreamHeader header;
+    float keyState[INPUT_KEY_COUNT];
+    Event events[MAX_TICK_EVENTS];
+    uint32_t eventCount = 0;
+    uint32_t tick = 0;
+
+    std::vector<uint8_t> stream; // The whole recording while replaying.
+    size_t readOffset = 0;
+};
+
+// Parses --record file, --replay file, --csv file, --headless and --tick seconds. Returns false on anything unknown.
+bool parseInputReplayArgs(InputReplay& replay, int argc, char** argv);
+uint64_t hashSimulationState(ECS& scene);
+
+bool startInputRecording(InputReplay& replay, uint64_t initialHash);
+void recordInputEvent(InputReplay& replay, const Event& event);
+// Writes the key changes since the last tick and the events recorded during this one.
+void recordInputTick(InputReplay& replay, const float* keyStateBuffer);
+
+bool startInputReplay(InputReplay& replay, uint64_t initialHash);
+// Sets the key state and fills events for the next tick, false once the recording is over.
+bool replayInputTick(InputReplay& replay, float* keyStateBuffer);
+
+void writeFrameTiming(InputReplay& replay, double simulationMilliseconds, double renderMilliseconds, double frameMilliseconds);
+// Returns false when a replay ended in a different state than the one recorded.
+bool finishInputReplay(InputReplay& replay, uint64_t finalHash);
@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Bounded multi-producer multi-consumer queue (Vyukov). Every cell carries a sequence number that says whether it's
+// ready to be written or read for the current lap, so producers and consumers only contend on their own counter.
+// push and pop never block, they return false when the queue is full or empty.
+template <typename T, uint32_t Capacity>
+struct LockFreeQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+    static constexpr uint32_t capacity = Capacity;
+
+    struct Cell {
+        std::atomic<uint32_t> sequence;
+        T data;
+    };
+
+    alignas(64) Cell cells[Capacity];
+    alignas(64) std::atomic<uint32_t> enqueuePosition{0};
+    alignas(64) std::atomic<uint32_t> dequeuePosition{0};
+
+    LockFreeQueue() {
+        for (uint32_t i = 0; i < Capacity; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool push(const T& value) {
+        uint32_t position = enqueuePosition.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[position & (Capacity - 1)];
+            uint32_t sequence = cell.sequence.load(std::memory_order_acquire);
+            int32_t difference = (int32_t)(sequence - position);
+            if (difference == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.data = value;
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(T& value) {
+        uint32_t position = dequeuePosition.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[position & (Capacity - 1)];
+            uint32_t sequence = cell.sequence.load(std::memory_order_acquire);
+            int32_t difference = (int32_t)(sequence - (position + 1));
+            if (difference == 0) {
+                if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    value = cell.data;
+                    cell.sequence.store(position + Capacity, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = dequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
@@ -0,0 +1,80 @@
+#include "mapped_file.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+bool openMappedFile(const char* path, MappedFile& file) {
+    file = MappedFile{};
+    HANDLE fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(fileHandle, &size) || size.QuadPart == 0) {
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mappingHandle) {
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    file.data = static_cast<const uint8_t*>(view);
+    file.size = (size_t)size.QuadPart;
+    file.fileHandle = fileHandle;
+    file.mappingHandle = mappingHandle;
+    return true;
+}
+
+void closeMappedFile(MappedFile& file) {
+    if (file.data) UnmapViewOfFile(file.data);
+    if (file.mappingHandle) CloseHandle(file.mappingHandle);
+    if (file.fileHandle) CloseHandle(file.fileHandle);
+    file = MappedFile{};
+}
+#else
+bool openMappedFile(const char* path, MappedFile& file) {
+    file = MappedFile{};
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    madvise(view, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+    file.data = static_cast<const uint8_t*>(view);
+    file.size = (size_t)info.st_size;
+    file.fd = fd;
+    return true;
+}
+
+void closeMappedFile(MappedFile& file) {
+    if (file.data) munmap(const_cast<uint8_t*>(file.data), file.size);
+    if (file.fd >= 0) close(file.fd);
+    file = MappedFile{};
+}
+#endif
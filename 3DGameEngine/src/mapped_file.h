@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Read-only view of a whole file. The OS pages it in on demand, nothing is copied onto the heap.
+struct MappedFile {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+bool openMappedFile(const char* path, MappedFile& file);
+void closeMappedFile(MappedFile& file);
@@ -0,0 +1,51 @@
+#include "mesh_file.h"
+#include "asset_pack.h"
+#include <cstddef>
+#include <cstring>
+
+static size_t meshFileHeaderSize(uint32_t version) {
+    if (version <= 2) return offsetof(MeshFileHeader, vertexFormat);
+    if (version == 3) return offsetof(MeshFileHeader, indexSize);
+    if (version == 4) return offsetof(MeshFileHeader, meshletCount);
+    return sizeof(MeshFileHeader);
+}
+
+bool readMeshFileHeader(const AssetView& file, MeshFileHeader& header, size_t& vertexOffset) {
+    header = {};
+    header.indexSize = sizeof(uint32_t);
+
+    uint32_t magic = 0;
+    if (file.size >= sizeof(uint32_t)) memcpy(&magic, file.data, sizeof(uint32_t));
+    if (magic == MESH_FILE_MAGIC) {
+        // Later versions only ever append fields to the header, so older ones read a prefix and keep the defaults.
+        uint32_t version = 0;
+        if (file.size >= 2 * sizeof(uint32_t)) memcpy(&version, file.data + sizeof(uint32_t), sizeof(uint32_t));
+        if (version < 2 || version > MESH_FILE_VERSION) return false;
+        vertexOffset = meshFileHeaderSize(version);
+        if (file.size < vertexOffset) return false;
+        memcpy(&header, file.data, vertexOffset);
+    } else {
+        // Version 1 files start straight with the vertex count, treat them as a single LOD.
+        LegacyMeshFileHeader legacy;
+        if (file.size < sizeof(LegacyMeshFileHeader)) return false;
+        memcpy(&legacy, file.data, sizeof(LegacyMeshFileHeader));
+        header.vertexCount = legacy.vertexCount;
+        header.indexCount = legacy.indexCount;
+        header.localAABB = legacy.localAABB;
+        header.lodCount = 1;
+        header.lods[0] = MeshLOD{0, legacy.indexCount, 0.0f};
+        vertexOffset = sizeof(LegacyMeshFileHeader);
+    }
+
+    if (header.lodCount == 0 || header.lodCount > MAX_MESH_LODS) return false;
+    if (header.indexSize != sizeof(uint16_t) && header.indexSize != sizeof(uint32_t)) return false;
+    if (header.vertexFormat != MeshVertexFormat::Float && header.vertexFormat != MeshVertexFormat::Compact) return false;
+    for (uint32_t lod = 0; lod < header.lodCount; ++lod) {
+        if ((uint64_t)header.lods[lod].indexOffset + header.lods[lod].indexCount > header.indexCount) return false;
+    }
+
+    uint64_t vertexSize = header.vertexFormat == MeshVertexFormat::Compact ? sizeof(CompactVertex) : sizeof(float) * 8;
+    uint64_t fileEnd = (uint64_t)vertexOffset + header.vertexCount * vertexSize + (uint64_t)header.indexCount * header.indexSize +
+                       (uint64_t)header.meshletCount * sizeof(Meshlet);
+    return fileEnd <= file.size;
+}
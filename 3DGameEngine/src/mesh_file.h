@@ -0,0 +1,9 @@
+#pragma once
+#include <cstddef>
+#include "mesh_format.h"
+
+struct AssetView;
+
+// Copies the header out of a .mesh file in memory and checks that everything it describes lies inside the file.
+// The vertices start vertexOffset bytes in, followed by the indices and the meshlets.
+bool readMeshFileHeader(const AssetView& file, MeshFileHeader& header, size_t& vertexOffset);
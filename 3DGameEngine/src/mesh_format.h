@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+
+// Layout of .mesh files, shared between the engine and mesh_converter.
+// File = MeshFileHeader, vertexCount vertices in the header's vertex format, the index ranges of every LOD back to back,
+// then meshletCount Meshlets covering LOD0.
+
+#define MESH_FILE_MAGIC 0x4853454D // "MESH"
+#define MESH_FILE_VERSION 5
+
+static constexpr uint32_t MAX_MESH_LODS = 4;
+static constexpr uint32_t MAX_MESHLET_VERTICES = 64;
+static constexpr uint32_t MAX_MESHLET_TRIANGLES = 124;
+
+struct AABB {
+    float minX, minY, minZ;
+    float maxX, maxY, maxZ;
+};
+
+struct MeshLOD {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    float error; // Object space geometric error, projected to pixels at runtime to pick a LOD.
+};
+
+// Contiguous run of LOD0 indices with object space bounds for cluster culling.
+// The whole meshlet faces away from the camera when dot(center - camera, coneAxis) >= coneCutoff * |center - camera| + radius.
+struct Meshlet {
+    float center[3];
+    float radius;
+    float coneAxis[3];
+    float coneCutoff; // 1 when the normals spread too far for a useful cone.
+    uint32_t indexOffset;
+    uint32_t indexCount;
+};
+
+enum class MeshVertexFormat : uint32_t {
+    Float,   // 8 floats: position, normal, UV. 32 bytes.
+    Compact, // CompactVertex. 16 bytes.
+};
+
+// Position is unorm16 relative to localAABB, the renderer folds the AABB into the model matrix.
+// Normal is snorm 10_10_10_2 and the UV two halfs, both go through normalized/half vertex attributes so shaders don't change.
+struct CompactVertex {
+    uint16_t position[3];
+    uint16_t padding;
+    uint32_t normal;
+    uint16_t uv[2];
+};
+static_assert(sizeof(CompactVertex) == 16);
+
+struct MeshFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount; // Total over all LODs.
+    AABB localAABB;
+    uint32_t lodCount;
+    MeshLOD lods[MAX_MESH_LODS];
+    MeshVertexFormat vertexFormat; // Added in version 3, older files are always Float.
+    uint32_t indexSize;            // Added in version 4, 2 or 4 bytes. Older files always use 4.
+    uint32_t meshletCount;         // Added in version 5.
+};
+
+// Version 1 files have no magic, just this header followed by the vertices and a single index range.
+struct LegacyMeshFileHeader {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    AABB localAABB;
+};
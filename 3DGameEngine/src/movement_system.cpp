@@ -1,6 +1,7 @@
 #include "movement_system.h"
 #include "entity.h"
 #include "camera.h"
+#include "contact_solver.h"
 #include <glm/gtc/matrix_transform.hpp>
 
 void worldSpaceInputSystem(const SparseSet<PlayerInputWorldTag>& inputWorldSet, SparseSet<VelocityComponent>& velocitySet,
@@ -81,9 +82,11 @@ void patrolSystem(SparseSet<PatrolComponent>& patrolSet, const SparseSet<SpeedCo
     }
 }
 
-void movementSystem(const SparseSet<VelocityComponent>& velocitySet, SparseSet<TransformComponent>& transformSet, float deltaTime) {
+void movementSystem(const SparseSet<VelocityComponent>& velocitySet, SparseSet<TransformComponent>& transformSet, float deltaTime,
+                    const BodySleepState& sleep) {
     for (uint32_t i = 0; i < velocitySet.entityCount; ++i) {
         uint32_t entity = velocitySet.entities[i];
+        if (sleep.asleep[entity]) continue;
         auto& transform = transformSet.getComponent(entity);
         auto& velocity = velocitySet.getComponent(entity);
 
@@ -12,6 +12,7 @@ struct PlayerInputNoClipTag;
 struct InputMapComponent;
 struct PatrolComponent;
 struct CameraComponent;
+struct BodySleepState;
 
 struct InputDirection {
 	glm::vec3 direction;
@@ -32,4 +33,5 @@ void noClipInputSystem(const SparseSet<PlayerInputNoClipTag>& inputNoClipSet, co
     void patrolSystem(SparseSet<PatrolComponent>& patrolSet, const SparseSet<SpeedComponent>& speedSet,
                       SparseSet<VelocityComponent>& velocitySet, float deltaTime);
 
-void movementSystem(const SparseSet<VelocityComponent>& velocitySet, SparseSet<TransformComponent>& transformSet, float deltaTime);
\ No newline at end of file
+void movementSystem(const SparseSet<VelocityComponent>& velocitySet, SparseSet<TransformComponent>& transformSet, float deltaTime,
+                    const BodySleepState& sleep);
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "occlusion_culling.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+ScreenRect projectAABBToScreenRect(const glm::vec3& center, const glm::vec3& extent, const glm::mat4& viewProjection) {
+    ScreenRect rect{glm::vec2(1.0f), glm::vec2(0.0f), 1.0f, false};
+
+    for (int i = 0; i < 8; ++i) {
+        glm::vec3 corner = center + extent * glm::vec3((i & 1) ? 1.0f : -1.0f,
+                                                       (i & 2) ? 1.0f : -1.0f,
+                                                       (i & 4) ? 1.0f : -1.0f);
+        glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+
+        // Anything touching the near plane can't be projected safely, treat it as visible.
+        if (clip.w <= 1e-5f) {
+            rect.crossesNearPlane = true;
+            return rect;
+        }
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        glm::vec2 uv = glm::vec2(ndc) * 0.5f + 0.5f;
+        rect.min = glm::min(rect.min, uv);
+        rect.max = glm::max(rect.max, uv);
+        rect.minDepth = std::min(rect.minDepth, ndc.z * 0.5f + 0.5f);
+    }
+
+    rect.min = glm::clamp(rect.min, glm::vec2(0.0f), glm::vec2(1.0f));
+    rect.max = glm::clamp(rect.max, glm::vec2(0.0f), glm::vec2(1.0f));
+    return rect;
+}
+
+// Picks the level where the rect spans at most two texels on each axis, so four samples cover it.
+uint32_t selectHiZMip(const ScreenRect& rect, uint32_t width, uint32_t height, uint32_t mipCount) {
+    float texelsX = (rect.max.x - rect.min.x) * (float)width;
+    float texelsY = (rect.max.y - rect.min.y) * (float)height;
+    float size = std::max(std::max(texelsX, texelsY), 1.0f);
+    uint32_t level = (uint32_t)std::ceil(std::log2(size));
+    return std::min(level, mipCount - 1);
+}
+
+bool isScreenRectVisible(const ScreenRect& rect, const float* const* levels, uint32_t width, uint32_t height, uint32_t mipCount) {
+    if (rect.crossesNearPlane) return true;
+    uint32_t level = selectHiZMip(rect, width, height, mipCount);
+    int levelWidth = (int)std::max(width >> level, 1u);
+    int levelHeight = (int)std::max(height >> level, 1u);
+    int firstX = std::clamp((int)(rect.min.x * (float)levelWidth), 0, levelWidth - 1);
+    int firstY = std::clamp((int)(rect.min.y * (float)levelHeight), 0, levelHeight - 1);
+    int lastX = std::clamp((int)(rect.max.x * (float)levelWidth), 0, levelWidth - 1);
+    int lastY = std::clamp((int)(rect.max.y * (float)levelHeight), 0, levelHeight - 1);
+
+    const float* texels = levels[level];
+    float occluderDepth = std::max(std::max(texels[firstY * levelWidth + firstX], texels[firstY * levelWidth + lastX]),
+                                   std::max(texels[lastY * levelWidth + firstX], texels[lastY * levelWidth + lastX]));
+    return rect.minDepth <= occluderDepth;
+}
+
+bool collectOcclusionResults(HiZBuffer& hiZ, OcclusionCullingData& occlusionData) {
+    ++occlusionData.frame;
+    // Slots are handed out round robin, so starting at this frame's slot walks them oldest first.
+    for (uint32_t i = 0; i < OCCLUSION_READBACK_SLOTS; ++i) {
+        uint32_t slot = (occlusionData.frame + i) % OCCLUSION_READBACK_SLOTS;
+        if (occlusionData.slotFrames[slot] == 0) continue;
+        const uint32_t* visibility = readOcclusionResults(hiZ, slot, i == 0);
+        // Only a timed out wait on this frame's own slot keeps it busy, later slots are simply not done yet.
+        if (!visibility) return i != 0;
+        applyOcclusionResults(occlusionData, slot, visibility);
+    }
+    return true;
+}
+
+void applyOcclusionResults(OcclusionCullingData& occlusionData, uint32_t slot, const uint32_t* visibility) {
+    const VisibleEntityBuffer& candidates = occlusionData.slotCandidates[slot];
+    for (uint32_t i = 0; i < candidates.size; ++i) {
+        occlusionData.occludedFrame[candidates.buffer[i]] = visibility[i] != 0 ? 0 : occlusionData.slotFrames[slot];
+    }
+    occlusionData.slotFrames[slot] = 0;
+}
+
+void partitionOcclusionCandidates(const VisibleEntityBuffer& frustumVisible, const WorldBoundsBuffer& worldBounds,
+                                  const SparseSet<RenderableTag>& renderableSet, OcclusionCullingData& occlusionData) {
+    occlusionData.drawnFirst.size = 0;
+    occlusionData.retested.size = 0;
+    occlusionData.candidates.size = 0;
+
+    for (uint32_t i = 0; i < frustumVisible.size; ++i) {
+        uint32_t entity = frustumVisible.buffer[i];
+        uint32_t occludedFrame = occlusionData.occludedFrame[entity];
+        bool occluded = occludedFrame != 0 && occlusionData.frame - occludedFrame <= OCCLUSION_READBACK_SLOTS;
+        float retestIndex = -1.0f;
+        if (occluded) {
+            retestIndex = (float)occlusionData.retested.size;
+            occlusionData.retested.buffer[occlusionData.retested.size++] = entity;
+        } else {
+            occlusionData.drawnFirst.buffer[occlusionData.drawnFirst.size++] = entity;
+        }
+
+        // World bounds are laid out in renderable dense order.
+        uint32_t boundsIndex = renderableSet.sparse[entity];
+        uint32_t candidate = occlusionData.candidates.size++;
+        occlusionData.candidates.buffer[candidate] = entity;
+        occlusionData.candidateBounds[candidate * 2] = glm::vec4(worldBounds.centerX[boundsIndex], worldBounds.centerY[boundsIndex],
+                                                                 worldBounds.centerZ[boundsIndex], retestIndex);
+        occlusionData.candidateBounds[candidate * 2 + 1] = glm::vec4(worldBounds.extentX[boundsIndex], worldBounds.extentY[boundsIndex],
+                                                                     worldBounds.extentZ[boundsIndex], 0.0f);
+    }
+    occlusionData.occludedCount = occlusionData.retested.size;
+}
+
+uint32_t submitOcclusionTest(HiZBuffer& hiZ, OcclusionCullingData& occlusionData, const glm::mat4& viewProjection) {
+    uint32_t slot = occlusionData.frame % OCCLUSION_READBACK_SLOTS;
+    const VisibleEntityBuffer& candidates = occlusionData.candidates;
+    VisibleEntityBuffer& slotCandidates = occlusionData.slotCandidates[slot];
+    memcpy(slotCandidates.buffer, candidates.buffer, candidates.size * sizeof(uint32_t));
+    slotCandidates.size = candidates.size;
+    occlusionData.slotFrames[slot] = occlusionData.frame;
+    testOcclusion(hiZ, slot, occlusionData.candidateBounds, candidates.size, occlusionData.retestCommands,
+                  occlusionData.retested.size, viewProjection);
+    return slot;
+}
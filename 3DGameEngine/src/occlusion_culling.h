@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "render_system.h"
+
+// CPU side of the occlusion culling. Everything frustum visible that isn't known to be occluded is drawn, the Hi-Z is
+// built from that depth and every frustum visible entity is tested against it. The entities skipped in the first draw
+// are drawn right after through indirect commands the test fills in, so the ones it finds visible still show up this
+// frame without the CPU waiting on it. The results come back a frame or more later through readback slots and decide
+// what the next frames draw first.
+// Apart from collectOcclusionResults nothing in here touches GL, the Hi-Z build and the tests live in render_system
+// and the .comp shaders.
+
+// Screen space footprint of a world AABB. UVs are in [0, 1] and depth in [0, 1] like the depth buffer.
+struct ScreenRect {
+    glm::vec2 min;
+    glm::vec2 max;
+    float minDepth;
+    bool crossesNearPlane;
+};
+
+struct OcclusionCullingData {
+    uint32_t frame = 0;
+    // Frame whose test found the entity occluded, 0 when the last result said visible. Results older than the
+    // readback ring are ignored, so entities that were out of view for a while are drawn again until retested.
+    uint32_t occludedFrame[MAX_ENTITIES] = {};
+    VisibleEntityBuffer drawnFirst; // Frustum visible and not known to be occluded, drawn before the Hi-Z is built.
+    VisibleEntityBuffer retested;   // The rest of the frustum visible ones, drawn after the test if it passes them.
+    VisibleEntityBuffer candidates; // Everything frustum visible, tested against the Hi-Z.
+    // Center and extent pairs uploaded for the test. center.w is the candidate's index in retested, -1 when drawn first.
+    glm::vec4 candidateBounds[CULLING_CAPACITY * 2];
+    DrawElementsIndirectCommand retestCommands[CULLING_CAPACITY]; // One per retested entity, see writeDrawCommands.
+    VisibleEntityBuffer slotCandidates[OCCLUSION_READBACK_SLOTS]; // Candidates of the test in flight in each slot.
+    uint32_t slotFrames[OCCLUSION_READBACK_SLOTS] = {};           // Frame the slot was submitted in, 0 when empty.
+    uint32_t occludedCount = 0;
+};
+
+// Must match occlusion_cull.comp.
+ScreenRect projectAABBToScreenRect(const glm::vec3& center, const glm::vec3& extent, const glm::mat4& viewProjection);
+uint32_t selectHiZMip(const ScreenRect& rect, uint32_t width, uint32_t height, uint32_t mipCount);
+// levels[i] is mip i of the max depth chain, row major and max(size >> i, 1) texels on each axis.
+bool isScreenRectVisible(const ScreenRect& rect, const float* const* levels, uint32_t width, uint32_t height, uint32_t mipCount);
+
+// Applies every finished readback in submission order and frees this frame's slot, waiting only if it's still busy.
+// False when the wait timed out and the slot is still in flight, nothing may be submitted into it this frame.
+bool collectOcclusionResults(HiZBuffer& hiZ, OcclusionCullingData& occlusionData);
+void applyOcclusionResults(OcclusionCullingData& occlusionData, uint32_t slot, const uint32_t* visibility);
+void partitionOcclusionCandidates(const VisibleEntityBuffer& frustumVisible, const WorldBoundsBuffer& worldBounds,
+                                  const SparseSet<RenderableTag>& renderableSet, OcclusionCullingData& occlusionData);
+// Tests this frame's candidates against the Hi-Z built from the drawnFirst depth. retestCommands must be written already.
+// Returns the slot the test went into, the retested entities are drawn from its commands.
+uint32_t submitOcclusionTest(HiZBuffer& hiZ, OcclusionCullingData& occlusionData, const glm::mat4& viewProjection);
@@ -1,31 +1,123 @@
 #include "render_system.h"
 #include "asset_manager.h"
+#include "cluster_culling.h"
 #include "entity.h"
 #include "camera.h"
 #include <iostream>
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Sets the entity's uniforms and binds its program and VAO, everything but the draw itself.
+static const MeshData& bindEntityDraw(uint32_t entity, const SparseSet<MaterialData>& materialSet, const SparseSet<MeshData>& meshSet,
+                                      const SparseSet<TransformComponent>& transformSet, const MeshBuffer& meshBuffer) {
+    const MaterialData& material = materialSet.getComponent(entity);
+    const MeshData& mesh = meshSet.getComponent(entity);
+    const TransformComponent& transform = transformSet.getComponent(entity);
+    glm::mat4 transformMatrix = buildTransformMatrix(transform.position, transform.scale, transform.rotation);
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transformMatrix)));
+    if (meshBuffer.vertexFormats[mesh.handle] == MeshVertexFormat::Compact) {
+        // Normals aren't quantized against the AABB so the normal matrix above stays as is.
+        const AABB& bounds = mesh.localAABB;
+        transformMatrix = glm::scale(glm::translate(transformMatrix, glm::vec3(bounds.minX, bounds.minY, bounds.minZ)),
+                                     glm::vec3(bounds.maxX - bounds.minX, bounds.maxY - bounds.minY, bounds.maxZ - bounds.minZ));
+    }
+    glProgramUniformMatrix4fv(material.shaderID, 0, 1, GL_FALSE, &transformMatrix[0][0]);
+    glProgramUniformMatrix3fv(material.shaderID, 1, 1, GL_FALSE, &normalMatrix[0][0]);
+
+    glBindVertexArray(mesh.vao);
+    glProgramUniform1i(material.shaderID, 2, material.materialSSBOIndex);
+    glUseProgram(material.shaderID);
+    return mesh;
+}
 
 void renderSystem(const VisibleEntityBuffer& visibleEntityBuffer, const SparseSet<MaterialData>& materialSet, 
-                  const SparseSet<MeshData>& meshSet, const SparseSet<TransformComponent>& transformSet, const Framebuffer& framebuffer) {
+                  const SparseSet<MeshData>& meshSet, const SparseSet<TransformComponent>& transformSet,
+                  const MeshBuffer& meshBuffer, const MeshLODSelection& lodSelection, const ClusterDrawList& clusterDrawList,
+                  const Framebuffer& framebuffer) {
     glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.buffer);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     for (uint32_t i = 0; i < visibleEntityBuffer.size; ++i) {
         uint32_t entity = visibleEntityBuffer.buffer[i];
-        const MaterialData& material = materialSet.getComponent(entity);
+        const MeshData& mesh = bindEntityDraw(entity, materialSet, meshSet, transformSet, meshBuffer);
+        const MeshLOD& lod = meshBuffer.lods[mesh.handle][lodSelection.lod[entity]];
+        GLenum indexType = meshBuffer.indexTypes[mesh.handle];
+        size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+        uint32_t firstCluster = clusterDrawList.first[entity];
+        if (firstCluster != NOT_CLUSTERED) {
+            glMultiDrawElements(GL_TRIANGLES, &clusterDrawList.counts[firstCluster], indexType,
+                                &clusterDrawList.offsets[firstCluster], (GLsizei)clusterDrawList.count[entity]);
+        } else {
+            glDrawElements(GL_TRIANGLES, lod.indexCount, indexType, (void*)(uintptr_t)(lod.indexOffset * indexSize));
+        }
+    }
+}
+
+void writeDrawCommands(const VisibleEntityBuffer& entities, const SparseSet<MeshData>& meshSet, const MeshBuffer& meshBuffer,
+                       const MeshLODSelection& lodSelection, DrawElementsIndirectCommand* drawCommands) {
+    for (uint32_t i = 0; i < entities.size; ++i) {
+        uint32_t entity = entities.buffer[i];
+        const MeshLOD& lod = meshBuffer.lods[meshSet.getComponent(entity).handle][lodSelection.lod[entity]];
+        drawCommands[i] = DrawElementsIndirectCommand{lod.indexCount, 0, lod.indexOffset, 0, 0};
+    }
+}
+
+// Clusters aren't culled here, the whole LOD is drawn. These are mostly entities that were hidden last frame.
+void renderIndirect(const VisibleEntityBuffer& entities, const HiZBuffer& hiZ, uint32_t slot,
+                    const SparseSet<MaterialData>& materialSet, const SparseSet<MeshData>& meshSet,
+                    const SparseSet<TransformComponent>& transformSet, const MeshBuffer& meshBuffer, const Framebuffer& framebuffer) {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.buffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, hiZ.drawCommandBuffer);
+    for (uint32_t i = 0; i < entities.size; ++i) {
+        const MeshData& mesh = bindEntityDraw(entities.buffer[i], materialSet, meshSet, transformSet, meshBuffer);
+        size_t commandOffset = (slot * CULLING_CAPACITY + i) * sizeof(DrawElementsIndirectCommand);
+        glDrawElementsIndirect(GL_TRIANGLES, meshBuffer.indexTypes[mesh.handle], (void*)(uintptr_t)commandOffset);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+// Projects each LOD's object space error to pixels at the entity's distance and keeps the coarsest one under the threshold.
+void selectMeshLODs(const VisibleEntityBuffer& visibleEntities, const SparseSet<MeshData>& meshSet,
+                    const SparseSet<TransformComponent>& transformSet, const MeshBuffer& meshBuffer,
+                    const CameraComponent& camera, uint32_t screenHeight, MeshLODSelection& lodSelection) {
+    std::memset(lodSelection.lodHistogram, 0, sizeof(lodSelection.lodHistogram));
+    // Pixels per world unit at distance 1.
+    const float projectionScale = 0.5f * (float)screenHeight * camera.projectionMatrix[1][1];
+
+    for (uint32_t i = 0; i < visibleEntities.size; ++i) {
+        uint32_t entity = visibleEntities.buffer[i];
         const MeshData& mesh = meshSet.getComponent(entity);
         const TransformComponent& transform = transformSet.getComponent(entity);
-        glm::mat4 transformMatrix = buildTransformMatrix(transform.position, transform.scale, transform.rotation);
-        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transformMatrix)));
-        glProgramUniformMatrix4fv(material.shaderID, 0, 1, GL_FALSE, &transformMatrix[0][0]);
-        glProgramUniformMatrix3fv(material.shaderID, 1, 1, GL_FALSE, &normalMatrix[0][0]);
-
-        glBindVertexArray(mesh.vao);
-        glProgramUniform1i(material.shaderID, 2, material.materialSSBOIndex);
-        glUseProgram(material.shaderID);
-        glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0);
+        uint8_t lodCount = meshBuffer.lodCounts[mesh.handle];
+
+        float maxScale = std::max(std::max(std::abs(transform.scale.x), std::abs(transform.scale.y)), std::abs(transform.scale.z));
+        glm::vec3 localExtent = glm::vec3(mesh.localAABB.maxX - mesh.localAABB.minX, mesh.localAABB.maxY - mesh.localAABB.minY,
+                                          mesh.localAABB.maxZ - mesh.localAABB.minZ) * 0.5f;
+        float radius = glm::length(localExtent) * maxScale;
+        // Distance to the bounding sphere rather than the origin, so large meshes don't drop detail on their near side.
+        float distance = glm::length(transform.position - camera.position) - radius;
+
+        uint8_t selected = 0;
+        if (distance > 0.0f) {
+            for (uint8_t lod = 1; lod < lodCount; ++lod) {
+                float projectedError = meshBuffer.lods[mesh.handle][lod].error * maxScale * projectionScale / distance;
+                if (projectedError > lodSelection.pixelThreshold) break;
+                selected = lod;
+            }
+        }
+        lodSelection.lod[entity] = selected;
+        ++lodSelection.lodHistogram[selected];
     }
 }
 
+void clearFramebuffer(const Framebuffer& framebuffer) {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.buffer);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
 void drawToFramebuffer(const Framebuffer& framebuffer, uint32_t quadVAO) {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glUseProgram(framebuffer.shaderID);
@@ -41,7 +133,7 @@ void renderSkybox(const SkyboxData& skyboxData) {
     glBindVertexArray(skyboxData.meshVAO);
     glUseProgram(skyboxData.shaderID);
     glDepthFunc(GL_LEQUAL);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+    glDrawElements(GL_TRIANGLES, 36, skyboxData.indexType, 0);
     glDepthFunc(GL_LESS);
 };
 
@@ -57,11 +149,137 @@ glm::mat4 buildTransformMatrix(const glm::vec3& position, const glm::vec3& scale
     return transformMatrix;
 }
 
+#if defined(__AVX2__)
+// For every 8 bit visibility mask, the lanes that passed packed to the front - lets AVX2 emulate a compress-store with one permute.
+struct CompressTable {
+    alignas(32) uint32_t permutation[256][CULLING_BATCH];
+};
+
+static constexpr CompressTable buildCompressTable() {
+    CompressTable table{};
+    for (uint32_t mask = 0; mask < 256; ++mask) {
+        uint32_t count = 0;
+        for (uint32_t lane = 0; lane < CULLING_BATCH; ++lane) {
+            if (mask & (1u << lane)) table.permutation[mask][count++] = lane;
+        }
+    }
+    return table;
+}
+
+static constexpr CompressTable compressTable = buildCompressTable();
+
+struct FrustumPlanesAVX2 {
+    __m256 x[6], y[6], z[6], w[6];
+    __m256 absX[6], absY[6], absZ[6];
+};
+
+static FrustumPlanesAVX2 broadcastPlanes(const glm::vec4* frustumPlanes) {
+    FrustumPlanesAVX2 planes;
+    for (int i = 0; i < 6; ++i) {
+        planes.x[i] = _mm256_set1_ps(frustumPlanes[i].x);
+        planes.y[i] = _mm256_set1_ps(frustumPlanes[i].y);
+        planes.z[i] = _mm256_set1_ps(frustumPlanes[i].z);
+        planes.w[i] = _mm256_set1_ps(frustumPlanes[i].w);
+        planes.absX[i] = _mm256_set1_ps(glm::abs(frustumPlanes[i].x));
+        planes.absY[i] = _mm256_set1_ps(glm::abs(frustumPlanes[i].y));
+        planes.absZ[i] = _mm256_set1_ps(glm::abs(frustumPlanes[i].z));
+    }
+    return planes;
+}
+
+// Signed distance to each plane in the same operation order as the scalar path, so both give identical results.
+static inline __m256 planeDistance(const FrustumPlanesAVX2& planes, int i, __m256 cx, __m256 cy, __m256 cz) {
+    __m256 s = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes.x[i], cx), _mm256_mul_ps(planes.y[i], cy)),
+                             _mm256_mul_ps(planes.z[i], cz));
+    return _mm256_add_ps(s, planes.w[i]);
+}
+
+static inline uint32_t tailMask(uint32_t first, uint32_t size) {
+    uint32_t remaining = size - first;
+    return remaining >= CULLING_BATCH ? 0xFFu : (1u << remaining) - 1u;
+}
+#endif
+
+static void gatherPointLightBounds(const SparseSet<PointLightComponent>& pointLightSet,
+                                   const SparseSet<TransformComponent>& transformSet,
+                                   PointLightBoundsBuffer& pointLightBounds) {
+    uint32_t count = std::min<uint32_t>(pointLightSet.entityCount, pointLightBounds.capacity);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t entity = pointLightSet.entities[i];
+        const glm::vec3& position = transformSet.getComponent(entity).position;
+        pointLightBounds.centerX[i] = position.x;
+        pointLightBounds.centerY[i] = position.y;
+        pointLightBounds.centerZ[i] = position.z;
+        pointLightBounds.radius[i] = pointLightSet.dense[i].radius;
+        pointLightBounds.entities[i] = entity;
+    }
+    pointLightBounds.size = (uint16_t)count;
+}
+
 void performLightCulling(const SparseSet<PointLightComponent>& pointLightSet,
                          const SparseSet<TransformComponent>& transformSet,
+                         PointLightBoundsBuffer& pointLightBounds,
                          VisiblePointLightBuffer& visiblePointLightBuffer,
                          const glm::vec4* frustumPlanes) {
 
+    gatherPointLightBounds(pointLightSet, transformSet, pointLightBounds);
+    visiblePointLightBuffer.size = 0;
+    const uint32_t size = pointLightBounds.size;
+
+#if defined(__AVX2__)
+    const FrustumPlanesAVX2 planes = broadcastPlanes(frustumPlanes);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+    for (uint32_t first = 0; first < size; first += CULLING_BATCH) {
+        __m256 cx = _mm256_load_ps(pointLightBounds.centerX + first);
+        __m256 cy = _mm256_load_ps(pointLightBounds.centerY + first);
+        __m256 cz = _mm256_load_ps(pointLightBounds.centerZ + first);
+        __m256 negRadius = _mm256_xor_ps(_mm256_load_ps(pointLightBounds.radius + first), signMask);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int i = 0; i < 6; ++i) {
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(planeDistance(planes, i, cx, cy, cz), negRadius, _CMP_NLT_UQ));
+        }
+
+        uint32_t mask = (uint32_t)_mm256_movemask_ps(inside) & tailMask(first, size);
+        while (mask) {
+            uint32_t index = first + (uint32_t)std::countr_zero(mask);
+            mask &= mask - 1;
+            const PointLightComponent& light = pointLightSet.getComponent(pointLightBounds.entities[index]);
+            visiblePointLightBuffer.buffer[visiblePointLightBuffer.size++] =
+                PackedLightData{glm::vec4(light.colour, light.intensity),
+                                glm::vec4(pointLightBounds.centerX[index], pointLightBounds.centerY[index],
+                                          pointLightBounds.centerZ[index], light.radius)};
+        }
+    }
+#else
+    for (uint32_t index = 0; index < size; ++index) {
+        glm::vec3 center(pointLightBounds.centerX[index], pointLightBounds.centerY[index], pointLightBounds.centerZ[index]);
+        float radius = pointLightBounds.radius[index];
+
+        bool isInside = true;
+        for (int i = 0; i < 6; ++i) {
+            float distance = glm::dot(glm::vec3(frustumPlanes[i]), center) + frustumPlanes[i].w;
+            if (distance < -radius) {
+                isInside = false;
+                break;
+            }
+        }
+
+        if (isInside) {
+            const PointLightComponent& light = pointLightSet.getComponent(pointLightBounds.entities[index]);
+            visiblePointLightBuffer.buffer[visiblePointLightBuffer.size++] = PackedLightData{glm::vec4(light.colour, light.intensity),
+                                                                                             glm::vec4(center, light.radius)};
+        }
+    }
+#endif
+}
+
+void performLightCullingScalar(const SparseSet<PointLightComponent>& pointLightSet,
+                               const SparseSet<TransformComponent>& transformSet,
+                               VisiblePointLightBuffer& visiblePointLightBuffer,
+                               const glm::vec4* frustumPlanes) {
+
     visiblePointLightBuffer.size = 0;
 
     for (uint32_t i = 0; i < pointLightSet.entityCount; ++i) {
@@ -81,20 +299,126 @@ void performLightCulling(const SparseSet<PointLightComponent>& pointLightSet,
             }
         }
 
-        if (isInside) {
-            // TODO: ADD SAFETY CHECK
+        if (isInside && visiblePointLightBuffer.size < visiblePointLightBuffer.capacity) {
             visiblePointLightBuffer.buffer[visiblePointLightBuffer.size++] = PackedLightData{glm::vec4(light.colour, light.intensity),
                                                                                              glm::vec4(transform.position, light.radius)};
         }
     }
 }
 
-void performFrustumCulling(const SparseSet<RenderableTag>& renderableSet,
-                           const SparseSet<TransformComponent>& transformSet,
-                           const SparseSet<MeshData>& meshSet,
+void computeWorldBounds(const TransformComponent& transform, const MeshData& mesh, glm::vec3& worldCenter, glm::vec3& worldExtent) {
+    // ARVO METHOD
+    glm::mat3 R = glm::mat3_cast(transform.rotation);
+
+    glm::vec3 localCenter = glm::vec3(
+        (mesh.localAABB.minX + mesh.localAABB.maxX) * 0.5f,
+        (mesh.localAABB.minY + mesh.localAABB.maxY) * 0.5f,
+        (mesh.localAABB.minZ + mesh.localAABB.maxZ) * 0.5f);
+    glm::vec3 localExtent = glm::vec3(
+        (mesh.localAABB.maxX - mesh.localAABB.minX) * 0.5f,
+        (mesh.localAABB.maxY - mesh.localAABB.minY) * 0.5f,
+        (mesh.localAABB.maxZ - mesh.localAABB.minZ) * 0.5f);
+
+    worldCenter = transform.position + (R * (localCenter * transform.scale));
+
+    for (int j = 0; j < 3; ++j) {
+        worldExtent[j] =
+            glm::abs(R[0][j] * transform.scale.x) * localExtent.x +
+            glm::abs(R[1][j] * transform.scale.y) * localExtent.y +
+            glm::abs(R[2][j] * transform.scale.z) * localExtent.z;
+    }
+}
+
+void updateWorldBounds(const SparseSet<RenderableTag>& renderableSet,
+                       const SparseSet<TransformComponent>& transformSet,
+                       const SparseSet<MeshData>& meshSet,
+                       WorldBoundsBuffer& worldBounds) {
+
+    worldBounds.size = renderableSet.entityCount;
+    for (uint32_t i = 0; i < renderableSet.entityCount; ++i) {
+        uint32_t entity = renderableSet.entities[i];
+        glm::vec3 worldCenter, worldExtent;
+        computeWorldBounds(transformSet.getComponent(entity), meshSet.getComponent(entity), worldCenter, worldExtent);
+
+        worldBounds.centerX[i] = worldCenter.x;
+        worldBounds.centerY[i] = worldCenter.y;
+        worldBounds.centerZ[i] = worldCenter.z;
+        worldBounds.extentX[i] = worldExtent.x;
+        worldBounds.extentY[i] = worldExtent.y;
+        worldBounds.extentZ[i] = worldExtent.z;
+        worldBounds.entities[i] = entity;
+    }
+}
+
+void performFrustumCulling(const WorldBoundsBuffer& worldBounds,
                            VisibleEntityBuffer& visibleEntityBuffer,
                            const glm::vec4* frustumPlanes) {
 
+    visibleEntityBuffer.size = 0;
+    const uint32_t size = worldBounds.size;
+
+#if defined(__AVX2__)
+    const FrustumPlanesAVX2 planes = broadcastPlanes(frustumPlanes);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+    for (uint32_t first = 0; first < size; first += CULLING_BATCH) {
+        __m256 cx = _mm256_load_ps(worldBounds.centerX + first);
+        __m256 cy = _mm256_load_ps(worldBounds.centerY + first);
+        __m256 cz = _mm256_load_ps(worldBounds.centerZ + first);
+        __m256 ex = _mm256_load_ps(worldBounds.extentX + first);
+        __m256 ey = _mm256_load_ps(worldBounds.extentY + first);
+        __m256 ez = _mm256_load_ps(worldBounds.extentZ + first);
+
+        // All six planes are tested without early-outs, a batch is only rejected lane by lane through the mask.
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int i = 0; i < 6; ++i) {
+            __m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, planes.absX[i]), _mm256_mul_ps(ey, planes.absY[i])),
+                                     _mm256_mul_ps(ez, planes.absZ[i]));
+            __m256 s = planeDistance(planes, i, cx, cy, cz);
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(s, _mm256_xor_ps(r, signMask), _CMP_NLT_UQ));
+        }
+
+        uint32_t mask = (uint32_t)_mm256_movemask_ps(inside) & tailMask(first, size);
+        __m256i entities = _mm256_load_si256((const __m256i*)(worldBounds.entities + first));
+        __m256i permutation = _mm256_load_si256((const __m256i*)compressTable.permutation[mask]);
+        _mm256_storeu_si256((__m256i*)(visibleEntityBuffer.buffer + visibleEntityBuffer.size),
+                            _mm256_permutevar8x32_epi32(entities, permutation));
+        visibleEntityBuffer.size += (uint32_t)std::popcount(mask);
+    }
+#else
+    for (uint32_t index = 0; index < size; ++index) {
+        glm::vec3 worldCenter(worldBounds.centerX[index], worldBounds.centerY[index], worldBounds.centerZ[index]);
+        glm::vec3 worldExtent(worldBounds.extentX[index], worldBounds.extentY[index], worldBounds.extentZ[index]);
+
+        bool isInside = true;
+        for (int i = 0; i < 6; ++i) {
+            const glm::vec4& plane = frustumPlanes[i];
+
+            float r = worldExtent.x * glm::abs(plane.x) +
+                      worldExtent.y * glm::abs(plane.y) +
+                      worldExtent.z * glm::abs(plane.z);
+
+            float s = glm::dot(glm::vec3(plane), worldCenter) + plane.w;
+
+            if (s < -r) {
+                isInside = false;
+                break;
+            }
+        }
+
+        if (isInside) {
+            visibleEntityBuffer.buffer[visibleEntityBuffer.size++] = worldBounds.entities[index];
+        }
+    }
+#endif
+}
+
+void performFrustumCullingScalar(const SparseSet<RenderableTag>& renderableSet,
+                                 const SparseSet<TransformComponent>& transformSet,
+                                 const SparseSet<MeshData>& meshSet,
+                                 VisibleEntityBuffer& visibleEntityBuffer,
+                                 const glm::vec4* frustumPlanes) {
+
     visibleEntityBuffer.size = 0;
     for (uint32_t i = 0; i < renderableSet.entityCount; ++i) {
         uint32_t entity = renderableSet.entities[i];
@@ -204,12 +528,13 @@ Framebuffer createFrameBuffer(const uint32_t framebufferShaderID, const uint32_t
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColorbuffer, 0);
 
-    unsigned int rbo;
-    glGenRenderbuffers(1, &rbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
+    unsigned int depthTexture;
+    glGenTextures(1, &depthTexture);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
 
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!"
@@ -218,8 +543,119 @@ Framebuffer createFrameBuffer(const uint32_t framebufferShaderID, const uint32_t
 
     return Framebuffer{.buffer = framebuffer,
                        .textureAttachment = textureColorbuffer,
-                       .renderBufferObject = rbo,
-                       .shaderID = framebufferShaderID};
+                       .depthAttachment = depthTexture,
+                       .shaderID = framebufferShaderID,
+                       .width = width,
+                       .height = height};
+}
+
+void destroyFrameBuffer(Framebuffer& framebuffer) {
+    glDeleteFramebuffers(1, &framebuffer.buffer);
+    glDeleteTextures(1, &framebuffer.textureAttachment);
+    glDeleteTextures(1, &framebuffer.depthAttachment);
+}
+
+HiZBuffer createHiZBuffer(uint32_t downsampleShaderID, uint32_t cullShaderID) {
+    HiZBuffer hiZ;
+    hiZ.downsampleShaderID = downsampleShaderID;
+    hiZ.cullShaderID = cullShaderID;
+
+    const GLbitfield candidateFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLsizeiptr candidateBytes = OCCLUSION_READBACK_SLOTS * CULLING_CAPACITY * 2 * sizeof(glm::vec4);
+    glGenBuffers(1, &hiZ.candidateSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, hiZ.candidateSSBO);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, candidateBytes, nullptr, candidateFlags);
+    hiZ.mappedCandidates = (glm::vec4*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, candidateBytes, candidateFlags);
+
+    const GLbitfield visibilityFlags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLsizeiptr visibilityBytes = OCCLUSION_READBACK_SLOTS * CULLING_CAPACITY * sizeof(uint32_t);
+    glGenBuffers(1, &hiZ.visibilitySSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, hiZ.visibilitySSBO);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, visibilityBytes, nullptr, visibilityFlags);
+    hiZ.mappedVisibility = (const uint32_t*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, visibilityBytes, visibilityFlags);
+
+    // Written by the CPU before the test and by the test itself, read by the indirect draws after it.
+    const GLsizeiptr drawCommandBytes = OCCLUSION_READBACK_SLOTS * CULLING_CAPACITY * sizeof(DrawElementsIndirectCommand);
+    glGenBuffers(1, &hiZ.drawCommandBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, hiZ.drawCommandBuffer);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, drawCommandBytes, nullptr, candidateFlags);
+    hiZ.mappedDrawCommands = (DrawElementsIndirectCommand*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, drawCommandBytes, candidateFlags);
+
+    return hiZ;
+}
+
+// Texture storage is immutable, so a resize throws the old chain away.
+static void resizeHiZ(HiZBuffer& hiZ, uint32_t framebufferWidth, uint32_t framebufferHeight) {
+    if (hiZ.texture) glDeleteTextures(1, &hiZ.texture);
+
+    hiZ.width = std::bit_floor(std::max(framebufferWidth, 1u));
+    hiZ.height = std::bit_floor(std::max(framebufferHeight, 1u));
+    hiZ.mipCount = std::bit_width(std::max(hiZ.width, hiZ.height));
+
+    glGenTextures(1, &hiZ.texture);
+    glBindTexture(GL_TEXTURE_2D, hiZ.texture);
+    glTexStorage2D(GL_TEXTURE_2D, hiZ.mipCount, GL_R32F, hiZ.width, hiZ.height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+void buildHiZ(HiZBuffer& hiZ, const Framebuffer& framebuffer) {
+    if (hiZ.width != std::bit_floor(std::max(framebuffer.width, 1u)) ||
+        hiZ.height != std::bit_floor(std::max(framebuffer.height, 1u))) {
+        resizeHiZ(hiZ, framebuffer.width, framebuffer.height);
+    }
+
+    glUseProgram(hiZ.downsampleShaderID);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, framebuffer.depthAttachment);
+
+    for (uint32_t level = 0; level < hiZ.mipCount; ++level) {
+        uint32_t levelWidth = std::max(hiZ.width >> level, 1u);
+        uint32_t levelHeight = std::max(hiZ.height >> level, 1u);
+
+        glProgramUniform1i(hiZ.downsampleShaderID, 0, level == 0 ? 1 : 0);
+        if (level > 0) glBindImageTexture(0, hiZ.texture, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(1, hiZ.texture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute((levelWidth + 7) / 8, (levelHeight + 7) / 8, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void testOcclusion(HiZBuffer& hiZ, uint32_t slot, const glm::vec4* candidateBounds, uint32_t candidateCount,
+                   const DrawElementsIndirectCommand* drawCommands, uint32_t drawCommandCount, const glm::mat4& viewProjection) {
+    // Offsets into the slot go through a uniform, SSBO range bindings would have to respect the offset alignment.
+    uint32_t firstCandidate = slot * CULLING_CAPACITY;
+    memcpy(hiZ.mappedCandidates + firstCandidate * 2, candidateBounds, candidateCount * 2 * sizeof(glm::vec4));
+    memcpy(hiZ.mappedDrawCommands + firstCandidate, drawCommands, drawCommandCount * sizeof(DrawElementsIndirectCommand));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, hiZ.candidateSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, hiZ.visibilitySSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, hiZ.drawCommandBuffer);
+
+    glUseProgram(hiZ.cullShaderID);
+    glProgramUniformMatrix4fv(hiZ.cullShaderID, 0, 1, GL_FALSE, &viewProjection[0][0]);
+    glProgramUniform1ui(hiZ.cullShaderID, 1, candidateCount);
+    glProgramUniform1i(hiZ.cullShaderID, 2, (int)hiZ.mipCount);
+    glProgramUniform1ui(hiZ.cullShaderID, 3, firstCandidate);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, hiZ.texture);
+    if (candidateCount > 0) glDispatchCompute((candidateCount + 63) / 64, 1, 1);
+
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+    if (hiZ.fences[slot]) glDeleteSync(hiZ.fences[slot]);
+    hiZ.fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+const uint32_t* readOcclusionResults(HiZBuffer& hiZ, uint32_t slot, bool wait) {
+    if (!hiZ.fences[slot]) return nullptr;
+    // Flushing makes sure the fence gets submitted, without it a wait could block forever.
+    GLenum status = glClientWaitSync(hiZ.fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, wait ? 100'000'000 : 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return nullptr;
+    glDeleteSync(hiZ.fences[slot]);
+    hiZ.fences[slot] = nullptr;
+    return hiZ.mappedVisibility + slot * CULLING_CAPACITY;
 }
 
 uint32_t createQuad() {
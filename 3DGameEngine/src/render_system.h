@@ -4,14 +4,21 @@
 #include <cstdint>
 #include "sparse_set.h"
 #include "entity.h"
+#include "mesh_format.h"
 
 struct MaterialData;
 struct MeshData;
+struct MeshBuffer;
+struct ClusterDrawList;
 struct CameraComponent;
 
+// Culling kernels work on 8 entities at a time, arrays are padded so the last batch and compress-stores never run off the end.
+static constexpr uint32_t CULLING_BATCH = 8;
+static constexpr uint32_t CULLING_CAPACITY = (MAX_ENTITIES + CULLING_BATCH - 1) & ~(CULLING_BATCH - 1);
+
 struct VisibleEntityBuffer {
     uint32_t size = 0;
-    uint32_t buffer[MAX_ENTITIES];
+    uint32_t buffer[CULLING_CAPACITY + CULLING_BATCH];
 };
 
 struct VisiblePointLightBuffer {
@@ -20,11 +27,74 @@ struct VisiblePointLightBuffer {
     PackedLightData buffer[capacity];
 };
 
+// SoA world space AABBs of every renderable in renderableSet dense order. The linear path rebuilds it each frame,
+// the render tree only rewrites the entries that changed.
+struct WorldBoundsBuffer {
+    uint32_t size = 0;
+    alignas(32) float centerX[CULLING_CAPACITY];
+    alignas(32) float centerY[CULLING_CAPACITY];
+    alignas(32) float centerZ[CULLING_CAPACITY];
+    alignas(32) float extentX[CULLING_CAPACITY];
+    alignas(32) float extentY[CULLING_CAPACITY];
+    alignas(32) float extentZ[CULLING_CAPACITY];
+    alignas(32) uint32_t entities[CULLING_CAPACITY];
+};
+
+// SoA bounding spheres of the point lights, same idea as WorldBoundsBuffer.
+struct PointLightBoundsBuffer {
+    static constexpr uint16_t capacity = 256;
+    uint16_t size = 0;
+    alignas(32) float centerX[capacity];
+    alignas(32) float centerY[capacity];
+    alignas(32) float centerZ[capacity];
+    alignas(32) float radius[capacity];
+    alignas(32) uint32_t entities[capacity];
+};
+
+// LOD picked for every visible entity this frame, indexed by entity.
+struct MeshLODSelection {
+    float pixelThreshold = 1.0f; // Coarsest LOD whose projected error stays below this many pixels wins.
+    uint8_t lod[MAX_ENTITIES];
+    uint32_t lodHistogram[MAX_MESH_LODS];
+};
+
 struct Framebuffer {
     GLuint buffer;
     GLuint textureAttachment;
-    GLuint renderBufferObject;
+    GLuint depthAttachment; // Texture rather than a renderbuffer so the Hi-Z pass can read it.
     uint32_t shaderID;
+    uint32_t width;
+    uint32_t height;
+};
+
+// Occlusion tests in flight at once. Results are read a frame or more after the dispatch, so the CPU doesn't wait on it.
+static constexpr uint32_t OCCLUSION_READBACK_SLOTS = 3;
+
+// Layout glDrawElementsIndirect reads.
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+// Max depth mip chain of the depth attachment, level 0 is the largest power of two that fits the framebuffer.
+// Candidate, visibility and draw command buffers are persistently mapped, one CULLING_CAPACITY slice per readback slot.
+struct HiZBuffer {
+    GLuint texture = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipCount = 0;
+    uint32_t downsampleShaderID;
+    uint32_t cullShaderID;
+    GLuint candidateSSBO;
+    GLuint visibilitySSBO;
+    glm::vec4* mappedCandidates;
+    const uint32_t* mappedVisibility;
+    GLuint drawCommandBuffer;
+    DrawElementsIndirectCommand* mappedDrawCommands;
+    GLsync fences[OCCLUSION_READBACK_SLOTS] = {};
 };
 
 struct SceneUBOData {
@@ -39,20 +109,40 @@ struct SkyboxData {
     uint64_t cubemapHandle;
     uint32_t shaderID;
     uint32_t meshVAO;
+    GLenum indexType;
 };
 
 // TODO: THE CONST-CORRECTNESS HERE IS UNNECSSARY - NOT SURE IF I LIKE IT
 glm::mat4 buildTransformMatrix(const glm::vec3& position, const glm::vec3& scale, const glm::quat& rotation);
 void renderSkybox(const SkyboxData& skyboxData);
+void clearFramebuffer(const Framebuffer& framebuffer);
 void renderSystem(const VisibleEntityBuffer& visibleEntities, const SparseSet<MaterialData>& materialSet,
-                 const SparseSet<MeshData>& meshSet, const SparseSet<TransformComponent>& transformSet, const Framebuffer& framebuffer);
+                 const SparseSet<MeshData>& meshSet, const SparseSet<TransformComponent>& transformSet,
+                 const MeshBuffer& meshBuffer, const MeshLODSelection& lodSelection, const ClusterDrawList& clusterDrawList,
+                 const Framebuffer& framebuffer);
+// One command per entity for its selected LOD, with instanceCount left at 0 for the occlusion test to fill in.
+void writeDrawCommands(const VisibleEntityBuffer& entities, const SparseSet<MeshData>& meshSet, const MeshBuffer& meshBuffer,
+                       const MeshLODSelection& lodSelection, DrawElementsIndirectCommand* drawCommands);
+// Draws entities through the commands testOcclusion left in the slot, so the ones it found occluded draw nothing.
+void renderIndirect(const VisibleEntityBuffer& entities, const HiZBuffer& hiZ, uint32_t slot,
+                    const SparseSet<MaterialData>& materialSet, const SparseSet<MeshData>& meshSet,
+                    const SparseSet<TransformComponent>& transformSet, const MeshBuffer& meshBuffer, const Framebuffer& framebuffer);
+void selectMeshLODs(const VisibleEntityBuffer& visibleEntities, const SparseSet<MeshData>& meshSet,
+                    const SparseSet<TransformComponent>& transformSet, const MeshBuffer& meshBuffer,
+                    const CameraComponent& camera, uint32_t screenHeight, MeshLODSelection& lodSelection);
 void drawToFramebuffer(const Framebuffer& framebuffer, uint32_t quadVAO);
 void initOpenglRenderState();
 uint32_t createLightSSBO(uint32_t maxLights);
 void performLightCulling(const SparseSet<PointLightComponent>& pointLightEntities,
                          const SparseSet<TransformComponent>& transformSet,
+                         PointLightBoundsBuffer& pointLightBounds,
                          VisiblePointLightBuffer& visiblePointLights,
                          const glm::vec4* frustumPlanes);
+// Reference implementation, culling_test checks the batched kernel against it.
+void performLightCullingScalar(const SparseSet<PointLightComponent>& pointLightEntities,
+                               const SparseSet<TransformComponent>& transformSet,
+                               VisiblePointLightBuffer& visiblePointLights,
+                               const glm::vec4* frustumPlanes);
 void uploadLightSSBO(const uint32_t lightSSBO, const VisiblePointLightBuffer& visiblePointLights);
 
 uint32_t createSceneUBO();
@@ -60,11 +150,30 @@ void updateSceneData(SceneUBOData& sceneData, const CameraComponent& camera,
                      const VisiblePointLightBuffer& visiblePointLights, const SkyboxData& skyboxData);
 void uploadSceneUBO(const uint32_t sceneUBO, const SceneUBOData sceneData);
 
-void performFrustumCulling(const SparseSet<RenderableTag>& renderableEntities,
-                           const SparseSet<TransformComponent>& transformSet,
-                           const SparseSet<MeshData>& meshSet,
+void computeWorldBounds(const TransformComponent& transform, const MeshData& mesh, glm::vec3& worldCenter, glm::vec3& worldExtent);
+void updateWorldBounds(const SparseSet<RenderableTag>& renderableEntities,
+                       const SparseSet<TransformComponent>& transformSet,
+                       const SparseSet<MeshData>& meshSet,
+                       WorldBoundsBuffer& worldBounds);
+void performFrustumCulling(const WorldBoundsBuffer& worldBounds,
                            VisibleEntityBuffer& visibleEntities,
                            const glm::vec4* frustumPlanes);
+// Reference implementation, culling_test checks the batched kernel against it.
+void performFrustumCullingScalar(const SparseSet<RenderableTag>& renderableEntities,
+                                 const SparseSet<TransformComponent>& transformSet,
+                                 const SparseSet<MeshData>& meshSet,
+                                 VisibleEntityBuffer& visibleEntities,
+                                 const glm::vec4* frustumPlanes);
 
 Framebuffer createFrameBuffer(const uint32_t frambufferShaderID, const uint32_t width, const uint32_t height);
+void destroyFrameBuffer(Framebuffer& framebuffer);
+
+HiZBuffer createHiZBuffer(uint32_t downsampleShaderID, uint32_t cullShaderID);
+void buildHiZ(HiZBuffer& hiZ, const Framebuffer& framebuffer);
+// Dispatches the test into a readback slot and fences it, the slot must have been read or never used.
+// A candidate whose center.w is a draw command index also gets that command's instanceCount set to its result.
+void testOcclusion(HiZBuffer& hiZ, uint32_t slot, const glm::vec4* candidateBounds, uint32_t candidateCount,
+                   const DrawElementsIndirectCommand* drawCommands, uint32_t drawCommandCount, const glm::mat4& viewProjection);
+// One entry per candidate of the slot's dispatch, or null while the GPU is still on it. Only waits when asked to.
+const uint32_t* readOcclusionResults(HiZBuffer& hiZ, uint32_t slot, bool wait);
 uint32_t createQuad();
\ No newline at end of file
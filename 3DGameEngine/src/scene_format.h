@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+
+// Layout of scene files. File = SceneFileHeader, then chunkCount chunks back to back.
+// Chunk = SceneChunkHeader, the entity IDs and the component array, each at its offset from the start of the chunk.
+// Chunks the loader doesn't know are skipped using their size, so new component types don't break older builds.
+
+#define SCENE_FILE_MAGIC 0x4E435350 // "PSCN"
+#define SCENE_FILE_VERSION 1
+
+static constexpr uint32_t SCENE_CHUNK_ALIGNMENT = 16;
+
+// Values are stored in files, only ever append.
+enum class SceneChunkID : uint32_t {
+    Transform = 1,
+    Velocity,
+    Speed,
+    RotationSpeed,
+    Health,
+    Collision,
+    Patrol,
+    PointLight,
+    Material,
+    Mesh,
+    Camera,
+    InputMap,
+    Renderable,
+    Dynamic,
+    Bullet,
+    InputWorld,
+    InputTank,
+    InputNoClip,
+    Name,
+    Occluder,
+};
+
+struct SceneFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entityCount;
+    uint32_t chunkCount;
+};
+
+struct SceneChunkHeader {
+    SceneChunkID id;
+    uint32_t layoutVersion; // Bumped when the component struct changes, older layouts go through a migration hook.
+    uint32_t elementSize;
+    uint32_t count;
+    uint32_t alignment;
+    uint32_t entitiesOffset;
+    uint32_t componentsOffset;
+    uint32_t size; // Whole chunk including this header and the padding after it.
+};
+
+// Compressed scenes: CompressedSceneHeader, the block table, then the blocks. Decoding every block into its rawOffset
+// gives back the plain scene file above. The file header is one block and every chunk another, so blocks decode in parallel.
+
+#define SCENE_COMPRESSED_MAGIC 0x5A435350 // "PSCZ"
+#define SCENE_COMPRESSED_VERSION 1
+
+enum class SceneBlockFilter : uint32_t {
+    None,
+    // The chunk's entity IDs are stored as deltas, and its components split into 4 byte columns, each delta encoded
+    // against the previous element and then split into byte planes. Repeated and slowly changing floats become zeros.
+    Chunk,
+};
+
+struct CompressedSceneHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t blockCount;
+    uint32_t reserved;
+    uint64_t rawSize;
+};
+
+struct CompressedSceneBlock {
+    uint64_t rawOffset;
+    uint64_t offset; // From the start of the file.
+    uint32_t rawSize;
+    uint32_t size; // Equal to rawSize when the block is stored uncompressed.
+    SceneBlockFilter filter;
+    uint32_t reserved;
+};
+
+// Streamed worlds: WorldFileHeader, the cell table, then every cell as a run of the chunks above.
+// Entity IDs inside a cell are local to it (0 to entityCount - 1, ascending in every chunk), the streamer maps them to
+// ECS entities when the cell is loaded.
+
+#define WORLD_FILE_MAGIC 0x444C5750 // "PWLD"
+#define WORLD_FILE_VERSION 1
+
+struct WorldFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t cellCount;
+    float cellSize; // Cells are square on the XZ plane, cell (x, z) covers [x, x + 1) * cellSize.
+};
+
+struct WorldCellEntry {
+    int32_t x;
+    int32_t z;
+    uint32_t entityCount;
+    uint32_t chunkCount;
+    uint64_t offset; // From the start of the file.
+    uint64_t size;
+};
@@ -0,0 +1,29 @@
+#pragma once
+#include "ecs.h"
+#include "serialization.h"
+
+// Every component set with its chunk ID, the layout version this build writes and the hook that upgrades older layouts.
+// When a component struct changes, bump its version and give it a hook that reads the old one.
+template <typename Visitor>
+void forEachSceneSet(ECS& scene, Visitor&& visit) {
+    visit(SceneChunkID::Transform, 1u, nullptr, scene.transformSet);
+    visit(SceneChunkID::Velocity, 1u, nullptr, scene.velocitySet);
+    visit(SceneChunkID::Speed, 1u, nullptr, scene.speedSet);
+    visit(SceneChunkID::RotationSpeed, 1u, nullptr, scene.rotationSpeedSet);
+    visit(SceneChunkID::Health, 1u, nullptr, scene.healthSet);
+    visit(SceneChunkID::Collision, 1u, nullptr, scene.collisionSet);
+    visit(SceneChunkID::Patrol, 1u, nullptr, scene.patrolSet);
+    visit(SceneChunkID::PointLight, 1u, nullptr, scene.pointLightSet);
+    visit(SceneChunkID::Material, 1u, nullptr, scene.materialSet);
+    visit(SceneChunkID::Mesh, 1u, nullptr, scene.meshSet);
+    visit(SceneChunkID::Camera, 1u, nullptr, scene.cameraSet);
+    visit(SceneChunkID::InputMap, 1u, nullptr, scene.inputMapSet);
+    visit(SceneChunkID::Renderable, 1u, nullptr, scene.renderableSet);
+    visit(SceneChunkID::Dynamic, 1u, nullptr, scene.dynamicSet);
+    visit(SceneChunkID::Bullet, 1u, nullptr, scene.bulletSet);
+    visit(SceneChunkID::InputWorld, 1u, nullptr, scene.inputWorldSet);
+    visit(SceneChunkID::InputTank, 1u, nullptr, scene.inputTankSet);
+    visit(SceneChunkID::InputNoClip, 1u, nullptr, scene.inputNoClipSet);
+    visit(SceneChunkID::Name, 1u, nullptr, scene.nameSet);
+    visit(SceneChunkID::Occluder, 1u, nullptr, scene.occluderSet);
+}
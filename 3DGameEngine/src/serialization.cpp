@@ -1,60 +1,273 @@
 #include "serialization.h"
-#include "ecs.h"
+#include "scene_sets.h"
+#include "mapped_file.h"
+#include "block_compression.h"
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
 
-void saveScene(ECS& scene, const char* path) {
+// The chunk header itself stays as it is so the inverse can find the arrays.
+bool filterChunk(uint8_t* chunk, size_t size, bool forward, std::vector<uint8_t>& scratch) {
+    SceneChunkHeader header;
+    if (size < sizeof(SceneChunkHeader)) return false;
+    memcpy(&header, chunk, sizeof(SceneChunkHeader));
+    if (!sceneChunkInBounds(header, size)) return false;
+
+    uint8_t* entities = chunk + header.entitiesOffset;
+    for (uint32_t n = 1; n < header.count; ++n) {
+        uint32_t i = forward ? header.count - n : n;
+        uint32_t entity, previous;
+        memcpy(&entity, entities + i * sizeof(uint32_t), sizeof(uint32_t));
+        memcpy(&previous, entities + (i - 1) * sizeof(uint32_t), sizeof(uint32_t));
+        entity = forward ? entity - previous : entity + previous;
+        memcpy(entities + i * sizeof(uint32_t), &entity, sizeof(uint32_t));
+    }
+
+    if (header.elementSize % sizeof(uint32_t) != 0 || header.count < 2) return true;
+    uint8_t* components = chunk + header.componentsOffset;
+    uint32_t columns = header.elementSize / sizeof(uint32_t);
+    size_t bytes = (size_t)header.count * header.elementSize;
+    scratch.resize(bytes);
+    if (!forward) memcpy(scratch.data(), components, bytes);
+    for (uint32_t column = 0; column < columns; ++column) {
+        uint32_t previous = 0;
+        uint8_t* planes = scratch.data() + (size_t)column * sizeof(uint32_t) * header.count;
+        for (uint32_t i = 0; i < header.count; ++i) {
+            uint8_t* word = components + (size_t)i * header.elementSize + column * sizeof(uint32_t);
+            uint32_t value;
+            if (forward) {
+                memcpy(&value, word, sizeof(uint32_t));
+                uint32_t delta = value - previous;
+                previous = value;
+                for (uint32_t b = 0; b < sizeof(uint32_t); ++b) planes[b * header.count + i] = (uint8_t)(delta >> (b * 8));
+            } else {
+                uint32_t delta = 0;
+                for (uint32_t b = 0; b < sizeof(uint32_t); ++b) delta |= (uint32_t)planes[b * header.count + i] << (b * 8);
+                value = previous + delta;
+                previous = value;
+                memcpy(word, &value, sizeof(uint32_t));
+            }
+        }
+    }
+    if (forward) memcpy(components, scratch.data(), bytes);
+    return true;
+}
+
+static void compressSceneFile(const char* path) {
+    auto startTime = std::chrono::steady_clock::now();
+    MappedFile file;
+    if (!openMappedFile(path, file)) return;
+    std::vector<uint8_t> image(file.data, file.data + file.size);
+    closeMappedFile(file);
+
+    // The file header is the first block, every chunk after it gets its own.
+    std::vector<CompressedSceneBlock> blocks;
+    blocks.push_back({0, 0, (uint32_t)sizeof(SceneFileHeader), 0, SceneBlockFilter::None, 0});
+    size_t offset = sizeof(SceneFileHeader);
+    while (offset + sizeof(SceneChunkHeader) <= image.size()) {
+        SceneChunkHeader chunk;
+        memcpy(&chunk, image.data() + offset, sizeof(SceneChunkHeader));
+        if (!sceneChunkInBounds(chunk, image.size() - offset)) break;
+        blocks.push_back({offset, 0, chunk.size, 0, SceneBlockFilter::Chunk, 0});
+        offset += chunk.size;
+    }
+    if (offset < image.size()) blocks.push_back({offset, 0, (uint32_t)(image.size() - offset), 0, SceneBlockFilter::None, 0});
+
+    std::vector<uint8_t> compressed;
+    std::vector<uint8_t> scratch;
+    uint64_t dataOffset = sizeof(CompressedSceneHeader) + blocks.size() * sizeof(CompressedSceneBlock);
+    for (CompressedSceneBlock& block : blocks) {
+        uint8_t* raw = image.data() + block.rawOffset;
+        if (block.filter == SceneBlockFilter::Chunk) filterChunk(raw, block.rawSize, true, scratch);
+        size_t start = compressed.size();
+        compressed.resize(start + compressBlockBound(block.rawSize));
+        size_t size = compressBlock(raw, block.rawSize, compressed.data() + start, compressed.size() - start);
+        if (size == 0 || size >= block.rawSize) {
+            // Stored as is, still filtered, the decoder undoes the filter either way.
+            size = block.rawSize;
+            memcpy(compressed.data() + start, raw, size);
+        }
+        compressed.resize(start + size);
+        block.offset = dataOffset + start;
+        block.size = (uint32_t)size;
+    }
+
+    FILE* f = fopen(path, "wb");
+    if (!f) return;
+    CompressedSceneHeader header = {SCENE_COMPRESSED_MAGIC, SCENE_COMPRESSED_VERSION, (uint32_t)blocks.size(), 0, image.size()};
+    fwrite(&header, sizeof(CompressedSceneHeader), 1, f);
+    fwrite(blocks.data(), sizeof(CompressedSceneBlock), blocks.size(), f);
+    fwrite(compressed.data(), 1, compressed.size(), f);
+    fclose(f);
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime);
+    size_t total = (size_t)dataOffset + compressed.size();
+    std::cout << "Compressed " << path << ": " << image.size() << " -> " << total << " bytes (" << (float)image.size() / total
+              << "x) in " << elapsed.count() << " us" << std::endl;
+}
+
+void saveScene(ECS& scene, const char* path, bool compress) {
     FILE* f = fopen(path, "wb");
     if (!f) return;
 
-    fwrite(&scene.entityCount, sizeof(uint32_t), 1, f);
-
-    writeSet(f, scene.transformSet);
-    writeSet(f, scene.velocitySet);
-    writeSet(f, scene.speedSet);
-    writeSet(f, scene.rotationSpeedSet);
-    writeSet(f, scene.healthSet);
-    writeSet(f, scene.collisionSet);
-    writeSet(f, scene.patrolSet);
-    writeSet(f, scene.pointLightSet);
-    writeSet(f, scene.materialSet);
-    writeSet(f, scene.meshSet);
-    writeSet(f, scene.cameraSet);
-    writeSet(f, scene.inputMapSet);
-    writeSet(f, scene.renderableSet);
-    writeSet(f, scene.dynamicSet);
-    writeSet(f, scene.bulletSet);
-    writeSet(f, scene.inputWorldSet);
-    writeSet(f, scene.inputTankSet);
-    writeSet(f, scene.inputNoClipSet);
-    writeSet(f, scene.nameSet);
+    SceneFileHeader header = {SCENE_FILE_MAGIC, SCENE_FILE_VERSION, scene.entityCount, 0};
+    forEachSceneSet(scene, [&](SceneChunkID, uint32_t, SceneMigrateFn, auto&) { ++header.chunkCount; });
+    fwrite(&header, sizeof(SceneFileHeader), 1, f);
+    forEachSceneSet(scene, [&](SceneChunkID id, uint32_t layoutVersion, SceneMigrateFn, auto& set) {
+        writeChunk(f, id, layoutVersion, set);
+    });
 
     fclose(f);
+    if (compress) compressSceneFile(path);
 }
 
-void loadScene(ECS& scene, const char* path) {
+// Blocks are handed out to threads one at a time, chunk sizes vary too much to split them evenly up front.
+static bool decompressScene(const MappedFile& file, std::vector<uint8_t>& image, const char* path) {
+    auto startTime = std::chrono::steady_clock::now();
+    CompressedSceneHeader header = {};
+    if (file.size >= sizeof(CompressedSceneHeader)) memcpy(&header, file.data, sizeof(CompressedSceneHeader));
+    const uint8_t* table = file.data + sizeof(CompressedSceneHeader);
+    bool valid = header.version <= SCENE_COMPRESSED_VERSION && header.rawSize >= sizeof(SceneFileHeader) &&
+                 sizeof(CompressedSceneHeader) + (uint64_t)header.blockCount * sizeof(CompressedSceneBlock) <= file.size;
+    for (uint32_t i = 0; i < header.blockCount && valid; ++i) {
+        CompressedSceneBlock block;
+        memcpy(&block, table + (size_t)i * sizeof(CompressedSceneBlock), sizeof(CompressedSceneBlock));
+        valid = block.offset <= file.size && block.size <= file.size - block.offset && block.rawOffset <= header.rawSize &&
+                block.rawSize <= header.rawSize - block.rawOffset;
+    }
+    if (!valid) {
+        std::cout << "Compressed scene is damaged: " << path << std::endl;
+        return false;
+    }
+    image.assign((size_t)header.rawSize, 0);
+
+    std::atomic<uint32_t> nextBlock{0};
+    std::atomic<bool> decoded{true};
+    auto decodeBlocks = [&]() {
+        std::vector<uint8_t> scratch;
+        for (uint32_t i = nextBlock++; i < header.blockCount; i = nextBlock++) {
+            CompressedSceneBlock block;
+            memcpy(&block, table + (size_t)i * sizeof(CompressedSceneBlock), sizeof(CompressedSceneBlock));
+            uint8_t* raw = image.data() + block.rawOffset;
+            bool ok = block.size == block.rawSize ? (memcpy(raw, file.data + block.offset, block.size), true)
+                                                  : decompressBlock(file.data + block.offset, block.size, raw, block.rawSize);
+            if (ok && block.filter == SceneBlockFilter::Chunk) ok = filterChunk(raw, block.rawSize, false, scratch);
+            if (!ok) decoded.store(false, std::memory_order_relaxed);
+        }
+    };
+    uint32_t threadCount = std::min(std::max(std::thread::hardware_concurrency(), 1u), std::min(header.blockCount, 8u));
+    std::vector<std::thread> threads;
+    for (uint32_t t = 1; t < threadCount; ++t) threads.emplace_back(decodeBlocks);
+    decodeBlocks();
+    for (std::thread& thread : threads) thread.join();
+    if (!decoded.load()) {
+        std::cout << "Compressed scene failed to decode: " << path << std::endl;
+        return false;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime);
+    double seconds = std::max((double)elapsed.count(), 1.0) / 1e6;
+    std::cout << "Decompressed " << path << ": " << file.size << " -> " << header.rawSize << " bytes, " << header.blockCount
+              << " blocks on " << threadCount << " threads, " << (header.rawSize / (1024.0 * 1024.0)) / seconds << " MB/s" << std::endl;
+    return true;
+}
+
+// Sleep and contacts refer to the entities that were there before, everything wakes and settles again.
+static void resetSimulationState(ECS& scene) {
+    wakeAllBodies(scene.bodySleep);
+    resetContactPairs(scene.contacts);
+}
+
+static void loadLegacyScene(ECS& scene, const char* path) {
     FILE* f = fopen(path, "rb");
     if (!f) return;
 
-    fread(&scene.entityCount, sizeof(uint32_t), 1, f);
-
-    readSet(f, scene.transformSet);
-    readSet(f, scene.velocitySet);
-    readSet(f, scene.speedSet);
-    readSet(f, scene.rotationSpeedSet);
-    readSet(f, scene.healthSet);
-    readSet(f, scene.collisionSet);
-    readSet(f, scene.patrolSet);
-    readSet(f, scene.pointLightSet);
-    readSet(f, scene.materialSet);
-    readSet(f, scene.meshSet);
-    readSet(f, scene.cameraSet);
-    readSet(f, scene.inputMapSet);
-    readSet(f, scene.renderableSet);
-    readSet(f, scene.dynamicSet);
-    readSet(f, scene.bulletSet);
-    readSet(f, scene.inputWorldSet);
-    readSet(f, scene.inputTankSet);
-    readSet(f, scene.inputNoClipSet);
-    readSet(f, scene.nameSet);
+    if (fread(&scene.entityCount, sizeof(uint32_t), 1, f) != 1) scene.entityCount = 0;
+    // A set that doesn't fit means the file is from a different layout, everything after it would be garbage.
+    bool valid = true;
+    forEachSceneSet(scene, [&](SceneChunkID, uint32_t, SceneMigrateFn, auto& set) {
+        if (valid) {
+            valid = readSet(f, set);
+        } else {
+            set.entityCount = 0;
+            set.rebuildSparse();
+        }
+    });
+    if (!valid) std::cout << "Scene file doesn't match the component layout, stopped reading: " << path << std::endl;
 
     fclose(f);
-}
\ No newline at end of file
+    resetSimulationState(scene);
+}
+
+static void loadSceneImage(ECS& scene, const uint8_t* data, size_t size, const char* path,
+                           std::chrono::steady_clock::time_point startTime) {
+    SceneFileHeader header = {};
+    if (size >= sizeof(SceneFileHeader)) memcpy(&header, data, sizeof(SceneFileHeader));
+    if (header.version > SCENE_FILE_VERSION) {
+        std::cout << "Scene file version " << header.version << " is newer than this build: " << path << std::endl;
+        return;
+    }
+
+    forEachSceneSet(scene, [&](SceneChunkID, uint32_t, SceneMigrateFn, auto& set) {
+        set.entityCount = 0;
+        set.rebuildSparse();
+    });
+    scene.entityCount = std::min(header.entityCount, (uint32_t)MAX_ENTITIES);
+
+    size_t offset = sizeof(SceneFileHeader);
+    uint32_t skippedChunks = 0;
+    for (uint32_t c = 0; c < header.chunkCount; ++c) {
+        SceneChunkHeader chunk;
+        if (offset + sizeof(SceneChunkHeader) > size) break;
+        memcpy(&chunk, data + offset, sizeof(SceneChunkHeader));
+        if (!sceneChunkInBounds(chunk, size - offset)) {
+            std::cout << "Scene chunk " << c << " runs past the end of the file: " << path << std::endl;
+            break;
+        }
+
+        bool known = false;
+        const uint8_t* chunkData = data + offset;
+        forEachSceneSet(scene, [&](SceneChunkID id, uint32_t layoutVersion, SceneMigrateFn migrate, auto& set) {
+            if (id != chunk.id) return;
+            known = true;
+            if (!readChunk(chunk, chunkData, set, layoutVersion, migrate)) {
+                std::cout << "Dropped scene chunk " << (uint32_t)chunk.id << " with layout " << chunk.layoutVersion << std::endl;
+            }
+        });
+        if (!known) ++skippedChunks;
+        offset += chunk.size;
+    }
+    resetSimulationState(scene);
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime);
+    std::cout << "Loaded " << path << ": " << scene.entityCount << " entities, " << header.chunkCount << " chunks ("
+              << skippedChunks << " unknown) in " << elapsed.count() << " us" << std::endl;
+}
+
+void loadScene(ECS& scene, const char* path) {
+    auto startTime = std::chrono::steady_clock::now();
+    MappedFile file;
+    if (!openMappedFile(path, file)) {
+        std::cout << "Failed to open scene: " << path << std::endl;
+        return;
+    }
+
+    uint32_t magic = 0;
+    if (file.size >= sizeof(uint32_t)) memcpy(&magic, file.data, sizeof(uint32_t));
+    if (magic == SCENE_COMPRESSED_MAGIC) {
+        std::vector<uint8_t> image;
+        bool decoded = decompressScene(file, image, path);
+        closeMappedFile(file);
+        if (!decoded) return;
+        memcpy(&magic, image.data(), sizeof(uint32_t));
+        if (magic == SCENE_FILE_MAGIC) loadSceneImage(scene, image.data(), image.size(), path, startTime);
+    } else if (magic == SCENE_FILE_MAGIC) {
+        loadSceneImage(scene, file.data, file.size, path, startTime);
+        closeMappedFile(file);
+    } else {
+        closeMappedFile(file);
+        loadLegacyScene(scene, path);
+    }
+}
@@ -1,24 +1,109 @@
 #pragma once
 #define _CRT_SECURE_NO_WARNINGS
 #include <cstdio>
+#include <cstring>
+#include <vector>
 #include "sparse_set.h"
+#include "scene_format.h"
 
 struct ECS;
 
+// Converts one component stored with an older layout into the current struct. Returning false drops the chunk.
+using SceneMigrateFn = bool (*)(const uint8_t* source, uint32_t elementSize, uint32_t layoutVersion, void* destination);
+
+inline uint32_t alignSceneOffset(uint32_t offset, uint32_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+template <typename T>
+void writeChunkData(FILE* f, SceneChunkID id, uint32_t layoutVersion, const uint32_t* entities, const T* components, uint32_t count) {
+    SceneChunkHeader header = {};
+    header.id = id;
+    header.layoutVersion = layoutVersion;
+    header.elementSize = sizeof(T);
+    header.count = count;
+    header.alignment = alignof(T) > SCENE_CHUNK_ALIGNMENT ? (uint32_t)alignof(T) : SCENE_CHUNK_ALIGNMENT;
+    header.entitiesOffset = sizeof(SceneChunkHeader);
+    header.componentsOffset = alignSceneOffset(header.entitiesOffset + count * sizeof(uint32_t), header.alignment);
+    header.size = alignSceneOffset(header.componentsOffset + count * sizeof(T), SCENE_CHUNK_ALIGNMENT);
+
+    static const uint8_t padding[64] = {};
+    fwrite(&header, sizeof(SceneChunkHeader), 1, f);
+    fwrite(entities, sizeof(uint32_t), count, f);
+    fwrite(padding, 1, header.componentsOffset - header.entitiesOffset - count * sizeof(uint32_t), f);
+    fwrite(components, sizeof(T), count, f);
+    fwrite(padding, 1, header.size - header.componentsOffset - count * sizeof(T), f);
+}
+
 template <typename T>
-void writeSet(FILE* f, SparseSet<T>& set) {
-    fwrite(&set.entityCount, sizeof(uint32_t), 1, f);
-    fwrite(set.entities, sizeof(uint32_t), set.entityCount, f);
-    fwrite(set.dense, sizeof(T), set.entityCount, f);
+void writeChunk(FILE* f, SceneChunkID id, uint32_t layoutVersion, const SparseSet<T>& set) {
+    writeChunkData(f, id, layoutVersion, set.entities, set.dense, set.entityCount);
 }
 
+// Whether a chunk header's arrays lie inside the chunk, and the chunk inside the available bytes.
+inline bool sceneChunkInBounds(const SceneChunkHeader& chunk, size_t available) {
+    return chunk.size >= sizeof(SceneChunkHeader) && chunk.size <= available &&
+           chunk.entitiesOffset + (uint64_t)chunk.count * sizeof(uint32_t) <= chunk.size &&
+           chunk.componentsOffset + (uint64_t)chunk.count * chunk.elementSize <= chunk.size;
+}
+
+// Reads one component of a chunk in the current layout, through the migration hook when it was stored with another.
 template <typename T>
-void readSet(FILE* f, SparseSet<T>& set) {
-    fread(&set.entityCount, sizeof(uint32_t), 1, f);
-    fread(set.entities, sizeof(uint32_t), set.entityCount, f);
-    fread(set.dense, sizeof(T), set.entityCount, f);
+bool readChunkElement(const SceneChunkHeader& header, const uint8_t* chunk, uint32_t index, uint32_t layoutVersion,
+                      SceneMigrateFn migrate, T& component) {
+    const uint8_t* source = chunk + header.componentsOffset + (size_t)index * header.elementSize;
+    if (header.layoutVersion == layoutVersion) {
+        if (header.elementSize != sizeof(T)) return false;
+        memcpy(&component, source, sizeof(T));
+        return true;
+    }
+    return migrate && migrate(source, header.elementSize, header.layoutVersion, &component);
+}
+
+// The chunk's offsets are already checked against its size. Leaves the set empty when the chunk can't be used.
+template <typename T>
+bool readChunk(const SceneChunkHeader& header, const uint8_t* chunk, SparseSet<T>& set, uint32_t layoutVersion, SceneMigrateFn migrate) {
+    set.entityCount = 0;
+    bool valid = header.count <= set.denseCapacity;
+    if (valid) {
+        memcpy(set.entities, chunk + header.entitiesOffset, header.count * sizeof(uint32_t));
+        for (uint32_t i = 0; i < header.count && valid; ++i) valid = set.entities[i] < MAX_ENTITIES;
+    }
+
+    const uint8_t* components = chunk + header.componentsOffset;
+    if (valid && header.layoutVersion == layoutVersion) {
+        valid = header.elementSize == sizeof(T);
+        if (valid) memcpy(set.dense, components, header.count * sizeof(T));
+    } else if (valid) {
+        valid = migrate != nullptr;
+        for (uint32_t i = 0; i < header.count && valid; ++i) {
+            valid = migrate(components + (size_t)i * header.elementSize, header.elementSize, header.layoutVersion, &set.dense[i]);
+        }
+    }
+
+    if (valid) set.entityCount = header.count;
     set.rebuildSparse();
+    return valid;
 }
 
-void saveScene(ECS& scene, const char* path);
-void loadScene(ECS& scene, const char* path);
\ No newline at end of file
+// Headerless files from before the chunked format, a fixed order of raw set dumps.
+template <typename T>
+bool readSet(FILE* f, SparseSet<T>& set) {
+    // Older files end before sets that were added later, those just load empty.
+    uint32_t count = 0;
+    if (fread(&count, sizeof(uint32_t), 1, f) != 1) count = 0;
+    bool valid = count <= set.denseCapacity && fread(set.entities, sizeof(uint32_t), count, f) == count &&
+                 fread(set.dense, sizeof(T), count, f) == count;
+    for (uint32_t i = 0; i < count && valid; ++i) valid = set.entities[i] < MAX_ENTITIES;
+    set.entityCount = valid ? count : 0;
+    set.rebuildSparse();
+    return valid;
+}
+
+// Run on every chunk block of a compressed scene. Forward turns the chunk's entity IDs and components into deltas and byte
+// planes, inverse undoes it. False when the chunk header doesn't fit the chunk.
+bool filterChunk(uint8_t* chunk, size_t size, bool forward, std::vector<uint8_t>& scratch);
+
+// Compressed scenes are written as a plain scene first and then rewritten block by block.
+void saveScene(ECS& scene, const char* path, bool compress = false);
+void loadScene(ECS& scene, const char* path);
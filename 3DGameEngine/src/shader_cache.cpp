@@ -0,0 +1,189 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "shader_cache.h"
+#include "shader_s.h"
+#include <GLFW/glfw3.h>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Not in the glad build, the KHR and ARB entry points share this signature.
+typedef void(APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+static ShaderCache shaderCache;
+
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t hashString(uint64_t hash, const char* text) {
+    // The terminator goes in too, so "ab" + "c" and "a" + "bc" differ.
+    return hashBytes(hash, text ? text : "", text ? strlen(text) + 1 : 1);
+}
+
+static bool hasExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension && strcmp(extension, name) == 0) return true;
+    }
+    return false;
+}
+
+void initShaderCache(const char* directory) {
+    shaderCache.startTime = std::chrono::steady_clock::now();
+    strncpy(shaderCache.directory, directory, sizeof(shaderCache.directory) - 1);
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    // A driver update can change what a binary means, so the driver is part of every key.
+    uint64_t hash = 14695981039346656037ull;
+    hash = hashString(hash, (const char*)glGetString(GL_VENDOR));
+    hash = hashString(hash, (const char*)glGetString(GL_RENDERER));
+    hash = hashString(hash, (const char*)glGetString(GL_VERSION));
+    shaderCache.driverHash = hash;
+
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreads = nullptr;
+    if (hasExtension("GL_KHR_parallel_shader_compile")) {
+        maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+    } else if (hasExtension("GL_ARB_parallel_shader_compile")) {
+        maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+    }
+    if (maxShaderCompilerThreads) {
+        // All ones lets the driver pick the thread count.
+        maxShaderCompilerThreads(0xFFFFFFFFu);
+        shaderCache.parallelCompile = true;
+    }
+}
+
+static std::string cachePath(uint64_t key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return std::string(shaderCache.directory) + "/" + name;
+}
+
+static bool loadProgramBinary(uint32_t program, uint64_t key) {
+    std::string path = cachePath(key);
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    // A truncated or corrupt file must not size the allocation, the binary has to be exactly the rest of the file.
+    std::error_code error;
+    uintmax_t fileSize = std::filesystem::file_size(path, error);
+    ShaderBinaryHeader header;
+    std::vector<uint8_t> binary;
+    bool valid = !error && fread(&header, sizeof(header), 1, file) == 1 && header.magic == SHADER_BINARY_MAGIC &&
+                 header.length > 0 && header.length == fileSize - sizeof(header);
+    if (valid) {
+        binary.resize(header.length);
+        valid = fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    fclose(file);
+    if (!valid) return false;
+
+    glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    return success == GL_TRUE;
+}
+
+static void saveProgramBinary(uint32_t program, uint64_t key) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<uint8_t> binary((size_t)length);
+    ShaderBinaryHeader header = {SHADER_BINARY_MAGIC, 0, 0};
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &header.format, binary.data());
+    header.length = (uint32_t)written;
+
+    FILE* file = fopen(cachePath(key).c_str(), "wb");
+    if (!file) return;
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(binary.data(), 1, header.length, file);
+    fclose(file);
+}
+
+// Defines go right after the #version line, which has to stay first.
+static void splitVersionLine(const std::string& source, std::string& version, std::string& body) {
+    size_t lineEnd = source.compare(0, 8, "#version") == 0 ? source.find('\n') : std::string::npos;
+    if (lineEnd == std::string::npos) {
+        version.clear();
+        body = source;
+        return;
+    }
+    version = source.substr(0, lineEnd + 1);
+    body = source.substr(lineEnd + 1);
+}
+
+uint32_t createCachedProgram(const ShaderStageSource* stages, uint32_t stageCount, const char* defines) {
+    std::string sources[MAX_SHADER_STAGES];
+    uint64_t key = hashString(shaderCache.driverHash, defines);
+    for (uint32_t i = 0; i < stageCount; ++i) {
+        sources[i] = readShaderFile(stages[i].path);
+        key = hashBytes(key, &stages[i].type, sizeof(GLenum));
+        key = hashString(key, sources[i].c_str());
+    }
+
+    uint32_t program = glCreateProgram();
+    if (loadProgramBinary(program, key)) {
+        ++shaderCache.cacheHits;
+        return program;
+    }
+
+    // Issue everything now and only look at the results in finishShaderPrograms.
+    PendingProgram pending = {};
+    pending.program = program;
+    pending.key = key;
+    snprintf(pending.name, sizeof(pending.name), "%s", stages[0].path);
+    for (uint32_t i = 0; i < stageCount; ++i) {
+        std::string version, body;
+        splitVersionLine(sources[i], version, body);
+        const char* parts[3] = {version.c_str(), defines ? defines : "", body.c_str()};
+        uint32_t shader = glCreateShader(stages[i].type);
+        glShaderSource(shader, 3, parts, NULL);
+        glCompileShader(shader);
+        glAttachShader(program, shader);
+        pending.shaders[pending.shaderCount++] = shader;
+    }
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    ++shaderCache.compiled;
+
+    if (shaderCache.pendingCount == MAX_PENDING_PROGRAMS) finishShaderPrograms();
+    shaderCache.pending[shaderCache.pendingCount++] = pending;
+    return program;
+}
+
+void finishShaderPrograms() {
+    for (uint32_t i = 0; i < shaderCache.pendingCount; ++i) {
+        PendingProgram& pending = shaderCache.pending[i];
+        GLint success = GL_FALSE;
+        glGetProgramiv(pending.program, GL_LINK_STATUS, &success);
+        if (success == GL_TRUE) {
+            saveProgramBinary(pending.program, pending.key);
+        } else {
+            std::cout << "Shader program failed: " << pending.name << std::endl;
+            for (uint32_t s = 0; s < pending.shaderCount; ++s) checkShaderCompileErrors(pending.shaders[s], "SHADER");
+            checkShaderCompileErrors(pending.program, "PROGRAM");
+        }
+        for (uint32_t s = 0; s < pending.shaderCount; ++s) {
+            glDetachShader(pending.program, pending.shaders[s]);
+            glDeleteShader(pending.shaders[s]);
+        }
+    }
+    shaderCache.pendingCount = 0;
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - shaderCache.startTime);
+    std::cout << "Shader programs: " << shaderCache.cacheHits << " from cache, " << shaderCache.compiled << " compiled"
+              << (shaderCache.parallelCompile ? " in parallel" : "") << ", " << elapsed.count() << " ms" << std::endl;
+}
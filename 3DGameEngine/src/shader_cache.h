@@ -0,0 +1,48 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <glad/glad.h>
+
+// Linked programs are saved with glGetProgramBinary under a hash of their sources, defines and the driver, so a warm
+// start loads them with glProgramBinary instead of compiling. Cold compiles are all issued before any of them is waited
+// on, with GL_KHR_parallel_shader_compile the driver builds them on its own threads in the meantime.
+
+static constexpr uint32_t MAX_SHADER_STAGES = 2;
+static constexpr uint32_t MAX_PENDING_PROGRAMS = 32;
+#define SHADER_BINARY_MAGIC 0x4E494250 // "PBIN"
+
+struct ShaderStageSource {
+    GLenum type;
+    const char* path;
+};
+
+struct ShaderBinaryHeader {
+    uint32_t magic;
+    uint32_t format;
+    uint32_t length;
+};
+
+struct PendingProgram {
+    uint32_t program;
+    uint64_t key;
+    uint32_t shaders[MAX_SHADER_STAGES];
+    uint32_t shaderCount;
+    char name[64];
+};
+
+struct ShaderCache {
+    char directory[128];
+    uint64_t driverHash = 0;
+    bool parallelCompile = false;
+    PendingProgram pending[MAX_PENDING_PROGRAMS];
+    uint32_t pendingCount = 0;
+    uint32_t cacheHits = 0;
+    uint32_t compiled = 0;
+    std::chrono::steady_clock::time_point startTime;
+};
+
+// Needs a current GL context.
+void initShaderCache(const char* directory);
+uint32_t createCachedProgram(const ShaderStageSource* stages, uint32_t stageCount, const char* defines);
+// Waits for every program still compiling, reports errors and writes the new binaries to the cache.
+void finishShaderPrograms();
@@ -1,28 +1,27 @@
 
 #pragma once
-#include <fstream>
+#include <cstdio>
 #include <glad/glad.h>
 #include <iostream>
-#include <sstream>
 #include <string>
+#include "shader_cache.h"
 
 inline std::string readShaderFile(const std::string &path) {
     std::string shaderCode;
-    std::ifstream shaderFile;
-
-    shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    try {
-        shaderFile.open(path);
-        std::stringstream shaderStream;
-        shaderStream << shaderFile.rdbuf();
-        shaderFile.close();
-        shaderCode = shaderStream.str();
-    }
-    catch (std::ifstream::failure &e) {
+    FILE* shaderFile = fopen(path.c_str(), "rb");
+    if (!shaderFile) {
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ\n"
-                    << "Path: " << path << "\n"
-                    << "Error: " << e.what() << std::endl;
+                  << "Path: " << path << std::endl;
+        return shaderCode;
     }
+    fseek(shaderFile, 0, SEEK_END);
+    long size = ftell(shaderFile);
+    fseek(shaderFile, 0, SEEK_SET);
+    if (size > 0) {
+        shaderCode.resize((size_t)size);
+        shaderCode.resize(fread(shaderCode.data(), 1, (size_t)size, shaderFile));
+    }
+    fclose(shaderFile);
     return shaderCode;
 }
 
@@ -58,39 +57,23 @@ inline void checkShaderCompileErrors(GLuint shader, std::string type) {
 
 
 
-inline uint32_t createShaderProgram(const std::string& vertexPath, const std::string& fragmentPath) {
+// Both go through the program cache, compile and link errors are reported by finishShaderPrograms.
+inline uint32_t createComputeProgram(const std::string& computePath, const char* defines = "") {
+    std::string cp = computePath;
+#ifdef PROJECT_SOURCE_DIR
+    cp = std::string(PROJECT_SOURCE_DIR) + "/" + computePath;
+#endif
+    ShaderStageSource stages[] = {{GL_COMPUTE_SHADER, cp.c_str()}};
+    return createCachedProgram(stages, 1, defines);
+}
+
+inline uint32_t createShaderProgram(const std::string& vertexPath, const std::string& fragmentPath, const char* defines = "") {
     std::string vp = vertexPath;
     std::string fp = fragmentPath;
 #ifdef PROJECT_SOURCE_DIR
     vp = std::string(PROJECT_SOURCE_DIR) + "/" + vertexPath;
     fp = std::string(PROJECT_SOURCE_DIR) + "/" + fragmentPath;
 #endif
-    std::string vShaderString = readShaderFile(vp);
-    std::string fShaderString = readShaderFile(fp);
-    //  Can't return const char* directly due to dangling pointer
-    const char* vShaderCode = vShaderString.c_str();
-    const char* fShaderCode = fShaderString.c_str();
-
-    unsigned int vertex, fragment;
-
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    checkShaderCompileErrors(vertex, "VERTEX");
-
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    checkShaderCompileErrors(fragment, "FRAGMENT");
-
-    uint32_t id = glCreateProgram();
-    glAttachShader(id, vertex);
-    glAttachShader(id, fragment);
-    glLinkProgram(id);
-    checkShaderCompileErrors(id, "PROGRAM");
-
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
-
-    return id;
-}
\ No newline at end of file
+    ShaderStageSource stages[] = {{GL_VERTEX_SHADER, vp.c_str()}, {GL_FRAGMENT_SHADER, fp.c_str()}};
+    return createCachedProgram(stages, 2, defines);
+}
@@ -0,0 +1,238 @@
+#include "snapshot.h"
+#include "scene_sets.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <type_traits>
+
+static float microsecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void captureState(ECS& scene, SnapshotState& state) {
+    uint32_t set = 0;
+    forEachSceneSet(scene, [&](SceneChunkID, uint32_t, SceneMigrateFn, auto& sparseSet) { state.setCounts[set++] = sparseSet.entityCount; });
+    state.entityCount = scene.entityCount;
+    memcpy(state.freeStack, scene.freeStack, sizeof(scene.freeStack));
+    state.freeStackSize = scene.freeStackSize;
+    state.currentCamera = scene.currentCamera;
+}
+
+// The arena was just overwritten, so every block differs from whatever the history recorded last.
+static void applyState(ECS& scene, const SnapshotState& state) {
+    uint32_t set = 0;
+    forEachSceneSet(scene, [&](SceneChunkID, uint32_t, SceneMigrateFn, auto& sparseSet) {
+        sparseSet.entityCount = state.setCounts[set++];
+        sparseSet.markAllDirty();
+    });
+    scene.entityCount = state.entityCount;
+    memcpy(scene.freeStack, state.freeStack, sizeof(scene.freeStack));
+    scene.freeStackSize = state.freeStackSize;
+    scene.currentCamera = state.currentCamera;
+    // Sleep and contacts aren't part of a snapshot, everything wakes and settles again.
+    wakeAllBodies(scene.bodySleep);
+    resetContactPairs(scene.contacts);
+    if (scene.selectedEntity >= 0 && !scene.transformSet.hasComponent((uint32_t)scene.selectedEntity)) scene.selectedEntity = -1;
+}
+
+bool takeSnapshot(ECS& scene, WorldSnapshot& snapshot) {
+    // Everything is allocated at startup, so the used size never changes after the first snapshot.
+    if (snapshot.arenaBytes != scene.arena.offset) {
+        free(snapshot.arena);
+        snapshot.arena = (uint8_t*)malloc(scene.arena.offset);
+        snapshot.arenaBytes = snapshot.arena ? scene.arena.offset : 0;
+        if (!snapshot.arena) return false;
+    }
+    memcpy(snapshot.arena, scene.arena.base, snapshot.arenaBytes);
+    captureState(scene, snapshot.state);
+    snapshot.valid = true;
+    return true;
+}
+
+bool restoreSnapshot(ECS& scene, const WorldSnapshot& snapshot) {
+    if (!snapshot.valid || snapshot.arenaBytes != scene.arena.offset) return false;
+    if (scene.worldStreamer.open) {
+        std::cout << "Close the streamed world before restoring a snapshot" << std::endl;
+        return false;
+    }
+    memcpy(scene.arena.base, snapshot.arena, snapshot.arenaBytes);
+    applyState(scene, snapshot.state);
+    return true;
+}
+
+void freeSnapshot(WorldSnapshot& snapshot) {
+    free(snapshot.arena);
+    snapshot = WorldSnapshot{};
+}
+
+// Calls visit(arenaOffset, size) for the dense, entity and sparse ranges of every dirty block.
+template <typename Visitor>
+static void forEachDirtyBlock(ECS& scene, Visitor&& visit) {
+    const uint8_t* base = scene.arena.base;
+    forEachSceneSet(scene, [&](SceneChunkID, uint32_t, SceneMigrateFn, auto& set) {
+        using Component = std::remove_reference_t<decltype(set.dense[0])>;
+        for (uint32_t block = 0; block * DIRTY_BLOCK_SIZE < set.denseCapacity; ++block) {
+            if (!set.isDenseBlockDirty(DIRTY_SNAPSHOT, block)) continue;
+            uint32_t first = block * DIRTY_BLOCK_SIZE;
+            uint32_t count = std::min(DIRTY_BLOCK_SIZE, set.denseCapacity - first);
+            visit((uint32_t)((const uint8_t*)(set.dense + first) - base), count * (uint32_t)sizeof(Component));
+            visit((uint32_t)((const uint8_t*)(set.entities + first) - base), count * (uint32_t)sizeof(uint32_t));
+        }
+        for (uint32_t block = 0; block * DIRTY_BLOCK_SIZE < MAX_ENTITIES; ++block) {
+            if (!set.isSparseBlockDirty(DIRTY_SNAPSHOT, block)) continue;
+            uint32_t first = block * DIRTY_BLOCK_SIZE;
+            uint32_t count = std::min(DIRTY_BLOCK_SIZE, (uint32_t)MAX_ENTITIES - first);
+            visit((uint32_t)((const uint8_t*)(set.sparse + first) - base), count * (uint32_t)sizeof(uint32_t));
+        }
+    });
+}
+
+static void evictOldestKeyframe(SnapshotRing& ring) {
+    do {
+        ring.first = (ring.first + 1) % SNAPSHOT_HISTORY_FRAMES;
+        --ring.count;
+    } while (ring.count > 0 && !ring.records[ring.first].keyframe);
+}
+
+// Finds room after the newest record, wrapping to the start of the pool, and evicts from the oldest end until it fits.
+static bool allocateRecord(SnapshotRing& ring, size_t size, size_t& offset) {
+    if (size > SNAPSHOT_HISTORY_BYTES) return false;
+    for (;;) {
+        if (ring.count == 0) {
+            offset = 0;
+            return true;
+        }
+        if (ring.count < SNAPSHOT_HISTORY_FRAMES) {
+            const SnapshotRecord& oldest = ring.records[ring.first];
+            const SnapshotRecord& newest = ring.records[(ring.first + ring.count - 1) % SNAPSHOT_HISTORY_FRAMES];
+            size_t end = newest.offset + newest.size;
+            if (newest.offset >= oldest.offset) {
+                if (end + size <= SNAPSHOT_HISTORY_BYTES) {
+                    offset = end;
+                    return true;
+                }
+                if (size <= oldest.offset) {
+                    offset = 0;
+                    return true;
+                }
+            } else if (end + size <= oldest.offset) {
+                offset = end;
+                return true;
+            }
+        }
+        evictOldestKeyframe(ring);
+    }
+}
+
+void recordSnapshot(SnapshotRing& ring, ECS& scene) {
+    ++ring.frame;
+    if (!ring.recording || ring.scrubFrame >= 0 || scene.worldStreamer.open) return;
+    auto startTime = std::chrono::steady_clock::now();
+    if (!ring.pool) {
+        ring.pool = (uint8_t*)malloc(SNAPSHOT_HISTORY_BYTES);
+        if (!ring.pool) {
+            ring.recording = false;
+            return;
+        }
+    }
+
+    size_t arenaBytes = scene.arena.offset;
+    size_t keyframeBytes = sizeof(SnapshotState) + sizeof(SnapshotBlockHeader) + arenaBytes;
+    size_t deltaBytes = sizeof(SnapshotState);
+    forEachDirtyBlock(scene, [&](uint32_t, uint32_t size) { deltaBytes += sizeof(SnapshotBlockHeader) + size; });
+
+    bool keyframe = ring.count == 0 || ring.framesSinceKeyframe >= SNAPSHOT_MAX_KEYFRAME_INTERVAL ||
+                    ring.bytesSinceKeyframe + deltaBytes >= keyframeBytes;
+    size_t offset = 0;
+    bool allocated = allocateRecord(ring, keyframe ? keyframeBytes : deltaBytes, offset);
+    // Making room can evict the frame a delta builds on.
+    if (allocated && !keyframe && ring.count == 0) {
+        keyframe = true;
+        allocated = allocateRecord(ring, keyframeBytes, offset);
+    }
+    if (!allocated) {
+        std::cout << "Snapshot history is too small for a " << keyframeBytes << " byte keyframe, stopped recording" << std::endl;
+        ring.recording = false;
+        return;
+    }
+
+    // Block sizes aren't all multiples of anything, so nothing in the pool is assumed to be aligned.
+    uint8_t* out = ring.pool + offset;
+    SnapshotState state;
+    captureState(scene, state);
+    memcpy(out, &state, sizeof(SnapshotState));
+    out += sizeof(SnapshotState);
+    auto writeBlock = [&](uint32_t arenaOffset, uint32_t size) {
+        SnapshotBlockHeader header = {arenaOffset, size};
+        memcpy(out, &header, sizeof(SnapshotBlockHeader));
+        memcpy(out + sizeof(SnapshotBlockHeader), scene.arena.base + arenaOffset, size);
+        out += sizeof(SnapshotBlockHeader) + size;
+    };
+    if (keyframe) writeBlock(0, (uint32_t)arenaBytes);
+    else forEachDirtyBlock(scene, writeBlock);
+    forEachSceneSet(scene, [&](SceneChunkID, uint32_t, SceneMigrateFn, auto& set) { set.clearDirty(DIRTY_SNAPSHOT); });
+
+    SnapshotRecord& record = ring.records[(ring.first + ring.count) % SNAPSHOT_HISTORY_FRAMES];
+    record = {offset, (size_t)(out - (ring.pool + offset)), ring.frame, keyframe};
+    ++ring.count;
+    ring.framesSinceKeyframe = keyframe ? 0 : ring.framesSinceKeyframe + 1;
+    ring.bytesSinceKeyframe = keyframe ? 0 : ring.bytesSinceKeyframe + record.size;
+    ring.lastRecordBytes = record.size;
+    ring.averageRecordBytes += (record.size - ring.averageRecordBytes) * 0.05f;
+    ring.snapshotMicroseconds = microsecondsSince(startTime);
+}
+
+bool restoreRingSnapshot(SnapshotRing& ring, ECS& scene, uint32_t framesBack) {
+    if (framesBack >= ring.count) return false;
+    if (scene.worldStreamer.open) {
+        std::cout << "Close the streamed world before restoring a snapshot" << std::endl;
+        return false;
+    }
+    auto startTime = std::chrono::steady_clock::now();
+    uint32_t target = ring.count - 1 - framesBack; // Position from the oldest record.
+    uint32_t keyframe = target;
+    while (!ring.records[(ring.first + keyframe) % SNAPSHOT_HISTORY_FRAMES].keyframe) --keyframe;
+
+    // The keyframe and then every delta up to the target, in order.
+    for (uint32_t position = keyframe; position <= target; ++position) {
+        const SnapshotRecord& record = ring.records[(ring.first + position) % SNAPSHOT_HISTORY_FRAMES];
+        const uint8_t* in = ring.pool + record.offset + sizeof(SnapshotState);
+        const uint8_t* end = ring.pool + record.offset + record.size;
+        while (in < end) {
+            SnapshotBlockHeader header;
+            memcpy(&header, in, sizeof(SnapshotBlockHeader));
+            memcpy(scene.arena.base + header.arenaOffset, in + sizeof(SnapshotBlockHeader), header.size);
+            in += sizeof(SnapshotBlockHeader) + header.size;
+        }
+    }
+    SnapshotState state;
+    memcpy(&state, ring.pool + ring.records[(ring.first + target) % SNAPSHOT_HISTORY_FRAMES].offset, sizeof(SnapshotState));
+    applyState(scene, state);
+    ring.scrubFrame = (int32_t)framesBack;
+    ring.restoreMicroseconds = microsecondsSince(startTime);
+    return true;
+}
+
+void resumeFromScrub(SnapshotRing& ring) {
+    if (ring.scrubFrame < 0) return;
+    ring.count -= (uint32_t)ring.scrubFrame;
+    ring.scrubFrame = -1;
+    // Every set is dirty after the restore, a delta would be as big as a keyframe anyway.
+    ring.framesSinceKeyframe = SNAPSHOT_MAX_KEYFRAME_INTERVAL;
+}
+
+size_t snapshotRingBytes(const SnapshotRing& ring) {
+    size_t bytes = 0;
+    for (uint32_t i = 0; i < ring.count; ++i) bytes += ring.records[(ring.first + i) % SNAPSHOT_HISTORY_FRAMES].size;
+    return bytes;
+}
+
+void freeSnapshotRing(SnapshotRing& ring) {
+    free(ring.pool);
+    ring.pool = nullptr;
+    ring.first = 0;
+    ring.count = 0;
+    ring.scrubFrame = -1;
+    ring.framesSinceKeyframe = 0;
+    ring.bytesSinceKeyframe = 0;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+struct ECS;
+
+// Every component set lives in the ECS arena, so a copy of the used part of the arena plus each set's count and the
+// entity allocator is the whole simulation state. Taking and restoring one is a straight memcpy.
+// Pointers into the arena stay valid across a restore, the data behind them changes.
+
+static constexpr uint32_t MAX_SNAPSHOT_SETS = 32;
+
+// What lives outside the arena.
+struct SnapshotState {
+    uint32_t setCounts[MAX_SNAPSHOT_SETS];
+    uint32_t entityCount;
+    uint32_t freeStack[64];
+    uint8_t freeStackSize;
+    uint32_t currentCamera;
+};
+
+struct WorldSnapshot {
+    uint8_t* arena = nullptr;
+    size_t arenaBytes = 0;
+    SnapshotState state;
+    bool valid = false;
+};
+
+bool takeSnapshot(ECS& scene, WorldSnapshot& snapshot);
+// Fails while a world is streaming, the streamer's view of which entities exist would no longer match.
+bool restoreSnapshot(ECS& scene, const WorldSnapshot& snapshot);
+void freeSnapshot(WorldSnapshot& snapshot);
+
+// Rewind history. Every frame stores only the blocks the sets marked dirty since the frame before, with a full copy of
+// the arena (a keyframe) whenever the deltas since the last one add up to its size or it's too many frames back.
+// Records live in one byte pool used as a ring, the oldest keyframe and its deltas go first when it fills up.
+static constexpr uint32_t SNAPSHOT_HISTORY_FRAMES = 4096;
+static constexpr size_t SNAPSHOT_HISTORY_BYTES = 64 * 1024 * 1024;
+// Bounds how many deltas a restore replays.
+static constexpr uint32_t SNAPSHOT_MAX_KEYFRAME_INTERVAL = 240;
+
+// A record in the pool is a SnapshotState followed by blocks, each a SnapshotBlockHeader and its bytes.
+struct SnapshotBlockHeader {
+    uint32_t arenaOffset;
+    uint32_t size;
+};
+
+struct SnapshotRecord {
+    size_t offset;
+    size_t size;
+    uint32_t frame;
+    bool keyframe;
+};
+
+struct SnapshotRing {
+    uint8_t* pool = nullptr;
+    SnapshotRecord records[SNAPSHOT_HISTORY_FRAMES];
+    uint32_t first = 0; // Oldest record, always a keyframe.
+    uint32_t count = 0;
+    uint32_t frame = 0;
+    uint32_t framesSinceKeyframe = 0;
+    size_t bytesSinceKeyframe = 0;
+    bool recording = false;
+    int32_t scrubFrame = -1; // Frames back from the newest record being shown, -1 while live.
+
+    size_t lastRecordBytes = 0;
+    float averageRecordBytes = 0.0f;
+    float snapshotMicroseconds = 0.0f;
+    float restoreMicroseconds = 0.0f;
+};
+
+void recordSnapshot(SnapshotRing& ring, ECS& scene);
+// framesBack 0 is the newest record.
+bool restoreRingSnapshot(SnapshotRing& ring, ECS& scene, uint32_t framesBack);
+// Drops the records newer than the one being shown, recording carries on from it.
+void resumeFromScrub(SnapshotRing& ring);
+size_t snapshotRingBytes(const SnapshotRing& ring);
+void freeSnapshotRing(SnapshotRing& ring);
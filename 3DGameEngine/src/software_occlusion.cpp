@@ -0,0 +1,220 @@
+#include "software_occlusion.h"
+#include "occlusion_culling.h"
+#include "render_system.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+struct ScreenVertex {
+    float x, y, z;
+};
+
+static void rasterizeTriangle(ScreenVertex a, ScreenVertex b, ScreenVertex c, float* depth) {
+    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (std::abs(area) < 1e-8f) return;
+    // Both windings are drawn, the closest depth wins anyway.
+    if (area < 0.0f) {
+        std::swap(b, c);
+        area = -area;
+    }
+
+    int minX = std::max((int)std::floor(std::min({a.x, b.x, c.x})), 0);
+    int maxX = std::min((int)std::ceil(std::max({a.x, b.x, c.x})), (int)SOFTWARE_DEPTH_WIDTH - 1);
+    int minY = std::max((int)std::floor(std::min({a.y, b.y, c.y})), 0);
+    int maxY = std::min((int)std::ceil(std::max({a.y, b.y, c.y})), (int)SOFTWARE_DEPTH_HEIGHT - 1);
+    if (minX > maxX || minY > maxY) return;
+
+    // Edge functions E(p) = A * x + B * y + C, positive inside. Edge 0 is opposite a, so it weights a's depth.
+    float A0 = b.y - c.y, B0 = c.x - b.x, C0 = -(A0 * b.x + B0 * b.y);
+    float A1 = c.y - a.y, B1 = a.x - c.x, C1 = -(A1 * c.x + B1 * c.y);
+    float A2 = a.y - b.y, B2 = b.x - a.x, C2 = -(A2 * a.x + B2 * a.y);
+
+    // NDC depth is affine in screen space, so it is one plane equation over the whole triangle.
+    float invArea = 1.0f / area;
+    float zA = (A0 * a.z + A1 * b.z + A2 * c.z) * invArea;
+    float zB = (B0 * a.z + B1 * b.z + B2 * c.z) * invArea;
+    float zC = (C0 * a.z + C1 * b.z + C2 * c.z) * invArea;
+
+    int startX = minX & ~7;
+
+#if defined(__AVX2__)
+    const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 a0 = _mm256_set1_ps(A0), a1 = _mm256_set1_ps(A1), a2 = _mm256_set1_ps(A2);
+    const __m256 za = _mm256_set1_ps(zA);
+
+    for (int y = minY; y <= maxY; ++y) {
+        float py = (float)y + 0.5f;
+        __m256 row0 = _mm256_set1_ps(B0 * py + C0);
+        __m256 row1 = _mm256_set1_ps(B1 * py + C1);
+        __m256 row2 = _mm256_set1_ps(B2 * py + C2);
+        __m256 rowZ = _mm256_set1_ps(zB * py + zC);
+        float* depthRow = depth + y * SOFTWARE_DEPTH_WIDTH;
+
+        for (int x = startX; x <= maxX; x += 8) {
+            __m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffsets);
+            __m256 e0 = _mm256_add_ps(_mm256_mul_ps(a0, px), row0);
+            __m256 e1 = _mm256_add_ps(_mm256_mul_ps(a1, px), row1);
+            __m256 e2 = _mm256_add_ps(_mm256_mul_ps(a2, px), row2);
+            __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ), _mm256_cmp_ps(e1, zero, _CMP_GE_OQ)),
+                                          _mm256_cmp_ps(e2, zero, _CMP_GE_OQ));
+            if (_mm256_testz_ps(inside, inside)) continue;
+
+            __m256 z = _mm256_add_ps(_mm256_mul_ps(za, px), rowZ);
+            __m256 current = _mm256_load_ps(depthRow + x);
+            _mm256_store_ps(depthRow + x, _mm256_blendv_ps(current, _mm256_min_ps(current, z), inside));
+        }
+    }
+#else
+    for (int y = minY; y <= maxY; ++y) {
+        float py = (float)y + 0.5f;
+        float* depthRow = depth + y * SOFTWARE_DEPTH_WIDTH;
+        for (int x = startX; x <= maxX; ++x) {
+            float px = (float)x + 0.5f;
+            if (A0 * px + B0 * py + C0 < 0.0f || A1 * px + B1 * py + C1 < 0.0f || A2 * px + B2 * py + C2 < 0.0f) continue;
+            depthRow[x] = std::min(depthRow[x], zA * px + zB * py + zC);
+        }
+    }
+#endif
+}
+
+void addOccluderMesh(MeshBuffer& meshBuffer, uint32_t handle, const glm::vec3* positions, const uint8_t* indices,
+                     uint32_t indexSize, uint32_t indexCount) {
+    meshBuffer.occluderOffsets[handle] = meshBuffer.occluderVertexSize;
+    meshBuffer.occluderVertexCounts[handle] = 0;
+    indexCount -= indexCount % 3;
+    if (indexCount / 3 > MAX_OCCLUDER_TRIANGLES || meshBuffer.occluderVertexSize + indexCount > MeshBuffer::occluderVertexCapacity) return;
+
+    glm::vec3* vertices = meshBuffer.occluderVertices + meshBuffer.occluderVertexSize;
+    for (uint32_t i = 0; i < indexCount; ++i) {
+        uint32_t index = 0;
+        if (indexSize == sizeof(uint16_t)) {
+            uint16_t narrow;
+            memcpy(&narrow, indices + i * sizeof(uint16_t), sizeof(uint16_t));
+            index = narrow;
+        } else {
+            memcpy(&index, indices + i * sizeof(uint32_t), sizeof(uint32_t));
+        }
+        vertices[i] = positions[index];
+    }
+    meshBuffer.occluderVertexCounts[handle] = indexCount;
+    meshBuffer.occluderVertexSize += indexCount;
+}
+
+void gatherOccluders(const SparseSet<OccluderTag>& occluderSet, const SparseSet<TransformComponent>& transformSet,
+                     const SparseSet<MeshData>& meshSet, const MeshBuffer& meshBuffer, OccluderBuffer& occluders) {
+    occluders.size = 0;
+    for (uint32_t i = 0; i < occluderSet.entityCount && occluders.size < occluders.capacity; ++i) {
+        uint32_t entity = occluderSet.entities[i];
+        if (!meshSet.hasComponent(entity)) continue;
+        uint32_t handle = meshSet.getComponent(entity).handle;
+        if (meshBuffer.occluderVertexCounts[handle] == 0) continue;
+        const TransformComponent& transform = transformSet.getComponent(entity);
+        occluders.modelMatrices[occluders.size] = buildTransformMatrix(transform.position, transform.scale, transform.rotation);
+        occluders.vertices[occluders.size] = meshBuffer.occluderVertices + meshBuffer.occluderOffsets[handle];
+        occluders.vertexCounts[occluders.size] = meshBuffer.occluderVertexCounts[handle];
+        ++occluders.size;
+    }
+}
+
+void rasterizeOccluders(const OccluderBuffer& occluders, const glm::mat4& viewProjection, SoftwareDepthBuffer& depthBuffer) {
+    std::fill(depthBuffer.depth, depthBuffer.depth + SOFTWARE_DEPTH_WIDTH * SOFTWARE_DEPTH_HEIGHT, 1.0f);
+
+    ScreenVertex triangle[3];
+    for (uint32_t i = 0; i < occluders.size; ++i) {
+        glm::mat4 mvp = viewProjection * occluders.modelMatrices[i];
+        const glm::vec3* vertices = occluders.vertices[i];
+
+        for (uint32_t v = 0; v < occluders.vertexCounts[i]; ++v) {
+            glm::vec4 clip = mvp * glm::vec4(vertices[v], 1.0f);
+            // No near plane clipping, a triangle crossing it is skipped. The occluder covers less, which is still conservative.
+            if (clip.w <= 1e-5f) {
+                v += 2 - v % 3;
+                continue;
+            }
+            float invW = 1.0f / clip.w;
+            triangle[v % 3] = ScreenVertex{(clip.x * invW * 0.5f + 0.5f) * SOFTWARE_DEPTH_WIDTH,
+                                           (clip.y * invW * 0.5f + 0.5f) * SOFTWARE_DEPTH_HEIGHT,
+                                           std::clamp(clip.z * invW * 0.5f + 0.5f, 0.0f, 1.0f)};
+            if (v % 3 == 2) rasterizeTriangle(triangle[0], triangle[1], triangle[2], depthBuffer.depth);
+        }
+    }
+}
+
+static void occluderWorker(OccluderRasterizer* rasterizer) {
+    for (;;) {
+        rasterizer->startSignal.acquire();
+        if (!rasterizer->running.load(std::memory_order_acquire)) return;
+        rasterizeOccluders(rasterizer->occluders, rasterizer->viewProjection, rasterizer->depthBuffer);
+        rasterizer->doneSignal.release();
+    }
+}
+
+void startOccluderRasterizer(OccluderRasterizer& rasterizer) {
+    rasterizer.running.store(true, std::memory_order_release);
+    rasterizer.worker = std::thread(occluderWorker, &rasterizer);
+}
+
+void stopOccluderRasterizer(OccluderRasterizer& rasterizer) {
+    if (rasterizer.busy) waitOccluderRasterization(rasterizer);
+    rasterizer.running.store(false, std::memory_order_release);
+    rasterizer.startSignal.release();
+    if (rasterizer.worker.joinable()) rasterizer.worker.join();
+}
+
+void kickOccluderRasterization(OccluderRasterizer& rasterizer, const SparseSet<OccluderTag>& occluderSet,
+                               const SparseSet<TransformComponent>& transformSet, const SparseSet<MeshData>& meshSet,
+                               const MeshBuffer& meshBuffer, const glm::mat4& viewProjection) {
+    if (rasterizer.busy) waitOccluderRasterization(rasterizer);
+    gatherOccluders(occluderSet, transformSet, meshSet, meshBuffer, rasterizer.occluders);
+    rasterizer.viewProjection = viewProjection;
+    rasterizer.busy = true;
+    rasterizer.startSignal.release();
+}
+
+const SoftwareDepthBuffer& waitOccluderRasterization(OccluderRasterizer& rasterizer) {
+    if (rasterizer.busy) {
+        rasterizer.doneSignal.acquire();
+        rasterizer.busy = false;
+    }
+    return rasterizer.depthBuffer;
+}
+
+static bool isRectOccluded(const SoftwareDepthBuffer& depthBuffer, const ScreenRect& rect) {
+    if (rect.crossesNearPlane) return false;
+
+    int minX = std::min((int)(rect.min.x * SOFTWARE_DEPTH_WIDTH), (int)SOFTWARE_DEPTH_WIDTH - 1);
+    int maxX = std::min((int)(rect.max.x * SOFTWARE_DEPTH_WIDTH), (int)SOFTWARE_DEPTH_WIDTH - 1);
+    int minY = std::min((int)(rect.min.y * SOFTWARE_DEPTH_HEIGHT), (int)SOFTWARE_DEPTH_HEIGHT - 1);
+    int maxY = std::min((int)(rect.max.y * SOFTWARE_DEPTH_HEIGHT), (int)SOFTWARE_DEPTH_HEIGHT - 1);
+
+    for (int y = minY; y <= maxY; ++y) {
+        const float* depthRow = depthBuffer.depth + y * SOFTWARE_DEPTH_WIDTH;
+        for (int x = minX; x <= maxX; ++x) {
+            if (rect.minDepth <= depthRow[x]) return false;
+        }
+    }
+    return true;
+}
+
+void performSoftwareOcclusionCulling(const SoftwareDepthBuffer& depthBuffer, const WorldBoundsBuffer& worldBounds,
+                                     const SparseSet<RenderableTag>& renderableSet, const SparseSet<OccluderTag>& occluderSet,
+                                     const glm::mat4& viewProjection, VisibleEntityBuffer& visibleEntityBuffer, uint32_t& occludedCount) {
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < visibleEntityBuffer.size; ++i) {
+        uint32_t entity = visibleEntityBuffer.buffer[i];
+        // Occluders would only ever test against their own depth.
+        if (!occluderSet.hasComponent(entity)) {
+            uint32_t boundsIndex = renderableSet.sparse[entity];
+            glm::vec3 center(worldBounds.centerX[boundsIndex], worldBounds.centerY[boundsIndex], worldBounds.centerZ[boundsIndex]);
+            glm::vec3 extent(worldBounds.extentX[boundsIndex], worldBounds.extentY[boundsIndex], worldBounds.extentZ[boundsIndex]);
+            if (isRectOccluded(depthBuffer, projectAABBToScreenRect(center, extent, viewProjection))) continue;
+        }
+        visibleEntityBuffer.buffer[kept++] = entity;
+    }
+    occludedCount = visibleEntityBuffer.size - kept;
+    visibleEntityBuffer.size = kept;
+}
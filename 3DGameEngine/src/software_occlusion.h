@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <semaphore>
+#include <thread>
+#include <glm/glm.hpp>
+#include "sparse_set.h"
+#include "entity.h"
+#include "asset_manager.h"
+
+struct WorldBoundsBuffer;
+struct VisibleEntityBuffer;
+
+// Low resolution depth buffer the occluders are rasterized into on the CPU. Width is a multiple of 8 for the AVX2 rows.
+static constexpr uint32_t SOFTWARE_DEPTH_WIDTH = 256;
+static constexpr uint32_t SOFTWARE_DEPTH_HEIGHT = 192;
+
+// Meshes with more LOD0 triangles than this keep no occluder triangles and are never rasterized.
+static constexpr uint32_t MAX_OCCLUDER_TRIANGLES = 1024;
+
+// Occluders are rasterized as their own triangles, the local AABB would hide things seen past a mesh that isn't a box.
+// The triangles live in MeshBuffer, which only ever appends to them, so the worker can read them in place.
+struct OccluderBuffer {
+    static constexpr uint32_t capacity = CAPACITY_OCCLUDER;
+    uint32_t size = 0;
+    glm::mat4 modelMatrices[capacity];
+    const glm::vec3* vertices[capacity];
+    uint32_t vertexCounts[capacity];
+};
+
+struct SoftwareDepthBuffer {
+    alignas(32) float depth[SOFTWARE_DEPTH_WIDTH * SOFTWARE_DEPTH_HEIGHT];
+};
+
+// Rasterizes the occluders on a persistent worker while the render thread does the rest of the culling setup.
+// Occluders are gathered after the simulation, so they use the same transforms as the bounds they are tested against.
+struct OccluderRasterizer {
+    OccluderBuffer occluders;
+    SoftwareDepthBuffer depthBuffer;
+    glm::mat4 viewProjection;
+    std::counting_semaphore<> startSignal{0};
+    std::counting_semaphore<> doneSignal{0};
+    std::atomic<bool> running{false};
+    std::thread worker;
+    bool busy = false; // Render thread only, a kick is in flight that hasn't been waited for.
+};
+
+void startOccluderRasterizer(OccluderRasterizer& rasterizer);
+void stopOccluderRasterizer(OccluderRasterizer& rasterizer);
+// Gathers the occluders on the calling thread and hands them to the worker, the sets are free to change afterwards.
+void kickOccluderRasterization(OccluderRasterizer& rasterizer, const SparseSet<OccluderTag>& occluderSet,
+                               const SparseSet<TransformComponent>& transformSet, const SparseSet<MeshData>& meshSet,
+                               const MeshBuffer& meshBuffer, const glm::mat4& viewProjection);
+// Blocks until the depth buffer of the last kick is ready.
+const SoftwareDepthBuffer& waitOccluderRasterization(OccluderRasterizer& rasterizer);
+
+// Stores the LOD0 triangles of a mesh for the rasterizer, or none when it has more than MAX_OCCLUDER_TRIANGLES or the pool
+// is full. indexSize is 2 or 4 bytes, indices may be unaligned.
+void addOccluderMesh(MeshBuffer& meshBuffer, uint32_t handle, const glm::vec3* positions, const uint8_t* indices,
+                     uint32_t indexSize, uint32_t indexCount);
+// Copies what the rasterizer needs so it can run on another thread while the sets change.
+void gatherOccluders(const SparseSet<OccluderTag>& occluderSet, const SparseSet<TransformComponent>& transformSet,
+                     const SparseSet<MeshData>& meshSet, const MeshBuffer& meshBuffer, OccluderBuffer& occluders);
+void rasterizeOccluders(const OccluderBuffer& occluders, const glm::mat4& viewProjection, SoftwareDepthBuffer& depthBuffer);
+// Removes entities hidden behind the rasterized occluders from the visible buffer, keeping the order of the rest.
+void performSoftwareOcclusionCulling(const SoftwareDepthBuffer& depthBuffer, const WorldBoundsBuffer& worldBounds,
+                                     const SparseSet<RenderableTag>& renderableSet, const SparseSet<OccluderTag>& occluderSet,
+                                     const glm::mat4& viewProjection, VisibleEntityBuffer& visibleEntities, uint32_t& occludedCount);
@@ -4,13 +4,16 @@
 #include "entity.h"
 #include "asset_manager.h"
 
+// The scene load benchmark builds with a larger MAX_ENTITIES, the sets every entity can have follow it.
+#ifndef MAX_ENTITIES
 #define MAX_ENTITIES 6000
-#define CAPACITY_TRANSFORM 6000
-#define CAPACITY_MESH 6000
-#define CAPACITY_MATERIAL 6000
-#define CAPACITY_RENDERABLE 6000
-#define CAPACITY_VELOCITY 6000
-#define CAPACITY_COLLISION 6000
+#endif
+#define CAPACITY_TRANSFORM MAX_ENTITIES
+#define CAPACITY_MESH MAX_ENTITIES
+#define CAPACITY_MATERIAL MAX_ENTITIES
+#define CAPACITY_RENDERABLE MAX_ENTITIES
+#define CAPACITY_VELOCITY MAX_ENTITIES
+#define CAPACITY_COLLISION MAX_ENTITIES
 #define CAPACITY_DYNAMIC 16
 #define CAPACITY_BULLET 128
 #define CAPACITY_CAMERA 4
@@ -24,6 +27,7 @@
 #define CAPACITY_INPUT_TANK 16
 #define CAPACITY_INPUT_NOCLIP 16
 #define CAPACITY_NAME 256
+#define CAPACITY_OCCLUDER 64
 
 constexpr size_t ARENA_SIZE =
     CAPACITY_TRANSFORM * (sizeof(TransformComponent) + sizeof(uint32_t)) + MAX_ENTITIES * sizeof(uint32_t) +
@@ -45,6 +49,7 @@ constexpr size_t ARENA_SIZE =
     CAPACITY_INPUT_TANK * (sizeof(PlayerInputTankTag) + sizeof(uint32_t)) + MAX_ENTITIES * sizeof(uint32_t) +
     CAPACITY_INPUT_NOCLIP * (sizeof(PlayerInputNoClipTag) + sizeof(uint32_t)) + MAX_ENTITIES * sizeof(uint32_t) +
     CAPACITY_NAME * (sizeof(NameComponent) + sizeof(uint32_t)) + MAX_ENTITIES * sizeof(uint32_t) +
+    CAPACITY_OCCLUDER * (sizeof(OccluderTag) + sizeof(uint32_t)) + MAX_ENTITIES * sizeof(uint32_t) +
     1024; // in case of padding
 
 struct Arena {
@@ -67,6 +72,17 @@ struct Arena {
 
 #define INVALID_INDEX UINT32_MAX
 
+// Dirty tracking granularity, one bit per this many dense entries and per this many sparse entries.
+static constexpr uint32_t DIRTY_BLOCK_SIZE = 64;
+static constexpr uint32_t DIRTY_WORDS = ((MAX_ENTITIES + DIRTY_BLOCK_SIZE - 1) / DIRTY_BLOCK_SIZE + 63) / 64;
+
+// Every consumer of the dirty bits gets its own copy, so clearing one doesn't hide writes from the others.
+enum DirtyChannel : uint32_t {
+    DIRTY_SNAPSHOT,
+    DIRTY_RENDER_TREE,
+    DIRTY_CHANNELS
+};
+
 template <typename Component>
 class SparseSet {
 public:
@@ -75,6 +91,38 @@ public:
     uint32_t* entities;
     uint32_t entityCount = 0;
     uint32_t denseCapacity;
+    // Blocks written since each channel was last cleared. Everything that writes through the set marks them,
+    // writing dense or entities directly has to call markAllDirty. Read through a const set so reads don't mark.
+    uint64_t denseDirty[DIRTY_CHANNELS][DIRTY_WORDS] = {};
+    uint64_t sparseDirty[DIRTY_CHANNELS][DIRTY_WORDS] = {};
+
+    void markDenseDirty(uint32_t denseIndex) {
+        uint32_t block = denseIndex / DIRTY_BLOCK_SIZE;
+        for (uint32_t channel = 0; channel < DIRTY_CHANNELS; ++channel) denseDirty[channel][block / 64] |= 1ull << (block % 64);
+    }
+
+    void markSparseDirty(uint32_t entityID) {
+        uint32_t block = entityID / DIRTY_BLOCK_SIZE;
+        for (uint32_t channel = 0; channel < DIRTY_CHANNELS; ++channel) sparseDirty[channel][block / 64] |= 1ull << (block % 64);
+    }
+
+    void markAllDirty() {
+        std::fill(&denseDirty[0][0], &denseDirty[0][0] + DIRTY_CHANNELS * DIRTY_WORDS, ~0ull);
+        std::fill(&sparseDirty[0][0], &sparseDirty[0][0] + DIRTY_CHANNELS * DIRTY_WORDS, ~0ull);
+    }
+
+    void clearDirty(DirtyChannel channel) {
+        std::fill(denseDirty[channel], denseDirty[channel] + DIRTY_WORDS, 0ull);
+        std::fill(sparseDirty[channel], sparseDirty[channel] + DIRTY_WORDS, 0ull);
+    }
+
+    bool isDenseBlockDirty(DirtyChannel channel, uint32_t block) const {
+        return denseDirty[channel][block / 64] & (1ull << (block % 64));
+    }
+
+    bool isSparseBlockDirty(DirtyChannel channel, uint32_t block) const {
+        return sparseDirty[channel][block / 64] & (1ull << (block % 64));
+    }
 
     void init(Arena& arena, uint32_t capacity) {
         denseCapacity = capacity;
@@ -99,11 +147,14 @@ public:
     // Write to component
     Component& getComponent(uint32_t entityID) {
         uint32_t denseIndex = sparse[entityID];
+        markDenseDirty(denseIndex);
         return dense[denseIndex];
     }
 
     void add(uint32_t entityID, const Component& component) {
         if (entityCount >= denseCapacity) return;
+        markDenseDirty(entityCount);
+        markSparseDirty(entityID);
         dense[entityCount] = component;
         sparse[entityID] = entityCount;
         entities[entityCount] = entityID;
@@ -117,6 +168,10 @@ public:
         uint32_t denseIndex = sparse[entityID];
         uint32_t denseLast = entityCount - 1;
         uint32_t entitiesLast = entities[denseLast];
+        markDenseDirty(denseIndex);
+        markDenseDirty(denseLast);
+        markSparseDirty(entitiesLast);
+        markSparseDirty(entityID);
         dense[denseIndex] = dense[denseLast];
         entities[denseIndex] = entitiesLast;
         sparse[entitiesLast] = denseIndex;
@@ -124,7 +179,9 @@ public:
         sparse[entityID] = INVALID_INDEX;
     }
 
+    // Called after the arrays were filled in bulk, so everything counts as written.
     void rebuildSparse() {
+        markAllDirty();
         std::fill(sparse, sparse + MAX_ENTITIES, INVALID_INDEX);
         for (uint32_t i = 0; i < entityCount; i++) {
             sparse[entities[i]] = i;
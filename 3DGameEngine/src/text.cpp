@@ -1,19 +1,32 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include "text.h"
 #include "stb_image.h"
+#include "asset_manager.h"
+#include "asset_pack.h"
 #include <glad/glad.h>
 #include <cstdio>
 #include <cstring>
 #include <iostream>
+#include <algorithm>
 
 void parseFont(const char* path, Glyph* glyphs, uint16_t& glyphCount) {
-    FILE* file = fopen(path, "rb");
-    if (!file) { // TODO: MAKE THIS MORE ROBUST AND LOOK INTO STD::FROM_CHARS FOR BELOW
+    AssetView file;
+    if (!openAsset(path, file)) { // TODO: MAKE THIS MORE ROBUST AND LOOK INTO STD::FROM_CHARS FOR BELOW
         std::cout << "FAILED TO LOAD FNT FILE." << std::endl;
+        return;
     }
     char buffer[256];
 
-    while (std::fgets(buffer, sizeof(buffer), file)) {
+    const char* cursor = reinterpret_cast<const char*>(file.data);
+    const char* end = cursor + file.size;
+    while (cursor < end) {
+        const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', (size_t)(end - cursor)));
+        if (!lineEnd) lineEnd = end;
+        size_t length = std::min((size_t)(lineEnd - cursor), sizeof(buffer) - 1);
+        std::memcpy(buffer, cursor, length);
+        buffer[length] = '\0';
+        cursor = lineEnd + 1;
+
         if (std::strncmp(buffer, "char", 4) == 0 && glyphCount < MAX_GLYPHS) {
             Glyph g;
             int result = sscanf(buffer,
@@ -28,7 +41,7 @@ void parseFont(const char* path, Glyph* glyphs, uint16_t& glyphCount) {
             ++glyphCount;
         }
     }
-    std::fclose(file);
+    closeAsset(file);
 }
 
 uint32_t loadBitmapFont(const char* path, Glyph* glyphs, uint16_t glyphCount) {
@@ -36,7 +49,7 @@ uint32_t loadBitmapFont(const char* path, Glyph* glyphs, uint16_t glyphCount) {
     glGenTextures(1, &textureID);
 
     int width, height, nrComponents;
-    unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
+    unsigned char* data = loadImage(path, width, height, nrComponents, 0);
     if (data) {
         GLenum format = GL_RED;
 
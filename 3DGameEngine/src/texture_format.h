@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+
+// Layout of .ptex files, shared between the engine and texture_cooker.
+// File = TextureFileHeader, then every mip level from largest to smallest at the offsets in the header.
+
+#define TEXTURE_FILE_MAGIC 0x58455450 // "PTEX"
+#define TEXTURE_FILE_VERSION 1
+
+static constexpr uint32_t MAX_TEXTURE_MIPS = 16;
+
+enum class TextureFileFormat : uint32_t {
+    RGBA8, // Uncompressed fallback.
+    BC1,   // Opaque colour, 4 bpp.
+    BC3,   // Colour with alpha, 8 bpp.
+    BC5,   // Two channels (normal maps), 8 bpp.
+    BC7,   // High quality colour with alpha, 8 bpp.
+};
+
+struct TextureFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    TextureFileFormat format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipCount;
+    uint32_t mipOffsets[MAX_TEXTURE_MIPS]; // From the start of the file.
+    uint32_t mipSizes[MAX_TEXTURE_MIPS];
+};
+
+inline uint32_t textureMipSize(TextureFileFormat format, uint32_t width, uint32_t height) {
+    if (format == TextureFileFormat::RGBA8) return width * height * 4;
+    uint32_t blockBytes = format == TextureFileFormat::BC1 ? 8 : 16;
+    return ((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+}
@@ -0,0 +1,237 @@
+#include "texture_streamer.h"
+#include "asset_manager.h"
+#include "render_system.h"
+#include "entity.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Only one prefetch per texture is ever in flight.
+static_assert(MAX_STREAMED_TEXTURES <= decltype(TextureStreamer::prefetchJobs)::capacity);
+static_assert(MAX_STREAMED_TEXTURES <= decltype(TextureStreamer::prefetched)::capacity);
+
+static size_t mipRangeBytes(const TextureFileHeader& header, uint32_t firstMip, uint32_t endMip) {
+    size_t bytes = 0;
+    for (uint32_t level = firstMip; level < std::min(endMip, header.mipCount); ++level) bytes += header.mipSizes[level];
+    return bytes;
+}
+
+static void prefetchWorker(TextureStreamer* streamer) {
+    for (;;) {
+        streamer->prefetchSignal.acquire();
+        if (!streamer->running.load(std::memory_order_acquire)) return;
+
+        MipPrefetchJob job;
+        if (!streamer->prefetchJobs.pop(job)) continue;
+
+        // Touch every page of the new mips so the upload on the GL thread reads memory instead of faulting on the disk.
+        const StreamedTexture& texture = streamer->textures[job.texture];
+        volatile uint8_t sink = 0;
+        for (uint32_t level = job.mip; level < job.endMip; ++level) {
+            const uint8_t* mip = texture.file.data + texture.header.mipOffsets[level];
+            for (size_t offset = 0; offset < texture.header.mipSizes[level]; offset += 4096) sink = sink + mip[offset];
+        }
+        (void)sink;
+        streamer->prefetched.push(job);
+    }
+}
+
+static void releaseRetiredTextures(TextureStreamer& streamer, bool all) {
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < streamer.retiredCount; ++i) {
+        RetiredTexture& retired = streamer.retired[i];
+        if (!all && streamer.frame - retired.frame < STREAMING_RETIRE_FRAMES) {
+            streamer.retired[kept++] = retired;
+            continue;
+        }
+        glMakeTextureHandleNonResidentARB(retired.handle);
+        glDeleteTextures(1, &retired.textureID);
+    }
+    streamer.retiredCount = kept;
+}
+
+void startTextureStreamer(TextureStreamer& streamer) {
+    streamer.running.store(true, std::memory_order_release);
+    streamer.worker = std::thread(prefetchWorker, &streamer);
+}
+
+void stopTextureStreamer(TextureStreamer& streamer) {
+    streamer.running.store(false, std::memory_order_release);
+    streamer.prefetchSignal.release();
+    if (streamer.worker.joinable()) streamer.worker.join();
+    releaseRetiredTextures(streamer, true);
+    for (uint16_t i = 0; i < streamer.textureCount; ++i) closeAsset(streamer.textures[i].file);
+    streamer.textureCount = 0;
+}
+
+// Builds a texture holding mips [mip, mipCount), copying the levels the old one already has on the GPU.
+static void rebuildStreamedTexture(TextureStreamer& streamer, StreamedTexture& texture, uint8_t mip, uint32_t materialSSBO) {
+    const TextureFileHeader& header = texture.header;
+    uint32_t copyFrom = firstCopiedMip(mip, texture.residentMip, header.mipCount, texture.textureID != 0);
+
+    uint32_t textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    allocateCookedTexture(GL_TEXTURE_2D, header, mip);
+    uploadCookedMips(GL_TEXTURE_2D, header, texture.file.data, mip, copyFrom);
+    for (uint32_t level = copyFrom; level < header.mipCount; ++level) {
+        GLsizei mipWidth = (GLsizei)std::max(header.width >> level, 1u);
+        GLsizei mipHeight = (GLsizei)std::max(header.height >> level, 1u);
+        glCopyImageSubData(texture.textureID, GL_TEXTURE_2D, level - texture.residentMip, 0, 0, 0, textureID, GL_TEXTURE_2D,
+                           level - mip, 0, 0, 0, mipWidth, mipHeight, 1);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    uint64_t handle = glGetTextureHandleARB(textureID);
+    glMakeTextureHandleResidentARB(handle);
+
+    *texture.handleTarget = handle;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, materialSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, texture.ssboOffset, sizeof(uint64_t), &handle);
+
+    // Frames already submitted may still sample the old texture.
+    if (texture.textureID) {
+        streamer.retired[streamer.retiredCount++] = RetiredTexture{texture.textureID, texture.handle, streamer.frame};
+    }
+
+    size_t bytes = mipRangeBytes(header, mip, header.mipCount);
+    streamer.residentBytes = streamer.residentBytes - texture.residentBytes + bytes;
+    texture.residentBytes = bytes;
+    texture.textureID = textureID;
+    texture.handle = handle;
+    texture.residentMip = mip;
+    texture.rebuiltFrame = streamer.frame;
+}
+
+bool registerStreamedTexture(TextureStreamer& streamer, const AssetView& file, const TextureFileHeader& header,
+                             uint64_t* handleTarget, GLintptr ssboOffset, uint32_t materialSSBO) {
+    if (streamer.textureCount >= MAX_STREAMED_TEXTURES || ssboOffset < 0) return false;
+    // Material textures are requested straight into their MaterialSSBOData, so the offset tells which material it is.
+    uint32_t material = (uint32_t)(ssboOffset / (GLintptr)sizeof(MaterialSSBOData));
+    if (material >= MAX_STREAMED_MATERIALS) return false;
+
+    uint8_t baseMip = 0;
+    while (baseMip + 1u < header.mipCount && std::max(header.width >> baseMip, header.height >> baseMip) > STREAMING_BASE_MIP_SIZE) {
+        ++baseMip;
+    }
+
+    StreamedTexture& texture = streamer.textures[streamer.textureCount++];
+    texture = StreamedTexture{};
+    texture.file = file;
+    texture.header = header;
+    texture.handleTarget = handleTarget;
+    texture.ssboOffset = ssboOffset;
+    texture.material = (uint16_t)material;
+    texture.baseMip = baseMip;
+    texture.requestedMip = baseMip;
+    texture.lastNeededFrame = streamer.frame;
+    texture.rebuiltFrame = UINT32_MAX;
+    rebuildStreamedTexture(streamer, texture, baseMip, materialSSBO);
+    return true;
+}
+
+static void computeMaterialPixels(TextureStreamer& streamer, const VisibleEntityBuffer& visibleEntities,
+                                  const SparseSet<MaterialData>& materialSet, const SparseSet<MeshData>& meshSet,
+                                  const SparseSet<TransformComponent>& transformSet, const CameraComponent& camera,
+                                  uint32_t screenHeight) {
+    std::memset(streamer.materialPixels, 0, sizeof(streamer.materialPixels));
+    // Pixels per world unit at distance 1, same as the LOD selection.
+    const float projectionScale = 0.5f * (float)screenHeight * camera.projectionMatrix[1][1];
+
+    for (uint32_t i = 0; i < visibleEntities.size; ++i) {
+        uint32_t entity = visibleEntities.buffer[i];
+        if (!materialSet.hasComponent(entity)) continue;
+        uint16_t material = materialSet.getComponent(entity).materialSSBOIndex;
+        if (material >= MAX_STREAMED_MATERIALS) continue;
+
+        const MeshData& mesh = meshSet.getComponent(entity);
+        const TransformComponent& transform = transformSet.getComponent(entity);
+        float maxScale = std::max(std::max(std::abs(transform.scale.x), std::abs(transform.scale.y)), std::abs(transform.scale.z));
+        glm::vec3 localExtent = glm::vec3(mesh.localAABB.maxX - mesh.localAABB.minX, mesh.localAABB.maxY - mesh.localAABB.minY,
+                                          mesh.localAABB.maxZ - mesh.localAABB.minZ) * 0.5f;
+        float radius = glm::length(localExtent) * maxScale;
+        float distance = glm::length(transform.position - camera.position) - radius;
+
+        // Inside the bounding sphere anything could fill the screen.
+        float pixels = distance > 0.0f ? 2.0f * radius * projectionScale / distance : (float)screenHeight * 4.0f;
+        streamer.materialPixels[material] = std::max(streamer.materialPixels[material], pixels);
+    }
+}
+
+// Drops mips nobody currently needs, longest unneeded first, until extraBytes more fit in the budget.
+static bool makeRoom(TextureStreamer& streamer, size_t extraBytes, uint16_t keep, uint32_t materialSSBO) {
+    while (streamer.residentBytes + extraBytes > streamer.memoryBudgetBytes) {
+        int32_t victim = -1;
+        for (uint16_t i = 0; i < streamer.textureCount; ++i) {
+            const StreamedTexture& texture = streamer.textures[i];
+            if (i == keep || texture.residentMip >= texture.requestedMip || texture.rebuiltFrame == streamer.frame) continue;
+            if (victim < 0 || texture.lastNeededFrame < streamer.textures[victim].lastNeededFrame) victim = i;
+        }
+        if (victim < 0) return false;
+        StreamedTexture& texture = streamer.textures[victim];
+        rebuildStreamedTexture(streamer, texture, texture.requestedMip, materialSSBO);
+        ++streamer.evictions;
+    }
+    return true;
+}
+
+void updateTextureStreaming(TextureStreamer& streamer, const VisibleEntityBuffer& visibleEntities,
+                            const SparseSet<MaterialData>& materialSet, const SparseSet<MeshData>& meshSet,
+                            const SparseSet<TransformComponent>& transformSet, const CameraComponent& camera,
+                            uint32_t screenHeight, uint32_t materialSSBO) {
+    ++streamer.frame;
+    releaseRetiredTextures(streamer, false);
+    computeMaterialPixels(streamer, visibleEntities, materialSet, meshSet, transformSet, camera, screenHeight);
+
+    for (uint16_t i = 0; i < streamer.textureCount; ++i) {
+        StreamedTexture& texture = streamer.textures[i];
+        float pixels = streamer.materialPixels[texture.material];
+        uint8_t requested = texture.baseMip;
+        if (pixels > 0.0f) {
+            // Assumes the texture spans the mesh once, one texel per pixel across the projected diameter.
+            float texels = (float)std::max(texture.header.width, texture.header.height);
+            float mip = std::floor(std::log2(texels / pixels) + streamer.mipBias);
+            requested = (uint8_t)std::clamp(mip, 0.0f, (float)texture.baseMip);
+        }
+        texture.requestedMip = requested;
+        if (requested <= texture.residentMip) texture.lastNeededFrame = streamer.frame;
+
+        if (requested < texture.residentMip && !texture.prefetching) {
+            texture.prefetching = true;
+            streamer.prefetchJobs.push(MipPrefetchJob{i, requested, texture.residentMip});
+            streamer.prefetchSignal.release();
+        }
+    }
+
+    size_t uploadedBytes = 0;
+    bool overBudget = false;
+    MipPrefetchJob job;
+    while (uploadedBytes < streamer.uploadBudgetBytes && streamer.prefetched.pop(job)) {
+        StreamedTexture& texture = streamer.textures[job.texture];
+        // The camera may have moved on while the pages came in, only load what's still wanted.
+        uint8_t target = std::max(job.mip, texture.requestedMip);
+        if (target < texture.residentMip && texture.rebuiltFrame != streamer.frame) {
+            size_t bytes = mipRangeBytes(texture.header, target, texture.residentMip);
+            if (makeRoom(streamer, bytes, job.texture, materialSSBO)) {
+                rebuildStreamedTexture(streamer, texture, target, materialSSBO);
+                uploadedBytes += bytes;
+                ++streamer.promotions;
+            } else {
+                overBudget = true;
+            }
+        }
+        texture.prefetching = false;
+    }
+    if (overBudget) ++streamer.overBudgetFrames;
+
+    for (uint16_t i = 0; i < streamer.textureCount; ++i) {
+        StreamedTexture& texture = streamer.textures[i];
+        if (texture.residentMip >= texture.requestedMip || texture.rebuiltFrame == streamer.frame) continue;
+        if (streamer.frame - texture.lastNeededFrame < streamer.evictionDelayFrames) continue;
+        rebuildStreamedTexture(streamer, texture, texture.requestedMip, materialSSBO);
+        ++streamer.evictions;
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <semaphore>
+#include <thread>
+#include <glad/glad.h>
+#include "sparse_set.h"
+#include "asset_pack.h"
+#include "texture_format.h"
+#include "lock_free_queue.h"
+
+struct MaterialData;
+struct MeshData;
+struct TransformComponent;
+struct CameraComponent;
+struct VisibleEntityBuffer;
+
+// Cooked material textures start with only their small mips resident. Each frame the visible entities decide the finest
+// mip every material needs from their projected size, finer mips are paged in from the pack on a worker and uploaded
+// under a per frame budget, and mips that haven't been needed for a while are dropped again to stay under the memory budget.
+// Bindless handles can't change their texture's levels, so every change builds a new texture and swaps the handle.
+
+static constexpr uint32_t MAX_STREAMED_TEXTURES = 64;
+static constexpr uint32_t MAX_STREAMED_MATERIALS = 255;
+// Mips this size and smaller are uploaded on registration and never evicted.
+static constexpr uint32_t STREAMING_BASE_MIP_SIZE = 64;
+// Frames the GPU may still be reading a replaced texture.
+static constexpr uint32_t STREAMING_RETIRE_FRAMES = 3;
+
+struct StreamedTexture {
+    AssetView file;
+    TextureFileHeader header;
+    uint32_t textureID;
+    uint64_t handle;
+    uint64_t* handleTarget;
+    GLintptr ssboOffset;
+    uint16_t material;
+    uint8_t baseMip;      // Coarsest level kept, the first one no bigger than STREAMING_BASE_MIP_SIZE.
+    uint8_t residentMip;  // Finest level on the GPU.
+    uint8_t requestedMip; // Finest level anything visible needs, baseMip when nothing does.
+    bool prefetching;
+    uint32_t lastNeededFrame; // Last frame all resident mips were needed.
+    uint32_t rebuiltFrame;    // At most one new texture per frame, the retire list is sized for that.
+    size_t residentBytes;
+};
+
+// Pages in mips [mip, endMip) of a texture.
+struct MipPrefetchJob {
+    uint16_t texture;
+    uint8_t mip;
+    uint8_t endMip;
+};
+
+struct RetiredTexture {
+    uint32_t textureID;
+    uint64_t handle;
+    uint32_t frame;
+};
+
+struct TextureStreamer {
+    StreamedTexture textures[MAX_STREAMED_TEXTURES];
+    uint16_t textureCount = 0;
+    float materialPixels[MAX_STREAMED_MATERIALS]; // Largest projected diameter of anything using each material this frame.
+
+    LockFreeQueue<MipPrefetchJob, 128> prefetchJobs;
+    LockFreeQueue<MipPrefetchJob, 128> prefetched;
+    std::counting_semaphore<> prefetchSignal{0};
+    std::atomic<bool> running{false};
+    std::thread worker;
+
+    // Every texture can be replaced once per frame, each replacement waits STREAMING_RETIRE_FRAMES.
+    RetiredTexture retired[MAX_STREAMED_TEXTURES * (STREAMING_RETIRE_FRAMES + 1)];
+    uint32_t retiredCount = 0;
+
+    size_t memoryBudgetBytes = 64 * 1024 * 1024;
+    size_t uploadBudgetBytes = 4 * 1024 * 1024;
+    uint32_t evictionDelayFrames = 120;
+    float mipBias = 0.0f;
+
+    uint32_t frame = 0;
+    size_t residentBytes = 0;
+    uint32_t promotions = 0;
+    uint32_t evictions = 0;
+    uint32_t overBudgetFrames = 0;
+};
+
+// A texture rebuilt to hold [mip, mipCount) uploads [mip, copyFrom) from the file and copies [copyFrom, mipCount) from the
+// old texture, whose level 0 is residentMip. Without an old texture, on registration, everything comes from the file.
+inline uint32_t firstCopiedMip(uint32_t mip, uint32_t residentMip, uint32_t mipCount, bool hasOldTexture) {
+    return hasOldTexture ? std::max(mip, residentMip) : mipCount;
+}
+
+void startTextureStreamer(TextureStreamer& streamer);
+void stopTextureStreamer(TextureStreamer& streamer);
+// Takes ownership of file. Returns false when the streamer is full, the caller then uploads the whole texture itself.
+bool registerStreamedTexture(TextureStreamer& streamer, const AssetView& file, const TextureFileHeader& header,
+                             uint64_t* handleTarget, GLintptr ssboOffset, uint32_t materialSSBO);
+void updateTextureStreaming(TextureStreamer& streamer, const VisibleEntityBuffer& visibleEntities,
+                            const SparseSet<MaterialData>& materialSet, const SparseSet<MeshData>& meshSet,
+                            const SparseSet<TransformComponent>& transformSet, const CameraComponent& camera,
+                            uint32_t screenHeight, uint32_t materialSSBO);
@@ -4,7 +4,7 @@
 #include <iostream>
 #include <stdexcept>
 
-GLFWwindow* createWindow(uint32_t width, uint32_t height, const char* title) {
+GLFWwindow* createWindow(uint32_t width, uint32_t height, const char* title, bool visible) {
     if (!glfwInit()) {
         throw std::runtime_error("Failed to initialize GLFW");
     }
@@ -12,6 +12,7 @@ GLFWwindow* createWindow(uint32_t width, uint32_t height, const char* title) {
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
 
     GLFWwindow* windowPtr = glfwCreateWindow(width, height, title, nullptr, nullptr);
     if (!windowPtr) {
@@ -10,5 +10,5 @@ struct WindowData {
     GLFWwindow* windowPtr;
 };
 
-GLFWwindow* createWindow(uint32_t width, uint32_t height, const char* title);
+GLFWwindow* createWindow(uint32_t width, uint32_t height, const char* title, bool visible = true);
 void destroyWindow(GLFWwindow* windowPtr);
\ No newline at end of file
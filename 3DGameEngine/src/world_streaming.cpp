@@ -0,0 +1,413 @@
+#include "world_streaming.h"
+#include "scene_sets.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <type_traits>
+
+static constexpr uint16_t NO_SLOT = UINT16_MAX;
+
+static bool isWorldEntity(ECS& scene, uint32_t entity) {
+    return !scene.cameraSet.hasComponent(entity) && !scene.dynamicSet.hasComponent(entity) &&
+           !scene.bulletSet.hasComponent(entity) && !scene.inputMapSet.hasComponent(entity) &&
+           !scene.inputWorldSet.hasComponent(entity) && !scene.inputTankSet.hasComponent(entity) &&
+           !scene.inputNoClipSet.hasComponent(entity);
+}
+
+static int32_t cellCoordinate(float position, float cellSize) {
+    return (int32_t)std::floor(position / cellSize);
+}
+
+bool saveWorld(ECS& scene, const char* path, float cellSize) {
+    struct CellEntity {
+        int32_t x, z;
+        uint32_t entity;
+    };
+    std::vector<CellEntity> cellEntities;
+    for (uint32_t i = 0; i < scene.transformSet.entityCount; ++i) {
+        uint32_t entity = scene.transformSet.entities[i];
+        if (!isWorldEntity(scene, entity)) continue;
+        const glm::vec3& position = scene.transformSet.dense[i].position;
+        cellEntities.push_back({cellCoordinate(position.x, cellSize), cellCoordinate(position.z, cellSize), entity});
+    }
+    // Grouped by cell, and ascending within a cell so local IDs come out ascending in every chunk.
+    std::sort(cellEntities.begin(), cellEntities.end(), [](const CellEntity& a, const CellEntity& b) {
+        if (a.x != b.x) return a.x < b.x;
+        if (a.z != b.z) return a.z < b.z;
+        return a.entity < b.entity;
+    });
+
+    std::vector<WorldCellEntry> cells;
+    std::vector<size_t> cellStarts;
+    for (size_t i = 0; i < cellEntities.size(); ++i) {
+        if (i == 0 || cellEntities[i].x != cells.back().x || cellEntities[i].z != cells.back().z) {
+            cells.push_back({cellEntities[i].x, cellEntities[i].z, 0, 0, 0, 0});
+            cellStarts.push_back(i);
+        }
+        ++cells.back().entityCount;
+    }
+    if (cells.size() > MAX_WORLD_CELLS) {
+        std::cout << "World has " << cells.size() << " cells, the streamer holds " << MAX_WORLD_CELLS << ": " << path << std::endl;
+        return false;
+    }
+
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+
+    WorldFileHeader header = {WORLD_FILE_MAGIC, WORLD_FILE_VERSION, (uint32_t)cells.size(), cellSize};
+    fwrite(&header, sizeof(WorldFileHeader), 1, f);
+    // The table is written again once the cell offsets are known.
+    fwrite(cells.data(), sizeof(WorldCellEntry), cells.size(), f);
+
+    std::vector<uint32_t> localEntities;
+    uint64_t offset = sizeof(WorldFileHeader) + cells.size() * sizeof(WorldCellEntry);
+    for (size_t c = 0; c < cells.size(); ++c) {
+        WorldCellEntry& cell = cells[c];
+        cell.offset = offset;
+        const CellEntity* members = cellEntities.data() + cellStarts[c];
+        forEachSceneSet(scene, [&](SceneChunkID id, uint32_t layoutVersion, SceneMigrateFn, auto& set) {
+            using Component = std::remove_reference_t<decltype(set.dense[0])>;
+            std::vector<Component> components;
+            localEntities.clear();
+            for (uint32_t local = 0; local < cell.entityCount; ++local) {
+                if (!set.hasComponent(members[local].entity)) continue;
+                localEntities.push_back(local);
+                components.push_back(set.getComponent(members[local].entity));
+            }
+            if (components.empty()) return;
+            writeChunkData(f, id, layoutVersion, localEntities.data(), components.data(), (uint32_t)components.size());
+            ++cell.chunkCount;
+        });
+        offset = (uint64_t)ftell(f);
+        cell.size = offset - cell.offset;
+    }
+
+    fseek(f, sizeof(WorldFileHeader), SEEK_SET);
+    fwrite(cells.data(), sizeof(WorldCellEntry), cells.size(), f);
+    fclose(f);
+    std::cout << "Saved world " << path << ": " << cellEntities.size() << " entities in " << cells.size() << " cells" << std::endl;
+    return true;
+}
+
+// An ID is in use while any set has it, entities without components don't exist anywhere else.
+static void markLiveEntities(ECS& scene, std::vector<bool>& live) {
+    live.assign(MAX_ENTITIES, false);
+    forEachSceneSet(scene, [&](SceneChunkID, uint32_t, SceneMigrateFn, auto& set) {
+        for (uint32_t i = 0; i < set.entityCount; ++i) live[set.entities[i]] = true;
+    });
+}
+
+void clearWorldEntities(ECS& scene) {
+    for (uint32_t i = scene.transformSet.entityCount; i-- > 0;) {
+        uint32_t entity = scene.transformSet.entities[i];
+        if (!isWorldEntity(scene, entity)) continue;
+        forEachSceneSet(scene, [&](SceneChunkID, uint32_t, SceneMigrateFn, auto& set) { set.remove(entity); });
+        if (scene.selectedEntity == (int)entity) scene.selectedEntity = -1;
+    }
+
+    // createEntity counts entityCount up, dropping it to the highest ID still in use hands the cleared ones above that
+    // out again. The ones below are picked up by openWorld.
+    std::vector<bool> live;
+    markLiveEntities(scene, live);
+    uint32_t highest = std::min(scene.entityCount, (uint32_t)MAX_ENTITIES - 1);
+    while (highest > 0 && !live[highest]) --highest;
+    scene.entityCount = highest;
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < scene.freeStackSize; ++i) {
+        if (scene.freeStack[i] <= highest) scene.freeStack[kept++] = scene.freeStack[i];
+    }
+    scene.freeStackSize = kept;
+}
+
+// Copies a cell out of the mapping and checks every chunk, so committing never has to.
+static bool stageCell(WorldStreamer& streamer, CellSlot& slot) {
+    const WorldCellEntry& cell = streamer.cells[slot.cell];
+    slot.staging.assign(streamer.file.data + cell.offset, streamer.file.data + cell.offset + cell.size);
+    slot.chunkCount = 0;
+    if (cell.chunkCount > MAX_CELL_CHUNKS) return false;
+
+    size_t offset = 0;
+    for (uint32_t c = 0; c < cell.chunkCount; ++c) {
+        StagedChunk& staged = slot.chunks[slot.chunkCount++];
+        if (offset + sizeof(SceneChunkHeader) > slot.staging.size()) return false;
+        memcpy(&staged.header, slot.staging.data() + offset, sizeof(SceneChunkHeader));
+        if (!sceneChunkInBounds(staged.header, slot.staging.size() - offset)) return false;
+        staged.offset = (uint32_t)offset;
+        staged.cursor = 0;
+
+        const uint8_t* entities = slot.staging.data() + offset + staged.header.entitiesOffset;
+        uint32_t previous = 0;
+        for (uint32_t i = 0; i < staged.header.count; ++i) {
+            uint32_t local;
+            memcpy(&local, entities + i * sizeof(uint32_t), sizeof(uint32_t));
+            if (local >= cell.entityCount || (i > 0 && local <= previous)) return false;
+            previous = local;
+        }
+        offset += staged.header.size;
+    }
+    return true;
+}
+
+static void worldStreamingWorker(WorldStreamer& streamer) {
+    for (;;) {
+        streamer.loadSignal.acquire();
+        if (!streamer.running.load(std::memory_order_acquire)) return;
+        CellLoadJob job;
+        while (streamer.loadJobs.pop(job)) {
+            CellSlot& slot = streamer.slots[job.slot];
+            slot.valid = stageCell(streamer, slot);
+            streamer.loadedCells.push(job);
+        }
+    }
+}
+
+static void resetSlot(WorldStreamer& streamer, uint16_t slotIndex) {
+    CellSlot& slot = streamer.slots[slotIndex];
+    streamer.reservedEntities -= streamer.cells[slot.cell].entityCount;
+    streamer.cellSlot[slot.cell] = NO_SLOT;
+    slot.state = CellState::Unloaded;
+    slot.entities.clear();
+    slot.staging.clear();
+    slot.staging.shrink_to_fit();
+}
+
+bool openWorld(WorldStreamer& streamer, ECS& scene, const char* path, uint32_t entityCapacity) {
+    if (streamer.open) closeWorld(streamer, scene);
+    if (!openMappedFile(path, streamer.file)) {
+        std::cout << "Failed to open world: " << path << std::endl;
+        return false;
+    }
+
+    WorldFileHeader& header = streamer.header;
+    header = {};
+    if (streamer.file.size >= sizeof(WorldFileHeader)) memcpy(&header, streamer.file.data, sizeof(WorldFileHeader));
+    bool valid = header.magic == WORLD_FILE_MAGIC && header.version <= WORLD_FILE_VERSION && header.cellCount <= MAX_WORLD_CELLS &&
+                 header.cellSize > 0.0f &&
+                 sizeof(WorldFileHeader) + (uint64_t)header.cellCount * sizeof(WorldCellEntry) <= streamer.file.size;
+    if (valid) memcpy(streamer.cells, streamer.file.data + sizeof(WorldFileHeader), header.cellCount * sizeof(WorldCellEntry));
+    for (uint32_t c = 0; c < header.cellCount && valid; ++c) {
+        const WorldCellEntry& cell = streamer.cells[c];
+        valid = cell.offset <= streamer.file.size && cell.size <= streamer.file.size - cell.offset && cell.entityCount <= MAX_ENTITIES;
+    }
+    if (!valid) {
+        std::cout << "Not a world file, or it's damaged: " << path << std::endl;
+        closeMappedFile(streamer.file);
+        return false;
+    }
+
+    // Streamed entities first take the IDs below entityCount that nothing uses, clearWorldEntities leaves those behind,
+    // then a block right above the ones the scene uses so far. Whatever is created later comes after them.
+    std::vector<bool> live;
+    markLiveEntities(scene, live);
+    for (uint8_t i = 0; i < scene.freeStackSize; ++i) live[scene.freeStack[i]] = true;
+    uint32_t usedEntities = std::min(scene.entityCount, (uint32_t)MAX_ENTITIES - 1);
+    std::vector<uint32_t>& freeEntities = streamer.freeEntities;
+    freeEntities.clear();
+    for (uint32_t entity = 1; entity <= usedEntities && freeEntities.size() < entityCapacity; ++entity) {
+        if (!live[entity]) freeEntities.push_back(entity);
+    }
+    streamer.firstEntity = scene.entityCount + 1;
+    streamer.blockSize = std::min(entityCapacity - (uint32_t)freeEntities.size(), (uint32_t)MAX_ENTITIES - 1 - usedEntities);
+    for (uint32_t i = 0; i < streamer.blockSize; ++i) freeEntities.push_back(streamer.firstEntity + i);
+    // Taken from the back, lowest first.
+    std::reverse(freeEntities.begin(), freeEntities.end());
+    entityCapacity = (uint32_t)freeEntities.size();
+    streamer.entityCapacity = entityCapacity;
+    scene.entityCount += streamer.blockSize;
+    streamer.reservedEntities = 0;
+
+    std::fill(streamer.cellSlot, streamer.cellSlot + MAX_WORLD_CELLS, NO_SLOT);
+    for (CellSlot& slot : streamer.slots) slot.state = CellState::Unloaded;
+    streamer.residentCells = 0;
+    streamer.loadsInFlight = 0;
+    streamer.open = true;
+
+    streamer.running.store(true, std::memory_order_release);
+    streamer.worker = std::thread(worldStreamingWorker, std::ref(streamer));
+    std::cout << "Streaming world " << path << ": " << header.cellCount << " cells of " << header.cellSize << " units, "
+              << entityCapacity << " entity IDs reserved" << std::endl;
+    return true;
+}
+
+static void removeStreamedEntity(WorldStreamer& streamer, ECS& scene, uint32_t entity) {
+    forEachSceneSet(scene, [&](SceneChunkID, uint32_t, SceneMigrateFn, auto& set) { set.remove(entity); });
+    if (scene.selectedEntity == (int)entity) scene.selectedEntity = -1;
+    streamer.freeEntities.push_back(entity);
+}
+
+void closeWorld(WorldStreamer& streamer, ECS& scene) {
+    if (!streamer.open) return;
+    streamer.running.store(false, std::memory_order_release);
+    streamer.loadSignal.release();
+    streamer.worker.join();
+    CellLoadJob job;
+    while (streamer.loadJobs.pop(job)) {}
+    while (streamer.loadedCells.pop(job)) {}
+
+    for (uint16_t s = 0; s < MAX_RESIDENT_CELLS; ++s) {
+        CellSlot& slot = streamer.slots[s];
+        if (slot.state == CellState::Unloaded) continue;
+        for (uint32_t entity : slot.entities) removeStreamedEntity(streamer, scene, entity);
+        resetSlot(streamer, s);
+    }
+    // The block only goes back when nothing was created after it, the reused IDs below it are free again either way.
+    if (scene.entityCount == streamer.firstEntity + streamer.blockSize - 1) {
+        scene.entityCount -= streamer.blockSize;
+    }
+    streamer.freeEntities.clear();
+    closeMappedFile(streamer.file);
+    streamer.open = false;
+    streamer.residentCells = 0;
+    streamer.loadsInFlight = 0;
+}
+
+// Adds the next staged entities to the sets. Components are read entity by entity so an entity is complete as soon as
+// it exists, every chunk keeps a cursor since its entities come in the same ascending order.
+static uint32_t commitCell(WorldStreamer& streamer, ECS& scene, CellSlot& slot, uint32_t budget) {
+    const WorldCellEntry& cell = streamer.cells[slot.cell];
+    uint32_t committed = 0;
+    while (slot.committedEntities < cell.entityCount && committed < budget) {
+        uint32_t local = slot.committedEntities++;
+        uint32_t entity = streamer.freeEntities.back();
+        streamer.freeEntities.pop_back();
+        slot.entities.push_back(entity);
+
+        for (uint32_t c = 0; c < slot.chunkCount; ++c) {
+            StagedChunk& staged = slot.chunks[c];
+            if (staged.cursor >= staged.header.count) continue;
+            const uint8_t* chunk = slot.staging.data() + staged.offset;
+            uint32_t chunkEntity;
+            memcpy(&chunkEntity, chunk + staged.header.entitiesOffset + staged.cursor * sizeof(uint32_t), sizeof(uint32_t));
+            if (chunkEntity != local) continue;
+            uint32_t index = staged.cursor++;
+            forEachSceneSet(scene, [&](SceneChunkID id, uint32_t layoutVersion, SceneMigrateFn migrate, auto& set) {
+                if (id != staged.header.id) return;
+                std::remove_reference_t<decltype(set.dense[0])> component;
+                if (readChunkElement(staged.header, chunk, index, layoutVersion, migrate, component)) set.add(entity, component);
+            });
+        }
+
+        // Mesh handles are stable across runs, the VAO and counts behind them aren't.
+        if (scene.meshSet.hasComponent(entity)) {
+            MeshData& mesh = scene.meshSet.getComponent(entity);
+            if (mesh.handle < scene.meshBuffer.size) {
+                mesh = scene.meshBuffer.buffer[mesh.handle];
+            } else {
+                scene.meshSet.remove(entity);
+                scene.renderableSet.remove(entity);
+            }
+        }
+        ++committed;
+    }
+    return committed;
+}
+
+void updateWorldStreaming(WorldStreamer& streamer, ECS& scene, const glm::vec3& cameraPosition) {
+    streamer.committedThisFrame = 0;
+    streamer.removedThisFrame = 0;
+    if (!streamer.open) return;
+
+    CellLoadJob job;
+    while (streamer.loadedCells.pop(job)) {
+        CellSlot& slot = streamer.slots[job.slot];
+        --streamer.loadsInFlight;
+        if (!slot.valid) {
+            // Kept as an empty resident cell so it isn't retried every frame.
+            const WorldCellEntry& cell = streamer.cells[slot.cell];
+            std::cout << "World cell (" << cell.x << ", " << cell.z << ") is damaged, skipped" << std::endl;
+            slot.chunkCount = 0;
+            slot.committedEntities = cell.entityCount;
+        }
+        slot.state = CellState::Staged;
+    }
+
+    int32_t cameraX = cellCoordinate(cameraPosition.x, streamer.header.cellSize);
+    int32_t cameraZ = cellCoordinate(cameraPosition.z, streamer.header.cellSize);
+    struct Candidate {
+        uint32_t cell;
+        int32_t distance;
+    };
+    Candidate candidates[MAX_WORLD_CELLS];
+    uint32_t candidateCount = 0;
+    for (uint32_t c = 0; c < streamer.header.cellCount; ++c) {
+        const WorldCellEntry& cell = streamer.cells[c];
+        int32_t distance = std::max(std::abs(cell.x - cameraX), std::abs(cell.z - cameraZ));
+        uint16_t slotIndex = streamer.cellSlot[c];
+        if (slotIndex == NO_SLOT) {
+            if (distance <= streamer.loadRadius) candidates[candidateCount++] = {c, distance};
+        } else if (distance > streamer.unloadRadius) {
+            // Loading cells finish first, they're caught here again once staged.
+            CellSlot& slot = streamer.slots[slotIndex];
+            if (slot.state == CellState::Staged || slot.state == CellState::Committing || slot.state == CellState::Resident) {
+                slot.state = CellState::Unloading;
+            }
+        } else if (streamer.slots[slotIndex].state == CellState::Unloading) {
+            // Came back into range before it was gone, finish committing what's left.
+            streamer.slots[slotIndex].state = CellState::Committing;
+        }
+    }
+
+    // Removing first frees IDs and slots for this frame's loads.
+    uint32_t budget = streamer.entityBudgetPerFrame;
+    for (uint16_t s = 0; s < MAX_RESIDENT_CELLS; ++s) {
+        CellSlot& slot = streamer.slots[s];
+        if (slot.state != CellState::Unloading) continue;
+        while (!slot.entities.empty() && streamer.removedThisFrame < budget) {
+            removeStreamedEntity(streamer, scene, slot.entities.back());
+            slot.entities.pop_back();
+            ++streamer.removedThisFrame;
+        }
+        if (slot.entities.empty()) {
+            resetSlot(streamer, s);
+            --streamer.residentCells;
+        }
+    }
+
+    // Nearest cells first, both for committing and for loading.
+    std::sort(candidates, candidates + candidateCount, [](const Candidate& a, const Candidate& b) { return a.distance < b.distance; });
+    uint16_t committing[MAX_RESIDENT_CELLS];
+    uint32_t committingCount = 0;
+    for (uint16_t s = 0; s < MAX_RESIDENT_CELLS; ++s) {
+        CellState state = streamer.slots[s].state;
+        if (state == CellState::Staged || state == CellState::Committing) committing[committingCount++] = s;
+    }
+    std::sort(committing, committing + committingCount, [&](uint16_t a, uint16_t b) {
+        const WorldCellEntry& cellA = streamer.cells[streamer.slots[a].cell];
+        const WorldCellEntry& cellB = streamer.cells[streamer.slots[b].cell];
+        return std::max(std::abs(cellA.x - cameraX), std::abs(cellA.z - cameraZ)) <
+               std::max(std::abs(cellB.x - cameraX), std::abs(cellB.z - cameraZ));
+    });
+    for (uint32_t i = 0; i < committingCount && streamer.committedThisFrame < budget; ++i) {
+        CellSlot& slot = streamer.slots[committing[i]];
+        slot.state = CellState::Committing;
+        streamer.committedThisFrame += commitCell(streamer, scene, slot, budget - streamer.committedThisFrame);
+        if (slot.committedEntities == streamer.cells[slot.cell].entityCount) {
+            slot.state = CellState::Resident;
+            slot.staging.clear();
+            slot.staging.shrink_to_fit();
+        }
+    }
+
+    uint16_t freeSlot = 0;
+    for (uint32_t i = 0; i < candidateCount && streamer.loadsInFlight < MAX_CELL_LOADS_IN_FLIGHT; ++i) {
+        const WorldCellEntry& cell = streamer.cells[candidates[i].cell];
+        // Reserving up front means a committed cell can always get its IDs. A cell too big for what's left waits,
+        // nothing further out jumps ahead of it.
+        if (streamer.reservedEntities + cell.entityCount > streamer.entityCapacity) break;
+        while (freeSlot < MAX_RESIDENT_CELLS && streamer.slots[freeSlot].state != CellState::Unloaded) ++freeSlot;
+        if (freeSlot == MAX_RESIDENT_CELLS) break;
+
+        CellSlot& slot = streamer.slots[freeSlot];
+        slot.state = CellState::Loading;
+        slot.cell = candidates[i].cell;
+        slot.committedEntities = 0;
+        slot.entities.clear();
+        slot.entities.reserve(cell.entityCount);
+        streamer.cellSlot[slot.cell] = freeSlot;
+        streamer.reservedEntities += cell.entityCount;
+        ++streamer.loadsInFlight;
+        ++streamer.residentCells;
+        streamer.loadJobs.push({freeSlot});
+        streamer.loadSignal.release();
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <semaphore>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include "mapped_file.h"
+#include "scene_format.h"
+#include "lock_free_queue.h"
+
+struct ECS;
+
+// Keeps the cells of a world file around the camera resident. A worker copies a cell's chunks out of the mapping into
+// staging and validates them, the main thread then commits staged entities into the ECS sets and removes the entities
+// of cells that fell out of range, both under a per frame entity budget.
+// Streamed entities come from a block of IDs reserved when the world is opened, so only the resident cells count
+// against MAX_ENTITIES. They're meant for static level content, gameplay shouldn't delete them.
+
+static constexpr uint32_t MAX_WORLD_CELLS = 4096;
+static constexpr uint32_t MAX_RESIDENT_CELLS = 64;
+static constexpr uint32_t MAX_CELL_CHUNKS = 32;
+static constexpr uint32_t MAX_CELL_LOADS_IN_FLIGHT = 4;
+
+enum class CellState : uint8_t {
+    Unloaded,
+    Loading,    // Owned by the worker.
+    Staged,     // Copied and validated, waiting to be committed.
+    Committing,
+    Resident,
+    Unloading,
+};
+
+struct StagedChunk {
+    SceneChunkHeader header;
+    uint32_t offset; // Into the slot's staging buffer.
+    uint32_t cursor; // Next element to commit, chunks list their entities in ascending order.
+};
+
+struct CellSlot {
+    CellState state = CellState::Unloaded;
+    uint32_t cell;
+    bool valid;
+    std::vector<uint8_t> staging;
+    StagedChunk chunks[MAX_CELL_CHUNKS];
+    uint32_t chunkCount;
+    uint32_t committedEntities;
+    std::vector<uint32_t> entities; // ECS IDs of the committed entities, by local ID.
+};
+
+struct CellLoadJob {
+    uint16_t slot;
+};
+
+struct WorldStreamer {
+    MappedFile file;
+    WorldFileHeader header;
+    WorldCellEntry cells[MAX_WORLD_CELLS];
+    uint16_t cellSlot[MAX_WORLD_CELLS]; // UINT16_MAX when the cell isn't in a slot.
+    CellSlot slots[MAX_RESIDENT_CELLS];
+
+    LockFreeQueue<CellLoadJob, 64> loadJobs;
+    LockFreeQueue<CellLoadJob, 64> loadedCells;
+    std::counting_semaphore<> loadSignal{0};
+    std::atomic<bool> running{false};
+    std::thread worker;
+    uint32_t loadsInFlight = 0;
+
+    // Entity IDs reserved for streamed entities, unused ones below the scene's entityCount and a block right above it.
+    std::vector<uint32_t> freeEntities;
+    uint32_t firstEntity = 0; // Start of the block.
+    uint32_t blockSize = 0;
+    uint32_t entityCapacity = 0;
+    uint32_t reservedEntities = 0; // Counted when a load is queued, so loads never outrun the free list.
+
+    int32_t loadRadius = 2;   // In cells, around the camera's cell.
+    int32_t unloadRadius = 3; // Larger than loadRadius so crossing a cell border doesn't thrash.
+    uint32_t entityBudgetPerFrame = 512;
+
+    bool open = false;
+    uint32_t residentCells = 0;
+    uint32_t committedThisFrame = 0;
+    uint32_t removedThisFrame = 0;
+};
+
+// Partitions the scene's static entities (everything without a camera, input or dynamic component) into cells.
+bool saveWorld(ECS& scene, const char* path, float cellSize);
+// Removes the entities saveWorld would write, so a world saved from the open scene can be streamed back into it.
+// Their IDs go back to the scene, close the world first so streamed entities aren't among them.
+void clearWorldEntities(ECS& scene);
+bool openWorld(WorldStreamer& streamer, ECS& scene, const char* path, uint32_t entityCapacity);
+// Removes every streamed entity at once.
+void closeWorld(WorldStreamer& streamer, ECS& scene);
+void updateWorldStreaming(WorldStreamer& streamer, ECS& scene, const glm::vec3& cameraPosition);
@@ -0,0 +1,89 @@
+#include "test_common.h"
+#include "bc_encoder.h"
+#include <cmath>
+#include <vector>
+
+// Every block format encoded and decoded again, the result has to stay above a minimum PSNR over the channels it stores.
+// The image is gradients with a little noise and some hard edges, sized so the last row and column of blocks are padded.
+
+static constexpr uint32_t IMAGE_WIDTH = 130;
+static constexpr uint32_t IMAGE_HEIGHT = 66;
+
+static std::vector<uint8_t> generateImage() {
+    TestRandom random;
+    std::vector<uint8_t> rgba(IMAGE_WIDTH * IMAGE_HEIGHT * 4);
+    for (uint32_t y = 0; y < IMAGE_HEIGHT; ++y) {
+        for (uint32_t x = 0; x < IMAGE_WIDTH; ++x) {
+            float u = (float)x / (IMAGE_WIDTH - 1);
+            float v = (float)y / (IMAGE_HEIGHT - 1);
+            float edge = ((x / 16) + (y / 16)) % 2 == 0 ? 0.0f : 40.0f;
+            float texel[4] = {u * 200.0f + edge, v * 180.0f + 30.0f, (1.0f - u) * 120.0f + v * 100.0f, 255.0f - v * 200.0f};
+            for (uint32_t c = 0; c < 4; ++c) {
+                float value = texel[c] + random.range(-4.0f, 4.0f);
+                rgba[(y * IMAGE_WIDTH + x) * 4 + c] = (uint8_t)std::fmin(std::fmax(value + 0.5f, 0.0f), 255.0f);
+            }
+        }
+    }
+    return rgba;
+}
+
+// Same measure texture_cooker reports, over the first channels of every texel.
+static double computePSNR(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, uint32_t channels) {
+    double squaredError = 0.0;
+    size_t samples = 0;
+    for (size_t i = 0; i < a.size(); i += 4) {
+        for (uint32_t c = 0; c < channels; ++c) {
+            double d = (double)a[i + c] - (double)b[i + c];
+            squaredError += d * d;
+            ++samples;
+        }
+    }
+    if (squaredError == 0.0) return INFINITY;
+    return 10.0 * std::log10(255.0 * 255.0 * (double)samples / squaredError);
+}
+
+struct RoundTripCase {
+    const char* name;
+    TextureFileFormat format;
+    uint32_t channels; // BC1 drops alpha, BC5 only stores red and green.
+    double minimumPSNR;
+};
+
+int main() {
+    std::vector<uint8_t> image = generateImage();
+    const RoundTripCase cases[] = {
+        {"BC1", TextureFileFormat::BC1, 3, 36.0},
+        {"BC3", TextureFileFormat::BC3, 4, 37.0},
+        {"BC5", TextureFileFormat::BC5, 2, 48.0},
+        {"BC7", TextureFileFormat::BC7, 4, 39.0},
+    };
+
+    for (const RoundTripCase& test : cases) {
+        std::vector<uint8_t> encoded = compressImage(image.data(), IMAGE_WIDTH, IMAGE_HEIGHT, test.format);
+        CHECK(encoded.size() == textureMipSize(test.format, IMAGE_WIDTH, IMAGE_HEIGHT));
+        std::vector<uint8_t> decoded = decompressImage(encoded.data(), IMAGE_WIDTH, IMAGE_HEIGHT, test.format);
+        CHECK(decoded.size() == image.size());
+        double psnr = computePSNR(image, decoded, test.channels);
+        printf("%s: %.2f dB, minimum %.1f dB\n", test.name, psnr, test.minimumPSNR);
+        CHECK(psnr >= test.minimumPSNR);
+    }
+
+    // A block of one colour comes back within the endpoint quantization.
+    uint8_t flat[64];
+    for (uint32_t i = 0; i < 16; ++i) {
+        flat[i * 4 + 0] = 90;
+        flat[i * 4 + 1] = 160;
+        flat[i * 4 + 2] = 30;
+        flat[i * 4 + 3] = 255;
+    }
+    uint8_t block[16];
+    uint8_t texels[64];
+    encodeBC7Block(flat, block);
+    CHECK(decodeBC7Block(block, texels));
+    for (uint32_t i = 0; i < 64; ++i) CHECK(std::abs((int)texels[i] - (int)flat[i]) <= 1);
+    encodeBC1Block(flat, block);
+    decodeBC1Block(block, texels);
+    for (uint32_t i = 0; i < 64; ++i) CHECK(std::abs((int)texels[i] - (int)flat[i]) <= 4);
+
+    return testResult();
+}
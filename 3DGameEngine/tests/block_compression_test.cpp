@@ -0,0 +1,188 @@
+#include "test_common.h"
+#include "block_compression.h"
+#include "serialization.h"
+#include "entity.h"
+#include <vector>
+
+// The scene block codec on inputs picked for its edge cases: nothing, less than a match, literal and match lengths
+// that need extra length bytes, runs that copy over themselves, and streams that are cut short or tampered with.
+// Then the chunk filter that runs in front of it, forward and back.
+
+static std::vector<uint8_t> compress(const std::vector<uint8_t>& raw) {
+    std::vector<uint8_t> compressed(compressBlockBound(raw.size()));
+    size_t size = compressBlock(raw.data(), raw.size(), compressed.data(), compressed.size());
+    compressed.resize(size);
+    return compressed;
+}
+
+static bool roundTrips(const std::vector<uint8_t>& raw) {
+    std::vector<uint8_t> compressed = compress(raw);
+    if (compressed.empty()) return false;
+    std::vector<uint8_t> decoded(raw.size());
+    if (!decompressBlock(compressed.data(), compressed.size(), decoded.data(), decoded.size())) return false;
+    // The size is part of the contract, one byte more or less than was encoded has to fail.
+    std::vector<uint8_t> longer(raw.size() + 1);
+    if (decompressBlock(compressed.data(), compressed.size(), longer.data(), longer.size())) return false;
+    if (!raw.empty() && decompressBlock(compressed.data(), compressed.size(), decoded.data(), raw.size() - 1)) return false;
+    return decoded == raw;
+}
+
+static std::vector<uint8_t> randomBytes(TestRandom& random, size_t size) {
+    std::vector<uint8_t> bytes(size);
+    for (uint8_t& byte : bytes) byte = (uint8_t)random.next();
+    return bytes;
+}
+
+int main() {
+    TestRandom random;
+
+    // Empty and shorter than the smallest match: a lone token with literals.
+    CHECK(roundTrips({}));
+    CHECK(compress({}).size() == 1);
+    for (size_t size = 1; size < 4; ++size) CHECK(roundTrips(randomBytes(random, size)));
+
+    // Literal runs around the 15 and 15 + 255 steps of the length encoding.
+    const size_t literalSizes[] = {14, 15, 16, 269, 270, 271, 525, 5000};
+    for (size_t size : literalSizes) CHECK(roundTrips(randomBytes(random, size)));
+
+    // Matches of the same lengths, a random block repeated once after some literals.
+    const size_t matchSizes[] = {4, 18, 19, 20, 273, 274, 275, 1000};
+    for (size_t size : matchSizes) {
+        std::vector<uint8_t> raw = randomBytes(random, 300);
+        std::vector<uint8_t> repeated = randomBytes(random, size);
+        raw.insert(raw.end(), repeated.begin(), repeated.end());
+        raw.insert(raw.end(), repeated.begin(), repeated.end());
+        std::vector<uint8_t> tail = randomBytes(random, 7);
+        raw.insert(raw.end(), tail.begin(), tail.end());
+        CHECK(roundTrips(raw));
+    }
+
+    // A byte repeated is one literal and an offset 1 match that reads what it writes, short periods the same.
+    std::vector<uint8_t> run(4096, 0x5A);
+    CHECK(roundTrips(run));
+    CHECK(compress(run).size() < 32);
+    for (uint32_t period = 2; period <= 5; ++period) {
+        std::vector<uint8_t> pattern = randomBytes(random, period);
+        std::vector<uint8_t> raw;
+        for (uint32_t i = 0; i < 1000; ++i) raw.push_back(pattern[i % period]);
+        CHECK(roundTrips(raw));
+    }
+
+    // Random data mixed with runs and repeats, the way component arrays look.
+    for (uint32_t trial = 0; trial < 50; ++trial) {
+        std::vector<uint8_t> raw;
+        while (raw.size() < 20000) {
+            uint32_t kind = random.next() % 3;
+            size_t length = 1 + random.next() % 600;
+            if (kind == 0 || raw.size() < 8) {
+                std::vector<uint8_t> literals = randomBytes(random, length);
+                raw.insert(raw.end(), literals.begin(), literals.end());
+            } else if (kind == 1) {
+                raw.insert(raw.end(), length, (uint8_t)random.next());
+            } else {
+                size_t offset = 1 + random.next() % std::min<size_t>(raw.size(), 65535);
+                for (size_t i = 0; i < length; ++i) raw.push_back(raw[raw.size() - offset]);
+            }
+        }
+        CHECK(roundTrips(raw));
+    }
+
+    // Too little room to write into gives 0 rather than a partial block.
+    std::vector<uint8_t> incompressible = randomBytes(random, 1000);
+    std::vector<uint8_t> small(500);
+    CHECK(compressBlock(incompressible.data(), incompressible.size(), small.data(), small.size()) == 0);
+
+    // Corrupted streams fail instead of reading or writing out of bounds.
+    std::vector<uint8_t> raw = run;
+    std::vector<uint8_t> extra = randomBytes(random, 700);
+    raw.insert(raw.end(), extra.begin(), extra.end());
+    std::vector<uint8_t> compressed = compress(raw);
+    std::vector<uint8_t> decoded(raw.size());
+    for (size_t cut = 1; cut < compressed.size(); cut += 7) {
+        CHECK(!decompressBlock(compressed.data(), compressed.size() - cut, decoded.data(), decoded.size()));
+    }
+    // The first sequence is one literal then the offset 1 match, its offset bytes follow the token and the literal.
+    std::vector<uint8_t> zeroOffset = compressed;
+    zeroOffset[2] = 0;
+    zeroOffset[3] = 0;
+    CHECK(!decompressBlock(zeroOffset.data(), zeroOffset.size(), decoded.data(), decoded.size()));
+    std::vector<uint8_t> farOffset = compressed;
+    farOffset[2] = 2;
+    CHECK(!decompressBlock(farOffset.data(), farOffset.size(), decoded.data(), decoded.size()));
+    const uint8_t literalsPastEnd[] = {0xF0, 255, 255, 1, 2, 3};
+    CHECK(!decompressBlock(literalsPastEnd, sizeof(literalsPastEnd), decoded.data(), decoded.size()));
+    const uint8_t unterminatedLength[] = {0xF0, 255};
+    CHECK(!decompressBlock(unterminatedLength, sizeof(unterminatedLength), decoded.data(), decoded.size()));
+    // Random damage may still decode by chance, it just must never run outside either buffer.
+    for (uint32_t trial = 0; trial < 2000; ++trial) {
+        std::vector<uint8_t> damaged = compressed;
+        for (uint32_t flips = 0; flips < 3; ++flips) damaged[random.next() % damaged.size()] ^= (uint8_t)(1 + random.next() % 255);
+        decompressBlock(damaged.data(), damaged.size(), decoded.data(), decoded.size());
+    }
+
+    // The chunk filter: sorted entity IDs and transform components, filtered, compressed, decoded and unfiltered.
+    const uint32_t counts[] = {0, 1, 2, 777};
+    for (uint32_t count : counts) {
+        std::vector<uint32_t> entities(count);
+        std::vector<TransformComponent> transforms(count);
+        uint32_t entity = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            entity += 1 + random.next() % 4;
+            entities[i] = entity;
+            transforms[i].position = glm::vec3(random.range(-100.0f, 100.0f), 0.0f, (float)i);
+            transforms[i].scale = glm::vec3(1.0f);
+        }
+        FILE* f = tmpfile();
+        CHECK(f != nullptr);
+        if (!f) break;
+        writeChunkData(f, SceneChunkID::Transform, 1, entities.data(), transforms.data(), count);
+        std::vector<uint8_t> chunk((size_t)ftell(f));
+        rewind(f);
+        CHECK(fread(chunk.data(), 1, chunk.size(), f) == chunk.size());
+        fclose(f);
+
+        std::vector<uint8_t> scratch;
+        std::vector<uint8_t> filtered = chunk;
+        CHECK(filterChunk(filtered.data(), filtered.size(), true, scratch));
+        CHECK(count < 2 || filtered != chunk);
+        std::vector<uint8_t> packed = compress(filtered);
+        std::vector<uint8_t> unpacked(filtered.size());
+        CHECK(decompressBlock(packed.data(), packed.size(), unpacked.data(), unpacked.size()));
+        CHECK(filterChunk(unpacked.data(), unpacked.size(), false, scratch));
+        CHECK(unpacked == chunk);
+    }
+
+    // Components that aren't whole words only get their entity IDs filtered.
+    struct Packed {
+        uint8_t bytes[6];
+    };
+    const uint32_t packedEntities[3] = {3, 9, 10};
+    const Packed packed[3] = {{{1, 2, 3, 4, 5, 6}}, {{7, 8, 9, 10, 11, 12}}, {{13, 14, 15, 16, 17, 18}}};
+    FILE* f = tmpfile();
+    CHECK(f != nullptr);
+    if (f) {
+        writeChunkData(f, SceneChunkID::Health, 1, packedEntities, packed, 3);
+        std::vector<uint8_t> chunk((size_t)ftell(f));
+        rewind(f);
+        CHECK(fread(chunk.data(), 1, chunk.size(), f) == chunk.size());
+        fclose(f);
+        std::vector<uint8_t> scratch;
+        std::vector<uint8_t> filtered = chunk;
+        CHECK(filterChunk(filtered.data(), filtered.size(), true, scratch));
+        SceneChunkHeader header;
+        memcpy(&header, filtered.data(), sizeof(header));
+        uint32_t deltas[3];
+        memcpy(deltas, filtered.data() + header.entitiesOffset, sizeof(deltas));
+        CHECK(deltas[0] == 3 && deltas[1] == 6 && deltas[2] == 1);
+        CHECK(memcmp(filtered.data() + header.componentsOffset, packed, sizeof(packed)) == 0);
+        CHECK(filterChunk(filtered.data(), filtered.size(), false, scratch));
+        CHECK(filtered == chunk);
+
+        // A header whose arrays don't fit the chunk is refused before anything is touched.
+        std::vector<uint8_t> truncated(chunk.begin(), chunk.begin() + header.componentsOffset);
+        CHECK(!filterChunk(truncated.data(), truncated.size(), true, scratch));
+        CHECK(!filterChunk(chunk.data(), sizeof(SceneChunkHeader) - 1, true, scratch));
+    }
+
+    return testResult();
+}
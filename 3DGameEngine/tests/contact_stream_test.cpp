@@ -0,0 +1,112 @@
+#include "test_common.h"
+#include "test_scene.h"
+#include "collision_system.h"
+
+// Contact states out of the narrowphase over several frames: a pair enters once, stays with the impulse the solver
+// left it, and exits exactly once when it stops touching. A sleeping body's pairs are kept without an exit, and
+// without a contact findContact would return.
+
+static constexpr float DELTA_TIME = 1.0f / 60.0f;
+
+static uint32_t addBox(ECS& scene, glm::vec3 position, glm::vec3 halfSize, bool dynamic) {
+    uint32_t entity = createEntity(scene);
+    TransformComponent transform;
+    transform.position = position;
+    scene.transformSet.add(entity, transform);
+    scene.collisionSet.add(entity, CollisionComponent{-halfSize.x, halfSize.x, -halfSize.y, halfSize.y, -halfSize.z, halfSize.z});
+    if (dynamic) {
+        scene.dynamicSet.add(entity, DynamicTag{});
+        scene.velocitySet.add(entity, VelocityComponent{glm::vec3(0.0f)});
+    }
+    return entity;
+}
+
+static void narrowphase(ECS& scene) {
+    collisionSystem(scene.collisionSet, scene.transformSet, scene.dynamicSet, scene.velocitySet, DELTA_TIME, scene.bodySleep,
+                    scene.contacts);
+}
+
+static const Contact* contactBetween(const ContactStream& contacts, uint32_t entity, uint32_t other) {
+    for (uint32_t i = 0; i < contacts.count; ++i) {
+        if (contacts.contacts[i].entity == entity && contacts.contacts[i].other == other) return &contacts.contacts[i];
+    }
+    return nullptr;
+}
+
+int main() {
+    static ECS scene;
+    initSceneSets(scene);
+    uint32_t floor = addBox(scene, glm::vec3(0.0f), glm::vec3(5.0f, 0.5f, 5.0f), false);
+    uint32_t box = addBox(scene, glm::vec3(0.0f, 0.95f, 0.0f), glm::vec3(0.5f), true);
+
+    // Enter on the first frame, then Stay, each frame starting from the impulse cached on the one before.
+    narrowphase(scene);
+    CHECK(scene.contacts.count == 1);
+    CHECK(scene.contacts.enterCount == 1 && scene.contacts.exitCount == 0);
+    const Contact* contact = contactBetween(scene.contacts, box, floor);
+    CHECK(contact && contact->state == ContactState::Enter && contact->impulse == 0.0f);
+    CHECK(contact && contact->normal == glm::vec3(0.0f, 1.0f, 0.0f) && std::abs(contact->depth - 0.05f) < 1e-5f);
+    for (uint32_t frame = 1; frame <= 5; ++frame) {
+        scene.contacts.contacts[0].impulse = (float)frame;
+        cacheContactImpulses(scene.contacts);
+        narrowphase(scene);
+        contact = contactBetween(scene.contacts, box, floor);
+        CHECK(scene.contacts.count == 1 && scene.contacts.enterCount == 0 && scene.contacts.exitCount == 0);
+        CHECK(contact && contact->state == ContactState::Stay && contact->impulse == (float)frame);
+    }
+
+    // Lifted off, one Exit and then nothing.
+    scene.transformSet.getComponent(box).position.y = 3.0f;
+    narrowphase(scene);
+    CHECK(scene.contacts.count == 1 && scene.contacts.exitCount == 1 && scene.contacts.enterCount == 0);
+    contact = contactBetween(scene.contacts, box, floor);
+    CHECK(contact && contact->state == ContactState::Exit && contact->normal == glm::vec3(0.0f));
+    for (uint32_t frame = 0; frame < 3; ++frame) {
+        narrowphase(scene);
+        CHECK(scene.contacts.count == 0 && scene.contacts.exitCount == 0);
+    }
+
+    // Back down is a new contact that starts from nothing.
+    scene.transformSet.getComponent(box).position.y = 0.95f;
+    narrowphase(scene);
+    contact = contactBetween(scene.contacts, box, floor);
+    CHECK(contact && contact->state == ContactState::Enter && contact->impulse == 0.0f);
+
+    // Two bodies see each other from both sides, each side is its own pair and exits once.
+    uint32_t neighbour = addBox(scene, glm::vec3(0.95f, 0.95f, 0.0f), glm::vec3(0.5f), true);
+    narrowphase(scene);
+    CHECK(scene.contacts.enterCount == 3);
+    CHECK(contactBetween(scene.contacts, box, neighbour) && contactBetween(scene.contacts, neighbour, box));
+    CHECK(findContact(scene.contacts, box, neighbour) == contactBetween(scene.contacts, box, neighbour));
+    narrowphase(scene);
+    CHECK(scene.contacts.count == 4 && scene.contacts.enterCount == 0);
+    scene.transformSet.getComponent(neighbour).position.x = 3.0f;
+    narrowphase(scene);
+    CHECK(scene.contacts.exitCount == 2);
+    CHECK(contactBetween(scene.contacts, box, neighbour)->state == ContactState::Exit);
+    CHECK(contactBetween(scene.contacts, neighbour, box)->state == ContactState::Exit);
+    CHECK(contactBetween(scene.contacts, box, floor)->state == ContactState::Stay);
+    CHECK(findContact(scene.contacts, box, neighbour) == nullptr);
+    narrowphase(scene);
+    CHECK(scene.contacts.exitCount == 0);
+
+    // A sleeping body isn't tested, its pair is kept without an Exit and carries on as Stay once it wakes.
+    scene.contacts.contacts[0].impulse = 2.5f;
+    cacheContactImpulses(scene.contacts);
+    scene.bodySleep.asleep[box] = true;
+    scene.bodySleep.sleepingCount = 1;
+    for (uint32_t frame = 0; frame < 3; ++frame) {
+        narrowphase(scene);
+        CHECK(contactBetween(scene.contacts, box, floor) == nullptr);
+        CHECK(findContact(scene.contacts, box, floor) == nullptr);
+        CHECK(scene.contacts.exitCount == 0);
+    }
+    resetBody(scene.bodySleep, box);
+    narrowphase(scene);
+    contact = contactBetween(scene.contacts, box, floor);
+    CHECK(contact && contact->state == ContactState::Stay && contact->impulse == 2.5f);
+
+    freeContactStream(scene.contacts);
+    free(scene.arena.base);
+    return testResult();
+}
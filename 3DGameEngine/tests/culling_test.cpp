@@ -0,0 +1,91 @@
+#include "test_common.h"
+#include "render_system.h"
+#include "camera.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cstring>
+
+// The batched culling kernels against the scalar reference implementations, over random scenes around a camera.
+
+static constexpr uint32_t SCENE_COUNT = 20;
+
+static void buildCamera(TestRandom& random, CameraComponent& camera) {
+    glm::vec3 eye(random.range(-20.0f, 20.0f), random.range(-5.0f, 5.0f), random.range(-20.0f, 20.0f));
+    glm::vec3 target(random.range(-20.0f, 20.0f), random.range(-5.0f, 5.0f), random.range(-20.0f, 20.0f));
+    camera.projectionMatrix = glm::perspective(glm::radians(random.range(30.0f, 90.0f)), random.range(0.5f, 2.5f), 0.1f, random.range(20.0f, 80.0f));
+    camera.viewMatrix = glm::lookAt(eye, target + glm::vec3(0.01f), glm::vec3(0.0f, 1.0f, 0.0f));
+    updateViewProjectionMatrix(camera);
+}
+
+static glm::quat randomRotation(TestRandom& random) {
+    return glm::normalize(glm::quat(random.range(-1.0f, 1.0f), random.range(-1.0f, 1.0f), random.range(-1.0f, 1.0f), random.range(-1.0f, 1.0f)));
+}
+
+int main() {
+    Arena arena;
+    arena.init(ARENA_SIZE);
+    SparseSet<TransformComponent> transformSet;
+    SparseSet<MeshData> meshSet;
+    SparseSet<RenderableTag> renderableSet;
+    SparseSet<PointLightComponent> pointLightSet;
+    transformSet.init(arena, CAPACITY_TRANSFORM);
+    meshSet.init(arena, CAPACITY_MESH);
+    renderableSet.init(arena, CAPACITY_RENDERABLE);
+    pointLightSet.init(arena, CAPACITY_POINT_LIGHT);
+
+    static WorldBoundsBuffer worldBounds;
+    static PointLightBoundsBuffer pointLightBounds;
+    static VisibleEntityBuffer batched, reference;
+    static VisiblePointLightBuffer batchedLights, referenceLights;
+
+    TestRandom random;
+    uint32_t totalVisible = 0;
+    for (uint32_t scene = 0; scene < SCENE_COUNT; ++scene) {
+        transformSet.entityCount = meshSet.entityCount = renderableSet.entityCount = pointLightSet.entityCount = 0;
+        memset(transformSet.sparse, 0xFF, MAX_ENTITIES * sizeof(uint32_t));
+        memset(meshSet.sparse, 0xFF, MAX_ENTITIES * sizeof(uint32_t));
+        memset(renderableSet.sparse, 0xFF, MAX_ENTITIES * sizeof(uint32_t));
+        memset(pointLightSet.sparse, 0xFF, MAX_ENTITIES * sizeof(uint32_t));
+
+        // Every count modulo the batch size shows up, so the tail masks get covered.
+        uint32_t entityCount = 1 + random.next() % (MAX_ENTITIES - 1);
+        for (uint32_t entity = 0; entity < entityCount; ++entity) {
+            TransformComponent transform;
+            transform.position = glm::vec3(random.range(-60.0f, 60.0f), random.range(-20.0f, 20.0f), random.range(-60.0f, 60.0f));
+            transform.scale = glm::vec3(random.range(0.1f, 4.0f), random.range(0.1f, 4.0f), random.range(0.1f, 4.0f));
+            transform.rotation = randomRotation(random);
+            MeshData mesh = {};
+            mesh.localAABB = AABB{random.range(-2.0f, 0.0f), random.range(-2.0f, 0.0f), random.range(-2.0f, 0.0f),
+                                  random.range(0.0f, 2.0f), random.range(0.0f, 2.0f), random.range(0.0f, 2.0f)};
+            transformSet.add(entity, transform);
+            meshSet.add(entity, mesh);
+            // Not everything is renderable, so the dense orders of the sets differ.
+            if (random.next() % 8 != 0) renderableSet.add(entity, RenderableTag{});
+            if (entity % 23 == 0 && pointLightSet.entityCount < VisiblePointLightBuffer::capacity) {
+                pointLightSet.add(entity, PointLightComponent{glm::vec3(1.0f), 1.0f, random.range(0.5f, 15.0f)});
+            }
+        }
+
+        CameraComponent camera = {};
+        buildCamera(random, camera);
+
+        updateWorldBounds(renderableSet, transformSet, meshSet, worldBounds);
+        performFrustumCulling(worldBounds, batched, camera.frustumPlanes);
+        performFrustumCullingScalar(renderableSet, transformSet, meshSet, reference, camera.frustumPlanes);
+        CHECK(batched.size == reference.size);
+        CHECK(memcmp(batched.buffer, reference.buffer, std::min(batched.size, reference.size) * sizeof(uint32_t)) == 0);
+        totalVisible += reference.size;
+
+        performLightCulling(pointLightSet, transformSet, pointLightBounds, batchedLights, camera.frustumPlanes);
+        performLightCullingScalar(pointLightSet, transformSet, referenceLights, camera.frustumPlanes);
+        CHECK(batchedLights.size == referenceLights.size);
+        for (uint32_t i = 0; i < std::min(batchedLights.size, referenceLights.size); ++i) {
+            CHECK(batchedLights.buffer[i].positionAndRadius == referenceLights.buffer[i].positionAndRadius);
+            CHECK(batchedLights.buffer[i].colourAndIntensity == referenceLights.buffer[i].colourAndIntensity);
+        }
+    }
+    // Random cameras that see nothing every time wouldn't test much.
+    CHECK(totalVisible > 0);
+    printf("%u scenes, %u visible entities in total\n", SCENE_COUNT, totalVisible);
+    return testResult();
+}
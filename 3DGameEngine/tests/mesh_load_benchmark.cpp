@@ -0,0 +1,126 @@
+#include "test_common.h"
+#include "mesh_file.h"
+#include "asset_pack.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Loads a generated 1M triangle .mesh through the mapping the engine uses and through the fread path it replaced.
+// Both end with the copy glBufferData makes, into a plain buffer here, so the runs differ only in how bytes reach it.
+// The file was just written, so both read from the page cache.
+
+static constexpr const char* MESH_PATH = "mesh_load_benchmark.mesh";
+static constexpr uint32_t GRID_VERTICES = 709; // 2 * 708 * 708 = 1,002,528 triangles.
+static constexpr uint32_t RUN_COUNT = 10;
+
+static bool writeGridMesh(const char* path, MeshFileHeader& header) {
+    std::vector<float> vertices;
+    vertices.reserve(GRID_VERTICES * GRID_VERTICES * 8);
+    for (uint32_t z = 0; z < GRID_VERTICES; ++z) {
+        for (uint32_t x = 0; x < GRID_VERTICES; ++x) {
+            float u = (float)x / (GRID_VERTICES - 1);
+            float v = (float)z / (GRID_VERTICES - 1);
+            float vertex[8] = {u * 100.0f, 0.0f, v * 100.0f, 0.0f, 1.0f, 0.0f, u, v};
+            vertices.insert(vertices.end(), vertex, vertex + 8);
+        }
+    }
+    std::vector<uint32_t> indices;
+    indices.reserve((GRID_VERTICES - 1) * (GRID_VERTICES - 1) * 6);
+    for (uint32_t z = 0; z + 1 < GRID_VERTICES; ++z) {
+        for (uint32_t x = 0; x + 1 < GRID_VERTICES; ++x) {
+            uint32_t corner = z * GRID_VERTICES + x;
+            uint32_t quad[6] = {corner, corner + GRID_VERTICES, corner + 1, corner + 1, corner + GRID_VERTICES, corner + GRID_VERTICES + 1};
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+
+    header = {};
+    header.magic = MESH_FILE_MAGIC;
+    header.version = MESH_FILE_VERSION;
+    header.vertexCount = GRID_VERTICES * GRID_VERTICES;
+    header.indexCount = (uint32_t)indices.size();
+    header.localAABB = AABB{0.0f, 0.0f, 0.0f, 100.0f, 0.0f, 100.0f};
+    header.lodCount = 1;
+    header.lods[0] = MeshLOD{0, header.indexCount, 0.0f};
+    header.vertexFormat = MeshVertexFormat::Float;
+    header.indexSize = sizeof(uint32_t);
+    header.meshletCount = 0;
+
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    bool written = fwrite(&header, sizeof(MeshFileHeader), 1, f) == 1 &&
+                   fwrite(vertices.data(), sizeof(float), vertices.size(), f) == vertices.size() &&
+                   fwrite(indices.data(), sizeof(uint32_t), indices.size(), f) == indices.size();
+    fclose(f);
+    return written;
+}
+
+// What loadBinaryMesh does up to the upload, straight out of the mapping.
+static bool loadMapped(const char* path, std::vector<uint8_t>& vertexUpload, std::vector<uint8_t>& indexUpload) {
+    AssetView file;
+    if (!openAsset(path, file)) return false;
+    MeshFileHeader header;
+    size_t vertexOffset = 0;
+    bool valid = readMeshFileHeader(file, header, vertexOffset);
+    if (valid) {
+        size_t vertexBytes = header.vertexCount * sizeof(float) * 8;
+        size_t indexBytes = header.indexCount * header.indexSize;
+        memcpy(vertexUpload.data(), file.data + vertexOffset, vertexBytes);
+        memcpy(indexUpload.data(), file.data + vertexOffset + vertexBytes, indexBytes);
+    }
+    closeAsset(file);
+    return valid;
+}
+
+// The loader before the mapping: the header and both arrays read into heap vectors, then uploaded from there.
+static bool loadWithFread(const char* path, std::vector<uint8_t>& vertexUpload, std::vector<uint8_t>& indexUpload) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    MeshFileHeader header = {};
+    bool valid = fread(&header, sizeof(MeshFileHeader), 1, f) == 1 && header.magic == MESH_FILE_MAGIC;
+    if (valid) {
+        std::vector<uint8_t> vertices(header.vertexCount * sizeof(float) * 8);
+        std::vector<uint8_t> indices(header.indexCount * header.indexSize);
+        valid = fread(vertices.data(), 1, vertices.size(), f) == vertices.size() && fread(indices.data(), 1, indices.size(), f) == indices.size();
+        memcpy(vertexUpload.data(), vertices.data(), vertices.size());
+        memcpy(indexUpload.data(), indices.data(), indices.size());
+    }
+    fclose(f);
+    return valid;
+}
+
+int main() {
+    MeshFileHeader header;
+    if (!writeGridMesh(MESH_PATH, header)) {
+        printf("Couldn't write %s\n", MESH_PATH);
+        return 1;
+    }
+    std::vector<uint8_t> mappedVertices(header.vertexCount * sizeof(float) * 8), mappedIndices(header.indexCount * sizeof(uint32_t));
+    std::vector<uint8_t> freadVertices(mappedVertices.size()), freadIndices(mappedIndices.size());
+
+    // Interleaved so neither path always runs on a warmer cache.
+    double mappedBest = 1e9, freadBest = 1e9, mappedTotal = 0.0, freadTotal = 0.0;
+    for (uint32_t run = 0; run < RUN_COUNT; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        CHECK(loadMapped(MESH_PATH, mappedVertices, mappedIndices));
+        double mapped = millisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        CHECK(loadWithFread(MESH_PATH, freadVertices, freadIndices));
+        double read = millisecondsSince(start);
+
+        mappedBest = std::min(mappedBest, mapped);
+        freadBest = std::min(freadBest, read);
+        mappedTotal += mapped;
+        freadTotal += read;
+    }
+    CHECK(mappedVertices == freadVertices);
+    CHECK(mappedIndices == freadIndices);
+    remove(MESH_PATH);
+
+    printf("%u triangles, %.1f MB\n", header.indexCount / 3, (mappedVertices.size() + mappedIndices.size()) / (1024.0 * 1024.0));
+    printf("mmap  best %.2f ms, mean %.2f ms\n", mappedBest, mappedTotal / RUN_COUNT);
+    printf("fread best %.2f ms, mean %.2f ms\n", freadBest, freadTotal / RUN_COUNT);
+    return testResult();
+}
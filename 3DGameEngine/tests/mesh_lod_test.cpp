@@ -0,0 +1,163 @@
+#include "test_common.h"
+#include "mesh_simplify.h"
+#include "render_system.h"
+#include "asset_manager.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// The converter's simplifier on generated grids, then the runtime picking a LOD from the errors it reports.
+// A flat grid has to simplify without error or losing area, a rolling one has to stay within the error it reports.
+
+static constexpr uint32_t GRID_VERTICES = 33; // 2 * 32 * 32 = 2048 triangles over 32 x 32 units.
+static constexpr float HILL_HEIGHT = 0.5f;
+
+static void generateGrid(float hillHeight, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    vertices.clear();
+    indices.clear();
+    for (uint32_t z = 0; z < GRID_VERTICES; ++z) {
+        for (uint32_t x = 0; x < GRID_VERTICES; ++x) {
+            float height = hillHeight * std::sin((float)x * 0.2f) * std::cos((float)z * 0.15f);
+            vertices.push_back(Vertex{(float)x, height, (float)z, 0.0f, 1.0f, 0.0f, (float)x / (GRID_VERTICES - 1), (float)z / (GRID_VERTICES - 1)});
+        }
+    }
+    for (uint32_t z = 0; z + 1 < GRID_VERTICES; ++z) {
+        for (uint32_t x = 0; x + 1 < GRID_VERTICES; ++x) {
+            uint32_t corner = z * GRID_VERTICES + x;
+            uint32_t quad[6] = {corner, corner + GRID_VERTICES, corner + 1, corner + 1, corner + GRID_VERTICES, corner + GRID_VERTICES + 1};
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+// Area of the triangles projected onto the grid plane, the simplified grid still has to cover all of it once.
+static float projectedArea(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+    float area = 0.0f;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const Vertex& a = vertices[indices[i]];
+        const Vertex& b = vertices[indices[i + 1]];
+        const Vertex& c = vertices[indices[i + 2]];
+        area += std::abs((b.px - a.px) * (c.pz - a.pz) - (b.pz - a.pz) * (c.px - a.px)) * 0.5f;
+    }
+    return area;
+}
+
+// Largest vertical distance from an original vertex to the simplified surface above or below it.
+static float maxHeightDeviation(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& simplified) {
+    float deviation = 0.0f;
+    for (const Vertex& point : vertices) {
+        float closest = INFINITY;
+        for (size_t i = 0; i < simplified.size(); i += 3) {
+            const Vertex& a = vertices[simplified[i]];
+            const Vertex& b = vertices[simplified[i + 1]];
+            const Vertex& c = vertices[simplified[i + 2]];
+            float area = (b.px - a.px) * (c.pz - a.pz) - (b.pz - a.pz) * (c.px - a.px);
+            float wb = ((point.px - a.px) * (c.pz - a.pz) - (point.pz - a.pz) * (c.px - a.px)) / area;
+            float wc = ((b.px - a.px) * (point.pz - a.pz) - (b.pz - a.pz) * (point.px - a.px)) / area;
+            if (wb < -1e-4f || wc < -1e-4f || wb + wc > 1.0f + 1e-4f) continue;
+            float height = a.py + wb * (b.py - a.py) + wc * (c.py - a.py);
+            closest = std::min(closest, std::abs(height - point.py));
+        }
+        deviation = std::max(deviation, closest);
+    }
+    return deviation;
+}
+
+static bool isValidIndexList(const std::vector<uint32_t>& indices, size_t vertexCount) {
+    if (indices.size() % 3 != 0) return false;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount) return false;
+        if (indices[i] == indices[i + 1] || indices[i + 1] == indices[i + 2] || indices[i] == indices[i + 2]) return false;
+    }
+    return true;
+}
+
+int main() {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    const float gridArea = (float)((GRID_VERTICES - 1) * (GRID_VERTICES - 1));
+
+    // Flat: every interior vertex can go without any error, only the locked border limits how far it gets.
+    generateGrid(0.0f, vertices, indices);
+    float flatError = 1.0f;
+    std::vector<uint32_t> flat = simplifyMesh(vertices, indices, indices.size() / 8 / 3 * 3, flatError);
+    CHECK(isValidIndexList(flat, vertices.size()));
+    CHECK(!flat.empty() && flat.size() <= indices.size() / 8);
+    CHECK(flatError < 1e-4f);
+    CHECK(std::abs(projectedArea(vertices, flat) - gridArea) < 1e-2f);
+
+    // Rolling hills: halving the triangle count each step like the converter does, the reported error only grows,
+    // no original vertex ends up further from the surface than it, and the grid stays covered exactly once.
+    // Down to an eighth, below that the 128 locked border vertices leave only collapses far off the surface.
+    generateGrid(HILL_HEIGHT, vertices, indices);
+    float previousError = 0.0f;
+    for (uint32_t lod = 1; lod <= 3; ++lod) {
+        size_t target = (indices.size() >> lod) / 3 * 3;
+        float error = 0.0f;
+        std::vector<uint32_t> simplified = simplifyMesh(vertices, indices, target, error);
+        float deviation = maxHeightDeviation(vertices, simplified);
+        printf("LOD %u: %zu triangles, error %.4f, deviation %.4f, area %.4f\n", lod, simplified.size() / 3, error, deviation, projectedArea(vertices, simplified));
+        CHECK(isValidIndexList(simplified, vertices.size()));
+        CHECK(!simplified.empty() && simplified.size() <= target);
+        CHECK(error >= previousError);
+        CHECK(error <= 2.0f * HILL_HEIGHT);
+        CHECK(deviation <= error + 1e-4f);
+        CHECK(std::abs(projectedArea(vertices, simplified) - gridArea) < 1e-2f);
+        previousError = error;
+    }
+    CHECK(previousError > 0.0f);
+
+    // selectMeshLODs keeps the coarsest LOD whose error projects to at most pixelThreshold pixels.
+    Arena arena;
+    arena.init(ARENA_SIZE);
+    SparseSet<MeshData> meshSet;
+    SparseSet<TransformComponent> transformSet;
+    meshSet.init(arena, CAPACITY_MESH);
+    transformSet.init(arena, CAPACITY_TRANSFORM);
+    static MeshBuffer meshBuffer;
+    meshBuffer.lodCounts[0] = 3;
+    meshBuffer.lods[0][0] = MeshLOD{0, 6144, 0.0f};
+    meshBuffer.lods[0][1] = MeshLOD{6144, 3072, 0.01f};
+    meshBuffer.lods[0][2] = MeshLOD{9216, 1536, 0.1f};
+    meshBuffer.size = 1;
+
+    CameraComponent camera = {};
+    camera.position = glm::vec3(0.0f);
+    camera.projectionMatrix = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    const uint32_t screenHeight = 1080;
+    // Pixels per world unit at distance 1, and the bounding sphere radius of the unit cube the distances start from.
+    const float projectionScale = 0.5f * screenHeight / std::tan(glm::radians(30.0f));
+    const float radius = std::sqrt(0.75f);
+
+    // Beyond the sphere distance where a LOD's error reaches one pixel, that LOD is allowed.
+    const float lod1Distance = 0.01f * projectionScale;
+    const float lod2Distance = 0.1f * projectionScale;
+    const float distances[6] = {0.0f, lod1Distance * 0.9f, lod1Distance * 1.1f, lod2Distance * 0.9f, lod2Distance * 1.1f, lod1Distance * 1.1f};
+    const float scales[6] = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 2.0f};
+    const uint8_t expected[6] = {0, 0, 1, 1, 2, 0}; // Twice the size doubles the projected error.
+    static VisibleEntityBuffer visible;
+    for (uint32_t entity = 0; entity < 6; ++entity) {
+        MeshData mesh = {};
+        mesh.localAABB = AABB{-0.5f, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f};
+        TransformComponent transform;
+        transform.scale = glm::vec3(scales[entity]);
+        transform.position = glm::vec3(0.0f, 0.0f, -(distances[entity] + radius * scales[entity]));
+        meshSet.add(entity, mesh);
+        transformSet.add(entity, transform);
+        visible.buffer[visible.size++] = entity;
+    }
+
+    static MeshLODSelection lodSelection;
+    selectMeshLODs(visible, meshSet, transformSet, meshBuffer, camera, screenHeight, lodSelection);
+    for (uint32_t entity = 0; entity < 6; ++entity) CHECK(lodSelection.lod[entity] == expected[entity]);
+    CHECK(lodSelection.lodHistogram[0] == 3 && lodSelection.lodHistogram[1] == 2 && lodSelection.lodHistogram[2] == 1);
+
+    // A looser threshold lets the same entities drop further.
+    lodSelection.pixelThreshold = 10.0f;
+    selectMeshLODs(visible, meshSet, transformSet, meshBuffer, camera, screenHeight, lodSelection);
+    CHECK(lodSelection.lod[2] == 2 && lodSelection.lod[5] == 1);
+
+    free(arena.base);
+    return testResult();
+}
@@ -0,0 +1,160 @@
+#include "test_common.h"
+#include "occlusion_culling.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <vector>
+
+// The CPU mirror of occlusion_cull.comp: projection, mip selection and the Hi-Z depth test, plus the readback bookkeeping.
+
+static constexpr uint32_t HIZ_WIDTH = 256;
+static constexpr uint32_t HIZ_HEIGHT = 128;
+
+struct TestHiZ {
+    std::vector<std::vector<float>> levels;
+    std::vector<const float*> pointers;
+    uint32_t mipCount;
+};
+
+// Same reduction as hiz_downsample.comp, every level a 2x2 max of the previous one with the edge clamped.
+static void buildTestHiZ(TestHiZ& hiZ, const std::vector<float>& depth) {
+    hiZ.mipCount = (uint32_t)std::bit_width(std::max(HIZ_WIDTH, HIZ_HEIGHT));
+    hiZ.levels.assign(1, depth);
+    for (uint32_t level = 1; level < hiZ.mipCount; ++level) {
+        uint32_t sourceWidth = std::max(HIZ_WIDTH >> (level - 1), 1u);
+        uint32_t sourceHeight = std::max(HIZ_HEIGHT >> (level - 1), 1u);
+        uint32_t width = std::max(HIZ_WIDTH >> level, 1u);
+        uint32_t height = std::max(HIZ_HEIGHT >> level, 1u);
+        const std::vector<float>& source = hiZ.levels.back();
+        std::vector<float> destination(width * height);
+        for (uint32_t y = 0; y < height; ++y) {
+            for (uint32_t x = 0; x < width; ++x) {
+                float maxDepth = 0.0f;
+                for (uint32_t i = 0; i < 4; ++i) {
+                    uint32_t sx = std::min(x * 2 + (i & 1), sourceWidth - 1);
+                    uint32_t sy = std::min(y * 2 + (i >> 1), sourceHeight - 1);
+                    maxDepth = std::max(maxDepth, source[sy * sourceWidth + sx]);
+                }
+                destination[y * width + x] = maxDepth;
+            }
+        }
+        hiZ.levels.push_back(std::move(destination));
+    }
+    hiZ.pointers.clear();
+    for (const std::vector<float>& level : hiZ.levels) hiZ.pointers.push_back(level.data());
+}
+
+static float depthAt(const glm::mat4& viewProjection, const glm::vec3& point) {
+    glm::vec4 clip = viewProjection * glm::vec4(point, 1.0f);
+    return clip.z / clip.w * 0.5f + 0.5f;
+}
+
+static bool isVisible(const TestHiZ& hiZ, const glm::mat4& viewProjection, const glm::vec3& center, const glm::vec3& extent) {
+    ScreenRect rect = projectAABBToScreenRect(center, extent, viewProjection);
+    return isScreenRectVisible(rect, hiZ.pointers.data(), HIZ_WIDTH, HIZ_HEIGHT, hiZ.mipCount);
+}
+
+int main() {
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), (float)HIZ_WIDTH / HIZ_HEIGHT, 0.1f, 100.0f);
+    glm::mat4 viewProjection = projection * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    // A box straight ahead lands centered on screen, its nearest depth is that of its front face.
+    ScreenRect rect = projectAABBToScreenRect(glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(1.0f), viewProjection);
+    CHECK(!rect.crossesNearPlane);
+    CHECK(std::abs(rect.min.x + rect.max.x - 1.0f) < 1e-5f);
+    CHECK(std::abs(rect.min.y + rect.max.y - 1.0f) < 1e-5f);
+    CHECK(std::abs(rect.minDepth - depthAt(viewProjection, glm::vec3(0.0f, 0.0f, -9.0f))) < 1e-6f);
+    // With a 90 degree field of view the front face, 9 units out, spans a ninth of the screen height.
+    CHECK(std::abs((rect.max.y - rect.min.y) - 1.0f / 9.0f) < 1e-5f);
+
+    CHECK(projectAABBToScreenRect(glm::vec3(0.0f), glm::vec3(1.0f), viewProjection).crossesNearPlane);
+    CHECK(projectAABBToScreenRect(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(1.0f), viewProjection).crossesNearPlane);
+
+    // Mip selection keeps the rect within two texels per axis, clamped to the chain.
+    ScreenRect quarter{glm::vec2(0.25f), glm::vec2(0.5f), 0.5f, false};
+    CHECK(selectHiZMip(quarter, 512, 512, 10) == 7);
+    ScreenRect tiny{glm::vec2(0.5f), glm::vec2(0.5f), 0.5f, false};
+    CHECK(selectHiZMip(tiny, 512, 512, 10) == 0);
+    ScreenRect full{glm::vec2(0.0f), glm::vec2(1.0f), 0.5f, false};
+    CHECK(selectHiZMip(full, 512, 512, 4) == 3);
+
+    // A wall 5 units ahead covering the middle half of the screen, far plane everywhere else.
+    float wallDepth = depthAt(viewProjection, glm::vec3(0.0f, 0.0f, -5.0f));
+    std::vector<float> depth(HIZ_WIDTH * HIZ_HEIGHT, 1.0f);
+    for (uint32_t y = HIZ_HEIGHT / 4; y < HIZ_HEIGHT * 3 / 4; ++y) {
+        for (uint32_t x = HIZ_WIDTH / 4; x < HIZ_WIDTH * 3 / 4; ++x) depth[y * HIZ_WIDTH + x] = wallDepth;
+    }
+    TestHiZ hiZ;
+    buildTestHiZ(hiZ, depth);
+
+    CHECK(!isVisible(hiZ, viewProjection, glm::vec3(0.0f, 0.0f, -20.0f), glm::vec3(1.0f)));
+    CHECK(isVisible(hiZ, viewProjection, glm::vec3(0.0f, 0.0f, -3.0f), glm::vec3(0.5f)));
+    CHECK(isVisible(hiZ, viewProjection, glm::vec3(18.0f, 0.0f, -20.0f), glm::vec3(1.0f)));
+    CHECK(isVisible(hiZ, viewProjection, glm::vec3(0.0f, 0.0f, -0.05f), glm::vec3(0.5f)));
+
+    // The test is conservative: whatever it rejects is behind the depth buffer at every texel it covers.
+    TestRandom random;
+    uint32_t rejected = 0;
+    for (uint32_t i = 0; i < 2000; ++i) {
+        glm::vec3 center(random.range(-30.0f, 30.0f), random.range(-15.0f, 15.0f), random.range(-60.0f, -1.0f));
+        glm::vec3 extent(random.range(0.1f, 3.0f), random.range(0.1f, 3.0f), random.range(0.1f, 3.0f));
+        ScreenRect box = projectAABBToScreenRect(center, extent, viewProjection);
+        if (isScreenRectVisible(box, hiZ.pointers.data(), HIZ_WIDTH, HIZ_HEIGHT, hiZ.mipCount)) continue;
+        ++rejected;
+        uint32_t firstX = std::min((uint32_t)(box.min.x * HIZ_WIDTH), HIZ_WIDTH - 1);
+        uint32_t firstY = std::min((uint32_t)(box.min.y * HIZ_HEIGHT), HIZ_HEIGHT - 1);
+        uint32_t lastX = std::min((uint32_t)(box.max.x * HIZ_WIDTH), HIZ_WIDTH - 1);
+        uint32_t lastY = std::min((uint32_t)(box.max.y * HIZ_HEIGHT), HIZ_HEIGHT - 1);
+        bool hidden = true;
+        for (uint32_t y = firstY; y <= lastY; ++y) {
+            for (uint32_t x = firstX; x <= lastX; ++x) hidden = hidden && depth[y * HIZ_WIDTH + x] < box.minDepth;
+        }
+        CHECK(hidden);
+    }
+    CHECK(rejected > 0);
+
+    // Readback bookkeeping: an occluded result holds for the ring's worth of frames, then the entity is drawn again.
+    Arena arena;
+    arena.init(ARENA_SIZE);
+    SparseSet<RenderableTag> renderableSet;
+    renderableSet.init(arena, CAPACITY_RENDERABLE);
+    static WorldBoundsBuffer worldBounds;
+    static VisibleEntityBuffer frustumVisible;
+    static OcclusionCullingData occlusion;
+    for (uint32_t entity = 0; entity < 4; ++entity) {
+        renderableSet.add(entity, RenderableTag{});
+        frustumVisible.buffer[frustumVisible.size++] = entity;
+    }
+    worldBounds.size = renderableSet.entityCount;
+
+    occlusion.frame = 1;
+    partitionOcclusionCandidates(frustumVisible, worldBounds, renderableSet, occlusion);
+    CHECK(occlusion.drawnFirst.size == 4);
+    occlusion.slotCandidates[1] = occlusion.candidates;
+    occlusion.slotFrames[1] = 1;
+
+    occlusion.frame = 2;
+    const uint32_t visibility[4] = {1, 0, 1, 0};
+    applyOcclusionResults(occlusion, 1, visibility);
+    CHECK(occlusion.slotFrames[1] == 0);
+    partitionOcclusionCandidates(frustumVisible, worldBounds, renderableSet, occlusion);
+    CHECK(occlusion.drawnFirst.size == 2);
+    CHECK(occlusion.drawnFirst.buffer[0] == 0 && occlusion.drawnFirst.buffer[1] == 2);
+    CHECK(occlusion.candidates.size == 4);
+    CHECK(occlusion.occludedCount == 2);
+    // The other two are retested against this frame's Hi-Z, each candidate knows which draw command its result goes to.
+    CHECK(occlusion.retested.size == 2);
+    CHECK(occlusion.retested.buffer[0] == 1 && occlusion.retested.buffer[1] == 3);
+    CHECK(occlusion.candidateBounds[0].w == -1.0f && occlusion.candidateBounds[4].w == -1.0f);
+    CHECK(occlusion.candidateBounds[2].w == 0.0f && occlusion.candidateBounds[6].w == 1.0f);
+
+    occlusion.frame = 2 + OCCLUSION_READBACK_SLOTS;
+    partitionOcclusionCandidates(frustumVisible, worldBounds, renderableSet, occlusion);
+    CHECK(occlusion.drawnFirst.size == 4);
+    CHECK(occlusion.retested.size == 0);
+
+    printf("%u of 2000 random boxes rejected, all behind the depth buffer\n", rejected);
+    free(arena.base);
+    return testResult();
+}
@@ -0,0 +1,124 @@
+#include "test_common.h"
+#include "aabb_tree.h"
+#include "render_system.h"
+#include "camera.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <vector>
+
+// A 100k object city seen from street level: a grid of static buildings and cars along the streets, a fifth of them driving.
+// Compares the render tree, which only touches the driving cars, against testing every object each frame.
+
+static constexpr uint32_t GRID_SIZE = 300;
+static constexpr float BLOCK_SPACING = 12.0f;
+static constexpr uint32_t BUILDING_COUNT = GRID_SIZE * GRID_SIZE;
+static constexpr uint32_t CAR_COUNT = 10000;
+static constexpr uint32_t DRIVING_CAR_COUNT = 2000;
+static constexpr uint32_t OBJECT_COUNT = BUILDING_COUNT + CAR_COUNT;
+static constexpr uint32_t FRAME_COUNT = 200;
+
+struct CityBounds {
+    std::vector<glm::vec3> centers;
+    std::vector<glm::vec3> extents;
+};
+
+static void cullLinear(const CityBounds& city, VisibleEntityBuffer& visible, const glm::vec4* frustumPlanes) {
+    visible.size = 0;
+    for (uint32_t entity = 0; entity < OBJECT_COUNT; ++entity) {
+        const glm::vec3& center = city.centers[entity];
+        const glm::vec3& extent = city.extents[entity];
+        bool isInside = true;
+        for (int i = 0; i < 6 && isInside; ++i) {
+            const glm::vec4& plane = frustumPlanes[i];
+            float r = extent.x * glm::abs(plane.x) + extent.y * glm::abs(plane.y) + extent.z * glm::abs(plane.z);
+            float s = glm::dot(glm::vec3(plane), center) + plane.w;
+            isInside = !(s < -r);
+        }
+        if (isInside) visible.buffer[visible.size++] = entity;
+    }
+}
+
+int main() {
+    TestRandom random;
+    CityBounds city;
+    city.centers.resize(OBJECT_COUNT);
+    city.extents.resize(OBJECT_COUNT);
+    std::vector<glm::vec3> carVelocities(CAR_COUNT);
+    const float citySize = GRID_SIZE * BLOCK_SPACING;
+
+    for (uint32_t x = 0; x < GRID_SIZE; ++x) {
+        for (uint32_t z = 0; z < GRID_SIZE; ++z) {
+            float height = random.range(4.0f, 60.0f);
+            city.centers[x * GRID_SIZE + z] = glm::vec3(x * BLOCK_SPACING, height * 0.5f, z * BLOCK_SPACING);
+            city.extents[x * GRID_SIZE + z] = glm::vec3(4.0f, height * 0.5f, 4.0f);
+        }
+    }
+    // Cars drive down the middle of the streets between the buildings, along x or along z.
+    for (uint32_t car = 0; car < CAR_COUNT; ++car) {
+        float street = (float)(random.next() % GRID_SIZE) * BLOCK_SPACING + BLOCK_SPACING * 0.5f;
+        float along = random.range(0.0f, citySize);
+        float speed = random.range(0.05f, 0.5f);
+        bool alongX = random.next() % 2 == 0;
+        city.centers[BUILDING_COUNT + car] = alongX ? glm::vec3(along, 0.75f, street) : glm::vec3(street, 0.75f, along);
+        city.extents[BUILDING_COUNT + car] = alongX ? glm::vec3(2.0f, 0.75f, 1.0f) : glm::vec3(1.0f, 0.75f, 2.0f);
+        carVelocities[car] = alongX ? glm::vec3(speed, 0.0f, 0.0f) : glm::vec3(0.0f, 0.0f, speed);
+    }
+
+    static AABBTree tree;
+    initAABBTree(tree, OBJECT_COUNT);
+    auto buildStart = std::chrono::steady_clock::now();
+    for (uint32_t entity = 0; entity < OBJECT_COUNT; ++entity) insertProxy(tree, entity, city.centers[entity], city.extents[entity]);
+    double buildMilliseconds = millisecondsSince(buildStart);
+
+    static VisibleEntityBuffer treeVisible, linearVisible;
+    double updateMilliseconds = 0.0;
+    double treeMilliseconds = 0.0;
+    double linearMilliseconds = 0.0;
+    uint32_t reinsertedCars = 0;
+    uint32_t totalVisible = 0;
+    for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame) {
+        for (uint32_t car = 0; car < DRIVING_CAR_COUNT; ++car) {
+            glm::vec3& center = city.centers[BUILDING_COUNT + car];
+            center += carVelocities[car];
+            if (center.x > citySize) center.x -= citySize;
+            if (center.z > citySize) center.z -= citySize;
+        }
+
+        CameraComponent camera = {};
+        glm::vec3 eye(random.range(0.0f, citySize), 1.8f, random.range(0.0f, citySize));
+        float heading = random.range(0.0f, 6.2831853f);
+        camera.projectionMatrix = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 300.0f);
+        camera.viewMatrix = glm::lookAt(eye, eye + glm::vec3(glm::cos(heading), 0.0f, glm::sin(heading)), glm::vec3(0.0f, 1.0f, 0.0f));
+        updateViewProjectionMatrix(camera);
+
+        // Only the driving cars moved, so only their proxies are touched.
+        auto updateStart = std::chrono::steady_clock::now();
+        for (uint32_t car = 0; car < DRIVING_CAR_COUNT; ++car) {
+            uint32_t entity = BUILDING_COUNT + car;
+            reinsertedCars += moveProxy(tree, entity, city.centers[entity], city.extents[entity]);
+        }
+        updateMilliseconds += millisecondsSince(updateStart);
+        auto treeStart = std::chrono::steady_clock::now();
+        performFrustumCullingTree(tree, treeVisible, camera.frustumPlanes);
+        treeMilliseconds += millisecondsSince(treeStart);
+
+        auto linearStart = std::chrono::steady_clock::now();
+        cullLinear(city, linearVisible, camera.frustumPlanes);
+        linearMilliseconds += millisecondsSince(linearStart);
+
+        // Street level with a 300m far plane keeps the visible set well inside the buffer.
+        CHECK(linearVisible.size < CULLING_CAPACITY);
+        std::sort(treeVisible.buffer, treeVisible.buffer + treeVisible.size);
+        CHECK(treeVisible.size == linearVisible.size);
+        CHECK(std::equal(treeVisible.buffer, treeVisible.buffer + std::min(treeVisible.size, linearVisible.size), linearVisible.buffer));
+        totalVisible += linearVisible.size;
+    }
+    CHECK(tree.proxyCount == OBJECT_COUNT);
+
+    printf("%u objects, tree built in %.1f ms, %.1f visible per frame, %.1f cars reinserted per frame\n", OBJECT_COUNT, buildMilliseconds,
+           (double)totalVisible / FRAME_COUNT, (double)reinsertedCars / FRAME_COUNT);
+    printf("tree update %.3f ms, tree cull %.3f ms, linear cull %.3f ms per frame\n", updateMilliseconds / FRAME_COUNT,
+           treeMilliseconds / FRAME_COUNT, linearMilliseconds / FRAME_COUNT);
+    freeAABBTree(tree);
+    return testResult();
+}
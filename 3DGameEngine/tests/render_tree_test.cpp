@@ -0,0 +1,157 @@
+#include "test_common.h"
+#include "aabb_tree.h"
+#include "render_system.h"
+#include "camera.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// The incrementally updated render tree against the linear path, over frames that move, add and remove renderables.
+
+static constexpr uint32_t FRAME_COUNT = 40;
+static constexpr uint32_t ENTITY_COUNT = 4000;
+
+static void buildCamera(TestRandom& random, CameraComponent& camera) {
+    glm::vec3 eye(random.range(-20.0f, 20.0f), random.range(-5.0f, 5.0f), random.range(-20.0f, 20.0f));
+    glm::vec3 target(random.range(-20.0f, 20.0f), random.range(-5.0f, 5.0f), random.range(-20.0f, 20.0f));
+    camera.projectionMatrix = glm::perspective(glm::radians(random.range(30.0f, 90.0f)), random.range(0.5f, 2.5f), 0.1f, random.range(20.0f, 80.0f));
+    camera.viewMatrix = glm::lookAt(eye, target + glm::vec3(0.01f), glm::vec3(0.0f, 1.0f, 0.0f));
+    updateViewProjectionMatrix(camera);
+}
+
+static glm::quat randomRotation(TestRandom& random) {
+    return glm::normalize(glm::quat(random.range(-1.0f, 1.0f), random.range(-1.0f, 1.0f), random.range(-1.0f, 1.0f), random.range(-1.0f, 1.0f)));
+}
+
+static AABB randomLocalBounds(TestRandom& random) {
+    return AABB{random.range(-2.0f, 0.0f), random.range(-2.0f, 0.0f), random.range(-2.0f, 0.0f),
+                random.range(0.0f, 2.0f), random.range(0.0f, 2.0f), random.range(0.0f, 2.0f)};
+}
+
+// Parents, heights and bounds agree all the way down.
+static int32_t checkSubtree(const AABBTree& tree, uint32_t index, uint32_t parent, bool& valid) {
+    const AABBTreeNode& node = tree.nodes[index];
+    valid = valid && node.parent == parent;
+    if (node.left == INVALID_INDEX) {
+        valid = valid && node.height == 0 && tree.leafOf[node.entity] == index;
+        return 0;
+    }
+    int32_t left = checkSubtree(tree, node.left, index, valid);
+    int32_t right = checkSubtree(tree, node.right, index, valid);
+    const AABB& a = tree.nodes[node.left].bounds;
+    const AABB& b = tree.nodes[node.right].bounds;
+    valid = valid && node.height == 1 + std::max(left, right) && node.bounds.minX <= std::min(a.minX, b.minX) &&
+            node.bounds.maxX >= std::max(a.maxX, b.maxX) && node.bounds.minZ <= std::min(a.minZ, b.minZ) &&
+            node.bounds.maxZ >= std::max(a.maxZ, b.maxZ);
+    return node.height;
+}
+
+static void checkTree(const AABBTree& tree) {
+    bool valid = true;
+    if (tree.root != INVALID_INDEX) checkSubtree(tree, tree.root, INVALID_INDEX, valid);
+    CHECK(valid);
+}
+
+static void sortVisible(VisibleEntityBuffer& visible) {
+    std::sort(visible.buffer, visible.buffer + visible.size);
+}
+
+int main() {
+    Arena arena;
+    arena.init(ARENA_SIZE);
+    SparseSet<TransformComponent> transformSet;
+    SparseSet<MeshData> meshSet;
+    SparseSet<RenderableTag> renderableSet;
+    transformSet.init(arena, CAPACITY_TRANSFORM);
+    meshSet.init(arena, CAPACITY_MESH);
+    renderableSet.init(arena, CAPACITY_RENDERABLE);
+
+    static AABBTree tree;
+    initAABBTree(tree, MAX_ENTITIES);
+    static WorldBoundsBuffer incremental, rebuilt;
+    static VisibleEntityBuffer treeVisible, linearVisible;
+
+    TestRandom random;
+    for (uint32_t entity = 0; entity < ENTITY_COUNT; ++entity) {
+        TransformComponent transform;
+        transform.position = glm::vec3(random.range(-60.0f, 60.0f), random.range(-20.0f, 20.0f), random.range(-60.0f, 60.0f));
+        transform.scale = glm::vec3(random.range(0.1f, 4.0f), random.range(0.1f, 4.0f), random.range(0.1f, 4.0f));
+        transform.rotation = randomRotation(random);
+        MeshData mesh = {};
+        mesh.localAABB = randomLocalBounds(random);
+        transformSet.add(entity, transform);
+        meshSet.add(entity, mesh);
+        if (random.next() % 8 != 0) renderableSet.add(entity, RenderableTag{});
+    }
+
+    uint32_t totalVisible = 0;
+    for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame) {
+        // Small moves that stay inside the fat bounds, jumps that don't, mesh swaps and renderables coming and going.
+        for (uint32_t i = 0; i < 60; ++i) {
+            TransformComponent& transform = transformSet.getComponent(random.next() % ENTITY_COUNT);
+            transform.position += glm::vec3(random.range(-0.1f, 0.1f), random.range(-0.1f, 0.1f), random.range(-0.1f, 0.1f));
+        }
+        for (uint32_t i = 0; i < 10; ++i) {
+            TransformComponent& transform = transformSet.getComponent(random.next() % ENTITY_COUNT);
+            transform.position = glm::vec3(random.range(-60.0f, 60.0f), random.range(-20.0f, 20.0f), random.range(-60.0f, 60.0f));
+            transform.rotation = randomRotation(random);
+        }
+        for (uint32_t i = 0; i < 5; ++i) meshSet.getComponent(random.next() % ENTITY_COUNT).localAABB = randomLocalBounds(random);
+        for (uint32_t i = 0; i < 20; ++i) {
+            uint32_t entity = random.next() % ENTITY_COUNT;
+            if (renderableSet.hasComponent(entity)) renderableSet.remove(entity);
+            else renderableSet.add(entity, RenderableTag{});
+        }
+        // The snapshot history clearing its bits mustn't hide anything from the tree.
+        transformSet.clearDirty(DIRTY_SNAPSHOT);
+        meshSet.clearDirty(DIRTY_SNAPSHOT);
+        renderableSet.clearDirty(DIRTY_SNAPSHOT);
+
+        CameraComponent camera = {};
+        buildCamera(random, camera);
+
+        updateRenderTree(tree, renderableSet, transformSet, meshSet, incremental);
+        performFrustumCullingTree(tree, treeVisible, camera.frustumPlanes);
+        updateWorldBounds(renderableSet, transformSet, meshSet, rebuilt);
+        performFrustumCulling(rebuilt, linearVisible, camera.frustumPlanes);
+
+        CHECK(tree.proxyCount == renderableSet.entityCount);
+        CHECK(incremental.size == rebuilt.size);
+        CHECK(memcmp(incremental.centerX, rebuilt.centerX, rebuilt.size * sizeof(float)) == 0);
+        CHECK(memcmp(incremental.extentY, rebuilt.extentY, rebuilt.size * sizeof(float)) == 0);
+        CHECK(memcmp(incremental.entities, rebuilt.entities, rebuilt.size * sizeof(uint32_t)) == 0);
+
+        // Leaves are tested with the tight bounds, so the tree sees exactly what the linear path sees.
+        sortVisible(treeVisible);
+        sortVisible(linearVisible);
+        CHECK(treeVisible.size == linearVisible.size);
+        CHECK(memcmp(treeVisible.buffer, linearVisible.buffer, std::min(treeVisible.size, linearVisible.size) * sizeof(uint32_t)) == 0);
+        totalVisible += linearVisible.size;
+        checkTree(tree);
+    }
+
+    // A frame without writes leaves the buffer alone, nothing is recomputed for entities that didn't change.
+    incremental.centerX[0] = 12345.0f;
+    updateRenderTree(tree, renderableSet, transformSet, meshSet, incremental);
+    CHECK(incremental.centerX[0] == 12345.0f);
+
+    CHECK(totalVisible > 0);
+
+    // Boxes along a line, then ever larger boxes around all of them. Each of those is cheapest next to the root, so the
+    // new parent sits above the whole tree and a leaf. Balancing has to start at that parent or every one adds a level.
+    static AABBTree line;
+    initAABBTree(line, 4096);
+    float extent = 4096.0f;
+    for (uint32_t entity = 0; entity < 4064; ++entity) insertProxy(line, entity, glm::vec3(entity * 2.0f, 0.0f, 0.0f), glm::vec3(0.5f));
+    for (uint32_t entity = 4064; entity < 4096; ++entity, extent *= 2.0f) insertProxy(line, entity, glm::vec3(4064.0f, 0.0f, 0.0f), glm::vec3(extent));
+    checkTree(line);
+    CHECK(line.nodes[line.root].height <= 16);
+    printf("4096 boxes, %d levels deep\n", line.nodes[line.root].height);
+    freeAABBTree(line);
+    printf("%u frames, %u visible entities in total\n", FRAME_COUNT, totalVisible);
+    freeAABBTree(tree);
+    free(arena.base);
+    return testResult();
+}
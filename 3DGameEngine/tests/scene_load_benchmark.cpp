@@ -0,0 +1,112 @@
+#include "test_common.h"
+#include "test_scene.h"
+#include <cstdio>
+#include <vector>
+
+// A 100k entity scene saved as chunks, compressed chunks and the headerless legacy layout, then loaded back through
+// loadScene. Built with MAX_ENTITIES = 100000, the engine's own limit is far below that.
+// Every entity has a transform, mesh, material and renderable tag, every fourth collides and every tenth moves.
+
+static constexpr uint32_t ENTITY_COUNT = 100000;
+static constexpr uint32_t RUN_COUNT = 5;
+static constexpr const char* CHUNKED_PATH = "scene_load_benchmark.scene";
+static constexpr const char* COMPRESSED_PATH = "scene_load_benchmark_compressed.scene";
+static constexpr const char* LEGACY_PATH = "scene_load_benchmark_legacy.scene";
+
+static_assert(MAX_ENTITIES >= ENTITY_COUNT, "scene_load_benchmark has to be built with a larger MAX_ENTITIES");
+
+static void buildScene(ECS& scene) {
+    TestRandom random;
+    for (uint32_t entity = 0; entity < ENTITY_COUNT; ++entity) {
+        TransformComponent transform;
+        transform.position = glm::vec3(random.range(-500.0f, 500.0f), random.range(0.0f, 50.0f), random.range(-500.0f, 500.0f));
+        transform.scale = glm::vec3(random.range(0.5f, 4.0f));
+        MeshData mesh = {};
+        mesh.handle = random.next() % 16;
+        mesh.localAABB = AABB{-0.5f, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f};
+        MaterialData material = {};
+        material.shaderID = 1;
+        material.materialSSBOIndex = (uint16_t)(random.next() % 32);
+        scene.transformSet.add(entity, transform);
+        scene.meshSet.add(entity, mesh);
+        scene.materialSet.add(entity, material);
+        scene.renderableSet.add(entity, RenderableTag{});
+        if (entity % 4 == 0) scene.collisionSet.add(entity, CollisionComponent{-0.5f, 0.5f, -0.5f, 0.5f, -0.5f, 0.5f});
+        if (entity % 10 == 0) scene.velocitySet.add(entity, VelocityComponent{glm::vec3(random.range(-1.0f, 1.0f), 0.0f, 0.0f)});
+    }
+    scene.entityCount = ENTITY_COUNT;
+}
+
+// What the engine wrote before scene files had a header: the entity count, then every set as count, IDs and components.
+static void saveLegacyScene(ECS& scene, const char* path) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return;
+    fwrite(&scene.entityCount, sizeof(uint32_t), 1, f);
+    forEachSceneSet(scene, [&](SceneChunkID, uint32_t, SceneMigrateFn, auto& set) {
+        fwrite(&set.entityCount, sizeof(uint32_t), 1, f);
+        fwrite(set.entities, sizeof(uint32_t), set.entityCount, f);
+        fwrite(set.dense, sizeof(set.dense[0]), set.entityCount, f);
+    });
+    fclose(f);
+}
+
+static bool matchesSource(const ECS& source, const ECS& loaded) {
+    if (loaded.entityCount != source.entityCount || loaded.transformSet.entityCount != ENTITY_COUNT ||
+        loaded.materialSet.entityCount != ENTITY_COUNT || loaded.renderableSet.entityCount != ENTITY_COUNT ||
+        loaded.collisionSet.entityCount != source.collisionSet.entityCount ||
+        loaded.velocitySet.entityCount != source.velocitySet.entityCount) {
+        return false;
+    }
+    for (uint32_t entity = 0; entity < ENTITY_COUNT; ++entity) {
+        const TransformComponent& a = source.transformSet.getComponent(entity);
+        const TransformComponent& b = loaded.transformSet.getComponent(entity);
+        if (a.position != b.position || a.scale != b.scale) return false;
+        if (source.materialSet.getComponent(entity).materialSSBOIndex != loaded.materialSet.getComponent(entity).materialSSBOIndex) return false;
+        if (source.meshSet.getComponent(entity).handle != loaded.meshSet.getComponent(entity).handle) return false;
+    }
+    return loaded.collisionSet.hasComponent(ENTITY_COUNT - 4) && !loaded.collisionSet.hasComponent(ENTITY_COUNT - 3);
+}
+
+static double fileMegabytes(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0.0;
+    fseek(f, 0, SEEK_END);
+    double megabytes = ftell(f) / (1024.0 * 1024.0);
+    fclose(f);
+    return megabytes;
+}
+
+int main() {
+    static ECS source, loaded;
+    initSceneSets(source);
+    initSceneSets(loaded);
+    buildScene(source);
+    saveScene(source, CHUNKED_PATH);
+    saveScene(source, COMPRESSED_PATH, true);
+    saveLegacyScene(source, LEGACY_PATH);
+
+    // Interleaved so no loader always runs on a warmer cache.
+    const char* paths[3] = {CHUNKED_PATH, COMPRESSED_PATH, LEGACY_PATH};
+    double best[3] = {1e9, 1e9, 1e9};
+    double total[3] = {};
+    for (uint32_t run = 0; run < RUN_COUNT; ++run) {
+        for (uint32_t i = 0; i < 3; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            loadScene(loaded, paths[i]);
+            double milliseconds = millisecondsSince(start);
+            CHECK(matchesSource(source, loaded));
+            best[i] = std::min(best[i], milliseconds);
+            total[i] += milliseconds;
+        }
+    }
+
+    const char* names[3] = {"chunked   ", "compressed", "legacy    "};
+    printf("%u entities\n", ENTITY_COUNT);
+    for (uint32_t i = 0; i < 3; ++i) {
+        printf("%s %6.2f MB, best %.2f ms, mean %.2f ms\n", names[i], fileMegabytes(paths[i]), best[i], total[i] / RUN_COUNT);
+        remove(paths[i]);
+    }
+    free(source.arena.base);
+    free(loaded.arena.base);
+    return testResult();
+}
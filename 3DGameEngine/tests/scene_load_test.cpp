@@ -0,0 +1,50 @@
+#include "test_common.h"
+#include "test_scene.h"
+
+// Loading a scene replaces every set, so sleep and contact pairs left over from the old one must not carry into it.
+
+static constexpr const char* SCENE_PATH = "scene_load_test.scene";
+
+static void addContact(ContactStream& contacts, uint32_t entity, uint32_t other) {
+    beginContacts(contacts);
+    reserveContacts(contacts, 1);
+    contacts.contacts[contacts.count++] = Contact{entity, other, glm::vec3(0.0f, 1.0f, 0.0f), 0.1f, ContactState::Enter, 0.0f, UINT32_MAX};
+    endContacts(contacts);
+}
+
+int main() {
+    static ECS scene;
+    initSceneSets(scene);
+    uint32_t box = createEntity(scene);
+    uint32_t floor = createEntity(scene);
+    scene.transformSet.add(box, TransformComponent{});
+    scene.dynamicSet.add(box, DynamicTag{});
+    scene.transformSet.add(floor, TransformComponent{});
+    saveScene(scene, SCENE_PATH);
+
+    // The box has been resting on the floor long enough to sleep.
+    addContact(scene.contacts, box, floor);
+    addContact(scene.contacts, box, floor);
+    CHECK(scene.contacts.contacts[0].state == ContactState::Stay);
+    scene.bodySleep.asleep[box] = true;
+    scene.bodySleep.restingFrames[box] = 100;
+    scene.bodySleep.sleepingCount = 1;
+
+    loadScene(scene, SCENE_PATH);
+    CHECK(scene.transformSet.hasComponent(box) && scene.dynamicSet.hasComponent(box));
+    CHECK(!scene.bodySleep.asleep[box]);
+    CHECK(scene.bodySleep.restingFrames[box] == 0);
+    CHECK(scene.bodySleep.sleepingCount == 0);
+    CHECK(scene.contacts.count == 0);
+
+    // The same pair touching after the load is a new contact, not one carrying on with an old impulse.
+    addContact(scene.contacts, box, floor);
+    CHECK(scene.contacts.count == 1);
+    CHECK(scene.contacts.contacts[0].state == ContactState::Enter);
+    CHECK(scene.contacts.enterCount == 1 && scene.contacts.exitCount == 0);
+
+    remove(SCENE_PATH);
+    freeContactStream(scene.contacts);
+    free(scene.arena.base);
+    return testResult();
+}
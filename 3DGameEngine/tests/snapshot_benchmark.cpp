@@ -0,0 +1,74 @@
+#include "test_common.h"
+#include "test_scene.h"
+#include "snapshot.h"
+#include <algorithm>
+
+// takeSnapshot and restoreSnapshot on a scene with as many entities as it can hold, the hot reload rollback pays for
+// both every reload. Meant to stay under a millisecond each. Every entity has a transform, mesh, material, renderable
+// tag, collider and velocity, so every set the engine sizes to MAX_ENTITIES is full.
+
+static constexpr uint32_t ENTITY_COUNT = MAX_ENTITIES - 1; // createEntity never hands out ID 0.
+static constexpr uint32_t RUN_COUNT = 50;
+static constexpr double TARGET_MILLISECONDS = 1.0;
+
+static void buildScene(ECS& scene) {
+    TestRandom random;
+    for (uint32_t i = 0; i < ENTITY_COUNT; ++i) {
+        uint32_t entity = createEntity(scene);
+        TransformComponent transform;
+        transform.position = glm::vec3(random.range(-500.0f, 500.0f), random.range(0.0f, 50.0f), random.range(-500.0f, 500.0f));
+        MeshData mesh = {};
+        mesh.handle = random.next() % 16;
+        mesh.localAABB = AABB{-0.5f, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f};
+        scene.transformSet.add(entity, transform);
+        scene.meshSet.add(entity, mesh);
+        scene.materialSet.add(entity, MaterialData{});
+        scene.renderableSet.add(entity, RenderableTag{});
+        scene.collisionSet.add(entity, CollisionComponent{-0.5f, 0.5f, -0.5f, 0.5f, -0.5f, 0.5f});
+        scene.velocitySet.add(entity, VelocityComponent{glm::vec3(random.range(-1.0f, 1.0f), 0.0f, 0.0f)});
+    }
+}
+
+int main() {
+    static ECS scene;
+    initSceneSets(scene);
+    buildScene(scene);
+    CHECK(scene.entityCount == ENTITY_COUNT && scene.transformSet.entityCount == ENTITY_COUNT);
+
+    WorldSnapshot snapshot;
+    CHECK(takeSnapshot(scene, snapshot));
+    const glm::vec3 saved = scene.transformSet.getComponent(ENTITY_COUNT).position;
+
+    double takeBest = 1e9, takeTotal = 0.0, restoreBest = 1e9, restoreTotal = 0.0;
+    for (uint32_t run = 0; run < RUN_COUNT; ++run) {
+        // Move everything and drop an entity so each restore has something to undo.
+        for (uint32_t entity = 1; entity <= ENTITY_COUNT; ++entity) scene.transformSet.getComponent(entity).position.y += 1.0f;
+        scene.velocitySet.remove(run + 1);
+
+        auto start = std::chrono::steady_clock::now();
+        CHECK(restoreSnapshot(scene, snapshot));
+        double milliseconds = millisecondsSince(start);
+        restoreBest = std::min(restoreBest, milliseconds);
+        restoreTotal += milliseconds;
+        CHECK(scene.transformSet.getComponent(ENTITY_COUNT).position == saved);
+        CHECK(scene.velocitySet.entityCount == ENTITY_COUNT && scene.velocitySet.hasComponent(run + 1));
+
+        start = std::chrono::steady_clock::now();
+        CHECK(takeSnapshot(scene, snapshot));
+        milliseconds = millisecondsSince(start);
+        takeBest = std::min(takeBest, milliseconds);
+        takeTotal += milliseconds;
+    }
+
+    printf("%u entities, %.2f MB arena\n", ENTITY_COUNT, snapshot.arenaBytes / (1024.0 * 1024.0));
+    printf("take    best %.3f ms, mean %.3f ms\n", takeBest, takeTotal / RUN_COUNT);
+    printf("restore best %.3f ms, mean %.3f ms\n", restoreBest, restoreTotal / RUN_COUNT);
+    if (takeTotal / RUN_COUNT > TARGET_MILLISECONDS || restoreTotal / RUN_COUNT > TARGET_MILLISECONDS) {
+        printf("over the %.1f ms target\n", TARGET_MILLISECONDS);
+    }
+
+    freeSnapshot(snapshot);
+    freeContactStream(scene.contacts);
+    free(scene.arena.base);
+    return testResult();
+}
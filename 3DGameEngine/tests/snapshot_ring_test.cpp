@@ -0,0 +1,155 @@
+#include "test_common.h"
+#include "test_scene.h"
+#include "snapshot.h"
+#include <algorithm>
+#include <vector>
+
+// The rewind history against a full copy of the arena taken every frame. Frames are recorded with random writes, then
+// restored at several depths: deltas replayed onto their keyframe, records that wrapped to the start of the pool, and
+// the oldest record left after the ones before it were evicted. Built with a small MAX_ENTITIES so a copy per frame
+// stays cheap and the 64 MB pool fills up in a few hundred frames. Only the latest frames and the keyframes are kept,
+// which covers the oldest record since it's always a keyframe.
+
+static constexpr uint32_t START_ENTITIES = 800;
+static constexpr uint32_t HEAVY_FRAMES = 2000; // Most blocks written, the pool wraps and evicts by size.
+static constexpr uint32_t FRAME_COUNT = 6500; // Then one write a frame, the record ring wraps and evicts by count.
+static constexpr uint32_t CHECK_INTERVAL = 250;
+static constexpr uint32_t COPY_FRAMES = 512; // Restores of deltas reach back at most this far.
+
+struct FrameCopy {
+    std::vector<uint8_t> arena;
+    std::vector<uint32_t> setCounts;
+    uint32_t entityCount = 0;
+    uint32_t frame = 0;
+};
+
+static void copyFrame(ECS& scene, uint32_t frame, FrameCopy& copy) {
+    copy.arena.assign(scene.arena.base, scene.arena.base + scene.arena.offset);
+    copy.setCounts.clear();
+    forEachSceneSet(scene, [&](SceneChunkID, uint32_t, SceneMigrateFn, auto& set) { copy.setCounts.push_back(set.entityCount); });
+    copy.entityCount = scene.entityCount;
+    copy.frame = frame;
+}
+
+static bool matchesCopy(ECS& scene, const FrameCopy& copy) {
+    FrameCopy current;
+    copyFrame(scene, copy.frame, current);
+    return current.arena == copy.arena && current.setCounts == copy.setCounts && current.entityCount == copy.entityCount;
+}
+
+static void writeFrame(ECS& scene, TestRandom& random, bool heavy) {
+    // Heavy frames move and resize every collider, their deltas come close to a keyframe.
+    if (heavy) {
+        for (uint32_t i = 0; i < scene.collisionSet.entityCount; ++i) {
+            uint32_t entity = scene.collisionSet.entities[i];
+            float size = random.range(0.1f, 1.0f);
+            scene.collisionSet.getComponent(entity) = CollisionComponent{-size, size, -size, size, -size, size};
+            if (scene.transformSet.hasComponent(entity)) scene.transformSet.getComponent(entity).position += glm::vec3(random.range(-1.0f, 1.0f));
+        }
+    }
+    // One more random write, on its own it keeps records small enough that the ring runs out of records first.
+    uint32_t entity = 1 + random.next() % scene.entityCount;
+    uint32_t kind = random.next() % 8;
+    if (kind == 0 && scene.entityCount + 1 < MAX_ENTITIES) {
+        uint32_t created = createEntity(scene);
+        scene.transformSet.add(created, TransformComponent{});
+        scene.velocitySet.add(created, VelocityComponent{glm::vec3(1.0f)});
+    } else if (kind == 1 && scene.velocitySet.hasComponent(entity)) {
+        scene.velocitySet.remove(entity);
+    } else if (kind == 2 && !scene.velocitySet.hasComponent(entity)) {
+        scene.velocitySet.add(entity, VelocityComponent{glm::vec3(random.range(-1.0f, 1.0f))});
+    } else if (scene.transformSet.hasComponent(entity)) {
+        scene.transformSet.getComponent(entity).position += glm::vec3(random.range(-1.0f, 1.0f));
+    }
+}
+
+static const SnapshotRecord& recordAt(const SnapshotRing& ring, uint32_t position) {
+    return ring.records[(ring.first + position) % SNAPSHOT_HISTORY_FRAMES];
+}
+
+int main() {
+    static ECS scene;
+    initSceneSets(scene);
+    TestRandom random;
+    for (uint32_t i = 0; i < START_ENTITIES; ++i) {
+        uint32_t entity = createEntity(scene);
+        scene.transformSet.add(entity, TransformComponent{});
+        scene.collisionSet.add(entity, CollisionComponent{-0.5f, 0.5f, -0.5f, 0.5f, -0.5f, 0.5f});
+        if (i % 2 == 0) scene.velocitySet.add(entity, VelocityComponent{glm::vec3(0.0f)});
+    }
+
+    static SnapshotRing ring;
+    ring.recording = true;
+    std::vector<FrameCopy> copies(COPY_FRAMES);
+    std::vector<FrameCopy> keyframeCopies;
+    uint32_t restores = 0, wrappedRestores = 0, evictedRestores = 0, evictions = 0;
+    bool evictedBySize = false, evictedByCount = false;
+    for (uint32_t frame = 0; frame < FRAME_COUNT; ++frame) {
+        writeFrame(scene, random, frame < HEAVY_FRAMES);
+        uint32_t countBefore = ring.count;
+        recordSnapshot(ring, scene);
+        CHECK(ring.recording);
+        copyFrame(scene, ring.frame, copies[ring.frame % COPY_FRAMES]);
+        if (recordAt(ring, ring.count - 1).keyframe) keyframeCopies.push_back(copies[ring.frame % COPY_FRAMES]);
+        while (keyframeCopies.front().frame < recordAt(ring, 0).frame) keyframeCopies.erase(keyframeCopies.begin());
+        // The oldest record is always a keyframe, and the newest is this frame.
+        CHECK(ring.count > 0 && recordAt(ring, 0).keyframe);
+        CHECK(recordAt(ring, ring.count - 1).frame == ring.frame);
+        bool evicted = ring.count <= countBefore;
+        evictedBySize = evictedBySize || (evicted && countBefore < SNAPSHOT_HISTORY_FRAMES);
+        evictedByCount = evictedByCount || (evicted && countBefore == SNAPSHOT_HISTORY_FRAMES);
+        evictions += evicted ? 1 : 0;
+        // Resuming after a restore starts with a keyframe, checking on every eviction would leave no deltas to wrap.
+        if ((frame + 1) % CHECK_INTERVAL != 0 && !(evicted && evictions % 16 == 1)) continue;
+
+        // The newest few, one a keyframe's worth of deltas back, the oldest, and the first record placed after the
+        // pool wrapped whose keyframe was placed before it.
+        std::vector<uint32_t> depths = {0, 1, 2, 7, 64, 239, 300, ring.count - 1};
+        for (uint32_t position = 1; position < ring.count; ++position) {
+            uint32_t keyframe = position;
+            while (!recordAt(ring, keyframe).keyframe) --keyframe;
+            if (recordAt(ring, position).offset < recordAt(ring, keyframe).offset) {
+                depths.push_back(ring.count - 1 - position);
+                break;
+            }
+        }
+        for (uint32_t depth : depths) {
+            if (depth >= ring.count) continue;
+            uint32_t target = ring.count - 1 - depth;
+            const FrameCopy* copy = &copies[recordAt(ring, target).frame % COPY_FRAMES];
+            if (depth >= COPY_FRAMES) {
+                if (!recordAt(ring, target).keyframe) continue;
+                copy = &*std::find_if(keyframeCopies.begin(), keyframeCopies.end(), [&](const FrameCopy& keyframeCopy) {
+                    return keyframeCopy.frame == recordAt(ring, target).frame;
+                });
+            }
+            CHECK(copy->frame == recordAt(ring, target).frame);
+            CHECK(restoreRingSnapshot(ring, scene, depth));
+            CHECK(matchesCopy(scene, *copy));
+            ++restores;
+            uint32_t keyframe = target;
+            while (!recordAt(ring, keyframe).keyframe) --keyframe;
+            if (recordAt(ring, target).offset < recordAt(ring, keyframe).offset) ++wrappedRestores;
+            if (evicted && target == 0) ++evictedRestores;
+        }
+        // Back to the newest record, which is the live state, and on with recording from it.
+        CHECK(restoreRingSnapshot(ring, scene, 0));
+        resumeFromScrub(ring);
+        CHECK(matchesCopy(scene, copies[ring.frame % COPY_FRAMES]));
+    }
+
+    printf("%u frames, %u records kept, %u restores, %u across a pool wrap, %u of the oldest after an eviction\n",
+           ring.frame, ring.count, restores, wrappedRestores, evictedRestores);
+    CHECK(evictedBySize && evictedByCount);
+    CHECK(ring.first + ring.count > SNAPSHOT_HISTORY_FRAMES);
+    CHECK(wrappedRestores > 0);
+    CHECK(evictedRestores > 0);
+
+    // Nothing further back than the oldest record.
+    CHECK(!restoreRingSnapshot(ring, scene, ring.count));
+
+    freeSnapshotRing(ring);
+    freeContactStream(scene.contacts);
+    free(scene.arena.base);
+    return testResult();
+}
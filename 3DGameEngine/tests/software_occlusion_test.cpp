@@ -0,0 +1,132 @@
+#include "test_common.h"
+#include "software_occlusion.h"
+#include "render_system.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+
+// The software rasterizer run through its worker without a window: a wall in front of the camera hides what is behind it.
+// Then the wall becomes a triangle, which must only hide what is behind its solid half and not the rest of its AABB.
+
+static constexpr uint32_t CUBE_MESH = 0;
+static constexpr uint32_t TRIANGLE_MESH = 1;
+
+static void addTestMeshes(MeshBuffer& meshBuffer) {
+    glm::vec3 corners[8];
+    for (uint32_t c = 0; c < 8; ++c) corners[c] = glm::vec3((c & 1) ? 0.5f : -0.5f, (c & 2) ? 0.5f : -0.5f, (c & 4) ? 0.5f : -0.5f);
+    const uint16_t cubeIndices[36] = {0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3, 0, 4, 5, 0, 5, 1,
+                                      2, 3, 7, 2, 7, 6, 0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5};
+    addOccluderMesh(meshBuffer, CUBE_MESH, corners, (const uint8_t*)cubeIndices, sizeof(uint16_t), 36);
+
+    // Lower left half of the unit square, flat in z. Its AABB is the whole square.
+    const glm::vec3 triangle[3] = {glm::vec3(-0.5f, -0.5f, 0.0f), glm::vec3(0.5f, -0.5f, 0.0f), glm::vec3(-0.5f, 0.5f, 0.0f)};
+    const uint32_t triangleIndices[3] = {0, 1, 2};
+    addOccluderMesh(meshBuffer, TRIANGLE_MESH, triangle, (const uint8_t*)triangleIndices, sizeof(uint32_t), 3);
+    meshBuffer.size = 2;
+}
+
+static uint32_t addEntity(SparseSet<TransformComponent>& transformSet, SparseSet<MeshData>& meshSet, SparseSet<RenderableTag>& renderableSet,
+                          uint32_t entity, const glm::vec3& position, const glm::vec3& scale) {
+    TransformComponent transform;
+    transform.position = position;
+    transform.scale = scale;
+    transform.rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    MeshData mesh = {};
+    mesh.handle = CUBE_MESH;
+    mesh.localAABB = AABB{-0.5f, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f};
+    transformSet.add(entity, transform);
+    meshSet.add(entity, mesh);
+    renderableSet.add(entity, RenderableTag{});
+    return entity;
+}
+
+static bool contains(const VisibleEntityBuffer& visible, uint32_t entity) {
+    for (uint32_t i = 0; i < visible.size; ++i) {
+        if (visible.buffer[i] == entity) return true;
+    }
+    return false;
+}
+
+int main() {
+    Arena arena;
+    arena.init(ARENA_SIZE);
+    SparseSet<TransformComponent> transformSet;
+    SparseSet<MeshData> meshSet;
+    SparseSet<RenderableTag> renderableSet;
+    SparseSet<OccluderTag> occluderSet;
+    transformSet.init(arena, CAPACITY_TRANSFORM);
+    meshSet.init(arena, CAPACITY_MESH);
+    renderableSet.init(arena, CAPACITY_RENDERABLE);
+    occluderSet.init(arena, CAPACITY_OCCLUDER);
+    static MeshBuffer meshBuffer;
+    addTestMeshes(meshBuffer);
+    CHECK(meshBuffer.occluderVertexCounts[CUBE_MESH] == 36 && meshBuffer.occluderVertexCounts[TRIANGLE_MESH] == 3);
+
+    // Camera at the origin looking down -Z, an 8 x 8 wall 10 units out.
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), (float)SOFTWARE_DEPTH_WIDTH / SOFTWARE_DEPTH_HEIGHT, 0.1f, 200.0f);
+    glm::mat4 viewProjection = projection * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    uint32_t wall = addEntity(transformSet, meshSet, renderableSet, 0, glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(8.0f, 8.0f, 1.0f));
+    occluderSet.add(wall, OccluderTag{});
+    uint32_t behind = addEntity(transformSet, meshSet, renderableSet, 1, glm::vec3(1.0f, -1.0f, -30.0f), glm::vec3(2.0f));
+    uint32_t inFront = addEntity(transformSet, meshSet, renderableSet, 2, glm::vec3(0.0f, 0.0f, -5.0f), glm::vec3(1.0f));
+    uint32_t beside = addEntity(transformSet, meshSet, renderableSet, 3, glm::vec3(20.0f, 0.0f, -30.0f), glm::vec3(2.0f));
+    uint32_t peeking = addEntity(transformSet, meshSet, renderableSet, 4, glm::vec3(12.0f, 0.0f, -30.0f), glm::vec3(6.0f));
+
+    static OccluderRasterizer rasterizer;
+    startOccluderRasterizer(rasterizer);
+    kickOccluderRasterization(rasterizer, occluderSet, transformSet, meshSet, meshBuffer, viewProjection);
+    // The sets can change while the worker runs, it only reads its own copy.
+    transformSet.getComponent(wall).position.z = -100.0f;
+    const SoftwareDepthBuffer& depth = waitOccluderRasterization(rasterizer);
+    CHECK(rasterizer.occluders.size == 1);
+
+    // The wall's front face is at z = -9.5 and covers the middle of the buffer, the corners stay at the far plane.
+    glm::vec4 clip = viewProjection * glm::vec4(0.0f, 0.0f, -9.5f, 1.0f);
+    float wallDepth = clip.z / clip.w * 0.5f + 0.5f;
+    float center = depth.depth[(SOFTWARE_DEPTH_HEIGHT / 2) * SOFTWARE_DEPTH_WIDTH + SOFTWARE_DEPTH_WIDTH / 2];
+    CHECK(std::abs(center - wallDepth) < 1e-4f);
+    CHECK(depth.depth[0] == 1.0f);
+
+    static WorldBoundsBuffer worldBounds;
+    static VisibleEntityBuffer visible;
+    transformSet.getComponent(wall).position.z = -10.0f;
+    updateWorldBounds(renderableSet, transformSet, meshSet, worldBounds);
+    visible.size = 0;
+    for (uint32_t entity = 0; entity < renderableSet.entityCount; ++entity) visible.buffer[visible.size++] = entity;
+
+    uint32_t occludedCount = 0;
+    performSoftwareOcclusionCulling(depth, worldBounds, renderableSet, occluderSet, viewProjection, visible, occludedCount);
+    CHECK(occludedCount == 1);
+    CHECK(contains(visible, wall));
+    CHECK(!contains(visible, behind));
+    CHECK(contains(visible, inFront));
+    CHECK(contains(visible, beside));
+    CHECK(contains(visible, peeking));
+
+    // A second kick reuses the same worker.
+    kickOccluderRasterization(rasterizer, occluderSet, transformSet, meshSet, meshBuffer, viewProjection);
+    CHECK(std::abs(waitOccluderRasterization(rasterizer).depth[(SOFTWARE_DEPTH_HEIGHT / 2) * SOFTWARE_DEPTH_WIDTH + SOFTWARE_DEPTH_WIDTH / 2] -
+                   wallDepth) < 1e-4f);
+
+    // The wall as a flat triangle covering its lower left half, from (-4, -4) to (4, -4) and (-4, 4).
+    MeshData& wallMesh = meshSet.getComponent(wall);
+    wallMesh.handle = TRIANGLE_MESH;
+    wallMesh.localAABB = AABB{-0.5f, -0.5f, 0.0f, 0.5f, 0.5f, 0.0f};
+    uint32_t behindSolid = addEntity(transformSet, meshSet, renderableSet, 5, glm::vec3(-4.0f, -4.0f, -30.0f), glm::vec3(1.0f));
+    uint32_t behindEmpty = addEntity(transformSet, meshSet, renderableSet, 6, glm::vec3(4.0f, 4.0f, -30.0f), glm::vec3(1.0f));
+    kickOccluderRasterization(rasterizer, occluderSet, transformSet, meshSet, meshBuffer, viewProjection);
+    const SoftwareDepthBuffer& triangleDepth = waitOccluderRasterization(rasterizer);
+    updateWorldBounds(renderableSet, transformSet, meshSet, worldBounds);
+    visible.size = 0;
+    for (uint32_t entity = 0; entity < renderableSet.entityCount; ++entity) visible.buffer[visible.size++] = entity;
+
+    uint32_t triangleOccludedCount = 0;
+    performSoftwareOcclusionCulling(triangleDepth, worldBounds, renderableSet, occluderSet, viewProjection, visible, triangleOccludedCount);
+    CHECK(!contains(visible, behindSolid));
+    CHECK(contains(visible, behindEmpty));
+    CHECK(contains(visible, beside));
+    stopOccluderRasterizer(rasterizer);
+
+    printf("%u of 5 entities hidden behind the wall, %u of 7 behind the triangle\n", occludedCount, triangleOccludedCount);
+    free(arena.base);
+    return testResult();
+}
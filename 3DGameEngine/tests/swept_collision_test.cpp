@@ -0,0 +1,98 @@
+#include "test_common.h"
+#include "test_scene.h"
+#include "collision_system.h"
+
+// Something fast enough to end a tick past thin walls without overlapping any of them where it ended up. The sweep
+// has to report the first wall at its time of impact and none behind it, and the solver has to stop the mover there.
+// A bullet on the same path hits and damages only the first wall.
+
+static constexpr float DELTA_TIME = 1.0f / 60.0f;
+static constexpr float SPEED = 600.0f; // 10 units a tick.
+
+static uint32_t addBox(ECS& scene, glm::vec3 position, glm::vec3 halfSize) {
+    uint32_t entity = createEntity(scene);
+    TransformComponent transform;
+    transform.position = position;
+    scene.transformSet.add(entity, transform);
+    scene.collisionSet.add(entity, CollisionComponent{-halfSize.x, halfSize.x, -halfSize.y, halfSize.y, -halfSize.z, halfSize.z});
+    return entity;
+}
+
+// A 0.2 unit box at the origin moving along x, as movementSystem leaves it at the end of the tick.
+static uint32_t addMover(ECS& scene) {
+    uint32_t mover = addBox(scene, glm::vec3(SPEED * DELTA_TIME, 0.0f, 0.0f), glm::vec3(0.1f));
+    scene.dynamicSet.add(mover, DynamicTag{});
+    scene.velocitySet.add(mover, VelocityComponent{glm::vec3(SPEED, 0.0f, 0.0f)});
+    return mover;
+}
+
+static void removeEntity(ECS& scene, uint32_t entity) {
+    scene.transformSet.remove(entity);
+    scene.collisionSet.remove(entity);
+    scene.dynamicSet.remove(entity);
+    scene.velocitySet.remove(entity);
+    scene.bulletSet.remove(entity);
+}
+
+static void narrowphase(ECS& scene) {
+    collisionSystem(scene.collisionSet, scene.transformSet, scene.dynamicSet, scene.velocitySet, DELTA_TIME, scene.bodySleep,
+                    scene.contacts);
+}
+
+int main() {
+    static ECS scene;
+    initSceneSets(scene);
+    subscribeGameplayEvents(scene.gameEvents);
+    // Walls 0.1 thick at x = 2, 3 and 4, one further wall tested before the near one and one after it.
+    uint32_t farWall = addBox(scene, glm::vec3(3.0f, 0.0f, 0.0f), glm::vec3(0.05f, 2.0f, 2.0f));
+    uint32_t nearWall = addBox(scene, glm::vec3(2.0f, 0.0f, 0.0f), glm::vec3(0.05f, 2.0f, 2.0f));
+    addBox(scene, glm::vec3(4.0f, 0.0f, 0.0f), glm::vec3(0.05f, 2.0f, 2.0f));
+    scene.healthSet.add(farWall, HealthComponent{3});
+    scene.healthSet.add(nearWall, HealthComponent{3});
+
+    // Touches the near wall when its front face reaches x = 1.95, the centre at 1.85, 0.185 of the way along.
+    uint32_t mover = addMover(scene);
+    narrowphase(scene);
+    CHECK(scene.contacts.count == 1);
+    const Contact& hit = scene.contacts.contacts[0];
+    CHECK(hit.entity == mover && hit.other == nearWall);
+    CHECK(hit.normal == glm::vec3(-1.0f, 0.0f, 0.0f));
+    CHECK(std::abs(hit.depth - (SPEED * DELTA_TIME - 1.85f)) < 1e-3f);
+
+    // Solved, it stands at the near wall without moving on into it.
+    solveContacts(scene.contacts, scene.dynamicSet, scene.bulletSet, scene.transformSet, scene.velocitySet, scene.bodySleep);
+    float x = scene.transformSet.getComponent(mover).position.x;
+    CHECK(x > 1.85f - 1e-3f && x < 1.85f + CONTACT_SLOP + 1e-3f);
+    CHECK(scene.velocitySet.getComponent(mover).velocity.x <= 1e-3f);
+    removeEntity(scene, mover);
+    resetContactPairs(scene.contacts);
+
+    // Two walls side by side at the same x are hit at the same time, both are reported.
+    uint32_t seamWall = addBox(scene, glm::vec3(2.0f, 0.0f, 4.0f), glm::vec3(0.05f, 2.0f, 2.0f));
+    mover = addMover(scene);
+    scene.transformSet.getComponent(mover).position.z = 2.0f;
+    narrowphase(scene);
+    CHECK(scene.contacts.count == 2);
+    for (uint32_t i = 0; i < scene.contacts.count; ++i) {
+        const Contact& contact = scene.contacts.contacts[i];
+        CHECK(contact.other == nearWall || contact.other == seamWall);
+    }
+    removeEntity(scene, mover);
+    removeEntity(scene, seamWall);
+    resetContactPairs(scene.contacts);
+
+    // A bullet on the same path is deleted at the near wall and only damages that one.
+    uint32_t bullet = addMover(scene);
+    scene.bulletSet.add(bullet, BulletTag{});
+    narrowphase(scene);
+    solveContacts(scene.contacts, scene.dynamicSet, scene.bulletSet, scene.transformSet, scene.velocitySet, scene.bodySleep);
+    bulletHitSystem(scene.contacts, scene.bulletSet, scene.healthSet, scene.deleteBuffer, scene.gameEvents);
+    CHECK(scene.deleteBuffer.size == 1 && scene.deleteBuffer.buffer[0] == bullet);
+    dispatchEvents(scene.gameEvents, &scene);
+    CHECK(scene.healthSet.getComponent(nearWall).health == 2);
+    CHECK(scene.healthSet.getComponent(farWall).health == 3);
+
+    freeContactStream(scene.contacts);
+    free(scene.arena.base);
+    return testResult();
+}
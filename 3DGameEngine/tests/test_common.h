@@ -0,0 +1,39 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Every test is its own executable, a failed CHECK is reported and the exit code says whether any failed.
+
+static int testFailures = 0;
+
+#define CHECK(condition)                                                                  \
+    do {                                                                                  \
+        if (!(condition)) {                                                               \
+            printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition);          \
+            ++testFailures;                                                               \
+        }                                                                                 \
+    } while (0)
+
+static int testResult() {
+    if (testFailures > 0) printf("%d checks failed\n", testFailures);
+    return testFailures > 0 ? 1 : 0;
+}
+
+// xorshift, so generated scenes come out the same on every platform and run.
+struct TestRandom {
+    uint32_t state = 2463534242u;
+
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    float range(float min, float max) { return min + (max - min) * (float)(next() >> 8) * (1.0f / 16777216.0f); }
+};
+
+inline double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "scene_sets.h"
+
+// Same sets and capacities as the engine's scene.
+inline void initSceneSets(ECS& scene) {
+    scene.arena.init(ARENA_SIZE);
+    scene.transformSet.init(scene.arena, CAPACITY_TRANSFORM);
+    scene.meshSet.init(scene.arena, CAPACITY_MESH);
+    scene.materialSet.init(scene.arena, CAPACITY_MATERIAL);
+    scene.inputWorldSet.init(scene.arena, CAPACITY_INPUT_WORLD);
+    scene.inputTankSet.init(scene.arena, CAPACITY_INPUT_TANK);
+    scene.inputNoClipSet.init(scene.arena, CAPACITY_INPUT_NOCLIP);
+    scene.velocitySet.init(scene.arena, CAPACITY_VELOCITY);
+    scene.speedSet.init(scene.arena, CAPACITY_SPEED);
+    scene.rotationSpeedSet.init(scene.arena, CAPACITY_ROT_SPEED);
+    scene.patrolSet.init(scene.arena, CAPACITY_PATROL);
+    scene.collisionSet.init(scene.arena, CAPACITY_COLLISION);
+    scene.renderableSet.init(scene.arena, CAPACITY_RENDERABLE);
+    scene.cameraSet.init(scene.arena, CAPACITY_CAMERA);
+    scene.pointLightSet.init(scene.arena, CAPACITY_POINT_LIGHT);
+    scene.bulletSet.init(scene.arena, CAPACITY_BULLET);
+    scene.dynamicSet.init(scene.arena, CAPACITY_DYNAMIC);
+    scene.healthSet.init(scene.arena, CAPACITY_HEALTH);
+    scene.inputMapSet.init(scene.arena, CAPACITY_INPUT_MAP);
+    scene.nameSet.init(scene.arena, CAPACITY_NAME);
+    scene.occluderSet.init(scene.arena, CAPACITY_OCCLUDER);
+}
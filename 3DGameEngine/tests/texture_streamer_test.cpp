@@ -0,0 +1,62 @@
+#include "test_common.h"
+#include "texture_streamer.h"
+
+// Which levels a rebuild uploads and which it copies from the texture it replaces, through a texture's whole life:
+// registered with only its small mips, promoted to full detail, evicted back down and promoted part of the way again.
+
+static constexpr uint32_t MIP_COUNT = 11; // 1024 x 1024.
+static constexpr uint32_t BASE_MIP = 4;   // 64 x 64, STREAMING_BASE_MIP_SIZE.
+
+struct RebuildCheck {
+    uint32_t uploaded = 0;
+    uint32_t copied = 0;
+    bool valid = true;
+};
+
+// Walks the levels of the new texture like rebuildStreamedTexture, every one must come from exactly one place.
+static RebuildCheck checkRebuild(uint32_t mip, uint32_t& residentMip, bool& hasTexture) {
+    RebuildCheck check;
+    uint32_t copyFrom = firstCopiedMip(mip, residentMip, MIP_COUNT, hasTexture);
+    check.valid = copyFrom >= mip && copyFrom <= MIP_COUNT;
+    for (uint32_t level = mip; level < copyFrom; ++level) ++check.uploaded;
+    for (uint32_t level = copyFrom; level < MIP_COUNT; ++level) {
+        // The old texture has to exist and hold the level, its own level 0 being residentMip.
+        check.valid = check.valid && hasTexture && level >= residentMip && level - residentMip < MIP_COUNT - residentMip;
+        ++check.copied;
+    }
+    check.valid = check.valid && check.uploaded + check.copied == MIP_COUNT - mip;
+    residentMip = mip;
+    hasTexture = true;
+    return check;
+}
+
+int main() {
+    uint32_t residentMip = 0;
+    bool hasTexture = false;
+
+    // Registration: nothing to copy from, the base mips all come from the file.
+    RebuildCheck registered = checkRebuild(BASE_MIP, residentMip, hasTexture);
+    CHECK(registered.valid);
+    CHECK(registered.uploaded == MIP_COUNT - BASE_MIP && registered.copied == 0);
+
+    // Promotion: only the new finer levels are read from the file, the rest is already on the GPU.
+    RebuildCheck promoted = checkRebuild(0, residentMip, hasTexture);
+    CHECK(promoted.valid);
+    CHECK(promoted.uploaded == BASE_MIP && promoted.copied == MIP_COUNT - BASE_MIP);
+
+    // Eviction: nothing is read, the coarser levels are copied out of the old texture.
+    RebuildCheck evicted = checkRebuild(2, residentMip, hasTexture);
+    CHECK(evicted.valid);
+    CHECK(evicted.uploaded == 0 && evicted.copied == MIP_COUNT - 2);
+
+    RebuildCheck repromoted = checkRebuild(1, residentMip, hasTexture);
+    CHECK(repromoted.valid);
+    CHECK(repromoted.uploaded == 1 && repromoted.copied == MIP_COUNT - 2);
+
+    // Evicting all the way back to the base mips.
+    RebuildCheck dropped = checkRebuild(BASE_MIP, residentMip, hasTexture);
+    CHECK(dropped.valid);
+    CHECK(dropped.uploaded == 0 && dropped.copied == MIP_COUNT - BASE_MIP);
+
+    return testResult();
+}
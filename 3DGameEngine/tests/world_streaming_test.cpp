@@ -0,0 +1,85 @@
+#include "test_common.h"
+#include "test_scene.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+// The editor's Stream World button over and over: close the world, clear the static entities, stream them back in.
+// The cleared IDs have to be reused, so the scene's entity count stays where it was however often that happens.
+
+static constexpr const char* WORLD_PATH = "world_streaming_test.world";
+static constexpr uint32_t STATIC_COUNT = 300;
+static constexpr float CELL_SIZE = 10.0f;
+static constexpr uint32_t CYCLE_COUNT = 4;
+
+static bool streamEverything(WorldStreamer& streamer, ECS& scene) {
+    for (uint32_t frame = 0; frame < 2000; ++frame) {
+        updateWorldStreaming(streamer, scene, glm::vec3(20.0f, 0.0f, 20.0f));
+        bool resident = streamer.residentCells == streamer.header.cellCount;
+        for (const CellSlot& slot : streamer.slots) resident = resident && (slot.state == CellState::Unloaded || slot.state == CellState::Resident);
+        if (resident) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+int main() {
+    static ECS scene;
+    initSceneSets(scene);
+    MeshData cube = {};
+    cube.localAABB = AABB{-0.5f, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f};
+    scene.meshBuffer.buffer[scene.meshBuffer.size++] = cube;
+
+    // A camera first, then the static level, then a player created after it.
+    scene.cameraSet.add(createEntity(scene), CameraComponent{});
+    TestRandom random;
+    for (uint32_t i = 0; i < STATIC_COUNT; ++i) {
+        uint32_t entity = createEntity(scene);
+        TransformComponent transform;
+        transform.position = glm::vec3(random.range(0.0f, 40.0f), 0.0f, random.range(0.0f, 40.0f));
+        scene.transformSet.add(entity, transform);
+        scene.meshSet.add(entity, cube);
+        scene.renderableSet.add(entity, RenderableTag{});
+    }
+    uint32_t player = createEntity(scene);
+    scene.transformSet.add(player, TransformComponent{});
+    scene.inputWorldSet.add(player, PlayerInputWorldTag{});
+    const uint32_t sceneEntities = scene.entityCount;
+    CHECK(sceneEntities == STATIC_COUNT + 2);
+    CHECK(saveWorld(scene, WORLD_PATH, CELL_SIZE));
+
+    static WorldStreamer streamer;
+    streamer.loadRadius = 8;
+    streamer.unloadRadius = 9;
+    for (uint32_t cycle = 0; cycle < CYCLE_COUNT; ++cycle) {
+        closeWorld(streamer, scene);
+        clearWorldEntities(scene);
+        // The player keeps the highest ID, the cleared ones below it are left for the streamer.
+        CHECK(scene.entityCount == sceneEntities);
+        CHECK(scene.transformSet.entityCount == 1);
+
+        CHECK(openWorld(streamer, scene, WORLD_PATH, 4096));
+        CHECK(streamer.entityCapacity == 4096);
+        CHECK(streamer.blockSize == 4096 - STATIC_COUNT);
+        CHECK(streamEverything(streamer, scene));
+        CHECK(scene.transformSet.entityCount == STATIC_COUNT + 1);
+
+        // Every streamed entity got one of the cleared IDs back, none came out of the block.
+        uint32_t highestStreamed = 0;
+        for (const CellSlot& slot : streamer.slots) {
+            for (uint32_t entity : slot.entities) highestStreamed = std::max(highestStreamed, entity);
+        }
+        CHECK(highestStreamed < player);
+    }
+
+    // Closing hands the block back and leaves the player.
+    closeWorld(streamer, scene);
+    CHECK(scene.entityCount == sceneEntities);
+    CHECK(scene.transformSet.entityCount == 1);
+    CHECK(scene.transformSet.hasComponent(player));
+
+    remove(WORLD_PATH);
+    free(scene.arena.base);
+    printf("%u stream cycles, entity count stayed at %u\n", CYCLE_COUNT, scene.entityCount);
+    return testResult();
+}
@@ -0,0 +1,99 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <filesystem>
+#include "asset_pack_format.h"
+
+struct PackInput {
+    std::string name;
+    std::filesystem::path path;
+    AssetPackEntry entry;
+};
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        printf("Usage: asset_packer resource_dir [more_dirs...] output.pack\n");
+        return 1;
+    }
+
+    // Names are relative to whichever directory a file came from, so every directory maps onto the same namespace.
+    std::vector<PackInput> inputs;
+    for (int arg = 1; arg < argc - 1; ++arg) {
+        std::filesystem::path root = argv[arg];
+        std::error_code error;
+        for (const auto& item : std::filesystem::recursive_directory_iterator(root, error)) {
+            if (!item.is_regular_file()) continue;
+            PackInput input;
+            input.name = std::filesystem::relative(item.path(), root).generic_string();
+            input.path = item.path();
+            input.entry.nameHash = hashAssetName(input.name.c_str());
+            input.entry.size = (uint64_t)item.file_size();
+            inputs.push_back(input);
+        }
+        if (error) {
+            printf("Failed to read %s: %s\n", argv[arg], error.message().c_str());
+            return 1;
+        }
+    }
+    const char* outputPath = argv[argc - 1];
+
+    std::sort(inputs.begin(), inputs.end(), [](const PackInput& a, const PackInput& b) { return a.entry.nameHash < b.entry.nameHash; });
+    for (size_t i = 1; i < inputs.size(); ++i) {
+        if (inputs[i].entry.nameHash == inputs[i - 1].entry.nameHash) {
+            printf("Name hash collision: %s and %s\n", inputs[i - 1].name.c_str(), inputs[i].name.c_str());
+            return 1;
+        }
+    }
+
+    AssetPackHeader header = {};
+    header.magic = ASSET_PACK_MAGIC;
+    header.version = ASSET_PACK_VERSION;
+    header.entryCount = (uint32_t)inputs.size();
+    header.alignment = ASSET_PACK_ALIGNMENT;
+    header.tocOffset = sizeof(AssetPackHeader);
+
+    uint64_t offset = alignUp(header.tocOffset + inputs.size() * sizeof(AssetPackEntry), ASSET_PACK_ALIGNMENT);
+    for (PackInput& input : inputs) {
+        input.entry.offset = offset;
+        offset = alignUp(offset + input.entry.size, ASSET_PACK_ALIGNMENT);
+    }
+
+    FILE* out = fopen(outputPath, "wb");
+    if (!out) {
+        printf("Failed to open %s for writing\n", outputPath);
+        return 1;
+    }
+    fwrite(&header, sizeof(AssetPackHeader), 1, out);
+    for (const PackInput& input : inputs) fwrite(&input.entry, sizeof(AssetPackEntry), 1, out);
+
+    const char padding[ASSET_PACK_ALIGNMENT] = {};
+    std::vector<char> data;
+    for (const PackInput& input : inputs) {
+        long position = ftell(out);
+        fwrite(padding, 1, (size_t)(input.entry.offset - (uint64_t)position), out);
+
+        data.resize((size_t)input.entry.size);
+        FILE* in = fopen(input.path.string().c_str(), "rb");
+        if (!in || fread(data.data(), 1, data.size(), in) != data.size()) {
+            printf("Failed to read %s\n", input.name.c_str());
+            if (in) fclose(in);
+            fclose(out);
+            return 1;
+        }
+        fclose(in);
+        fwrite(data.data(), 1, data.size(), out);
+        printf("  %-32s %10llu bytes at %llu\n", input.name.c_str(), (unsigned long long)input.entry.size,
+               (unsigned long long)input.entry.offset);
+    }
+    fclose(out);
+
+    printf("Packed %u assets into %s\n", header.entryCount, outputPath);
+    return 0;
+}
@@ -0,0 +1,463 @@
+#include "bc_encoder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Principal axis of the block's colours by power iteration, endpoints are the extreme projections onto it.
+template <int Channels>
+static void fitEndpoints(const float (&texels)[16][4], float (&low)[4], float (&high)[4]) {
+    float mean[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < Channels; ++c) mean[c] += texels[i][c] / 16.0f;
+    }
+
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; ++i) {
+        for (int a = 0; a < Channels; ++a) {
+            for (int b = 0; b < Channels; ++b) {
+                covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+            }
+        }
+    }
+
+    float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        float next[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        float length = 0.0f;
+        for (int a = 0; a < Channels; ++a) {
+            for (int b = 0; b < Channels; ++b) next[a] += covariance[a][b] * axis[b];
+            length = std::max(length, std::abs(next[a]));
+        }
+        if (length <= 0.0f) break;
+        for (int a = 0; a < Channels; ++a) axis[a] = next[a] / length;
+    }
+
+    float minProjection = INFINITY;
+    float maxProjection = -INFINITY;
+    for (int i = 0; i < 16; ++i) {
+        float projection = 0.0f;
+        for (int c = 0; c < Channels; ++c) projection += (texels[i][c] - mean[c]) * axis[c];
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+
+    float axisLengthSq = 0.0f;
+    for (int c = 0; c < Channels; ++c) axisLengthSq += axis[c] * axis[c];
+    if (axisLengthSq <= 0.0f) axisLengthSq = 1.0f;
+    for (int c = 0; c < Channels; ++c) {
+        low[c] = std::clamp(mean[c] + axis[c] * minProjection / axisLengthSq, 0.0f, 255.0f);
+        high[c] = std::clamp(mean[c] + axis[c] * maxProjection / axisLengthSq, 0.0f, 255.0f);
+    }
+}
+
+static void loadTexels(const uint8_t* rgba, float (&texels)[16][4]) {
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 4; ++c) texels[i][c] = (float)rgba[i * 4 + c];
+    }
+}
+
+static uint16_t packRGB565(const float* colour) {
+    uint32_t r = (uint32_t)std::lround(colour[0] * 31.0f / 255.0f);
+    uint32_t g = (uint32_t)std::lround(colour[1] * 63.0f / 255.0f);
+    uint32_t b = (uint32_t)std::lround(colour[2] * 31.0f / 255.0f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpackRGB565(uint16_t packed, int* colour) {
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    colour[0] = (r << 3) | (r >> 2);
+    colour[1] = (g << 2) | (g >> 4);
+    colour[2] = (b << 3) | (b >> 2);
+}
+
+static void writeUint16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)(value & 0xFF);
+    out[1] = (uint8_t)(value >> 8);
+}
+
+static uint16_t readUint16(const uint8_t* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+void encodeBC1Block(const uint8_t* rgba, uint8_t* block) {
+    float texels[16][4];
+    loadTexels(rgba, texels);
+    float low[4], high[4];
+    fitEndpoints<3>(texels, low, high);
+
+    uint16_t colour0 = packRGB565(high);
+    uint16_t colour1 = packRGB565(low);
+    // colour0 > colour1 selects the four colour mode, the three colour mode would spend an index on transparency.
+    if (colour0 < colour1) std::swap(colour0, colour1);
+    writeUint16(block, colour0);
+    writeUint16(block + 2, colour1);
+
+    uint32_t indices = 0;
+    if (colour0 != colour1) {
+        int palette[4][3];
+        unpackRGB565(colour0, palette[0]);
+        unpackRGB565(colour1, palette[1]);
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; ++i) {
+            int best = 0;
+            float bestError = INFINITY;
+            for (int p = 0; p < 4; ++p) {
+                float error = 0.0f;
+                for (int c = 0; c < 3; ++c) {
+                    float d = texels[i][c] - (float)palette[p][c];
+                    error += d * d;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (i * 2);
+        }
+    }
+    memcpy(block + 4, &indices, sizeof(indices));
+}
+
+static void decodeColourBlock(const uint8_t* block, uint8_t* rgba, bool forceFourColour) {
+    uint16_t colour0 = readUint16(block);
+    uint16_t colour1 = readUint16(block + 2);
+    int palette[4][4];
+    unpackRGB565(colour0, palette[0]);
+    unpackRGB565(colour1, palette[1]);
+    palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+    if (colour0 > colour1 || forceFourColour) {
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+    } else {
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+        palette[3][3] = 0;
+    }
+
+    uint32_t indices;
+    memcpy(&indices, block + 4, sizeof(indices));
+    for (int i = 0; i < 16; ++i) {
+        int index = (indices >> (i * 2)) & 3;
+        for (int c = 0; c < 4; ++c) rgba[i * 4 + c] = (uint8_t)palette[index][c];
+    }
+}
+
+void decodeBC1Block(const uint8_t* block, uint8_t* rgba) {
+    decodeColourBlock(block, rgba, false);
+}
+
+// Single channel block used for BC3 alpha and both BC5 channels.
+static void encodeBC4Block(const uint8_t* rgba, int channel, uint8_t* block) {
+    int minValue = 255;
+    int maxValue = 0;
+    for (int i = 0; i < 16; ++i) {
+        minValue = std::min(minValue, (int)rgba[i * 4 + channel]);
+        maxValue = std::max(maxValue, (int)rgba[i * 4 + channel]);
+    }
+
+    // value0 > value1 selects eight interpolated values.
+    block[0] = (uint8_t)maxValue;
+    block[1] = (uint8_t)minValue;
+    uint64_t indices = 0;
+    if (maxValue != minValue) {
+        int palette[8];
+        palette[0] = maxValue;
+        palette[1] = minValue;
+        for (int p = 2; p < 8; ++p) palette[p] = ((8 - p) * maxValue + (p - 1) * minValue) / 7;
+        for (int i = 0; i < 16; ++i) {
+            int value = rgba[i * 4 + channel];
+            int best = 0;
+            for (int p = 1; p < 8; ++p) {
+                if (std::abs(palette[p] - value) < std::abs(palette[best] - value)) best = p;
+            }
+            indices |= (uint64_t)best << (i * 3);
+        }
+    }
+    for (int b = 0; b < 6; ++b) block[2 + b] = (uint8_t)(indices >> (b * 8));
+}
+
+static void decodeBC4Block(const uint8_t* block, int channel, uint8_t* rgba) {
+    int palette[8];
+    palette[0] = block[0];
+    palette[1] = block[1];
+    if (palette[0] > palette[1]) {
+        for (int p = 2; p < 8; ++p) palette[p] = ((8 - p) * palette[0] + (p - 1) * palette[1]) / 7;
+    } else {
+        for (int p = 2; p < 6; ++p) palette[p] = ((6 - p) * palette[0] + (p - 1) * palette[1]) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64_t indices = 0;
+    for (int b = 0; b < 6; ++b) indices |= (uint64_t)block[2 + b] << (b * 8);
+    for (int i = 0; i < 16; ++i) rgba[i * 4 + channel] = (uint8_t)palette[(indices >> (i * 3)) & 7];
+}
+
+void encodeBC3Block(const uint8_t* rgba, uint8_t* block) {
+    encodeBC4Block(rgba, 3, block);
+    encodeBC1Block(rgba, block + 8);
+}
+
+void decodeBC3Block(const uint8_t* block, uint8_t* rgba) {
+    decodeColourBlock(block + 8, rgba, true);
+    decodeBC4Block(block, 3, rgba);
+}
+
+void encodeBC5Block(const uint8_t* rgba, uint8_t* block) {
+    encodeBC4Block(rgba, 0, block);
+    encodeBC4Block(rgba, 1, block + 8);
+}
+
+void decodeBC5Block(const uint8_t* block, uint8_t* rgba) {
+    for (int i = 0; i < 16; ++i) {
+        rgba[i * 4 + 2] = 0;
+        rgba[i * 4 + 3] = 255;
+    }
+    decodeBC4Block(block, 0, rgba);
+    decodeBC4Block(block + 8, 1, rgba);
+}
+
+static constexpr int BC7_WEIGHTS4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+struct BitWriter {
+    uint8_t* data;
+    uint32_t position = 0;
+
+    void write(uint32_t value, uint32_t count) {
+        for (uint32_t i = 0; i < count; ++i, ++position) {
+            if ((value >> i) & 1) data[position >> 3] |= (uint8_t)(1 << (position & 7));
+        }
+    }
+};
+
+struct BitReader {
+    const uint8_t* data;
+    uint32_t position = 0;
+
+    uint32_t read(uint32_t count) {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < count; ++i, ++position) {
+            value |= (uint32_t)((data[position >> 3] >> (position & 7)) & 1) << i;
+        }
+        return value;
+    }
+};
+
+// Mode 6 endpoints are 7 bits per channel plus one p-bit shared by the channels of that endpoint.
+static void quantizeBC7Endpoint(const float* endpoint, uint32_t* quantized, uint32_t& pBit) {
+    float bestError = INFINITY;
+    for (uint32_t p = 0; p < 2; ++p) {
+        uint32_t candidate[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; ++c) {
+            candidate[c] = (uint32_t)std::clamp((int)std::lround((endpoint[c] - (float)p) * 0.5f), 0, 127);
+            float d = (float)((candidate[c] << 1) | p) - endpoint[c];
+            error += d * d;
+        }
+        if (error < bestError) {
+            bestError = error;
+            pBit = p;
+            memcpy(quantized, candidate, sizeof(candidate));
+        }
+    }
+}
+
+struct BC7Mode6 {
+    uint32_t endpoints[2][4];
+    uint32_t pBits[2];
+    uint8_t indices[16];
+    float error;
+};
+
+static void assignBC7Indices(const float (&texels)[16][4], BC7Mode6& mode) {
+    int colours[2][4];
+    for (int e = 0; e < 2; ++e) {
+        for (int c = 0; c < 4; ++c) colours[e][c] = (int)((mode.endpoints[e][c] << 1) | mode.pBits[e]);
+    }
+    float palette[16][4];
+    for (int p = 0; p < 16; ++p) {
+        for (int c = 0; c < 4; ++c) {
+            palette[p][c] = (float)(((64 - BC7_WEIGHTS4[p]) * colours[0][c] + BC7_WEIGHTS4[p] * colours[1][c] + 32) >> 6);
+        }
+    }
+
+    mode.error = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        float bestError = INFINITY;
+        for (int p = 0; p < 16; ++p) {
+            float error = 0.0f;
+            for (int c = 0; c < 4; ++c) {
+                float d = texels[i][c] - palette[p][c];
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                mode.indices[i] = (uint8_t)p;
+            }
+        }
+        mode.error += bestError;
+    }
+}
+
+static void quantizeBC7Endpoints(const float* low, const float* high, BC7Mode6& mode) {
+    quantizeBC7Endpoint(low, mode.endpoints[0], mode.pBits[0]);
+    quantizeBC7Endpoint(high, mode.endpoints[1], mode.pBits[1]);
+}
+
+void encodeBC7Block(const uint8_t* rgba, uint8_t* block) {
+    float texels[16][4];
+    loadTexels(rgba, texels);
+    float low[4], high[4];
+    fitEndpoints<4>(texels, low, high);
+
+    BC7Mode6 mode;
+    quantizeBC7Endpoints(low, high, mode);
+    assignBC7Indices(texels, mode);
+
+    // One least squares pass: with the indices fixed, solve for the endpoints that minimise the error.
+    float a = 0.0f, b = 0.0f, c = 0.0f;
+    float rhsLow[4] = {}, rhsHigh[4] = {};
+    for (int i = 0; i < 16; ++i) {
+        float t = (float)BC7_WEIGHTS4[mode.indices[i]] / 64.0f;
+        a += (1.0f - t) * (1.0f - t);
+        b += (1.0f - t) * t;
+        c += t * t;
+        for (int ch = 0; ch < 4; ++ch) {
+            rhsLow[ch] += (1.0f - t) * texels[i][ch];
+            rhsHigh[ch] += t * texels[i][ch];
+        }
+    }
+    float determinant = a * c - b * b;
+    if (std::abs(determinant) > 1e-6f) {
+        float refinedLow[4], refinedHigh[4];
+        for (int ch = 0; ch < 4; ++ch) {
+            refinedLow[ch] = std::clamp((c * rhsLow[ch] - b * rhsHigh[ch]) / determinant, 0.0f, 255.0f);
+            refinedHigh[ch] = std::clamp((a * rhsHigh[ch] - b * rhsLow[ch]) / determinant, 0.0f, 255.0f);
+        }
+        BC7Mode6 refined;
+        quantizeBC7Endpoints(refinedLow, refinedHigh, refined);
+        assignBC7Indices(texels, refined);
+        if (refined.error < mode.error) mode = refined;
+    }
+
+    // The first index is stored with its top bit implied zero, swap the endpoints if it's set.
+    if (mode.indices[0] & 8) {
+        std::swap(mode.endpoints[0], mode.endpoints[1]);
+        std::swap(mode.pBits[0], mode.pBits[1]);
+        for (int i = 0; i < 16; ++i) mode.indices[i] = (uint8_t)(15 - mode.indices[i]);
+    }
+
+    memset(block, 0, 16);
+    BitWriter writer{block};
+    writer.write(1 << 6, 7);
+    for (int ch = 0; ch < 4; ++ch) {
+        writer.write(mode.endpoints[0][ch], 7);
+        writer.write(mode.endpoints[1][ch], 7);
+    }
+    writer.write(mode.pBits[0], 1);
+    writer.write(mode.pBits[1], 1);
+    writer.write(mode.indices[0], 3);
+    for (int i = 1; i < 16; ++i) writer.write(mode.indices[i], 4);
+}
+
+bool decodeBC7Block(const uint8_t* block, uint8_t* rgba) {
+    BitReader reader{block};
+    if (reader.read(7) != (1 << 6)) {
+        for (int i = 0; i < 16; ++i) {
+            rgba[i * 4 + 0] = 255;
+            rgba[i * 4 + 1] = 0;
+            rgba[i * 4 + 2] = 255;
+            rgba[i * 4 + 3] = 255;
+        }
+        return false;
+    }
+
+    uint32_t endpoints[2][4];
+    for (int ch = 0; ch < 4; ++ch) {
+        endpoints[0][ch] = reader.read(7);
+        endpoints[1][ch] = reader.read(7);
+    }
+    uint32_t pBits[2] = {reader.read(1), reader.read(1)};
+    for (int e = 0; e < 2; ++e) {
+        for (int ch = 0; ch < 4; ++ch) endpoints[e][ch] = (endpoints[e][ch] << 1) | pBits[e];
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        uint32_t index = reader.read(i == 0 ? 3 : 4);
+        for (int ch = 0; ch < 4; ++ch) {
+            rgba[i * 4 + ch] = (uint8_t)(((64 - BC7_WEIGHTS4[index]) * endpoints[0][ch] + BC7_WEIGHTS4[index] * endpoints[1][ch] + 32) >> 6);
+        }
+    }
+    return true;
+}
+
+std::vector<uint8_t> compressImage(const uint8_t* rgba, uint32_t width, uint32_t height, TextureFileFormat format) {
+    if (format == TextureFileFormat::RGBA8) return std::vector<uint8_t>(rgba, rgba + width * height * 4);
+
+    std::vector<uint8_t> output(textureMipSize(format, width, height));
+    uint32_t blockBytes = format == TextureFileFormat::BC1 ? 8 : 16;
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+    uint8_t texels[64];
+
+    for (uint32_t by = 0; by < blocksY; ++by) {
+        for (uint32_t bx = 0; bx < blocksX; ++bx) {
+            for (uint32_t y = 0; y < 4; ++y) {
+                for (uint32_t x = 0; x < 4; ++x) {
+                    uint32_t sx = std::min(bx * 4 + x, width - 1);
+                    uint32_t sy = std::min(by * 4 + y, height - 1);
+                    memcpy(&texels[(y * 4 + x) * 4], &rgba[(sy * width + sx) * 4], 4);
+                }
+            }
+
+            uint8_t* block = &output[(by * blocksX + bx) * blockBytes];
+            switch (format) {
+            case TextureFileFormat::BC1: encodeBC1Block(texels, block); break;
+            case TextureFileFormat::BC3: encodeBC3Block(texels, block); break;
+            case TextureFileFormat::BC5: encodeBC5Block(texels, block); break;
+            case TextureFileFormat::BC7: encodeBC7Block(texels, block); break;
+            default: break;
+            }
+        }
+    }
+    return output;
+}
+
+std::vector<uint8_t> decompressImage(const uint8_t* data, uint32_t width, uint32_t height, TextureFileFormat format) {
+    if (format == TextureFileFormat::RGBA8) return std::vector<uint8_t>(data, data + width * height * 4);
+
+    std::vector<uint8_t> output(width * height * 4);
+    uint32_t blockBytes = format == TextureFileFormat::BC1 ? 8 : 16;
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+    uint8_t texels[64];
+
+    for (uint32_t by = 0; by < blocksY; ++by) {
+        for (uint32_t bx = 0; bx < blocksX; ++bx) {
+            const uint8_t* block = &data[(by * blocksX + bx) * blockBytes];
+            switch (format) {
+            case TextureFileFormat::BC1: decodeBC1Block(block, texels); break;
+            case TextureFileFormat::BC3: decodeBC3Block(block, texels); break;
+            case TextureFileFormat::BC5: decodeBC5Block(block, texels); break;
+            case TextureFileFormat::BC7: decodeBC7Block(block, texels); break;
+            default: break;
+            }
+
+            for (uint32_t y = 0; y < 4 && by * 4 + y < height; ++y) {
+                for (uint32_t x = 0; x < 4 && bx * 4 + x < width; ++x) {
+                    memcpy(&output[((by * 4 + y) * width + bx * 4 + x) * 4], &texels[(y * 4 + x) * 4], 4);
+                }
+            }
+        }
+    }
+    return output;
+}
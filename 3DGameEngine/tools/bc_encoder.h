@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "texture_format.h"
+
+// Block compression for texture_cooker. Every encoder takes a 4x4 block of RGBA8 texels in row order (64 bytes).
+// The decoders exist so the cooker can report the error of what it wrote, BC7 only decodes mode 6 since that's
+// the only mode the encoder produces.
+void encodeBC1Block(const uint8_t* rgba, uint8_t* block);
+void encodeBC3Block(const uint8_t* rgba, uint8_t* block);
+void encodeBC5Block(const uint8_t* rgba, uint8_t* block);
+void encodeBC7Block(const uint8_t* rgba, uint8_t* block);
+
+void decodeBC1Block(const uint8_t* block, uint8_t* rgba);
+void decodeBC3Block(const uint8_t* block, uint8_t* rgba);
+void decodeBC5Block(const uint8_t* block, uint8_t* rgba);
+bool decodeBC7Block(const uint8_t* block, uint8_t* rgba);
+
+// Whole images, edges of sizes that aren't a multiple of 4 are padded by clamping.
+std::vector<uint8_t> compressImage(const uint8_t* rgba, uint32_t width, uint32_t height, TextureFileFormat format);
+std::vector<uint8_t> decompressImage(const uint8_t* data, uint32_t width, uint32_t height, TextureFileFormat format);
@@ -0,0 +1,129 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <bit>
+#include "stb_image.h"
+#include "texture_format.h"
+#include "bc_encoder.h"
+
+static bool parseFormat(const char* name, TextureFileFormat& format) {
+    const struct {
+        const char* name;
+        TextureFileFormat format;
+    } formats[] = {{"rgba8", TextureFileFormat::RGBA8}, {"bc1", TextureFileFormat::BC1}, {"bc3", TextureFileFormat::BC3},
+                   {"bc5", TextureFileFormat::BC5}, {"bc7", TextureFileFormat::BC7}};
+    for (const auto& entry : formats) {
+        if (strcmp(name, entry.name) == 0) {
+            format = entry.format;
+            return true;
+        }
+    }
+    return false;
+}
+
+// 2x2 box filter, the last row/column is repeated when a dimension is odd.
+static std::vector<uint8_t> downsample(const std::vector<uint8_t>& source, uint32_t width, uint32_t height) {
+    uint32_t mipWidth = std::max(width / 2, 1u);
+    uint32_t mipHeight = std::max(height / 2, 1u);
+    std::vector<uint8_t> mip(mipWidth * mipHeight * 4);
+    for (uint32_t y = 0; y < mipHeight; ++y) {
+        uint32_t y0 = std::min(y * 2, height - 1);
+        uint32_t y1 = std::min(y * 2 + 1, height - 1);
+        for (uint32_t x = 0; x < mipWidth; ++x) {
+            uint32_t x0 = std::min(x * 2, width - 1);
+            uint32_t x1 = std::min(x * 2 + 1, width - 1);
+            for (uint32_t c = 0; c < 4; ++c) {
+                uint32_t sum = source[(y0 * width + x0) * 4 + c] + source[(y0 * width + x1) * 4 + c] +
+                               source[(y1 * width + x0) * 4 + c] + source[(y1 * width + x1) * 4 + c];
+                mip[(y * mipWidth + x) * 4 + c] = (uint8_t)((sum + 2) / 4);
+            }
+        }
+    }
+    return mip;
+}
+
+static double computePSNR(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, uint32_t channels) {
+    double squaredError = 0.0;
+    size_t samples = 0;
+    for (size_t i = 0; i < a.size(); i += 4) {
+        for (uint32_t c = 0; c < channels; ++c) {
+            double d = (double)a[i + c] - (double)b[i + c];
+            squaredError += d * d;
+            ++samples;
+        }
+    }
+    if (squaredError == 0.0) return INFINITY;
+    return 10.0 * std::log10(255.0 * 255.0 * (double)samples / squaredError);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        printf("Usage: texture_cooker input.png output.ptex [--format rgba8|bc1|bc3|bc5|bc7]\n");
+        return 1;
+    }
+
+    TextureFileFormat format = TextureFileFormat::BC7;
+    for (int i = 3; i < argc; ++i) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            if (!parseFormat(argv[++i], format)) {
+                printf("Unknown format: %s\n", argv[i]);
+                return 1;
+            }
+        }
+    }
+
+    int width, height, componentCount;
+    unsigned char* pixels = stbi_load(argv[1], &width, &height, &componentCount, 4);
+    if (!pixels) {
+        printf("Failed to load %s\n", argv[1]);
+        return 1;
+    }
+
+    TextureFileHeader header = {};
+    header.magic = TEXTURE_FILE_MAGIC;
+    header.version = TEXTURE_FILE_VERSION;
+    header.format = format;
+    header.width = (uint32_t)width;
+    header.height = (uint32_t)height;
+    header.mipCount = std::min((uint32_t)std::bit_width((uint32_t)std::max(width, height)), MAX_TEXTURE_MIPS);
+
+    std::vector<uint8_t> mip(pixels, pixels + (size_t)width * height * 4);
+    stbi_image_free(pixels);
+
+    // BC5 only stores red and green, BC1 drops alpha.
+    uint32_t comparedChannels = format == TextureFileFormat::BC5 ? 2 : (format == TextureFileFormat::BC1 ? 3 : 4);
+    std::vector<uint8_t> data;
+    uint32_t mipWidth = header.width;
+    uint32_t mipHeight = header.height;
+    for (uint32_t level = 0; level < header.mipCount; ++level) {
+        std::vector<uint8_t> encoded = compressImage(mip.data(), mipWidth, mipHeight, format);
+        header.mipOffsets[level] = (uint32_t)(sizeof(TextureFileHeader) + data.size());
+        header.mipSizes[level] = (uint32_t)encoded.size();
+        data.insert(data.end(), encoded.begin(), encoded.end());
+
+        double psnr = computePSNR(mip, decompressImage(encoded.data(), mipWidth, mipHeight, format), comparedChannels);
+        printf("  mip %2u: %4ux%-4u %8zu bytes, PSNR %.2f dB\n", level, mipWidth, mipHeight, encoded.size(), psnr);
+
+        if (level + 1 < header.mipCount) {
+            mip = downsample(mip, mipWidth, mipHeight);
+            mipWidth = std::max(mipWidth / 2, 1u);
+            mipHeight = std::max(mipHeight / 2, 1u);
+        }
+    }
+
+    FILE* out = fopen(argv[2], "wb");
+    if (!out) {
+        printf("Failed to open %s for writing\n", argv[2]);
+        return 1;
+    }
+    fwrite(&header, sizeof(TextureFileHeader), 1, out);
+    fwrite(data.data(), 1, data.size(), out);
+    fclose(out);
+
+    printf("Cooked %s: %ux%u, %u mips, %zu bytes (%zu uncompressed with mips)\n", argv[2], header.width, header.height,
+           header.mipCount, data.size(), (size_t)width * height * 4 * 4 / 3);
+    return 0;
+}